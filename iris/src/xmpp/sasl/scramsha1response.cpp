@@ -67,9 +67,17 @@ SCRAMSHA1Response::SCRAMSHA1Response(const QByteArray &server_first_message, con
     QByteArray password;
 
     // SaltedPassword  := Hi(Normalize(password), salt, i)
-    if (salted_password_base64.size() > 0)
-        salted_password_
-            = QCA::SymmetricKey(QCA::SecureArray(QCA::Base64().stringToArray(salted_password_base64.toUtf8())));
+    // A stored salted password is tagged with the salt and iteration count it was made for,
+    // since the server may change them. Untagged ones come from older versions and are used as is.
+    salt_   = salt;
+    icount_ = icount;
+    if (salted_password_base64.size() > 0) {
+        auto const parts = salted_password_base64.split(QLatin1Char(':'));
+        if (parts.size() == 1)
+            salted_password_ = QCA::SymmetricKey(QCA::SecureArray(QCA::Base64().stringToArray(parts[0])));
+        else if (parts.size() == 3 && parts[0] == icount && parts[1] == salt)
+            salted_password_ = QCA::SymmetricKey(QCA::SecureArray(QCA::Base64().stringToArray(parts[2])));
+    }
     if (salted_password_.size() == 0) {
         if (!StringPrepCache::saslprep(pass_in, 1023, pass_out)) {
             isValid_ = false;
@@ -135,5 +143,9 @@ SCRAMSHA1Response::SCRAMSHA1Response(const QByteArray &server_first_message, con
     value_ = client_final_message.toUtf8();
 }
 
-const QString SCRAMSHA1Response::getSaltedPassword() { return QCA::Base64().arrayToString(salted_password_); }
+// returns the salted password tagged with its iteration count and salt, "i:salt:key"
+const QString SCRAMSHA1Response::getSaltedPassword()
+{
+    return icount_ + QLatin1Char(':') + salt_ + QLatin1Char(':') + QCA::Base64().arrayToString(salted_password_);
+}
 } // namespace XMPP
@@ -43,6 +43,8 @@ private:
     QByteArray        value_;
     QCA::SecureArray  server_signature_;
     QCA::SymmetricKey salted_password_;
+    QString           salt_;
+    QString           icount_;
 };
 } // namespace XMPP
 
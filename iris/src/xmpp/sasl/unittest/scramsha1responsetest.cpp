@@ -50,6 +50,30 @@ private slots:
         }
     }
 
+    void testSaltedPassword_TaggedWithSaltAndIterations()
+    {
+        if (!QCA::isSupported("hmac(sha1)"))
+            QFAIL("hmac(sha1) not supported in QCA.");
+
+        QByteArray        server_first("r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,s=QSXCR+Q6sek8bf92,i=4096");
+        QByteArray        client_first("n,,n=user,r=fyko+d2lbbFgONRv9qkxdawL");
+        SCRAMSHA1Response resp1(server_first, "pencil", client_first, "");
+        QString           stored = resp1.getSaltedPassword();
+        QVERIFY(stored.startsWith("4096:QSXCR+Q6sek8bf92:"));
+
+        // the stored key is enough, with or without the tag
+        SCRAMSHA1Response resp2(server_first, "", client_first, stored);
+        QCOMPARE(resp2.getValue(), resp1.getValue());
+        SCRAMSHA1Response resp3(server_first, "", client_first, stored.section(':', 2));
+        QCOMPARE(resp3.getValue(), resp1.getValue());
+
+        // but not when the server has changed the salt
+        SCRAMSHA1Response resp4("r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,s=c2FsdA==,i=4096", "pencil", client_first,
+                                stored);
+        QVERIFY(resp4.isValid());
+        QVERIFY(resp4.getSaltedPassword().section(':', 2) != stored.section(':', 2));
+    }
+
 private:
     QCA::Initializer initializer;
 };
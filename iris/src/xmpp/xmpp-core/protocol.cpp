@@ -82,14 +82,19 @@ Version::Version(int maj, int min)
 //----------------------------------------------------------------------------
 StreamFeatures::StreamFeatures()
 {
-    tls_supported      = false;
-    sasl_supported     = false;
-    bind_supported     = false;
-    tls_required       = false;
-    compress_supported = false;
-    sm_supported       = false;
-    session_supported  = false;
-    session_required   = false;
+    tls_supported       = false;
+    sasl_supported      = false;
+    bind_supported      = false;
+    tls_required        = false;
+    compress_supported  = false;
+    sm_supported        = false;
+    rosterver_supported = false;
+    csi_supported       = false;
+    session_supported   = false;
+    session_required    = false;
+    sasl2_supported     = false;
+    sasl2_sm_inline     = false;
+    bind2_supported     = false;
 }
 
 //----------------------------------------------------------------------------
@@ -180,6 +185,13 @@ void BasicProtocol::sendStanza(const QDomElement &e)
     sendList += i;
 }
 
+void BasicProtocol::sendStanzaData(const QByteArray &data)
+{
+    SendItem i;
+    i.dataToSend = data;
+    sendList += i;
+}
+
 void BasicProtocol::sendDirect(const QString &s)
 {
     SendItem i;
@@ -235,6 +247,8 @@ void BasicProtocol::setSASLNext(const QByteArray &step) { sasl_step = step; }
 
 void BasicProtocol::setSASLAuthed() { sasl_authed = true; }
 
+bool BasicProtocol::isSASLAuthed() const { return sasl_authed; }
+
 std::optional<BasicProtocol::SASLCond> BasicProtocol::stringToSASLCond(const QString &s)
 {
     for (auto const &entry : saslCondTable) {
@@ -320,6 +334,8 @@ void BasicProtocol::extractStreamError(const QDomElement &e)
 
 void BasicProtocol::send(const QDomElement &e, bool clip) { writeElement(e, TypeElement, false, clip, false); }
 
+void BasicProtocol::send(const QByteArray &data) { writeData(data, TypeElement, false); }
+
 void BasicProtocol::sendUrgent(const QDomElement &e, bool clip) { writeElement(e, TypeElement, false, clip, true); }
 
 void BasicProtocol::sendStreamError(StreamCond cond, const QString &text, const QDomElement &appSpec)
@@ -528,6 +544,10 @@ bool BasicProtocol::doStep(const QDomElement &e)
                 ++stanzasPending;
                 writeElement(i.stanzaToSend, TypeStanza, true);
                 event = ESend;
+            } else if (!i.dataToSend.isEmpty()) {
+                ++stanzasPending;
+                writeData(i.dataToSend, TypeStanza, true);
+                event = ESend;
             }
             // direct send?
             else if (!i.stringToSend.isEmpty()) {
@@ -615,6 +635,22 @@ void CoreProtocol::init()
     sasl_started     = false;
     compress_started = false;
 
+    // SASL2
+    sasl2          = false;
+    allowSASL2     = false;
+    bind2_carbons  = false;
+    bind2_inactive = false;
+    fast_used      = false;
+    sm_inline_sent = false;
+    fast           = FastToken();
+    bind2_enabled.clear();
+    ua_id.clear();
+    ua_software.clear();
+    ua_device.clear();
+    bind2_tag.clear();
+    fast_requested.clear();
+    sasl2_success = QDomElement();
+
     sm.reset();
 }
 
@@ -631,15 +667,47 @@ void CoreProtocol::needTimer(int seconds)
     timeout_sec = seconds;
 }
 
+static SMSendQueue::Kind stanzaKind(const QDomElement &e)
+{
+    if (e.tagName() == QLatin1String("presence"))
+        return SMSendQueue::Presence;
+    // a room message sent again in a new session would show up twice if the room already got it
+    if (e.tagName() != QLatin1String("message") || e.attribute(QLatin1String("type")) == QLatin1String("groupchat"))
+        return SMSendQueue::Other;
+    // a bare chat state notification isn't worth resending
+    bool chatState = false;
+    for (QDomElement c = e.firstChildElement(); !c.isNull(); c = c.nextSiblingElement()) {
+        if (c.namespaceURI() == QLatin1String("http://jabber.org/protocol/chatstates"))
+            chatState = true;
+        else if (c.tagName() != QLatin1String("thread") && c.tagName() != QLatin1String("no-store"))
+            return SMSendQueue::Message;
+    }
+    return chatState ? SMSendQueue::ChatState : SMSendQueue::Message;
+}
+
 void CoreProtocol::sendStanza(const QDomElement &e)
 {
-    if (sm.isActive()) {
-        int len = sm.addUnacknowledgedStanza(e);
-        if (len > 5 && len % 4 == 0)
-            if (needSMRequest())
-                event = ESend;
+    if (!sm.isActive()) {
+        BasicProtocol::sendStanza(e);
+        return;
+    }
+    // serialized once, for the wire and for a resend after resumption
+    QByteArray data;
+    appendXmlElement(data, e, defaultNamespace());
+    sm.addUnacknowledgedStanza(data, stanzaKind(e));
+    if (sm.isAckRequestDue() && needSMRequest())
+        event = ESend;
+    BasicProtocol::sendStanzaData(data);
+}
+
+void CoreProtocol::resendLostMessages()
+{
+    const auto messages = sm.takeLostMessages();
+    for (auto const &data : messages) {
+        if (sm.isActive())
+            sm.addUnacknowledgedStanza(data, SMSendQueue::Message);
+        BasicProtocol::sendStanzaData(data);
     }
-    BasicProtocol::sendStanza(e);
 }
 
 void CoreProtocol::startClientOut(const Jid &_jid, bool _oldOnly, bool tlsActive, bool _doAuth, bool _doCompress)
@@ -714,13 +782,31 @@ void CoreProtocol::setFrom(const QString &s) { from = s; }
 
 void CoreProtocol::setDialbackKey(const QString &s) { dialback_key = s; }
 
+void CoreProtocol::setSASL2(bool allow, const QString &userAgentId, const QString &software, const QString &device)
+{
+    allowSASL2  = allow;
+    ua_id       = userAgentId;
+    ua_software = software;
+    ua_device   = device;
+}
+
+// Bind2 is used only with a tag. carbons and the inactive state are sent along if the server can take them
+void CoreProtocol::setBind2(const QString &tag, bool carbons, bool inactive)
+{
+    bind2_tag      = tag;
+    bind2_carbons  = carbons;
+    bind2_inactive = inactive;
+}
+
 bool CoreProtocol::loginComplete()
 {
     setReady(true);
 
     // deal with stream management
     if (features.sm_supported && sm.state().isEnabled() && !sm.isActive()) {
-        if (sm.state().isResumption()) {
+        if (sm_inline_sent) {
+            // already sent along with bind
+        } else if (sm.state().isResumption()) {
             QDomElement e = doc.createElementNS(NS_STREAM_MANAGEMENT, "resume");
             e.setAttribute("previd", sm.state().resumption_id);
             e.setAttribute("h", sm.state().received_count);
@@ -739,6 +825,209 @@ bool CoreProtocol::loginComplete()
     return true;
 }
 
+// HT-* mechanisms of FAST: the token is the key of an HMAC over a fixed string. no channel binding yet
+static const QString FastMechanism = QStringLiteral("HT-SHA-256-NONE");
+
+static QByteArray fastHash(const QByteArray &secret, const QByteArray &data)
+{
+    return QCA::MessageAuthenticationCode("hmac(sha256)", QCA::SymmetricKey(secret)).process(data).toByteArray();
+}
+
+// <authenticate/> of SASL2 with everything which can go along with it, so
+// the stream is ready for stanzas right after a single round trip
+QDomElement CoreProtocol::sasl2Authenticate()
+{
+    QDomElement e = doc.createElementNS(NS_SASL2, "authenticate");
+    e.setAttribute("mechanism", sasl_mech);
+    if (!sasl_step.isEmpty()) {
+        QDomElement r = doc.createElementNS(NS_SASL2, "initial-response");
+        r.appendChild(doc.createTextNode(QCA::Base64().arrayToString(sasl_step)));
+        e.appendChild(r);
+    }
+    if (!ua_id.isEmpty()) {
+        QDomElement ua = doc.createElementNS(NS_SASL2, "user-agent");
+        ua.setAttribute("id", ua_id);
+        if (!ua_software.isEmpty()) {
+            QDomElement sw = doc.createElementNS(NS_SASL2, "software");
+            sw.appendChild(doc.createTextNode(ua_software));
+            ua.appendChild(sw);
+        }
+        if (!ua_device.isEmpty()) {
+            QDomElement dev = doc.createElementNS(NS_SASL2, "device");
+            dev.appendChild(doc.createTextNode(ua_device));
+            ua.appendChild(dev);
+        }
+        e.appendChild(ua);
+    }
+
+    sm_inline_sent = false;
+    bool enableSM  = sm.state().isEnabled() && !sm.isActive();
+    if (enableSM && features.sasl2_sm_inline && sm.state().isResumption()) {
+        QDomElement r = doc.createElementNS(NS_STREAM_MANAGEMENT, "resume");
+        r.setAttribute("previd", sm.state().resumption_id);
+        r.setAttribute("h", sm.state().received_count);
+        e.appendChild(r);
+        sm_inline_sent = true;
+    }
+
+    // the server binds only if resumption fails
+    bind2_enabled.clear();
+    if (features.bind2_supported && doBinding && !bind2_tag.isEmpty()) {
+        QDomElement b   = doc.createElementNS(NS_BIND2, "bind");
+        QDomElement tag = doc.createElementNS(NS_BIND2, "tag");
+        tag.appendChild(doc.createTextNode(bind2_tag));
+        b.appendChild(tag);
+        if (bind2_carbons && features.bind2_features.contains(NS_CARBONS)) {
+            b.appendChild(doc.createElementNS(NS_CARBONS, "enable"));
+            bind2_enabled += NS_CARBONS;
+        }
+        if (bind2_inactive && features.bind2_features.contains(NS_CSI)) {
+            b.appendChild(doc.createElementNS(NS_CSI, "inactive"));
+            bind2_enabled += NS_CSI;
+        }
+        if (enableSM && features.bind2_features.contains(NS_STREAM_MANAGEMENT)) {
+            QDomElement en = doc.createElementNS(NS_STREAM_MANAGEMENT, "enable");
+            en.setAttribute("resume", "true");
+            b.appendChild(en);
+            bind2_enabled += NS_STREAM_MANAGEMENT;
+        }
+        e.appendChild(b);
+    }
+
+    // ask for a new token every time, so a stolen one is good for one login at most
+    fast_requested.clear();
+    if (!ua_id.isEmpty() && features.fast_mechs.contains(FastMechanism) && QCA::isSupported("hmac(sha256)")) {
+        fast_requested = FastMechanism;
+        QDomElement r  = doc.createElementNS(NS_FAST, "request-token");
+        r.setAttribute("mechanism", fast_requested);
+        e.appendChild(r);
+    }
+    if (fast_used) {
+        QDomElement f = doc.createElementNS(NS_FAST, "fast");
+        f.setAttribute("count", fast.count);
+        e.appendChild(f);
+    }
+    return e;
+}
+
+// Handles what came with SASL2 success. There's no stream restart, so unless a resumed
+// or bound session came along, binding is done the usual way right away.
+bool CoreProtocol::sasl2Complete()
+{
+    QDomElement success = sasl2_success;
+    sasl2_success       = QDomElement();
+
+    // features of the authenticated stream are never sent. these are known anyway
+    features.sm_supported  = features.sm_supported || features.sasl2_sm_inline
+        || features.bind2_features.contains(NS_STREAM_MANAGEMENT);
+    features.csi_supported = features.csi_supported || features.bind2_features.contains(NS_CSI);
+
+    QDomElement token = success.firstChildElement(QLatin1String("token"));
+    if (!token.isNull() && token.namespaceURI() == NS_FAST && !fast_requested.isEmpty()) {
+        fast.mechanism = fast_requested;
+        fast.secret    = token.attribute("token").toUtf8();
+        fast.expiry    = QDateTime::fromString(token.attribute("expiry"), Qt::ISODate);
+        fast.count     = 0;
+    }
+
+    Jid         authzid(success.firstChildElement(QLatin1String("authorization-identifier")).text());
+    QDomElement resumed, bound;
+    for (QDomElement c = success.firstChildElement(); !c.isNull(); c = c.nextSiblingElement()) {
+        if (c.localName() == QLatin1String("resumed") && c.namespaceURI() == NS_STREAM_MANAGEMENT)
+            resumed = c;
+        else if (c.localName() == QLatin1String("bound") && c.namespaceURI() == NS_BIND2)
+            bound = c;
+    }
+
+    if (!resumed.isNull()) {
+        if (authzid.isValid())
+            jid_ = authzid;
+        bind2_enabled.clear();
+        setReady(true);
+        smResumed(resumed);
+        return true;
+    }
+    if (sm.state().isResumption() && sm_inline_sent) {
+        sm.state().resumption_id.clear(); // failed
+        sm_inline_sent = false;
+    }
+
+    if (!bound.isNull() && authzid.isValid() && !authzid.resource().isEmpty()) {
+        jid_ = authzid;
+        setReady(true);
+        QDomElement enabled = bound.firstChildElement(QLatin1String("enabled"));
+        if (!enabled.isNull() && enabled.namespaceURI() == NS_STREAM_MANAGEMENT) {
+            smEnabled(enabled);
+            return true;
+        }
+        event = EReady;
+        step  = Done;
+        return true;
+    }
+
+    bind2_enabled.clear();
+    features.bind_supported = true;
+    step                    = HandleFeatures;
+    return processStep();
+}
+
+void CoreProtocol::smEnabled(const QDomElement &e)
+{
+#ifdef IRIS_SM_DEBUG
+    qDebug() << "Stream Management: [INF] Enabled";
+#endif
+    QString rs = e.attribute("resume");
+    QString id = (rs == "true" || rs == "1") ? e.attribute("id") : QString();
+    sm.start(id);
+    if (!id.isEmpty()) {
+#ifdef IRIS_SM_DEBUG
+        qDebug() << "Stream Management: [INF] Resumption Supported";
+#endif
+        QString location = e.attribute("location").trimmed();
+        if (!location.isEmpty()) {
+            int         port_off = 0;
+            QStringView sm_host;
+            int         sm_port       = 0;
+            auto        location_view = QStringView { location };
+            if (location.startsWith('[')) { // ipv6
+                port_off = location.indexOf(']');
+                if (port_off != -1) { // looks valid
+                    sm_host = location_view.mid(1, port_off - 1);
+                    if (location.length() > port_off + 2 && location.at(port_off + 1) == ':')
+                        sm_port = location_view.mid(port_off + 2).toUInt();
+                }
+            }
+            if (port_off == 0) {
+                port_off = location.indexOf(':');
+                if (port_off != -1) {
+                    sm_host = location_view.left(port_off);
+                    sm_port = location_view.mid(port_off + 1).toUInt();
+                } else {
+                    sm_host = location_view.mid(0);
+                }
+            }
+            sm.setLocation(sm_host.toString(), sm_port);
+        }
+    } // else resumption is not supported on this server
+    needTimer(SM_TIMER_INTERVAL_SECS);
+    event = EReady;
+    step  = Done;
+}
+
+void CoreProtocol::smResumed(const QDomElement &e)
+{
+    sm.resume(e.attribute("h").toUInt());
+    while (true) {
+        QByteArray st = sm.getUnacknowledgedStanza();
+        if (st.isEmpty())
+            break;
+        send(st);
+    }
+    needTimer(SM_TIMER_INTERVAL_SECS);
+    event = EReady;
+    step  = Done;
+}
+
 int CoreProtocol::getOldErrorCode(const QDomElement &e)
 {
     QDomElement err = e.elementsByTagNameNS(NS_CLIENT, "error").item(0).toElement();
@@ -1103,7 +1392,7 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 
         // deal with SASL?
         if (!sasl_authed) {
-            if (!features.sasl_supported) {
+            if (!features.sasl_supported && !(allowSASL2 && features.sasl2_supported)) {
                 // SASL MUST be supported
                 // event = EError;
                 // errorCode = ErrProtocol;
@@ -1118,6 +1407,17 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 #ifdef XMPP_TEST
             TD::msg("starting SASL authentication...");
 #endif
+            sasl2 = allowSASL2 && features.sasl2_supported;
+            if (sasl2 && fast.isValid() && fast.mechanism == FastMechanism
+                && features.fast_mechs.contains(fast.mechanism) && QCA::isSupported("hmac(sha256)")) {
+                // no SASL exchange at all, the token proves who we are
+                fast_used = true;
+                fast.count++;
+                sasl_mech = fast.mechanism;
+                sasl_step = jid_.node().toUtf8() + '\0' + fastHash(fast.secret, "Initiator");
+                step      = GetSASLFirst;
+                return processStep();
+            }
             need = NSASLFirst;
             step = GetSASLFirst;
             return false;
@@ -1158,11 +1458,26 @@ bool CoreProtocol::normalStep(const QDomElement &e)
             e.appendChild(b);
 
             send(e);
+
+            // no need to wait for the bind result
+            sm_inline_sent = false;
+            if (features.sm_supported && sm.state().isEnabled() && !sm.isActive()) {
+                QDomElement en = doc.createElementNS(NS_STREAM_MANAGEMENT, "enable");
+                en.setAttribute("resume", "true");
+                send(en);
+                sm_inline_sent = true;
+            }
             event = ESend;
             step  = GetBindResponse;
             return true;
         }
     } else if (step == GetSASLFirst) {
+        if (sasl2) {
+            send(sasl2Authenticate(), true);
+            event = ESend;
+            step  = GetSASLChallenge;
+            return true;
+        }
         QDomElement e = doc.createElementNS(NS_SASL, "auth");
         e.setAttribute("mechanism", sasl_mech);
         if (!sasl_step.isEmpty()) {
@@ -1209,7 +1524,7 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 #ifdef XMPP_TEST
             TD::msg(QString("SASL OUT: [%1]").arg(printArray(sasl_step)));
 #endif
-            QDomElement e = doc.createElementNS(NS_SASL, "response");
+            QDomElement e = doc.createElementNS(sasl2 ? NS_SASL2 : NS_SASL, "response");
             if (!stepData.isEmpty())
                 e.appendChild(doc.createTextNode(QCA::Base64().arrayToString(stepData)));
 
@@ -1219,6 +1534,8 @@ bool CoreProtocol::normalStep(const QDomElement &e)
             return true;
         }
     } else if (step == HandleSASLSuccess) {
+        if (sasl2) // no security layers and no stream restart
+            return sasl2Complete();
         need  = NSASLLayer;
         spare = resetStream();
         step  = Start;
@@ -1336,6 +1653,27 @@ bool CoreProtocol::normalStep(const QDomElement &e)
                     for (int n = 0; n < l.count(); ++n)
                         f.sasl_mechs += l.item(n).toElement().text();
 
+                } else if (c.localName() == QLatin1String("authentication") && c.namespaceURI() == NS_SASL2) {
+                    f.sasl2_supported = true;
+                    QDomNodeList l    = c.elementsByTagNameNS(NS_SASL2, QLatin1String("mechanism"));
+                    for (int n = 0; n < l.count(); ++n)
+                        f.sasl2_mechs += l.item(n).toElement().text();
+                    QDomElement inl = c.firstChildElement(QLatin1String("inline"));
+                    for (QDomElement i = inl.firstChildElement(); !i.isNull(); i = i.nextSiblingElement()) {
+                        if (i.localName() == QLatin1String("sm") && i.namespaceURI() == NS_STREAM_MANAGEMENT) {
+                            f.sasl2_sm_inline = true;
+                        } else if (i.localName() == QLatin1String("bind") && i.namespaceURI() == NS_BIND2) {
+                            f.bind2_supported = true;
+                            l                 = i.elementsByTagNameNS(NS_BIND2, QLatin1String("feature"));
+                            for (int n = 0; n < l.count(); ++n)
+                                f.bind2_features += l.item(n).toElement().attribute(QLatin1String("var"));
+                        } else if (i.localName() == QLatin1String("fast") && i.namespaceURI() == NS_FAST) {
+                            l = i.elementsByTagNameNS(NS_FAST, QLatin1String("mechanism"));
+                            for (int n = 0; n < l.count(); ++n)
+                                f.fast_mechs += l.item(n).toElement().text();
+                        }
+                    }
+
                 } else if (c.localName() == QLatin1String("compression") && c.namespaceURI() == NS_COMPRESS_FEATURE) {
                     f.compress_supported = true;
                     QDomNodeList l       = c.elementsByTagNameNS(NS_COMPRESS_FEATURE, QLatin1String("method"));
@@ -1355,6 +1693,12 @@ bool CoreProtocol::normalStep(const QDomElement &e)
                     f.sm_supported = true;
                     // REVIEW: previously we checked for sasl_authed as well. why?
 
+                } else if (c.localName() == QLatin1String("ver") && c.namespaceURI() == NS_ROSTER_VER) {
+                    f.rosterver_supported = true;
+
+                } else if (c.localName() == QLatin1String("csi") && c.namespaceURI() == NS_CSI) {
+                    f.csi_supported = true;
+
                 } else if (c.localName() == QLatin1String("session") && c.namespaceURI() == NS_SESSION) {
                     f.session_supported = true;
                     f.session_required  = c.elementsByTagName(QLatin1String("optional")).count() == 0;
@@ -1448,7 +1792,40 @@ bool CoreProtocol::normalStep(const QDomElement &e)
         }
     } else if (step == GetSASLChallenge) {
         // waiting for sasl challenge/success/fail
-        if (e.namespaceURI() == NS_SASL) {
+        if (sasl2 && e.namespaceURI() == NS_SASL2 && e.localName() == QLatin1String("success")) {
+            sasl2_success = e;
+            sasl_authed   = true;
+            QByteArray a  = QCA::Base64()
+                               .stringToArray(e.firstChildElement(QLatin1String("additional-data")).text())
+                               .toByteArray();
+            if (fast_used) {
+                // the server proves it knows the token too
+                if (a != fastHash(fast.secret, "Responder")) {
+                    fast      = FastToken();
+                    event     = EError;
+                    errorCode = ErrProtocol;
+                    return true;
+                }
+            } else if (!a.isEmpty()) {
+                sasl_step = a;
+                need      = NSASLNext;
+                step      = GetSASLNext;
+                return false;
+            }
+            event = ESASLSuccess;
+            step  = HandleSASLSuccess;
+            return true;
+        }
+        if (sasl2 && fast_used && e.namespaceURI() == NS_SASL2 && e.localName() == QLatin1String("failure")) {
+            // the token has expired or was revoked. fall back to the usual mechanisms on the same stream
+            fast      = FastToken();
+            fast_used = false;
+            sasl_mech.clear();
+            sasl_step.clear();
+            step = HandleFeatures;
+            return processStep();
+        }
+        if (e.namespaceURI() == NS_SASL || (sasl2 && e.namespaceURI() == NS_SASL2)) {
             if (e.tagName() == "challenge") {
                 QByteArray a = QCA::Base64().stringToArray(e.text()).toByteArray();
 #ifdef XMPP_TEST
@@ -1482,7 +1859,7 @@ bool CoreProtocol::normalStep(const QDomElement &e)
                     errCond = stringToSASLCond(t.tagName());
 
                 // handle text elements
-                auto                  nodes = e.elementsByTagNameNS(NS_SASL, QLatin1String("text"));
+                auto                  nodes = e.elementsByTagNameNS(e.namespaceURI(), QLatin1String("text"));
                 decltype(errLangText) lt;
                 for (int i = 0; i < nodes.count(); i++) {
                     auto    e    = nodes.item(i).toElement();
@@ -1699,57 +2076,10 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 #endif
         if (e.namespaceURI() == NS_STREAM_MANAGEMENT) {
             if (e.localName() == "enabled") {
-#ifdef IRIS_SM_DEBUG
-                qDebug() << "Stream Management: [INF] Enabled";
-#endif
-                QString rs = e.attribute("resume");
-                QString id = (rs == "true" || rs == "1") ? e.attribute("id") : QString();
-                sm.start(id);
-                if (!id.isEmpty()) {
-#ifdef IRIS_SM_DEBUG
-                    qDebug() << "Stream Management: [INF] Resumption Supported";
-#endif
-                    QString location = e.attribute("location").trimmed();
-                    if (!location.isEmpty()) {
-                        int         port_off = 0;
-                        QStringView sm_host;
-                        int         sm_port       = 0;
-                        auto        location_view = QStringView { location };
-                        if (location.startsWith('[')) { // ipv6
-                            port_off = location.indexOf(']');
-                            if (port_off != -1) { // looks valid
-                                sm_host = location_view.mid(1, port_off - 1);
-                                if (location.length() > port_off + 2 && location.at(port_off + 1) == ':')
-                                    sm_port = location_view.mid(port_off + 2).toUInt();
-                            }
-                        }
-                        if (port_off == 0) {
-                            port_off = location.indexOf(':');
-                            if (port_off != -1) {
-                                sm_host = location_view.left(port_off);
-                                sm_port = location_view.mid(port_off + 1).toUInt();
-                            } else {
-                                sm_host = location_view.mid(0);
-                            }
-                        }
-                        sm.setLocation(sm_host.toString(), sm_port);
-                    }
-                } // else resumption is not supported on this server
-                needTimer(SM_TIMER_INTERVAL_SECS);
-                event = EReady;
-                step  = Done;
+                smEnabled(e);
                 return true;
             } else if (e.localName() == "resumed") {
-                sm.resume(e.attribute("h").toUInt());
-                while (true) {
-                    QDomElement st = sm.getUnacknowledgedStanza();
-                    if (st.isNull())
-                        break;
-                    send(st);
-                }
-                needTimer(SM_TIMER_INTERVAL_SECS);
-                event = EReady;
-                step  = Done;
+                smResumed(e);
                 return true;
             } else if (e.localName() == "failed") {
                 if (sm.state().isResumption()) { // tried to resume? ok, then try to just enable
@@ -23,6 +23,7 @@
 #include "sm.h"
 #include "xmlprotocol.h"
 #include "xmpp.h"
+#include "xmpp_clientstream.h"
 
 #include <QList>
 #include <QObject>
@@ -46,6 +47,12 @@
 #define NS_COMPRESS_FEATURE "http://jabber.org/features/compress"
 #define NS_COMPRESS_PROTOCOL "http://jabber.org/protocol/compress"
 #define NS_HOSTS "http://barracuda.com/xmppextensions/hosts"
+#define NS_ROSTER_VER "urn:xmpp:features:rosterver"
+#define NS_CSI "urn:xmpp:csi:0"
+#define NS_SASL2 "urn:xmpp:sasl:2"
+#define NS_BIND2 "urn:xmpp:bind:0"
+#define NS_FAST "urn:xmpp:fast:0"
+#define NS_CARBONS "urn:xmpp:carbons:2"
 
 namespace XMPP {
 class Version {
@@ -62,9 +69,17 @@ public:
     bool        tls_supported, sasl_supported, bind_supported, compress_supported;
     bool        tls_required;
     bool        sm_supported;
+    bool        rosterver_supported; // XEP-0237
+    bool        csi_supported;       // XEP-0352
     bool        session_supported;
     bool        session_required;
+    bool        sasl2_supported; // XEP-0388
+    bool        sasl2_sm_inline; // stream management can be resumed along with authentication
+    bool        bind2_supported; // XEP-0386
     QStringList sasl_mechs;
+    QStringList sasl2_mechs;
+    QStringList bind2_features; // what can be enabled along with Bind2
+    QStringList fast_mechs;     // XEP-0484
     QStringList compression_mechs;
     QStringList hosts;
 };
@@ -157,9 +172,11 @@ public:
     void       setSASLFirst(const QString &mech, const QByteArray &step);
     void       setSASLNext(const QByteArray &step);
     void       setSASLAuthed();
+    bool       isSASLAuthed() const;
 
     // send / recv
     void        sendStanza(const QDomElement &e);
+    void        sendStanzaData(const QByteArray &data); // serialized already
     void        sendDirect(const QString &s);
     void        sendWhitespace();
     void        clearSendQueue();
@@ -194,6 +211,7 @@ protected:
     static QString                   streamCondToString(StreamCond);
 
     void send(const QDomElement &e, bool clip = false);
+    void send(const QByteArray &data);
     void sendUrgent(const QDomElement &e, bool clip = false);
     void sendStreamError(StreamCond cond, const QString &text = "", const QDomElement &appSpec = QDomElement());
     void sendStreamError(const QString &text); // old-style
@@ -240,6 +258,7 @@ private:
 
     struct SendItem {
         QDomElement stanzaToSend;
+        QByteArray  dataToSend; // stanza serialized already
         QString     stringToSend;
         bool        doWhitespace;
     };
@@ -268,6 +287,7 @@ public:
 
     // reimplemented to do SM
     void sendStanza(const QDomElement &e);
+    void resendLostMessages(); // of the previous session, if it couldn't be resumed
 
     void startClientOut(const Jid &jid, bool oldOnly, bool tlsActive, bool doAuth, bool doCompression);
     void startServerOut(const QString &to);
@@ -285,12 +305,18 @@ public:
     void setPassword(const QString &s);
     void setFrom(const QString &s);
     void setDialbackKey(const QString &s);
+    void setSASL2(bool allow, const QString &userAgentId, const QString &software, const QString &device);
+    void setBind2(const QString &tag, bool carbons, bool inactive);
 
     // input
     QString user, host;
 
     // status
     bool old;
+    bool sasl2; // authenticating with SASL2
+
+    FastToken   fast;          // to authenticate with. replaced if the server issues a new one
+    QStringList bind2_enabled; // namespaces of what was enabled along with Bind2
 
     StreamFeatures     features;
     QList<QDomElement> unhandledFeatures;
@@ -348,12 +374,25 @@ private:
     bool    doTLS, doAuth, doBinding, doCompress;
     QString password;
 
+    bool        allowSASL2;
+    QString     ua_id, ua_software, ua_device;
+    QString     bind2_tag;
+    bool        bind2_carbons, bind2_inactive;
+    bool        fast_used;      // authenticating with a token
+    QString     fast_requested; // mechanism of the token asked for
+    bool        sm_inline_sent; // resumption or enabling went along with authentication or bind
+    QDomElement sasl2_success;
+
     QString dialback_id, dialback_key;
     QString self_from;
 
-    void       init();
-    static int getOldErrorCode(const QDomElement &e);
-    bool       loginComplete();
+    void        init();
+    static int  getOldErrorCode(const QDomElement &e);
+    bool        loginComplete();
+    QDomElement sasl2Authenticate();
+    bool        sasl2Complete();
+    void        smEnabled(const QDomElement &e);
+    void        smResumed(const QDomElement &e);
 
     bool isValidStanza(const QDomElement &e) const;
     bool streamManagementHandleStanza(const QDomElement &e);
@@ -23,8 +23,94 @@
 #include <QDebug>
 #endif
 
+#include <algorithm>
+
 using namespace XMPP;
 
+void SMSendQueue::enqueue(const QByteArray &data, Kind kind)
+{
+    entries_.enqueue(Entry { data, kind });
+    bytes_ += data.size();
+    ++counts_[kind];
+    shrink();
+}
+
+void SMSendQueue::dequeue()
+{
+    Entry e = entries_.dequeue();
+    if (!e.data.isEmpty()) {
+        bytes_ -= e.data.size();
+        --counts_[e.kind];
+    }
+}
+
+void SMSendQueue::clear()
+{
+    entries_.clear();
+    bytes_ = 0;
+    std::fill(std::begin(counts_), std::end(counts_), 0);
+    dropped_ = 0;
+}
+
+void SMSendQueue::setLimit(qint64 bytes, OverflowPolicy policy)
+{
+    limit_  = bytes;
+    policy_ = policy;
+    shrink();
+}
+
+// Messages still to be delivered, oldest first
+QList<QByteArray> SMSendQueue::messages() const
+{
+    QList<QByteArray> ret;
+    ret.reserve(counts_[Message]);
+    for (auto const &e : entries_) {
+        if (e.kind == Message && !e.data.isEmpty())
+            ret.append(e.data);
+    }
+    return ret;
+}
+
+// Drops the payload of the oldest stanza of the kind
+void SMSendQueue::drop(Kind kind)
+{
+    for (auto &e : entries_) {
+        if (e.kind == kind && !e.data.isEmpty()) {
+            drop(e);
+            return;
+        }
+    }
+}
+
+// The entry stays, so acks still match
+void SMSendQueue::drop(Entry &e)
+{
+    bytes_ -= e.data.size();
+    e.data.clear();
+    --counts_[e.kind];
+    ++dropped_;
+}
+
+void SMSendQueue::shrink()
+{
+    if (bytes_ <= limit_)
+        return;
+    for (Kind kind : { ChatState, Presence }) {
+        while (bytes_ > limit_ && counts_[kind])
+            drop(kind);
+    }
+    if (policy_ == DropOldest) {
+        for (auto it = entries_.begin(); bytes_ > limit_ && it != entries_.end(); ++it) {
+            if (!it->data.isEmpty())
+                drop(*it);
+        }
+    }
+#ifdef IRIS_SM_DEBUG
+    if (dropped_)
+        qDebug() << "Stream Management: [INF] Send queue is over the limit, dropped stanzas: " << dropped_;
+#endif
+}
+
 SMState::SMState()
 {
     enabled = false;
@@ -52,6 +138,8 @@ void StreamManagement::reset()
     sm_resumed                     = false;
     sm_stanzas_notify              = 0;
     sm_resend_pos                  = 0;
+    unrequested_stanzas            = 0;
+    unrequested_bytes              = 0;
     sm_timeout_data.elapsed_timer  = QElapsedTimer();
     sm_timeout_data.waiting_answer = false;
 }
@@ -59,6 +147,7 @@ void StreamManagement::reset()
 void StreamManagement::start(const QString &resumption_id)
 {
     reset();
+    lost_messages += state_.send_queue.messages(); // a new session after a failed resumption
     state_.resetCounters();
     state_.resumption_id = resumption_id;
     sm_started           = true;
@@ -107,23 +196,42 @@ void StreamManagement::countInputRawData(int bytes)
     }
 }
 
-QDomElement StreamManagement::getUnacknowledgedStanza()
+// Returns the next stanza to resend after resumption, skipping the dropped ones
+QByteArray StreamManagement::getUnacknowledgedStanza()
 {
-    if (sm_resend_pos < state_.send_queue.size())
-        return state_.send_queue.at(sm_resend_pos++);
-    return QDomElement();
+    while (sm_resend_pos < state_.send_queue.size()) {
+        auto const &e = state_.send_queue.at(sm_resend_pos++);
+        if (!e.data.isEmpty())
+            return e.data;
+    }
+    return QByteArray();
 }
 
-int StreamManagement::addUnacknowledgedStanza(const QDomElement &e)
+int StreamManagement::addUnacknowledgedStanza(const QByteArray &data, SMSendQueue::Kind kind)
 {
-    state_.send_queue.enqueue(e);
-    int len = state_.send_queue.length();
+    state_.send_queue.enqueue(data, kind);
+    ++unrequested_stanzas;
+    unrequested_bytes += data.size();
+    int len = state_.send_queue.size();
 #ifdef IRIS_SM_DEBUG
     qDebug() << "Stream Management: [INF] Send queue length is changed: " << len;
 #endif
     return len;
 }
 
+// An ack is requested every few stanzas or kilobytes, whatever comes first
+void StreamManagement::setAckRequestCadence(int stanzas, int bytes)
+{
+    ack_request_stanzas = stanzas;
+    ack_request_bytes   = bytes;
+}
+
+bool StreamManagement::isAckRequestDue() const
+{
+    return (ack_request_stanzas > 0 && unrequested_stanzas >= ack_request_stanzas)
+        || (ack_request_bytes > 0 && unrequested_bytes >= ack_request_bytes);
+}
+
 void StreamManagement::processAcknowledgement(quint32 last_handled)
 {
     sm_timeout_data.waiting_answer = false;
@@ -141,7 +249,7 @@ void StreamManagement::processAcknowledgement(quint32 last_handled)
     }
 #ifdef IRIS_SM_DEBUG
     if (f) {
-        qDebug() << "Stream Management: [INF] Send queue length is changed: " << state_.send_queue.length();
+        qDebug() << "Stream Management: [INF] Send queue length is changed: " << state_.send_queue.size();
         if (state_.send_queue.isEmpty() && last_handled != state_.server_last_handled)
             qDebug() << "Stream Management: [ERR] Send queue is empty but last_handled != server_last_handled "
                      << last_handled << state_.server_last_handled;
@@ -149,6 +257,22 @@ void StreamManagement::processAcknowledgement(quint32 last_handled)
 #endif
 }
 
+QList<QByteArray> StreamManagement::takeLostMessages()
+{
+    QList<QByteArray> ret = lost_messages;
+    lost_messages.clear();
+    return ret;
+}
+
+// Messages left unacknowledged by another stream, e.g. before a restart. Sent after login
+void StreamManagement::setLostMessages(const QList<QByteArray> &messages) { lost_messages = messages; }
+
+// All messages the server hasn't confirmed, serialized
+QList<QByteArray> StreamManagement::unacknowledgedMessages() const
+{
+    return lost_messages + state_.send_queue.messages();
+}
+
 void StreamManagement::markStanzaHandled()
 {
     ++state_.received_count;
@@ -165,6 +289,8 @@ QDomElement StreamManagement::generateRequestStanza(QDomDocument &doc)
 #endif
         sm_timeout_data.waiting_answer = true;
         sm_timeout_data.elapsed_timer.start();
+        unrequested_stanzas = 0;
+        unrequested_bytes   = 0;
         return doc.createElementNS(NS_STREAM_MANAGEMENT, "r");
     }
     return QDomElement();
@@ -20,8 +20,10 @@
 #ifndef XMPP_SM_H
 #define XMPP_SM_H
 
+#include <QByteArray>
 #include <QDomElement>
 #include <QElapsedTimer>
+#include <QList>
 #include <QObject>
 #include <QQueue>
 
@@ -31,6 +33,45 @@
 // #define IRIS_SM_DEBUG
 
 namespace XMPP {
+// Unacknowledged stanzas, kept as they were put on the wire
+class SMSendQueue {
+public:
+    enum Kind { Message, Other, Presence, ChatState }; // only messages are resent in a new session
+    enum OverflowPolicy {
+        DropDisposable, // only chat states, then presence, the queue may outgrow the limit otherwise
+        DropOldest      // then the rest in queue order
+    };
+
+    struct Entry {
+        QByteArray data; // empty once dropped
+        Kind       kind;
+    };
+
+    int          size() const { return entries_.size(); } // dropped stanzas included, they are acked as well
+    bool         isEmpty() const { return entries_.isEmpty(); }
+    qint64       bytes() const { return bytes_; }
+    const Entry &at(int i) const { return entries_.at(i); }
+    void         enqueue(const QByteArray &data, Kind kind);
+    void         dequeue();
+    void         clear();
+    void         setLimit(qint64 bytes, OverflowPolicy policy);
+    int          droppedCount() const { return dropped_; }
+
+    QList<QByteArray> messages() const;
+
+private:
+    void drop(Kind kind);
+    void drop(Entry &e);
+    void shrink();
+
+    QQueue<Entry>  entries_;
+    qint64         bytes_  = 0;
+    qint64         limit_  = 1024 * 1024;
+    OverflowPolicy policy_ = DropDisposable;
+    int            counts_[4] { 0, 0, 0, 0 }; // not dropped ones by kind
+    int            dropped_ = 0;              // since the last clear()
+};
+
 class SMState {
 public:
     SMState();
@@ -41,11 +82,11 @@ public:
     void setEnabled(bool e) { enabled = e; }
 
 public:
-    bool                enabled;
-    quint32             received_count;
-    quint32             server_last_handled;
-    QQueue<QDomElement> send_queue;
-    QString             resumption_id;
+    bool        enabled;
+    quint32     received_count;
+    quint32     server_last_handled;
+    SMSendQueue send_queue;
+    QString     resumption_id;
     struct {
         QString host;
         quint16 port;
@@ -66,9 +107,14 @@ public:
     int                  lastAckElapsed() const;
     int                  takeAckedCount();
     void                 countInputRawData(int bytes);
-    QDomElement          getUnacknowledgedStanza();
-    int                  addUnacknowledgedStanza(const QDomElement &e);
+    QByteArray           getUnacknowledgedStanza();
+    int                  addUnacknowledgedStanza(const QByteArray &data, SMSendQueue::Kind kind);
+    void                 setAckRequestCadence(int stanzas, int bytes);
+    bool                 isAckRequestDue() const;
     void                 processAcknowledgement(quint32 last_handled);
+    QList<QByteArray>    takeLostMessages();
+    void                 setLostMessages(const QList<QByteArray> &messages);
+    QList<QByteArray>    unacknowledgedMessages() const;
     void                 markStanzaHandled();
     QDomElement          generateRequestStanza(QDomDocument &doc);
     QDomElement          makeResponseStanza(QDomDocument &doc);
@@ -79,6 +125,12 @@ private:
     bool    sm_resumed;
     int     sm_stanzas_notify;
     int     sm_resend_pos;
+    int     ack_request_stanzas = 5;
+    int     ack_request_bytes   = 16 * 1024;
+    int     unrequested_stanzas = 0; // sent since the last <r/>
+    int     unrequested_bytes   = 0;
+
+    QList<QByteArray> lost_messages; // of a session which couldn't be resumed, to send in the next one
     struct {
         QElapsedTimer elapsed_timer;
         bool          waiting_answer = false;
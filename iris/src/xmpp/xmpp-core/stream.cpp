@@ -53,6 +53,7 @@
 #endif
 
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <QList>
 #include <QPointer>
 #include <QTextStream>
@@ -140,6 +141,14 @@ public:
         using_tls  = false;
     }
 
+    // Authentication exchanges carry passwords, SCRAM proofs and FAST tokens, so nothing
+    // is traced until the server has accepted us. The read which brings the success isn't traced either.
+    void traceData(bool incoming, const QByteArray &data)
+    {
+        if (trace && (state == Active || client.isSASLAuthed()))
+            trace(incoming, data);
+    }
+
     Jid                    jid;
     QString                server;
     bool                   oldOnly       = false;
@@ -192,6 +201,26 @@ public:
     QTimer noopTimer;
     int    noop_time;
     bool   quiet_reconnection = false;
+
+    TraceHandler trace;
+
+    bool          csiActive       = true; // what the application wants
+    bool          csiServerActive = true; // what the server was told
+    QElapsedTimer csiClock;               // since the last state change
+    CSIStats      csiStats;
+
+    bool      sasl2Enabled = true;
+    QString   uaId, uaSoftware, uaDevice;
+    QString   bindTag;
+    bool      carbonsInline = false;
+    FastToken fastToken;
+
+    void accountCSITime()
+    {
+        if (!csiClock.isValid())
+            return;
+        (csiServerActive ? csiStats.activeMsecs : csiStats.inactiveMsecs) += csiClock.restart();
+    }
 };
 
 ClientStream::ClientStream(Connector *conn, TLSHandler *tlsHandler, QObject *parent) : Stream(parent)
@@ -256,6 +285,8 @@ void ClientStream::reset(bool all)
 
     d->reset();
     d->noopTimer.stop();
+    d->accountCSITime();
+    d->csiClock.invalidate();
 
     // delete securestream
     delete d->ss;
@@ -415,6 +446,8 @@ QCA::Provider::Context *ClientStream::currentSASLContext() const
 
 void ClientStream::setSCRAMStoredSaltedHash(const QString &s)
 {
+    if (!d->sasl) // e.g. authenticated with a FAST token
+        return;
     QCA::SASLContext *context = (QCA::SASLContext *)(d->sasl->context());
     if (context) {
         context->setProperty("scram-salted-password-base64", s);
@@ -423,6 +456,8 @@ void ClientStream::setSCRAMStoredSaltedHash(const QString &s)
 
 const QString ClientStream::getSCRAMStoredSaltedHash()
 {
+    if (!d->sasl)
+        return QString();
     QCA::SASLContext *context = (QCA::SASLContext *)(d->sasl->context());
     if (context) {
         return context->property("scram-salted-password-base64").toString();
@@ -432,6 +467,25 @@ const QString ClientStream::getSCRAMStoredSaltedHash()
 
 void ClientStream::setResourceBinding(bool b) { d->doBinding = b; }
 
+void ClientStream::setSASL2Enabled(bool enable) { d->sasl2Enabled = enable; }
+
+void ClientStream::setUserAgent(const QString &id, const QString &software, const QString &device)
+{
+    d->uaId       = id;
+    d->uaSoftware = software;
+    d->uaDevice   = device;
+}
+
+void ClientStream::setBindTag(const QString &tag) { d->bindTag = tag; }
+
+void ClientStream::setCarbonsInline(bool enable) { d->carbonsInline = enable; }
+
+bool ClientStream::isCarbonsEnabledInline() const { return d->client.bind2_enabled.contains(NS_CARBONS); }
+
+void ClientStream::setFastToken(const FastToken &token) { d->fastToken = token; }
+
+FastToken ClientStream::fastToken() const { return d->fastToken; }
+
 void ClientStream::setLang(const QString &lang) { d->lang = lang; }
 
 void ClientStream::setNoopTime(int mills)
@@ -548,6 +602,10 @@ void ClientStream::cr_connected()
     d->client.setAllowBind(d->doBinding);
     d->client.setAllowPlain(d->allowPlain == AllowPlain || (d->allowPlain == AllowPlainOverTLS && d->conn->useSSL()));
     d->client.setLang(d->lang);
+    // SASL2 has no security layers
+    d->client.setSASL2(d->sasl2Enabled && d->minimumSSF == 0, d->uaId, d->uaSoftware, d->uaDevice);
+    d->client.setBind2(d->bindTag, d->carbonsInline, !d->csiActive);
+    d->client.fast = d->fastToken;
 
     /*d->client.jid = d->jid;
     d->client.server = d->server;
@@ -602,6 +660,9 @@ void ClientStream::ss_readyRead()
 #ifdef XMPP_DEBUG
     qDebug("ClientStream: recv: %d [%s]\n", a.size(), a.data());
 #endif
+    d->traceData(true, a);
+    if (d->state == Active)
+        (d->csiServerActive ? d->csiStats.activeBytes : d->csiStats.inactiveBytes) += quint64(a.size());
 
     if (d->mode == Client) {
         d->client.addIncomingData(a);
@@ -734,7 +795,8 @@ void ClientStream::sasl_error()
 #endif
     // has to be auth error
     int x      = convertedSASLCond();
-    d->errText = tr("Offered mechanisms: ") + d->client.features.sasl_mechs.join(", ");
+    d->errText = tr("Offered mechanisms: ")
+        + (d->client.sasl2 ? d->client.features.sasl2_mechs : d->client.features.sasl_mechs).join(", ");
     reset();
     d->errCond = x;
     emit error(ErrAuth);
@@ -817,6 +879,7 @@ void ClientStream::srvProcessNext()
 #ifdef XMPP_DEBUG
                 qDebug("Need Send: {%s}\n", a.data());
 #endif
+                d->traceData(false, a);
                 d->ss->write(a);
             }
             break;
@@ -948,6 +1011,7 @@ void ClientStream::processNext()
 #ifdef XMPP_DEBUG
                 qDebug("Need Send: {%s}\n", a.data());
 #endif
+                d->traceData(false, a);
                 d->ss->write(a);
             }
             break;
@@ -1001,6 +1065,17 @@ void ClientStream::processNext()
             d->jid   = d->client.jid();
             d->state = Active;
             setNoopTime(d->noop_time);
+            d->fastToken = d->client.fast;
+            // the server starts every session as active, unless told otherwise with Bind2
+            d->accountCSITime();
+            if (!d->client.sm.isResumed())
+                d->csiStats = CSIStats();
+            d->csiServerActive = !d->client.bind2_enabled.contains(NS_CSI);
+            if (d->client.sm.isResumed())
+                d->csiServerActive = !d->csiActive; // it keeps the old state, so say it again
+            d->csiClock.start();
+            syncClientState(); // sent by this loop
+            d->client.resendLostMessages();
             if (!d->quiet_reconnection)
                 emit authenticated();
             if (!self)
@@ -1042,6 +1117,8 @@ void ClientStream::processNext()
 #ifdef XMPP_DEBUG
             qDebug("Closed\n");
 #endif
+            // the server has closed its side too, so it has handled everything it got
+            d->client.sm.state().send_queue.clear();
             reset();
             emit delayedCloseFinished();
             return;
@@ -1137,6 +1214,8 @@ bool ClientStream::handleNeed()
             QCA::setProviderPriority("simplesasl", 10);
         }
 
+        d->fastToken = d->client.fast; // a rejected token is gone
+
         static QStringList preference { "GSSAPI",        "SCRAM-SHA-512-PLUS", "SCRAM-SHA-512", "SCRAM-SHA-384-PLUS",
                                         "SCRAM-SHA-384", "SCRAM-SHA-256-PLUS", "SCRAM-SHA-256", "SCRAM-SHA-1-PLUS",
                                         "SCRAM-SHA-1",   "DIGEST-MD5",         "PLAIN" };
@@ -1148,7 +1227,8 @@ bool ClientStream::handleNeed()
         else {
             QMap<int, QString> prefOrdered;
             QStringList        unpreferred;
-            for (auto const &m : std::as_const(d->client.features.sasl_mechs)) {
+            auto const &mechs = d->client.sasl2 ? d->client.features.sasl2_mechs : d->client.features.sasl_mechs;
+            for (auto const &m : mechs) {
                 int i = preference.indexOf(m);
                 if (i != -1) {
                     prefOrdered.insert(i, m);
@@ -1191,7 +1271,7 @@ bool ClientStream::handleNeed()
             auth_flags = (QCA::SASL::AuthFlags)(auth_flags | QCA::SASL::AllowPlain);
         if (d->mutualAuth)
             auth_flags = (QCA::SASL::AuthFlags)(auth_flags | QCA::SASL::RequireMutualAuth);
-        d->sasl->setConstraints(auth_flags, d->minimumSSF, d->maximumSSF);
+        d->sasl->setConstraints(auth_flags, d->minimumSSF, d->client.sasl2 ? 0 : d->maximumSSF);
 
 #ifdef IRIS_SASLCONNECTHOST
         d->sasl->startClient("xmpp", QUrl::toAce(d->connectHost), ml, QCA::SASL::AllowClientSendFirst);
@@ -1275,6 +1355,8 @@ void ClientStream::doNoop()
     }
 }
 
+void ClientStream::setTraceHandler(const TraceHandler &handler) { d->trace = handler; }
+
 void ClientStream::writeDirect(const QString &s)
 {
     if (d->state == Active) {
@@ -1288,6 +1370,7 @@ void ClientStream::writeDirect(const QString &s)
 
 void ClientStream::handleError()
 {
+    d->fastToken = d->client.fast; // may have been dropped by the server
     int c = d->client.errorCode;
     if (c == CoreProtocol::ErrParse) {
         reset();
@@ -1510,6 +1593,62 @@ bool ClientStream::isResumed() const { return d->client.sm.isResumed(); }
 
 void ClientStream::setSMEnabled(bool e) { d->client.sm.state().setEnabled(e); }
 
+void ClientStream::setSMQueueLimit(int bytes, bool dropMessages)
+{
+    d->client.sm.state().send_queue.setLimit(bytes,
+                                             dropMessages ? SMSendQueue::DropOldest : SMSendQueue::DropDisposable);
+}
+
+void ClientStream::setSMAckRequestCadence(int stanzas, int bytes) { d->client.sm.setAckRequestCadence(stanzas, bytes); }
+
+QList<QByteArray> ClientStream::unacknowledgedMessages() const { return d->client.sm.unacknowledgedMessages(); }
+
+void ClientStream::setUnacknowledgedMessages(const QList<QByteArray> &messages)
+{
+    d->client.sm.setLostMessages(messages);
+}
+
+bool ClientStream::isClientStateIndicationSupported() const { return d->client.features.csi_supported; }
+
+/**
+ * Tells the server whether the user is looking at the client. An inactive client lets
+ * the server hold back or drop traffic which is not urgent, like presence updates.
+ * The state is remembered and sent again on every new session.
+ */
+void ClientStream::setClientActive(bool active)
+{
+    d->csiActive = active;
+    if (syncClientState())
+        processNext();
+}
+
+bool ClientStream::isClientActive() const { return d->csiActive; }
+
+/**
+ * Returns time spent and incoming bytes received in each state during the current
+ * session, or the last one if the stream is closed. Resumed sessions keep counting.
+ */
+ClientStream::CSIStats ClientStream::csiStats() const
+{
+    CSIStats stats = d->csiStats;
+    if (d->csiClock.isValid())
+        (d->csiServerActive ? stats.activeMsecs : stats.inactiveMsecs) += d->csiClock.elapsed();
+    return stats;
+}
+
+// queues the state element if the server has to be told. returns true if it did
+bool ClientStream::syncClientState()
+{
+    if (d->state != Active || !d->client.features.csi_supported || d->csiActive == d->csiServerActive)
+        return false;
+
+    d->accountCSITime();
+    d->csiServerActive = d->csiActive;
+    d->client.sendDirect(d->csiActive ? QStringLiteral("<active xmlns='" NS_CSI "'/>")
+                                      : QStringLiteral("<inactive xmlns='" NS_CSI "'/>"));
+    return true;
+}
+
 void ClientStream::setTimer(int secs)
 {
     d->timeout_timer.setSingleShot(true);
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp/xmpp-core/protocol.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QtCrypto>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+static const QByteArray StreamHeader("<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'"
+                                     " from='example.org' id='s1' version='1.0'>");
+static const QByteArray PlainStep("\0user\0pencil", 12);
+
+// Runs a CoreProtocol against a scripted server the way ClientStream does, counting round trips
+class ScriptedLogin {
+public:
+    CoreProtocol p;
+    QByteArray   sent;              // by the client since the last server flight
+    int          roundTrips = 0;    // server flights the client had to wait for
+    bool         ready      = false;
+    bool         failed     = false;
+    bool         saslAsked  = false; // the client needed a SASL mechanism
+
+    void start(const Jid &jid)
+    {
+        p.startClientOut(jid, false, false, true, false);
+        p.setAllowTLS(false);
+        p.setAllowBind(true);
+        p.sm.state().setEnabled(true);
+    }
+
+    void run()
+    {
+        sent.clear();
+        while (!ready && !failed) {
+            if (!p.processStep()) {
+                if (p.need == CoreProtocol::NNotify)
+                    return; // waits for the server
+                if (p.need == CoreProtocol::NSASLFirst) {
+                    saslAsked = true;
+                    p.setSASLFirst(QStringLiteral("PLAIN"), PlainStep);
+                } else if (p.need != CoreProtocol::NSASLLayer) {
+                    failed = true;
+                }
+                continue;
+            }
+            if (p.event == CoreProtocol::ESend) {
+                QByteArray a;
+                while (!(a = p.takeOutgoingData()).isEmpty()) {
+                    sent += a;
+                    p.outgoingDataWritten(a.size());
+                }
+            } else if (p.event == CoreProtocol::EReady) {
+                ready = true;
+            } else if (p.event == CoreProtocol::EError) {
+                failed = true;
+            }
+        }
+    }
+
+    void reply(const QByteArray &data)
+    {
+        roundTrips++;
+        p.addIncomingData(data);
+        run();
+    }
+};
+
+class ProtocolTest : public QObject {
+    Q_OBJECT
+
+private:
+    static QByteArray sasl2Features(bool fast)
+    {
+        return "<stream:features><authentication xmlns='urn:xmpp:sasl:2'><mechanism>PLAIN</mechanism><inline>"
+               "<sm xmlns='urn:xmpp:sm:3'/>"
+               "<bind xmlns='urn:xmpp:bind:0'><inline><feature var='urn:xmpp:carbons:2'/>"
+               "<feature var='urn:xmpp:csi:0'/><feature var='urn:xmpp:sm:3'/></inline></bind>"
+            + QByteArray(fast ? "<fast xmlns='urn:xmpp:fast:0'><mechanism>HT-SHA-256-NONE</mechanism></fast>" : "")
+            + "</inline></authentication></stream:features>";
+    }
+
+    static QByteArray sasl2Success(const QByteArray &extra)
+    {
+        return "<success xmlns='urn:xmpp:sasl:2'>" + extra
+            + "<authorization-identifier>user@example.org/Psi.42</authorization-identifier>"
+              "<bound xmlns='urn:xmpp:bind:0'><enabled xmlns='urn:xmpp:sm:3' id='sm1' resume='true'/></bound>"
+              "</success>";
+    }
+
+    static void startSASL2(ScriptedLogin &login)
+    {
+        login.start(Jid("user@example.org"));
+        login.p.setSASL2(true, QStringLiteral("d4565fa7-4d72-4749-b3d3-740edbf87770"), QStringLiteral("Psi"),
+                         QStringLiteral("laptop"));
+        login.p.setBind2(QStringLiteral("Psi"), true, true);
+    }
+
+private slots:
+    void testLegacyLogin_PipelinesSMEnableWithBind()
+    {
+        ScriptedLogin login;
+        login.start(Jid("user@example.org/psi"));
+        login.run();
+        login.reply(StreamHeader
+                    + "<stream:features><mechanisms xmlns='urn:ietf:params:xml:ns:xmpp-sasl'>"
+                      "<mechanism>PLAIN</mechanism></mechanisms></stream:features>");
+        QVERIFY(login.sent.contains("urn:ietf:params:xml:ns:xmpp-sasl"));
+        login.reply("<success xmlns='urn:ietf:params:xml:ns:xmpp-sasl'/>");
+        login.reply(StreamHeader
+                    + "<stream:features><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'/>"
+                      "<sm xmlns='urn:xmpp:sm:3'/></stream:features>");
+        QVERIFY(login.sent.contains("bind_1"));
+        QVERIFY(login.sent.contains("<enable"));
+        QVERIFY(!login.ready);
+        login.reply("<iq type='result' id='bind_1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'>"
+                    "<jid>user@example.org/psi</jid></bind></iq>"
+                    "<enabled xmlns='urn:xmpp:sm:3' id='sm1' resume='true'/>");
+
+        QVERIFY(login.ready);
+        QCOMPARE(login.roundTrips, 4);
+        QVERIFY(login.p.sm.isActive());
+    }
+
+    void testSASL2Login_BindsInline()
+    {
+        ScriptedLogin login;
+        startSASL2(login);
+        login.run();
+        login.reply(StreamHeader + sasl2Features(false));
+
+        QVERIFY(login.saslAsked);
+        QVERIFY(login.sent.contains("<authenticate"));
+        QVERIFY(login.sent.contains("urn:xmpp:bind:0"));
+        QVERIFY(login.sent.contains("urn:xmpp:carbons:2"));
+        QVERIFY(login.sent.contains("urn:xmpp:csi:0"));
+        QVERIFY(!login.sent.contains("request-token"));
+        login.reply(sasl2Success(QByteArray()));
+
+        QVERIFY(login.ready);
+        QCOMPARE(login.roundTrips, 2);
+        QCOMPARE(login.p.jid().full(), QStringLiteral("user@example.org/Psi.42"));
+        QVERIFY(login.p.bind2_enabled.contains(NS_CARBONS));
+        QVERIFY(login.p.sm.isActive());
+    }
+
+    void testFastLogin_UsesIssuedToken()
+    {
+        if (!QCA::isSupported("hmac(sha256)"))
+            QSKIP("hmac(sha256) not supported in QCA.");
+
+        FastToken token;
+        {
+            ScriptedLogin login;
+            startSASL2(login);
+            login.run();
+            login.reply(StreamHeader + sasl2Features(true));
+            QVERIFY(login.sent.contains("request-token"));
+            login.reply(sasl2Success("<token xmlns='urn:xmpp:fast:0' token='s3cr3t'/>"));
+            QVERIFY(login.ready);
+            token = login.p.fast;
+        }
+        QVERIFY(token.isValid());
+        QCOMPARE(token.secret, QByteArray("s3cr3t"));
+
+        ScriptedLogin login;
+        startSASL2(login);
+        login.p.fast = token;
+        login.run();
+        login.reply(StreamHeader + sasl2Features(true));
+        QVERIFY(!login.saslAsked);
+        QVERIFY(login.sent.contains("HT-SHA-256-NONE"));
+
+        QByteArray responder = QCA::MessageAuthenticationCode("hmac(sha256)", QCA::SymmetricKey(token.secret))
+                                   .process("Responder")
+                                   .toByteArray();
+        login.reply(sasl2Success("<additional-data>" + QCA::Base64().arrayToString(responder).toLatin1()
+                                 + "</additional-data>"));
+        QVERIFY(login.ready);
+        QCOMPARE(login.roundTrips, 2);
+        QCOMPARE(login.p.fast.count, 1);
+    }
+
+    void testFastLogin_RejectsWrongResponder()
+    {
+        if (!QCA::isSupported("hmac(sha256)"))
+            QSKIP("hmac(sha256) not supported in QCA.");
+
+        ScriptedLogin login;
+        startSASL2(login);
+        login.p.fast.mechanism = QStringLiteral("HT-SHA-256-NONE");
+        login.p.fast.secret    = "s3cr3t";
+        login.run();
+        login.reply(StreamHeader + sasl2Features(true));
+        login.reply(sasl2Success("<additional-data>Zm9v</additional-data>"));
+
+        QVERIFY(login.failed);
+        QVERIFY(!login.p.fast.isValid());
+    }
+
+    void testSM_GroupChatMessagesNotResent()
+    {
+        CoreProtocol p;
+        p.sm.start(QStringLiteral("sm1"));
+        QDomDocument doc;
+        auto const   send = [&](const QString &xml) {
+            doc.setContent(xml, true);
+            p.sendStanza(doc.documentElement());
+        };
+        send("<message xmlns='jabber:client' to='juliet@example.com' type='chat'><body>hi</body></message>");
+        send("<message xmlns='jabber:client' to='room@muc.example.com' type='groupchat'><body>all</body></message>");
+        send("<message xmlns='jabber:client' to='juliet@example.com'>"
+             "<active xmlns='http://jabber.org/protocol/chatstates'/></message>");
+
+        auto const &queue = p.sm.state().send_queue;
+        QCOMPARE(queue.size(), 3);
+        QCOMPARE(queue.at(0).kind, SMSendQueue::Message);
+        QCOMPARE(queue.at(1).kind, SMSendQueue::Other);
+        QCOMPARE(queue.at(2).kind, SMSendQueue::ChatState);
+        QCOMPARE(p.sm.unacknowledgedMessages().size(), 1);
+        QVERIFY(p.sm.unacknowledgedMessages().first().contains("<body>hi</body>"));
+
+        // after a failed resumption only the chat message is sent again
+        p.sm.start(QStringLiteral("sm2"));
+        QCOMPARE(p.sm.takeLostMessages().size(), 1);
+    }
+
+private:
+    QCA::Initializer initializer;
+};
+
+QTTESTUTIL_REGISTER_TEST(ProtocolTest);
+#include "protocoltest.moc"
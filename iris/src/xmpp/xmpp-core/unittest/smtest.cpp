@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp/xmpp-core/sm.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+class SMTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testQueue_DropsChatStatesAndPresenceFirst()
+    {
+        SMSendQueue q;
+        q.setLimit(30, SMSendQueue::DropDisposable);
+        q.enqueue("<message>1</message>", SMSendQueue::Message);
+        q.enqueue("<presence/>", SMSendQueue::Presence);
+        q.enqueue("<message><active/></message>", SMSendQueue::ChatState);
+
+        // the chat state goes first, then the presence
+        QCOMPARE(q.size(), 3);
+        QVERIFY(q.at(2).data.isEmpty());
+        QVERIFY(q.at(1).data.isEmpty());
+        QCOMPARE(q.messages(), QList<QByteArray>() << "<message>1</message>");
+
+        // messages are kept over the limit
+        q.enqueue("<message>2</message>", SMSendQueue::Message);
+        QCOMPARE(q.messages().size(), 2);
+        QVERIFY(q.bytes() > 30);
+
+        q.setLimit(30, SMSendQueue::DropOldest);
+        QCOMPARE(q.messages(), QList<QByteArray>() << "<message>2</message>");
+        QCOMPARE(q.droppedCount(), 3);
+    }
+
+    void testQueue_DropOldestInQueueOrder()
+    {
+        SMSendQueue q;
+        q.enqueue("<message>1</message>", SMSendQueue::Message);
+        q.enqueue("<iq/>", SMSendQueue::Other);
+        q.enqueue("<message>2</message>", SMSendQueue::Message);
+        q.enqueue("<presence/>", SMSendQueue::Presence);
+
+        // the presence goes first, then the oldest stanza whatever its kind
+        q.setLimit(40, SMSendQueue::DropOldest);
+        QVERIFY(q.at(3).data.isEmpty());
+        QVERIFY(q.at(0).data.isEmpty());
+        QCOMPARE(q.at(1).data, QByteArray("<iq/>"));
+        QCOMPARE(q.messages(), QList<QByteArray>() << "<message>2</message>");
+        QCOMPARE(q.droppedCount(), 2);
+    }
+
+    void testResume_SkipsDroppedStanzas()
+    {
+        StreamManagement sm;
+        sm.start(QStringLiteral("sm1"));
+        sm.state().send_queue.setLimit(25, SMSendQueue::DropDisposable);
+        sm.addUnacknowledgedStanza("<message>1</message>", SMSendQueue::Message);
+        sm.addUnacknowledgedStanza("<presence/>", SMSendQueue::Presence);
+        sm.addUnacknowledgedStanza("<iq/>", SMSendQueue::Other);
+
+        // the server has handled the first one, the dropped presence still counts
+        sm.resume(1);
+        QCOMPARE(sm.state().send_queue.size(), 2);
+        QCOMPARE(sm.getUnacknowledgedStanza(), QByteArray("<iq/>"));
+        QVERIFY(sm.getUnacknowledgedStanza().isEmpty());
+        sm.processAcknowledgement(3);
+        QVERIFY(sm.state().send_queue.isEmpty());
+    }
+
+    void testStart_KeepsMessagesOfFailedSession()
+    {
+        StreamManagement sm;
+        sm.start(QStringLiteral("sm1"));
+        sm.addUnacknowledgedStanza("<message>1</message>", SMSendQueue::Message);
+        sm.addUnacknowledgedStanza("<iq/>", SMSendQueue::Other);
+
+        sm.start(QStringLiteral("sm2"));
+        QVERIFY(sm.state().send_queue.isEmpty());
+        QCOMPARE(sm.unacknowledgedMessages(), QList<QByteArray>() << "<message>1</message>");
+        QCOMPARE(sm.takeLostMessages(), QList<QByteArray>() << "<message>1</message>");
+        QVERIFY(sm.unacknowledgedMessages().isEmpty());
+    }
+
+    void testAckRequestCadence()
+    {
+        StreamManagement sm;
+        sm.start(QString());
+        sm.setAckRequestCadence(3, 100);
+        sm.addUnacknowledgedStanza("<iq/>", SMSendQueue::Other);
+        sm.addUnacknowledgedStanza("<iq/>", SMSendQueue::Other);
+        QVERIFY(!sm.isAckRequestDue());
+        sm.addUnacknowledgedStanza("<iq/>", SMSendQueue::Other);
+        QVERIFY(sm.isAckRequestDue());
+
+        QDomDocument doc;
+        QVERIFY(!sm.generateRequestStanza(doc).isNull());
+        QVERIFY(!sm.isAckRequestDue());
+        sm.addUnacknowledgedStanza(QByteArray(100, 'x'), SMSendQueue::Message);
+        QVERIFY(sm.isAckRequestDue());
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(SMTest);
+#include "smtest.moc"
@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp/xmpp-core/xmlprotocol.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QtTest/QtTest>
+
+#include <algorithm>
+
+using namespace XMPP;
+
+static const QString ClientNS = QStringLiteral("jabber:client");
+
+//----------------------------------------------------------------------------
+// The QDom based serializer XmlProtocol used before, kept as the reference
+//----------------------------------------------------------------------------
+// stripExtraNS
+//
+// This function removes namespace information from various nodes for
+// display purposes only (the element is pretty much useless for processing
+// after this).  We do this because QXml is a bit overzealous about outputting
+// redundant namespaces.
+static QDomElement legacyStripExtraNS(const QDomElement &e)
+{
+    // find closest parent with a namespace
+    QDomNode par = e.parentNode();
+    while (!par.isNull() && par.namespaceURI().isNull())
+        par = par.parentNode();
+    bool noShowNS = false;
+    if (!par.isNull() && par.namespaceURI() == e.namespaceURI())
+        noShowNS = true;
+
+    // build qName (prefix:localName)
+    QString qName;
+    if (!e.prefix().isEmpty())
+        qName = e.prefix() + ':' + e.localName();
+    else
+        qName = e.tagName();
+
+    QDomElement i;
+    int         x;
+    if (noShowNS)
+        i = e.ownerDocument().createElement(qName);
+    else
+        i = e.ownerDocument().createElementNS(e.namespaceURI(), qName);
+
+    // copy attributes
+    QDomNamedNodeMap al = e.attributes();
+    for (x = 0; x < al.count(); ++x) {
+        QDomAttr a = al.item(x).cloneNode().toAttr();
+
+        // don't show xml namespace
+        if (a.namespaceURI() == NS_XML)
+            i.setAttribute(QString("xml:") + a.name(), a.value());
+        else
+            i.setAttributeNodeNS(a);
+    }
+
+    // copy children
+    QDomNodeList nl = e.childNodes();
+    for (x = 0; x < nl.count(); ++x) {
+        QDomNode n = nl.item(x);
+        if (n.isElement())
+            i.appendChild(legacyStripExtraNS(n.toElement()));
+        else
+            i.appendChild(n.cloneNode());
+    }
+    return i;
+}
+
+// xmlToString
+//
+// This function converts a QDomElement into a QString, using stripExtraNS
+// to make it pretty.
+static QString legacyXmlToString(const QDomElement &e, const QString &fakeNS, const QString &fakeQName, bool clip)
+{
+    QDomElement i = e.cloneNode().toElement();
+
+    // It seems QDom can only have one namespace attribute at a time (see docElement 'HACK').
+    // Fortunately we only need one kind depending on the input, so it is specified here.
+    QDomElement fake = e.ownerDocument().createElementNS(fakeNS, fakeQName);
+    fake.appendChild(i);
+    fake = legacyStripExtraNS(fake);
+    QString out;
+    {
+        QTextStream ts(&out, QIODevice::WriteOnly);
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        // NOTE: Workaround for bug in QtXML https://bugreports.qt.io/browse/QTBUG-25291 (Qt4 and Qt5 MinGW only):
+        // Qt by default convert low surrogate to XML notation &#x....; and let high in binary!
+        //
+        // Qt is calling encode function per UTF-16 codepoint, which means that high and low
+        // surrogate pairs are encoded separately. So all encoding except UTF-16 will leads
+        // to damaged Unicode characters above 0xFFFF. Internal QString encoding is UTF-16
+        // so this should be safe as QString still contains valid Unicode characters.
+        ts.setCodec("UTF-16");
+#endif
+        fake.firstChild().save(ts, 0);
+    }
+    // 'clip' means to remove any unwanted (and unneeded) characters, such as a trailing newline
+    if (clip) {
+        int n = out.lastIndexOf('>');
+        out.truncate(n + 1);
+    }
+    return out;
+}
+
+// w3c xml spec:
+// [2] Char ::= #x9 | #xA | #xD | [#x20-#xD7FF] | [#xE000-#xFFFD] | [#x10000-#x10FFFF]
+static inline bool validChar(const quint32 ch)
+{
+    return ch == 0x9 || ch == 0xA || ch == 0xD || (ch >= 0x20 && ch <= 0xD7FF) || (ch >= 0xE000 && ch <= 0xFFFD)
+        || (ch >= 0x10000 && ch <= 0x10FFFF);
+}
+
+static inline bool lowSurrogate(const quint32 ch) { return ch >= 0xDC00 && ch <= 0xDFFF; }
+
+static inline bool highSurrogate(const quint32 ch) { return ch >= 0xD800 && ch <= 0xDBFF; }
+
+// force encoding of '>'.  this function is needed for XMPP-Core, which
+//  requires the '>' character to be encoded as "&gt;" even though this is
+//  not required by the XML spec.
+// Also remove chars that are ouside the allowed range for XML (see validChar)
+//  and invalid surrogate pairs
+static QString legacySanitizeForStream(const QString &in)
+{
+    QString out;
+    bool    intag   = false;
+    bool    inquote = false;
+    QChar   quotechar;
+    int     inlength = in.length();
+    for (int n = 0; n < inlength; ++n) {
+        QChar c      = in[n];
+        bool  escape = false;
+        if (c == '<') {
+            intag = true;
+        } else if (c == '>') {
+            if (inquote) {
+                escape = true;
+            } else if (!intag) {
+                escape = true;
+            } else {
+                intag = false;
+            }
+        } else if (c == '\'' || c == '\"') {
+            if (intag) {
+                if (!inquote) {
+                    inquote   = true;
+                    quotechar = c;
+                } else {
+                    if (quotechar == c) {
+                        inquote = false;
+                    }
+                }
+            }
+        }
+
+        if (escape) {
+            out += "&gt;";
+        } else {
+            // don't silently drop invalid chars in element or attribute names,
+            // because that's something that should not happen.
+            if (intag && (!inquote)) {
+                out += c;
+            } else if (validChar(c.unicode())) {
+                out += c;
+            } else if (highSurrogate(c.unicode()) && (n + 1 < inlength) && lowSurrogate(in[n + 1].unicode())) {
+                // uint unicode = (c.unicode() & 0x3FF) << 10 | in[n+1].unicode() & 0x3FF + 0x10000;
+                // we don't need to recheck this, because 0x10000 <= unicode <= 0x100000 is always true
+                out += c;
+                out += in[n + 1];
+                ++n;
+            } else {
+                qDebug("Dropping invalid XML char U+%04x", c.unicode());
+            }
+        }
+    }
+    return out;
+}
+
+static QByteArray legacySerialize(const QDomElement &e)
+{
+    return legacySanitizeForStream(legacyXmlToString(e, ClientNS, QStringLiteral("stream:stream"), true)).toUtf8();
+}
+
+static QByteArray directSerialize(const QDomElement &e)
+{
+    QByteArray out;
+    appendXmlElement(out, e, ClientNS);
+    return out;
+}
+
+// Parses serialized stanza the way it would be read from a client stream
+// and describes it in a form which doesn't depend on prefixes, attribute order
+// and the newlines QDom puts between elements.
+static QString canonical(const QDomElement &e)
+{
+    QString     ret = QLatin1Char('{') + e.namespaceURI() + QLatin1Char('}') + e.localName();
+    QStringList attrs;
+    auto const  al = e.attributes();
+    for (int i = 0; i < al.count(); ++i) {
+        auto const a = al.item(i).toAttr();
+        if (a.name().startsWith(QLatin1String("xmlns")) || a.prefix() == QLatin1String("xmlns"))
+            continue;
+        attrs << QLatin1Char('{') + a.namespaceURI() + QLatin1Char('}') + a.localName() + QLatin1Char('=')
+                + a.value();
+    }
+    attrs.sort();
+    ret += QLatin1Char('[') + attrs.join(QLatin1Char(',')) + QLatin1Char(']');
+
+    QStringList children;
+    QString     text;
+    for (auto n = e.firstChild(); !n.isNull(); n = n.nextSibling()) {
+        if (n.isText()) {
+            text += n.nodeValue();
+            continue;
+        }
+        if (!text.trimmed().isEmpty())
+            children << QLatin1Char('"') + text + QLatin1Char('"');
+        text.clear();
+        if (n.isElement())
+            children << canonical(n.toElement());
+    }
+    if (!text.trimmed().isEmpty())
+        children << QLatin1Char('"') + text + QLatin1Char('"');
+    return ret + QLatin1Char('(') + children.join(QLatin1Char(' ')) + QLatin1Char(')');
+}
+
+static QString canonical(const QByteArray &xml)
+{
+    QDomDocument doc;
+    QByteArray   wrapped = "<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>" + xml
+        + "</stream:stream>";
+    if (!doc.setContent(wrapped, true))
+        return QStringLiteral("not well-formed: ") + QString::fromUtf8(xml);
+    return canonical(doc.documentElement().firstChildElement());
+}
+
+class RandomStanza {
+public:
+    explicit RandomStanza(quint32 seed) : rng(seed) { }
+
+    QDomElement make(QDomDocument &doc)
+    {
+        auto e = doc.createElementNS(ClientNS, pick({ "message", "presence", "iq" }));
+        fill(doc, e, 0);
+        return e;
+    }
+
+private:
+    QRandomGenerator rng;
+
+    QString pick(std::initializer_list<const char *> list)
+    {
+        return QString::fromLatin1(*(list.begin() + rng.bounded(int(list.size()))));
+    }
+
+    QString text()
+    {
+        static const QList<QChar> special { QChar(' '),    QChar('<'),    QChar('>'),    QChar('&'),    QChar('"'),
+                                            QChar('\''),   QChar('\n'),   QChar('\t'),   QChar(0x00E9), QChar(0x4E2D),
+                                            QChar(0x0001), QChar(0xFFFF), QChar(0xD800), QChar(']') };
+        QString                   ret = QChar('a' + rng.bounded(26));
+        int                       len = rng.bounded(20);
+        for (int i = 0; i < len; ++i) {
+            int r = rng.bounded(100);
+            if (r < 60)
+                ret += QChar('a' + rng.bounded(26));
+            else if (r < 65)
+                ret += QString::fromUcs4(U"\U0001F600");
+            else
+                ret += special[rng.bounded(special.size())];
+        }
+        return ret;
+    }
+
+    void fill(QDomDocument &doc, QDomElement &e, int depth)
+    {
+        int attrs = rng.bounded(4);
+        for (int i = 0; i < attrs; ++i) {
+            switch (rng.bounded(4)) {
+            case 0:
+                e.setAttribute(pick({ "id", "type", "to", "from" }), text());
+                break;
+            case 1:
+                e.setAttribute(QStringLiteral("node"), text());
+                break;
+            case 2:
+                e.setAttributeNS(QLatin1String(NS_XML), QStringLiteral("xml:lang"), pick({ "en", "de", "ru" }));
+                break;
+            case 3:
+                e.setAttributeNS(QStringLiteral("urn:x"), QStringLiteral("x:attr"), text());
+                break;
+            }
+        }
+
+        int  children = depth < 4 ? rng.bounded(5) : 0;
+        bool lastText = false;
+        for (int i = 0; i < children; ++i) {
+            if (!lastText && rng.bounded(3) == 0) {
+                e.appendChild(doc.createTextNode(text()));
+                lastText = true;
+                continue;
+            }
+            QDomElement c;
+            switch (rng.bounded(5)) {
+            case 0:
+                c = doc.createElement(pick({ "body", "subject", "thread" }));
+                break;
+            case 1: // the reference gets it wrong under prefixed elements
+                c = doc.createElementNS(e.prefix().isEmpty() && !e.namespaceURI().isNull() ? e.namespaceURI() : ClientNS,
+                                        pick({ "body", "x" }));
+                break;
+            case 2:
+                c = doc.createElementNS(QStringLiteral("urn:a"), pick({ "active", "query", "item" }));
+                break;
+            case 3:
+                c = doc.createElementNS(QStringLiteral("urn:b"), pick({ "origin-id", "item" }));
+                break;
+            case 4:
+                c = doc.createElementNS(QStringLiteral("urn:p"), QStringLiteral("p:item"));
+                break;
+            }
+            fill(doc, c, depth + 1);
+            e.appendChild(c);
+            lastText = false;
+        }
+    }
+};
+
+static QDomElement typicalMessage(QDomDocument &doc)
+{
+    auto m = doc.createElementNS(ClientNS, QStringLiteral("message"));
+    m.setAttribute(QStringLiteral("to"), QStringLiteral("juliet@capulet.example/balcony"));
+    m.setAttribute(QStringLiteral("type"), QStringLiteral("chat"));
+    m.setAttribute(QStringLiteral("id"), QStringLiteral("a9f3c1e2-5d4b-4c8e-9a7f-2b1d3e4f5a6b"));
+    auto body = doc.createElementNS(ClientNS, QStringLiteral("body"));
+    body.appendChild(doc.createTextNode(
+        QString::fromUtf8("Wherefore art thou, Romeo? Deny thy father & refuse thy name; <or> if thou wilt not, "
+                          "be but sworn my love. Привет, 你好 \xF0\x9F\x98\x80")
+            .repeated(2)));
+    m.appendChild(body);
+    m.appendChild(doc.createElementNS(QStringLiteral("http://jabber.org/protocol/chatstates"),
+                                      QStringLiteral("active")));
+    auto origin = doc.createElementNS(QStringLiteral("urn:xmpp:sid:0"), QStringLiteral("origin-id"));
+    origin.setAttribute(QStringLiteral("id"), QStringLiteral("a9f3c1e2-5d4b-4c8e-9a7f-2b1d3e4f5a6b"));
+    m.appendChild(origin);
+    m.appendChild(doc.createElementNS(QStringLiteral("urn:xmpp:chat-markers:0"), QStringLiteral("markable")));
+    return m;
+}
+
+class XmlProtocolTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testStreamNamespaceIsNotRepeated()
+    {
+        QDomDocument doc;
+        auto         m = doc.createElementNS(ClientNS, QStringLiteral("message"));
+        m.appendChild(doc.createElementNS(ClientNS, QStringLiteral("body")));
+        m.appendChild(doc.createElementNS(QStringLiteral("urn:xmpp:sid:0"), QStringLiteral("origin-id")));
+
+        QCOMPARE(directSerialize(m), QByteArray("<message><body/><origin-id xmlns=\"urn:xmpp:sid:0\"/></message>"));
+    }
+
+    void testPrefixedElementKeepsDefaultNamespace()
+    {
+        QDomDocument doc;
+        auto         m    = doc.createElementNS(ClientNS, QStringLiteral("message"));
+        auto         item = doc.createElementNS(QStringLiteral("urn:p"), QStringLiteral("p:item"));
+        item.appendChild(doc.createElementNS(QStringLiteral("urn:p"), QStringLiteral("p:value")));
+        item.appendChild(doc.createElementNS(QStringLiteral("urn:p"), QStringLiteral("value")));
+        item.appendChild(doc.createElementNS(ClientNS, QStringLiteral("body")));
+        m.appendChild(item);
+
+        QCOMPARE(directSerialize(m),
+                 QByteArray("<message><p:item xmlns:p=\"urn:p\"><p:value/><value xmlns=\"urn:p\"/><body/></p:item>"
+                            "</message>"));
+    }
+
+    void testEscaping()
+    {
+        QDomDocument doc;
+        auto         m = doc.createElementNS(ClientNS, QStringLiteral("message"));
+        m.setAttribute(QStringLiteral("id"), QStringLiteral("a\"b>\nc"));
+        auto body = doc.createElementNS(ClientNS, QStringLiteral("body"));
+        body.appendChild(doc.createTextNode(QStringLiteral("1 < 2 > 0 & \"ok\"")));
+        m.appendChild(body);
+
+        QCOMPARE(directSerialize(m),
+                 QByteArray("<message id=\"a&quot;b&gt;&#xa;c\"><body>1 &lt; 2 &gt; 0 &amp; \"ok\"</body></message>"));
+    }
+
+    void testInvalidCharsAreDropped()
+    {
+        QDomDocument doc;
+        auto         body = doc.createElementNS(ClientNS, QStringLiteral("body"));
+        QString      text = QStringLiteral("a") + QChar(0x0001) + QChar(0xD800) + QChar(0xFFFE) + QChar(0x00E9)
+            + QString::fromUcs4(U"\U0001F600");
+        body.appendChild(doc.createTextNode(text));
+
+        QCOMPARE(directSerialize(body), QByteArray("<body>a\xC3\xA9\xF0\x9F\x98\x80</body>"));
+    }
+
+    void testEquivalentToLegacyOutput()
+    {
+        for (quint32 seed = 1; seed <= 2000; ++seed) {
+            QDomDocument doc;
+            auto         e = RandomStanza(seed).make(doc);
+
+            auto direct = directSerialize(e);
+            auto legacy = legacySerialize(e);
+            if (canonical(direct) != canonical(legacy)) {
+                qWarning("seed %u\n direct: %s\n legacy: %s", seed, direct.constData(), legacy.constData());
+            }
+            QCOMPARE(canonical(direct), canonical(legacy));
+        }
+    }
+
+    void benchmarkSerialize_data()
+    {
+        QTest::addColumn<bool>("direct");
+        QTest::newRow("legacy") << false;
+        QTest::newRow("direct") << true;
+    }
+
+    // Each iteration writes 1000 stanzas, so msecs per iteration read as msecs per 1000 stanzas
+    void benchmarkSerialize()
+    {
+        QFETCH(bool, direct);
+        QDomDocument doc;
+        auto         m = typicalMessage(doc);
+
+        QBENCHMARK
+        {
+            QByteArray out;
+            for (int i = 0; i < 1000; ++i) {
+                if (direct)
+                    appendXmlElement(out, m, ClientNS);
+                else
+                    out += legacySerialize(m);
+            }
+        }
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(XmlProtocolTest);
+#include "xmlprotocoltest.moc"
@@ -23,99 +23,12 @@
 
 #include <QByteArray>
 #include <QList>
+#include <QStringView>
 #include <QTextStream>
 
-using namespace XMPP;
-
-// stripExtraNS
-//
-// This function removes namespace information from various nodes for
-// display purposes only (the element is pretty much useless for processing
-// after this).  We do this because QXml is a bit overzealous about outputting
-// redundant namespaces.
-static QDomElement stripExtraNS(const QDomElement &e)
-{
-    // find closest parent with a namespace
-    QDomNode par = e.parentNode();
-    while (!par.isNull() && par.namespaceURI().isNull())
-        par = par.parentNode();
-    bool noShowNS = false;
-    if (!par.isNull() && par.namespaceURI() == e.namespaceURI())
-        noShowNS = true;
-
-    // build qName (prefix:localName)
-    QString qName;
-    if (!e.prefix().isEmpty())
-        qName = e.prefix() + ':' + e.localName();
-    else
-        qName = e.tagName();
-
-    QDomElement i;
-    int         x;
-    if (noShowNS)
-        i = e.ownerDocument().createElement(qName);
-    else
-        i = e.ownerDocument().createElementNS(e.namespaceURI(), qName);
-
-    // copy attributes
-    QDomNamedNodeMap al = e.attributes();
-    for (x = 0; x < al.count(); ++x) {
-        QDomAttr a = al.item(x).cloneNode().toAttr();
+#include <vector>
 
-        // don't show xml namespace
-        if (a.namespaceURI() == NS_XML)
-            i.setAttribute(QString("xml:") + a.name(), a.value());
-        else
-            i.setAttributeNodeNS(a);
-    }
-
-    // copy children
-    QDomNodeList nl = e.childNodes();
-    for (x = 0; x < nl.count(); ++x) {
-        QDomNode n = nl.item(x);
-        if (n.isElement())
-            i.appendChild(stripExtraNS(n.toElement()));
-        else
-            i.appendChild(n.cloneNode());
-    }
-    return i;
-}
-
-// xmlToString
-//
-// This function converts a QDomElement into a QString, using stripExtraNS
-// to make it pretty.
-static QString xmlToString(const QDomElement &e, const QString &fakeNS, const QString &fakeQName, bool clip)
-{
-    QDomElement i = e.cloneNode().toElement();
-
-    // It seems QDom can only have one namespace attribute at a time (see docElement 'HACK').
-    // Fortunately we only need one kind depending on the input, so it is specified here.
-    QDomElement fake = e.ownerDocument().createElementNS(fakeNS, fakeQName);
-    fake.appendChild(i);
-    fake = stripExtraNS(fake);
-    QString out;
-    {
-        QTextStream ts(&out, QIODevice::WriteOnly);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-        // NOTE: Workaround for bug in QtXML https://bugreports.qt.io/browse/QTBUG-25291 (Qt4 and Qt5 MinGW only):
-        // Qt by default convert low surrogate to XML notation &#x....; and let high in binary!
-        //
-        // Qt is calling encode function per UTF-16 codepoint, which means that high and low
-        // surrogate pairs are encoded separately. So all encoding except UTF-16 will leads
-        // to damaged Unicode characters above 0xFFFF. Internal QString encoding is UTF-16
-        // so this should be safe as QString still contains valid Unicode characters.
-        ts.setCodec("UTF-16");
-#endif
-        fake.firstChild().save(ts, 0);
-    }
-    // 'clip' means to remove any unwanted (and unneeded) characters, such as a trailing newline
-    if (clip) {
-        int n = out.lastIndexOf('>');
-        out.truncate(n + 1);
-    }
-    return out;
-}
+using namespace XMPP;
 
 // createRootXmlTags
 //
@@ -169,6 +82,198 @@ static inline bool lowSurrogate(const quint32 ch) { return ch >= 0xDC00 && ch <=
 
 static inline bool highSurrogate(const quint32 ch) { return ch >= 0xD800 && ch <= 0xDBFF; }
 
+enum class Escape { None, Text, Attribute };
+
+// Appends \a s as UTF-8. Unless \a escape is None, markup characters are escaped
+// (including '>', which XMPP-Core requires) and chars that are not allowed in XML
+// are dropped, see validChar.
+static void appendUtf8(QByteArray &out, QStringView s, Escape escape)
+{
+    const char16_t *p = reinterpret_cast<const char16_t *>(s.data());
+    const qsizetype n = s.size();
+    for (qsizetype i = 0; i < n; ++i) {
+        const char16_t c = p[i];
+        if (c < 0x80) {
+            if (escape == Escape::None) {
+                out += char(c);
+                continue;
+            }
+            switch (c) {
+            case '<':
+                out += "&lt;";
+                break;
+            case '>':
+                out += "&gt;";
+                break;
+            case '&':
+                out += "&amp;";
+                break;
+            case '"':
+                out += escape == Escape::Attribute ? "&quot;" : "\"";
+                break;
+            case 0x9:
+                out += escape == Escape::Attribute ? "&#x9;" : "\t";
+                break;
+            case 0xA:
+                out += escape == Escape::Attribute ? "&#xa;" : "\n";
+                break;
+            case 0xD:
+                out += escape == Escape::Attribute ? "&#xd;" : "\r";
+                break;
+            default:
+                if (c >= 0x20)
+                    out += char(c);
+                else
+                    qDebug("Dropping invalid XML char U+%04x", unsigned(c));
+            }
+        } else if (c < 0x800) {
+            out += char(0xC0 | (c >> 6));
+            out += char(0x80 | (c & 0x3F));
+        } else if (highSurrogate(c) && i + 1 < n && lowSurrogate(p[i + 1])) {
+            const quint32 ucs = 0x10000 + ((quint32(c) - 0xD800) << 10) + (quint32(p[i + 1]) - 0xDC00);
+            out += char(0xF0 | (ucs >> 18));
+            out += char(0x80 | ((ucs >> 12) & 0x3F));
+            out += char(0x80 | ((ucs >> 6) & 0x3F));
+            out += char(0x80 | (ucs & 0x3F));
+            ++i;
+        } else if (escape != Escape::None && !validChar(c)) {
+            qDebug("Dropping invalid XML char U+%04x", unsigned(c));
+        } else {
+            out += char(0xE0 | (c >> 12));
+            out += char(0x80 | ((c >> 6) & 0x3F));
+            out += char(0x80 | (c & 0x3F));
+        }
+    }
+}
+
+// The qualified name as it was written or created, without any namespace lookups
+static QString qualifiedName(const QDomNode &n)
+{
+    return n.prefix().isEmpty() ? n.nodeName() : n.prefix() + QLatin1Char(':') + n.localName();
+}
+
+// prefixes declared by the elements being written, innermost first
+struct PrefixScope {
+    QString            prefix;
+    QString            ns;
+    const PrefixScope *up;
+
+    bool binds(const QString &p, const QString &uri) const
+    {
+        for (auto s = this; s; s = s->up) {
+            if (s->prefix == p)
+                return s->ns == uri;
+        }
+        return false;
+    }
+};
+
+static void appendNSDeclaration(QByteArray &out, const QString &prefix, const QString &ns)
+{
+    out += " xmlns";
+    if (!prefix.isEmpty()) {
+        out += ':';
+        appendUtf8(out, prefix, Escape::None);
+    }
+    out += "=\"";
+    appendUtf8(out, ns, Escape::Attribute);
+    out += '"';
+}
+
+// defaultNS is the default namespace where e is written. Elements created without
+// a namespace inherit it, so QDom's redundant xmlns attributes don't end up on the wire.
+static void appendElement(QByteArray &out, const QDomElement &e, const QString &defaultNS,
+                          const PrefixScope *scope)
+{
+    const QString ns      = e.namespaceURI();
+    const QString prefix  = e.prefix();
+    const QString qName   = qualifiedName(e);
+    QString       childNS = defaultNS;
+    PrefixScope   own { prefix, ns, scope };
+    out += '<';
+    appendUtf8(out, qName, Escape::None);
+    if (!ns.isNull()) {
+        if (prefix.isEmpty()) {
+            if (ns != defaultNS)
+                appendNSDeclaration(out, prefix, ns);
+            childNS = ns;
+        } else if (!(scope && scope->binds(prefix, ns))) {
+            appendNSDeclaration(out, prefix, ns);
+            scope = &own;
+        }
+    }
+
+    const QDomNamedNodeMap   attrs = e.attributes();
+    std::vector<PrefixScope> declared; // attribute prefixes
+    declared.reserve(size_t(attrs.count()));
+    for (int x = 0; x < attrs.count(); ++x) {
+        const QDomAttr a     = attrs.item(x).toAttr();
+        const QString  attNS = a.namespaceURI();
+        out += ' ';
+        if (attNS.isNull() || a.prefix().isEmpty()) {
+            appendUtf8(out, a.nodeName(), Escape::None);
+        } else if (attNS == QLatin1String(NS_XML)) {
+            out += "xml:";
+            appendUtf8(out, a.localName(), Escape::None);
+        } else {
+            appendUtf8(out, qualifiedName(a), Escape::None);
+            bool bound = scope && scope->binds(a.prefix(), attNS);
+            for (auto const &d : declared)
+                bound = bound || (d.prefix == a.prefix() && d.ns == attNS);
+            if (!bound) {
+                appendNSDeclaration(out, a.prefix(), attNS);
+                declared.push_back(PrefixScope { a.prefix(), attNS, nullptr });
+            }
+        }
+        out += "=\"";
+        appendUtf8(out, a.value(), Escape::Attribute);
+        out += '"';
+    }
+    for (auto &d : declared) {
+        d.up  = scope;
+        scope = &d;
+    }
+
+    QDomNode n = e.firstChild();
+    if (n.isNull()) {
+        out += "/>";
+        return;
+    }
+    out += '>';
+    for (; !n.isNull(); n = n.nextSibling()) {
+        if (n.isElement()) {
+            appendElement(out, n.toElement(), childNS, scope);
+        } else if (n.isText()) { // CDATA sections too, written as escaped text
+            appendUtf8(out, n.nodeValue(), Escape::Text);
+        } else if (n.isEntityReference()) {
+            out += '&';
+            appendUtf8(out, n.nodeName(), Escape::None);
+            out += ';';
+        }
+        // comments and processing instructions are not allowed in XMPP streams
+    }
+    out += "</";
+    appendUtf8(out, qName, Escape::None);
+    out += '>';
+}
+
+/**
+ * Serializes \a e straight into \a out as UTF-8 ready to be sent: markup is escaped
+ * as XMPP-Core requires and chars not allowed in XML are dropped.
+ * \a contextNS is the namespace the prefix of \a e (or the default namespace if
+ * it has no prefix) is bound to where it's written, so \a e in that namespace
+ * gets no declaration.
+ */
+void XMPP::appendXmlElement(QByteArray &out, const QDomElement &e, const QString &contextNS)
+{
+    if (e.prefix().isEmpty()) {
+        appendElement(out, e, contextNS, nullptr);
+    } else {
+        PrefixScope root { e.prefix(), contextNS, nullptr };
+        appendElement(out, e, QString(), &root);
+    }
+}
+
 // force encoding of '>'.  this function is needed for XMPP-Core, which
 //  requires the '>' character to be encoded as "&gt;" even though this is
 //  not required by the XML spec.
@@ -368,51 +473,42 @@ bool XmlProtocol::processStep()
 
 QString XmlProtocol::xmlEncoding() const { return xml.encoding().toString(); }
 
-QString XmlProtocol::elementToString(const QDomElement &e, bool clip)
+// Returns the namespace in effect where \a e is written into the stream
+QString XmlProtocol::streamNS(const QDomElement &e)
 {
     if (elem.isNull())
         elem = elemDoc.importNode(docElement(), true).toElement();
 
-    // Determine the appropriate 'fakeNS' to use
-    QString ns;
-
     // first, check root namespace
     QString pre = e.prefix();
     if (pre.isNull())
         pre = "";
-    if (pre == elem.prefix()) {
-        ns = elem.namespaceURI();
-    } else {
-        // scan the root attributes for 'xmlns' (oh joyous hacks)
-        QDomNamedNodeMap al = elem.attributes();
-        int              n;
-        for (n = 0; n < al.count(); ++n) {
-            QDomAttr a = al.item(n).toAttr();
-            QString  s = a.name();
-            int      x = s.indexOf(':');
-            if (x != -1)
-                s = s.mid(x + 1);
-            else
-                s = "";
-            if (pre == s) {
-                ns = a.value();
-                break;
-            }
-        }
-        if (n >= al.count()) {
-            // if we get here, then no appropriate ns was found.  use root then..
-            ns = elem.namespaceURI();
-        }
+    if (pre == elem.prefix())
+        return elem.namespaceURI();
+
+    // scan the root attributes for 'xmlns' (oh joyous hacks)
+    QDomNamedNodeMap al = elem.attributes();
+    for (int n = 0; n < al.count(); ++n) {
+        QDomAttr a = al.item(n).toAttr();
+        QString  s = a.name();
+        int      x = s.indexOf(':');
+        if (x != -1)
+            s = s.mid(x + 1);
+        else
+            s = "";
+        if (pre == s)
+            return a.value();
     }
+    // if we get here, then no appropriate ns was found.  use root then..
+    return elem.namespaceURI();
+}
 
-    // build qName
-    QString qn;
-    if (!elem.prefix().isEmpty())
-        qn = elem.prefix() + ':';
-    qn += elem.localName();
-
-    // make the string
-    return sanitizeForStream(xmlToString(e, ns, qn, clip));
+QString XmlProtocol::elementToString(const QDomElement &e, bool clip)
+{
+    Q_UNUSED(clip) // nothing is written after the closing tag anyway
+    QByteArray out;
+    appendXmlElement(out, e, streamNS(e));
+    return QString::fromUtf8(out);
 }
 
 bool XmlProtocol::stepRequiresElement() const
@@ -479,8 +575,19 @@ int XmlProtocol::writeElement(const QDomElement &e, int id, bool external, bool
     transferItemList += TransferItem(e, true, external);
 
     // elementSend(e);
-    QString out = sanitizeForStream(elementToString(e, clip));
-    return internalWriteString(out, TrackItem::Custom, id, urgent);
+    Q_UNUSED(clip)
+    QByteArray &out   = urgent ? outDataUrgent : outDataNormal;
+    const int   start = out.size();
+    appendXmlElement(out, e, streamNS(e));
+    return trackWritten(TrackItem::Custom, id, out.size() - start, urgent);
+}
+
+// writes an element serialized already
+int XmlProtocol::writeData(const QByteArray &a, int id, bool external)
+{
+    // external items aren't shown, so there's no need to convert these
+    transferItemList += TransferItem(external ? QString() : QString::fromUtf8(a), true, external);
+    return internalWriteData(a, TrackItem::Custom, id);
 }
 
 QByteArray XmlProtocol::resetStream()
@@ -498,20 +605,27 @@ QByteArray XmlProtocol::resetStream()
 }
 
 int XmlProtocol::internalWriteData(const QByteArray &a, TrackItem::Type t, int id, bool urgent)
+{
+    if (urgent)
+        outDataUrgent += a;
+    else
+        outDataNormal += a;
+    return trackWritten(t, id, a.size(), urgent);
+}
+
+// accounts for size bytes just appended to the outgoing data
+int XmlProtocol::trackWritten(TrackItem::Type t, int id, int size, bool urgent)
 {
     TrackItem i;
     i.type = t;
     i.id   = id;
-    i.size = a.size();
+    i.size = size;
 
-    if (urgent) {
+    if (urgent)
         trackQueueUrgent += i;
-        outDataUrgent += a;
-    } else {
+    else
         trackQueueNormal += i;
-        outDataNormal += a;
-    }
-    return a.size();
+    return size;
 }
 
 int XmlProtocol::internalWriteString(const QString &s, TrackItem::Type t, int id, bool urgent)
@@ -22,6 +22,7 @@
 
 #include "parser.h"
 
+#include <QByteArray>
 #include <QList>
 #include <QObject>
 #include <qdom.h>
@@ -29,6 +30,9 @@
 #define NS_XML "http://www.w3.org/XML/1998/namespace"
 
 namespace XMPP {
+// writes an element as UTF-8 the way it's sent to the stream
+void appendXmlElement(QByteArray &out, const QDomElement &e, const QString &contextNS);
+
 class XmlProtocol : public QObject {
 public:
     enum Need {
@@ -112,6 +116,7 @@ protected:
     bool       close();
     int        writeString(const QString &s, int id, bool external);
     int        writeElement(const QDomElement &e, int id, bool external, bool clip = false, bool urgent = false);
+    int        writeData(const QByteArray &a, int id, bool external);
     QByteArray resetStream();
 
 private:
@@ -137,13 +142,15 @@ private:
     QList<TrackItem> trackQueueNormal;
     QList<TrackItem> trackQueueUrgent;
 
-    void init();
-    int  internalWriteData(const QByteArray &a, TrackItem::Type t, int id = -1, bool urgent = false);
-    int  internalWriteString(const QString &s, TrackItem::Type t, int id = -1, bool urgent = false);
-    int  processTrackQueue(QList<TrackItem> &queue, int bytes);
-    void sendTagOpen();
-    void sendTagClose();
-    bool baseStep(const Parser::Event &pe);
+    void    init();
+    int     internalWriteData(const QByteArray &a, TrackItem::Type t, int id = -1, bool urgent = false);
+    int     internalWriteString(const QString &s, TrackItem::Type t, int id = -1, bool urgent = false);
+    int     trackWritten(TrackItem::Type t, int id, int size, bool urgent);
+    int     processTrackQueue(QList<TrackItem> &queue, int bytes);
+    QString streamNS(const QDomElement &e);
+    void    sendTagOpen();
+    void    sendTagClose();
+    bool    baseStep(const Parser::Event &pe);
 };
 } // namespace XMPP
 
@@ -21,8 +21,11 @@
 
 #include "xmpp_stream.h"
 
+#include <QDateTime>
 #include <QtCrypto>
 
+#include <functional>
+
 class ByteStream;
 class QByteArray;
 class QDomDocument;
@@ -36,6 +39,21 @@ class Connector;
 class StreamFeatures;
 class TLSHandler;
 
+// a token for fast reauthentication (XEP-0484)
+class FastToken {
+public:
+    QString    mechanism; // e.g. HT-SHA-256-NONE
+    QByteArray secret;
+    QDateTime  expiry;
+    int        count = 0; // times used
+
+    bool isValid() const
+    {
+        return !mechanism.isEmpty() && !secret.isEmpty()
+            && (!expiry.isValid() || expiry > QDateTime::currentDateTimeUtc());
+    }
+};
+
 class ClientStream : public Stream {
     Q_OBJECT
 public:
@@ -122,6 +140,15 @@ public:
     // binding
     void setResourceBinding(bool);
 
+    // SASL2 (XEP-0388), Bind2 (XEP-0386) and FAST (XEP-0484)
+    void      setSASL2Enabled(bool enable);
+    void      setUserAgent(const QString &id, const QString &software, const QString &device);
+    void      setBindTag(const QString &tag); // enables Bind2. the server makes up the resource
+    void      setCarbonsInline(bool enable);  // with Bind2, if the server can
+    bool      isCarbonsEnabledInline() const;
+    void      setFastToken(const FastToken &token);
+    FastToken fastToken() const; // the last one the server has issued
+
     // Language
     void setLang(const QString &);
 
@@ -156,9 +183,30 @@ public:
     void writeDirect(const QString &s);
     void setNoopTime(int mills);
 
+    // tracing. the handler gets plain stream bytes as they are read from or written to the secure layer,
+    // starting after authentication
+    using TraceHandler = std::function<void(bool incoming, const QByteArray &data)>;
+    void setTraceHandler(const TraceHandler &handler);
+
     // Stream management
-    bool isResumed() const;
-    void setSMEnabled(bool enable);
+    bool              isResumed() const;
+    void              setSMEnabled(bool enable);
+    void              setSMQueueLimit(int bytes, bool dropMessages); // chat states and presence go first anyway
+    void              setSMAckRequestCadence(int stanzas, int bytes);
+    QList<QByteArray> unacknowledgedMessages() const; // serialized, to keep for the next stream
+    void              setUnacknowledgedMessages(const QList<QByteArray> &messages); // sent after login
+
+    // Client State Indication (XEP-0352)
+    struct CSIStats {
+        qint64  activeMsecs   = 0;
+        qint64  inactiveMsecs = 0;
+        quint64 activeBytes   = 0; // incoming
+        quint64 inactiveBytes = 0;
+    };
+    bool     isClientStateIndicationSupported() const;
+    void     setClientActive(bool active);
+    bool     isClientActive() const;
+    CSIStats csiStats() const;
 
     // barracuda extension
     QStringList hosts() const;
@@ -217,6 +265,7 @@ private:
     void handleError();
     void srvProcessNext();
     void setTimer(int secs);
+    bool syncClientState();
 };
 } // namespace XMPP
 
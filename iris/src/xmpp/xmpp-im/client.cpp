@@ -89,6 +89,7 @@
 
 #include <QList>
 #include <QMap>
+#include <QMetaMethod>
 #include <QObject>
 #include <QPointer>
 #include <QTimer>
@@ -131,6 +132,7 @@ public:
     bool                    useTzoffset      = false; // manual tzoffset is old way of doing utc<->local translations
     bool                    active           = false;
     bool                    capsOptimization = false; // don't send caps every time
+    bool                    rosterUnchanged  = false;
 
     LiveRoster                roster;
     ResourceList              resourceList;
@@ -529,9 +531,11 @@ void Client::streamReadyRead()
     while (d->stream && d->stream->stanzaAvailable()) {
         Stanza s = d->stream->read();
 
-        QString out = s.toString();
-        debug(QString("Client: incoming: [\n%1]\n").arg(out));
-        emit xmlIncoming(out);
+        if (isStanzaTextWanted()) {
+            QString out = s.toString();
+            debug(QString("Client: incoming: [\n%1]\n").arg(out));
+            emit xmlIncoming(out);
+        }
 
         QDomElement x = s.element();
         distribute(x);
@@ -569,6 +573,16 @@ void Client::parseUnhandledStreamFeatures()
 
 void Client::debug(const QString &str) { emit debugText(str); }
 
+// Serializing every stanza is expensive, so it's done only while somebody listens.
+// Raw stream tracing is available with ClientStream::setTraceHandler()
+bool Client::isStanzaTextWanted() const
+{
+    static const QMetaMethod debugSignal    = QMetaMethod::fromSignal(&Client::debugText);
+    static const QMetaMethod incomingSignal = QMetaMethod::fromSignal(&Client::xmlIncoming);
+    static const QMetaMethod outgoingSignal = QMetaMethod::fromSignal(&Client::xmlOutgoing);
+    return isSignalConnected(debugSignal) || isSignalConnected(incomingSignal) || isSignalConnected(outgoingSignal);
+}
+
 QString Client::genUniqueId()
 {
 #if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
@@ -641,10 +655,11 @@ void Client::send(const QDomElement &x)
     if (e.isNull()) {              // so it was changed by signal above
         return;
     }
-    QString out = s.toString();
-    // qWarning() << "Out: " << out;
-    debug(QString("Client: outgoing: [\n%1]\n").arg(out));
-    emit xmlOutgoing(out);
+    if (isStanzaTextWanted()) {
+        QString out = s.toString();
+        debug(QString("Client: outgoing: [\n%1]\n").arg(out));
+        emit xmlOutgoing(out);
+    }
 
     // printf("x[%s] x2[%s] s[%s]\n", Stream::xmlToString(x).toLatin1(), Stream::xmlToString(e).toLatin1(),
     // s.toString().toLatin1());
@@ -884,25 +899,47 @@ void Client::pmMessage(const Message &m)
         emit messageReceived(m);
 }
 
-void Client::prRoster(const Roster &r) { importRoster(r); }
+void Client::prRoster(const Roster &r)
+{
+    importRoster(r);
+    if (!r.version().isEmpty())
+        d->roster.setVersion(r.version());
+}
+
+void Client::restoreRoster(const Roster &cached)
+{
+    d->roster.clear();
+    for (const auto &item : cached)
+        d->roster += LiveRosterItem(item);
+    d->roster.setVersion(cached.version());
+}
+
+bool Client::isRosterUnchanged() const { return d->rosterUnchanged; }
 
 void Client::rosterRequest(bool withGroupsDelimiter)
 {
     if (!d->active)
         return;
 
+    auto prepareGet = [this](JT_Roster *r) {
+        connect(r, SIGNAL(finished()), SLOT(slotRosterRequestFinished()));
+        if (d->stream && d->stream->streamFeatures().rosterver_supported)
+            r->get(d->roster.version());
+        else
+            r->get();
+        d->roster.flagAllForDelete(); // mod_groups patch
+    };
+
     JT_Roster *r = new JT_Roster(rootTask());
     if (withGroupsDelimiter) {
-        connect(r, &JT_Roster::finished, this, [this, r]() mutable {
+        connect(r, &JT_Roster::finished, this, [this, r, prepareGet]() mutable {
             if (r->success()) {
                 d->roster.setGroupsDelimiter(r->groupsDelimiter());
                 emit rosterGroupsDelimiterRequestFinished(r->groupsDelimiter());
             }
 
             r = new JT_Roster(rootTask());
-            connect(r, SIGNAL(finished()), SLOT(slotRosterRequestFinished()));
-            r->get();
-            d->roster.flagAllForDelete(); // mod_groups patch
+            prepareGet(r);
             r->go(true);
         });
         r->getGroupsDelimiter();
@@ -910,9 +947,7 @@ void Client::rosterRequest(bool withGroupsDelimiter)
         // on groups delimiter request. Wait timeout and go ahead.
         r->setTimeout(GROUPS_DELIMITER_TIMEOUT);
     } else {
-        connect(r, SIGNAL(finished()), SLOT(slotRosterRequestFinished()));
-        r->get();
-        d->roster.flagAllForDelete(); // mod_groups patch
+        prepareGet(r);
     }
 
     r->go(true);
@@ -920,12 +955,18 @@ void Client::rosterRequest(bool withGroupsDelimiter)
 
 void Client::slotRosterRequestFinished()
 {
-    JT_Roster *r = static_cast<JT_Roster *>(sender());
+    JT_Roster *r       = static_cast<JT_Roster *>(sender());
+    d->rosterUnchanged = r->success() && r->rosterUnchanged();
     // on success, let's take it
-    if (r->success()) {
+    if (d->rosterUnchanged) {
+        // our cached copy is up to date, keep everything
+        for (auto &i : d->roster)
+            i.setFlagForDelete(false);
+    } else if (r->success()) {
         // d->roster.flagAllForDelete(); // mod_groups patch
 
         importRoster(r->roster());
+        d->roster.setVersion(r->roster().version());
 
         for (LiveRoster::Iterator it = d->roster.begin(); it != d->roster.end();) {
             LiveRosterItem &i = *it;
@@ -1289,12 +1330,14 @@ void LiveRosterItem::setFlagForDelete(bool b) { v_flagForDelete = b; }
 class LiveRoster::Private {
 public:
     QString groupsDelimiter;
+    QString version;
 };
 
 LiveRoster::LiveRoster() : QList<LiveRosterItem>(), d(new LiveRoster::Private) { }
 LiveRoster::LiveRoster(const LiveRoster &other) : QList<LiveRosterItem>(other), d(new LiveRoster::Private)
 {
     d->groupsDelimiter = other.d->groupsDelimiter;
+    d->version         = other.d->version;
 }
 
 LiveRoster::~LiveRoster() { delete d; }
@@ -1303,6 +1346,7 @@ LiveRoster &LiveRoster::operator=(const LiveRoster &other)
 {
     QList<LiveRosterItem>::operator=(other);
     d->groupsDelimiter = other.d->groupsDelimiter;
+    d->version         = other.d->version;
     return *this;
 }
 void LiveRoster::flagAllForDelete()
@@ -1335,4 +1379,8 @@ void LiveRoster::setGroupsDelimiter(const QString &groupsDelimiter) { d->groupsD
 
 QString LiveRoster::groupsDelimiter() const { return d->groupsDelimiter; }
 
+void LiveRoster::setVersion(const QString &version) { d->version = version; }
+
+QString LiveRoster::version() const { return d->version; }
+
 }
@@ -2619,6 +2619,7 @@ bool RosterItem::fromXml(const QDomElement &item)
 class Roster::Private {
 public:
     QString groupsDelimiter;
+    QString version;
 };
 
 Roster::Roster() : QList<RosterItem>(), d(new Roster::Private) { }
@@ -2628,12 +2629,14 @@ Roster::~Roster() { delete d; }
 Roster::Roster(const Roster &other) : QList<RosterItem>(other), d(new Roster::Private)
 {
     d->groupsDelimiter = other.d->groupsDelimiter;
+    d->version         = other.d->version;
 }
 
 Roster &Roster::operator=(const Roster &other)
 {
     QList<RosterItem>::operator=(other);
     d->groupsDelimiter = other.d->groupsDelimiter;
+    d->version         = other.d->version;
     return *this;
 }
 
@@ -2661,6 +2664,10 @@ void Roster::setGroupsDelimiter(const QString &groupsDelimiter) { d->groupsDelim
 
 QString Roster::groupsDelimiter() const { return d->groupsDelimiter; }
 
+void Roster::setVersion(const QString &version) { d->version = version; }
+
+QString Roster::version() const { return d->version; }
+
 //---------------------------------------------------------------------------
 // FormField
 //---------------------------------------------------------------------------
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp/xmpp-im/xmpp_features.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QThread>
+#include <QtTest/QtTest>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2
+#endif
+
+using namespace XMPP;
+
+static const int Occupants = 5000;
+
+// what a big room sends: a few popular clients and a bit of everyone's own
+static QStringList occupantFeatures(int occupant)
+{
+    static const QStringList common {
+        "http://jabber.org/protocol/caps",        "http://jabber.org/protocol/disco#info",
+        "http://jabber.org/protocol/disco#items", "http://jabber.org/protocol/muc",
+        "http://jabber.org/protocol/chatstates",  "jabber:iq:version",
+        "urn:xmpp:ping",                          "urn:xmpp:time",
+        "urn:xmpp:receipts",                      "urn:xmpp:carbons:2",
+        "urn:xmpp:jingle:1",                      "urn:xmpp:jingle:apps:rtp:1",
+        "urn:xmpp:jingle:transports:ice-udp:1",   "urn:xmpp:avatar:metadata+notify",
+        "http://jabber.org/protocol/nick+notify", "urn:xmpp:message-correct:0",
+    };
+    QStringList l = common.mid(0, 10 + occupant % 7);
+    l << QString("urn:xmpp:client:%1:features").arg(occupant % 3);
+    l << QString("urn:example:plugin:%1").arg(occupant); // different for everyone
+    return l;
+}
+
+static QSet<QString> toSet(const QStringList &l) { return QSet<QString>(l.cbegin(), l.cend()); }
+
+class FeaturesTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testLookup_DoesNotIntern()
+    {
+        int count = Features::internedCount();
+        QCOMPARE(Features::id(QString("urn:example:lookup")), long(Features::FID_None));
+        QVERIFY(!Features().test(QString("urn:example:lookup")));
+        QVERIFY(!Features(QString("jabber:iq:register")).test(QStringList { "urn:example:lookup" }));
+        QCOMPARE(Features::internedCount(), count);
+        QCOMPARE(Features::id(QString("jabber:iq:register")), long(Features::FID_Register));
+    }
+
+    void testConcurrentIntern()
+    {
+        QList<QThread *>     threads;
+        QList<QSet<QString>> results(4);
+        for (int t = 0; t < 4; ++t) {
+            threads << QThread::create([&results, t]() {
+                QStringList l;
+                for (int i = 0; i < 50; ++i)
+                    l << QString("urn:example:thread:%1").arg(i % 25 + t * 10); // overlapping ranges
+                results[t] = toSet(Features(l).list());
+            });
+        }
+        for (auto thread : std::as_const(threads))
+            thread->start();
+        for (auto thread : std::as_const(threads)) {
+            QVERIFY(thread->wait(10000));
+            delete thread;
+        }
+
+        for (int t = 0; t < 4; ++t) {
+            QSet<QString> expected;
+            for (int i = 0; i < 25; ++i)
+                expected << QString("urn:example:thread:%1").arg(i + t * 10);
+            QCOMPARE(results[t], expected);
+        }
+    }
+
+    void benchmarkManyOccupants()
+    {
+        QList<QStringList> lists;
+        lists.reserve(Occupants);
+        for (int i = 0; i < Occupants; ++i)
+            lists << occupantFeatures(i);
+
+        QList<Features> occupants;
+        occupants.reserve(Occupants);
+#ifdef HAVE_MALLINFO2
+        size_t before = mallinfo2().uordblks;
+#endif
+        for (const auto &l : std::as_const(lists))
+            occupants << Features(l);
+#ifdef HAVE_MALLINFO2
+        // heap per occupant, the table included
+        QTest::setBenchmarkResult(qreal(mallinfo2().uordblks - before) / Occupants, QTest::BytesAllocated);
+#endif
+
+        QVERIFY(Features::internedCount() <= 1024);
+        for (int i = 0; i < Occupants; i += 499)
+            QCOMPARE(toSet(occupants[i].list()), toSet(lists[i]));
+    }
+
+    void testFullTable_KeepsNamespaces()
+    {
+        QStringList l;
+        for (int i = 0; i < 2000; ++i)
+            l << QString("urn:example:overflow:%1").arg(i);
+        l << "jabber:iq:search";
+
+        Features f(l);
+        QVERIFY(Features::internedCount() <= 1024);
+        QCOMPARE(toSet(f.list()), toSet(l));
+        QVERIFY(f.test(QString("urn:example:overflow:1999")));
+        QVERIFY(f.test(l));
+        QVERIFY(f.hasSearch());
+        QVERIFY(!f.test(QString("urn:example:overflow:2000")));
+
+        // the same list in another order is the same set
+        std::reverse(l.begin(), l.end());
+        QVERIFY(Features(l) == f);
+
+        Features g(QString("urn:example:overflow:2001"));
+        g += f;
+        QVERIFY(g.test(QString("urn:example:overflow:2001")));
+        QVERIFY(g.test(QString("urn:example:overflow:1999")));
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(FeaturesTest);
+#include "featurestest.moc"
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmpp/xmpp-core/xmpp.h"
+#include "xmpp/xmpp-core/xmpp_clientstream.h"
+#include "xmpp/xmpp-im/xmpp_client.h"
+#include "xmpp/xmpp-im/xmpp_mammanager.h"
+#include "xmpp/xmpp-im/xmpp_mamtask.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QSignalSpy>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+// never connects. the stream only lets the client hand out what the tasks send
+class NullConnector : public Connector {
+    Q_OBJECT
+public:
+    void        setOptHostPort(const QString &, quint16) override { }
+    void        connectToServer(const QString &) override { }
+    ByteStream *stream() const override { return nullptr; }
+    void        done() override { }
+};
+
+class MAMTest : public QObject {
+    Q_OBJECT
+
+private:
+    NullConnector     *connector = nullptr;
+    ClientStream      *stream    = nullptr;
+    Client            *client    = nullptr;
+    QList<QDomElement> sent;
+
+    QDomElement parse(const QString &xml)
+    {
+        QDomDocument doc;
+        doc.setContent(xml, true);
+        return doc.documentElement();
+    }
+
+    bool receive(const QString &xml) { return client->rootTask()->take(parse(xml)); }
+
+    QDomElement takeSent()
+    {
+        if (sent.isEmpty())
+            return QDomElement();
+        return sent.takeFirst();
+    }
+
+    // answers the metadata request of a task that has just been started
+    void answerMetadata(const QString &startId, const QString &endId)
+    {
+        QDomElement iq = takeSent();
+        QCOMPARE(iq.firstChildElement("metadata").namespaceURI(), XMPP_MAM_NAMESPACE);
+        QVERIFY(receive(QString("<iq xmlns='jabber:client' type='result' id='%1'>"
+                                "<metadata xmlns='urn:xmpp:mam:2'><start id='%2'/><end id='%3'/></metadata></iq>")
+                            .arg(iq.attribute("id"), startId, endId)));
+    }
+
+    // answers the query of the next page with the given archive ids
+    void answerPage(const QStringList &ids, bool complete)
+    {
+        QDomElement iq      = takeSent();
+        QDomElement query   = iq.firstChildElement("query");
+        QString     queryId = query.attribute("queryid");
+        QVERIFY(!queryId.isEmpty());
+        for (const QString &id : ids)
+            QVERIFY(receive(QString("<message xmlns='jabber:client'>"
+                                    "<result xmlns='urn:xmpp:mam:2' queryid='%1' id='%2'>"
+                                    "<forwarded xmlns='urn:xmpp:forward:0'>"
+                                    "<message xmlns='jabber:client' from='juliet@example.com/balcony' "
+                                    "to='romeo@example.com'><body>%2</body></message>"
+                                    "</forwarded></result></message>")
+                                .arg(queryId, id)));
+        QVERIFY(receive(QString("<iq xmlns='jabber:client' type='result' id='%1'>"
+                                "<fin xmlns='urn:xmpp:mam:2' complete='%2'/></iq>")
+                            .arg(iq.attribute("id"), complete ? "true" : "false")));
+    }
+
+    static QString filterValue(const QDomElement &iq, const QString &var)
+    {
+        QDomElement x = iq.firstChildElement("query").firstChildElement("x");
+        for (QDomElement f = x.firstChildElement("field"); !f.isNull(); f = f.nextSiblingElement("field")) {
+            if (f.attribute("var") == var)
+                return f.firstChildElement("value").text();
+        }
+        return QString();
+    }
+
+    static QStringList ids(const QList<QDomElement> &page)
+    {
+        QStringList ret;
+        for (const auto &r : page)
+            ret << r.attribute("id");
+        return ret;
+    }
+
+private slots:
+    void init()
+    {
+        sent.clear();
+        connector = new NullConnector;
+        stream    = new ClientStream(connector);
+        client    = new Client;
+        client->connectToServer(stream, Jid("romeo@example.com/orchard"));
+        connect(client, &Client::stanzaElementOutgoing, this, [this](QDomElement &e) { sent << e; });
+    }
+
+    void cleanup()
+    {
+        delete client;
+        delete stream;
+        delete connector;
+    }
+
+    void testPages_DeliveredUntilEndOfArchive()
+    {
+        auto task = new MAMTask(client->rootTask());
+        task->setKeepArchive(false);
+        task->get(Jid("juliet@example.com"), QString(), QString(), false, 2, 0, false, false);
+        QList<QStringList> pages;
+        connect(task, &MAMTask::pageReady, this, [&pages](const QList<QDomElement> &page) { pages << ids(page); });
+        QSignalSpy finished(task, &MAMTask::finished);
+        task->go(true);
+
+        answerMetadata("a1", "a3");
+        answerPage({ "a1", "a2" }, false);
+        QCOMPARE(pages.size(), 1);
+        QCOMPARE(finished.count(), 0);
+
+        // the last id of the archive ends the task even if the server doesn't say so
+        answerPage({ "a3" }, false);
+        QCOMPARE(pages, QList<QStringList>() << QStringList { "a1", "a2" } << QStringList { "a3" });
+        QCOMPARE(finished.count(), 1);
+        QVERIFY(task->success());
+        QVERIFY(task->archive().isEmpty());
+        QVERIFY(sent.isEmpty());
+    }
+
+    void testPages_FinCompleteStops()
+    {
+        auto task = new MAMTask(client->rootTask());
+        task->get(Jid("juliet@example.com"), QString(), QString(), false, 2, 0, false, false);
+        int pages = 0;
+        connect(task, &MAMTask::pageReady, this, [&pages]() { ++pages; });
+        QSignalSpy finished(task, &MAMTask::finished);
+        task->go(true);
+
+        answerMetadata("a1", "a9");
+        answerPage({ "a1", "a2" }, true);
+        QCOMPARE(pages, 1);
+        QCOMPARE(finished.count(), 1);
+        QVERIFY(task->success());
+        QCOMPARE(ids(task->archive()), QStringList({ "a1", "a2" }));
+        QVERIFY(sent.isEmpty()); // no request for another page
+    }
+
+    void testSync_CursorAdvancesForward()
+    {
+        MAMManager manager(client, 2);
+        Jid        juliet("juliet@example.com");
+        manager.setSyncCursor(juliet, "a1");
+
+        QStringList cursors;
+        QList<bool> results;
+        connect(&manager, &MAMManager::syncCursorChanged, this,
+                [&cursors](const Jid &, const QString &stanzaId) { cursors << stanzaId; });
+        connect(&manager, &MAMManager::synchronized, this, [&results](const Jid &, bool ok) { results << ok; });
+        manager.synchronize(juliet.withResource("balcony"), false);
+
+        answerMetadata("a0", "a4");
+        QCOMPARE(filterValue(sent.first(), "after-id"), QString("a1"));
+        answerPage({ "a2", "a3" }, false);
+        QCOMPARE(manager.syncCursor(juliet), QString("a3"));
+        answerPage({ "a4" }, true);
+        QCOMPARE(manager.syncCursor(juliet), QString("a4"));
+
+        QCOMPARE(cursors, QStringList({ "a3", "a4" }));
+        QCOMPARE(results, QList<bool>() << true);
+    }
+
+    void testSync_FirstSyncKeepsNewestId()
+    {
+        MAMManager manager(client, 2, 3);
+        Jid        juliet("juliet@example.com");
+
+        QStringList cursors;
+        connect(&manager, &MAMManager::syncCursorChanged, this,
+                [&cursors](const Jid &, const QString &stanzaId) { cursors << stanzaId; });
+        manager.synchronize(juliet, false);
+
+        // backwards, newest page and newest result first
+        answerMetadata("a1", "a5");
+        QVERIFY(filterValue(sent.first(), "after-id").isEmpty());
+        answerPage({ "a5", "a4" }, false);
+        answerPage({ "a3" }, false);
+
+        QCOMPARE(cursors, QStringList { "a5" });
+        QCOMPARE(manager.syncCursor(juliet), QString("a5"));
+    }
+
+    void testSync_QueuedOverLimit()
+    {
+        MAMManager manager(client, 2);
+        manager.setMaxConcurrentSyncs(1);
+        int synchronized = 0;
+        connect(&manager, &MAMManager::synchronized, this, [&synchronized]() { ++synchronized; });
+
+        manager.synchronize(Jid("juliet@example.com"), false);
+        manager.synchronize(Jid("mercutio@example.com"), false);
+        manager.synchronize(Jid("juliet@example.com/balcony"), false); // already running
+        QCOMPARE(sent.size(), 1);
+
+        answerMetadata("a1", "a1");
+        answerPage({ "a1" }, true);
+        QCOMPARE(synchronized, 1);
+        QCOMPARE(sent.size(), 1); // metadata request of the second archive
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(MAMTest);
+#include "mamtest.moc"
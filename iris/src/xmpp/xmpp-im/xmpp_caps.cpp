@@ -89,6 +89,9 @@ void CapsRegistry::save()
     doc.appendChild(capabilities);
     QHash<QString, CapsInfo>::ConstIterator i = capsInfo_.constBegin();
     for (; i != capsInfo_.constEnd(); i++) {
+        if (i.value().expires().isValid()) {
+            continue; // not a caps entry
+        }
         QDomElement info = i.value().toXml(&doc);
         info.setAttribute("node", i.key());
         capabilities.appendChild(info);
@@ -105,6 +108,24 @@ void CapsRegistry::saveData(const QByteArray &data)
 
 QByteArray CapsRegistry::loadData() { return QByteArray(); }
 
+void CapsRegistry::saveEntry(const QString &key, const CapsInfo &info)
+{
+    Q_UNUSED(key)
+    Q_UNUSED(info)
+}
+
+/**
+ * \brief Adds an entry read from permanent storage. Neither signals nor saveEntry() are triggered.
+ */
+void CapsRegistry::addEntry(const QString &key, const CapsInfo &info)
+{
+    if (info.expires().isValid()) {
+        capsInfo_[key] = info;
+    } else {
+        capsInfo_[key] = CapsInfo(shareFeatures(key, info.disco()), info.lastSeen());
+    }
+}
+
 /**
  * \brief Sets the file to save the capabilities info to
  */
@@ -144,7 +165,7 @@ void CapsRegistry::load()
             if (sep > 0 && sep + 1 < node.length()) {
                 CapsInfo info = CapsInfo::fromXml(i);
                 if (info.isValid() && info.lastSeen() > validTime) {
-                    capsInfo_[node] = CapsInfo::fromXml(i);
+                    addEntry(node, info);
                 }
                 // qDebug() << QString("Read %1 %2").arg(node).arg(ver);
             } else {
@@ -163,12 +184,66 @@ void CapsRegistry::registerCaps(const CapsSpec &spec, const DiscoItem &item)
 {
     QString dnode = spec.flatten();
     if (!isRegistered(dnode)) {
-        CapsInfo info(item);
+        CapsInfo info(shareFeatures(dnode, item));
         capsInfo_[dnode] = info;
+        saveEntry(dnode, info);
         emit registered(spec);
     }
 }
 
+/**
+ * \brief Returns cache key of disco#info result of an entity without caps.
+ */
+QString CapsRegistry::discoKey(const Jid &jid, const QString &node)
+{
+    // XEP-0147 like uri, so it never clashes with caps node#ver keys
+    QString key = QLatin1String("xmpp:") + jid.full() + QLatin1String("?disco;type=get;request=info");
+    if (!node.isEmpty()) {
+        key += QLatin1String(";node=") + node;
+    }
+    return key;
+}
+
+/**
+ * \brief Caches disco#info result of an entity for \a ttl seconds.
+ */
+void CapsRegistry::registerDisco(const Jid &jid, const QString &node, const DiscoItem &item, int ttl)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QString   key = discoKey(jid, node);
+    CapsInfo  info(item, now, now.addSecs(ttl));
+    capsInfo_[key] = info;
+    saveEntry(key, info);
+}
+
+/**
+ * \brief Returns cached disco#info result of an entity or an empty item if it's unknown or expired.
+ */
+DiscoItem CapsRegistry::cachedDisco(const Jid &jid, const QString &node)
+{
+    auto it = capsInfo_.find(discoKey(jid, node));
+    if (it == capsInfo_.end()) {
+        return DiscoItem();
+    }
+    if (it.value().isExpired()) {
+        capsInfo_.erase(it);
+        return DiscoItem();
+    }
+    return it.value().disco();
+}
+
+/**
+ * \brief Accounts a disco#info request served from (or missed) the cache.
+ */
+void CapsRegistry::recordLookup(bool hit)
+{
+    if (hit) {
+        ++stats_.hits;
+    } else {
+        ++stats_.misses;
+    }
+}
+
 /**
  * \brief Checks if capabilities have been registered.
  */
@@ -180,6 +255,32 @@ DiscoItem CapsRegistry::disco(const QString &spec) const
     return ci.disco();
 }
 
+/**
+ * \brief Returns the features of a registered node without copying the whole disco item.
+ */
+Features CapsRegistry::features(const QString &spec) const
+{
+    auto it = capsInfo_.constFind(spec);
+    return it == capsInfo_.constEnd() ? Features() : it.value().disco().features();
+}
+
+/**
+ * \brief Replaces item features with the instance already known for the same ver hash.
+ * Thousands of contacts usually advertise a handful of distinct hashes, so this keeps
+ * one feature set in memory per hash instead of one per node.
+ */
+DiscoItem CapsRegistry::shareFeatures(const QString &node, DiscoItem item)
+{
+    QString hash = node.mid(node.lastIndexOf('#') + 1);
+    auto    it   = featuresByHash_.constFind(hash);
+    if (it != featuresByHash_.constEnd() && it.value() == item.features()) {
+        item.setFeatures(it.value());
+    } else {
+        featuresByHash_.insert(hash, item.features());
+    }
+    return item;
+}
+
 /*--------------------------------------------------------------
   _____                __  __
  / ____|              |  \/  |
@@ -348,7 +449,13 @@ XMPP::DiscoItem CapsManager::disco(const Jid &jid) const
 /**
  * \brief Requests the list of features of a given JID.
  */
-XMPP::Features CapsManager::features(const Jid &jid) const { return disco(jid).features(); }
+XMPP::Features CapsManager::features(const Jid &jid) const
+{
+    if (!capsEnabled(jid)) {
+        return Features();
+    }
+    return CapsRegistry::instance()->features(capsSpecs_[jid.full()].flatten());
+}
 
 /**
  * \brief Returns the client name of a given jid.
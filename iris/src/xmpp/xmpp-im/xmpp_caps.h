@@ -29,25 +29,42 @@ namespace XMPP {
 class CapsInfo {
 public:
     inline CapsInfo() { }
-    inline CapsInfo(const XMPP::DiscoItem &disco, const QDateTime &lastSeen = QDateTime()) :
-        _lastSeen(lastSeen.isNull() ? QDateTime::currentDateTime() : lastSeen), _disco(disco)
+    inline CapsInfo(const XMPP::DiscoItem &disco, const QDateTime &lastSeen = QDateTime(),
+                    const QDateTime &expires = QDateTime()) :
+        _lastSeen(lastSeen.isNull() ? QDateTime::currentDateTime() : lastSeen), _expires(expires), _disco(disco)
     {
     }
     inline bool                   isValid() const { return _lastSeen.isValid(); }
     inline const QDateTime       &lastSeen() const { return _lastSeen; }
+    inline const QDateTime       &expires() const { return _expires; } // null for caps, they never change
+    inline bool                   isExpired() const
+    {
+        return _expires.isValid() && _expires < QDateTime::currentDateTime();
+    }
     inline const XMPP::DiscoItem &disco() const { return _disco; }
     QDomElement                   toXml(QDomDocument *doc) const;
     static CapsInfo               fromXml(const QDomElement &ci);
 
 private:
     QDateTime       _lastSeen;
+    QDateTime       _expires;
     XMPP::DiscoItem _disco;
 };
 
+/*
+ * Cache of disco#info results shared by all accounts. Caps are keyed by node#ver and kept
+ * until not seen for a long time, results for entities without caps (servers, services)
+ * are keyed by discoKey() and expire after a ttl.
+ */
 class CapsRegistry : public QObject {
     Q_OBJECT
 
 public:
+    struct Stats {
+        quint64 hits   = 0;
+        quint64 misses = 0;
+    };
+
     CapsRegistry(QObject *parent = nullptr);
 
     static CapsRegistry *instance();
@@ -56,21 +73,37 @@ public:
     void      registerCaps(const CapsSpec &, const XMPP::DiscoItem &item);
     bool      isRegistered(const QString &) const;
     DiscoItem disco(const QString &) const;
+    Features  features(const QString &) const;
+
+    static QString discoKey(const Jid &jid, const QString &node = QString());
+    void           registerDisco(const Jid &jid, const QString &node, const DiscoItem &item, int ttl);
+    DiscoItem      cachedDisco(const Jid &jid, const QString &node = QString());
+    void           recordLookup(bool hit);
+    const Stats   &stats() const { return stats_; }
 
 signals:
     void registered(const XMPP::CapsSpec &);
 
 public slots:
-    void load();
-    void save();
+    virtual void load();
+    virtual void save();
 
 protected:
     virtual void       saveData(const QByteArray &data); // reimplmenet these two functions
     virtual QByteArray loadData();                       // to have permanent cache
 
+    // reimplement to store each new entry as it comes instead of rewriting everything in save()
+    virtual void                    saveEntry(const QString &key, const CapsInfo &info);
+    void                            addEntry(const QString &key, const CapsInfo &info);
+    const QHash<QString, CapsInfo> &entries() const { return capsInfo_; }
+
 private:
+    DiscoItem shareFeatures(const QString &node, DiscoItem item);
+
     static CapsRegistry     *instance_;
     QHash<QString, CapsInfo> capsInfo_;
+    QHash<QString, Features> featuresByHash_; // one feature set per caps ver hash, shared by all nodes using it
+    Stats                    stats_;
 };
 
 class CapsManager : public QObject {
@@ -213,6 +213,20 @@ void CarbonsManager::setEnabled(bool enable)
     }
 }
 
+/**
+ * Marks carbons as enabled without asking the server, since it has enabled them
+ * on stream negotiation already (Bind2).
+ */
+void CarbonsManager::setEnabledInline()
+{
+    if (d->enable)
+        return;
+
+    d->subscribe();
+    d->enable = true;
+    emit finished();
+}
+
 bool CarbonsManager::isEnabled() const { return d->enable; }
 
 } // namespace XMPP
@@ -46,6 +46,7 @@ namespace XMPP
         static QDomElement privateElement(QDomDocument &doc);
 
         void setEnabled(bool enable);
+        void setEnabledInline(); // already enabled on stream negotiation
         bool isEnabled() const;
 
     signals:
@@ -105,6 +105,8 @@ public:
     QNetworkAccessManager *networkAccessManager() const;
 
     void rosterRequest(bool withGroupsDelimiter = true);
+    void restoreRoster(const Roster &cached); // seed the live roster with a local copy before connecting
+    bool isRosterUnchanged() const;           // true if the last roster request returned no items (XEP-0237)
     void sendMessage(Message &);
     void sendSubscription(const Jid &, const QString &, const QString &nick = QString());
     void setPresence(const Status &);
@@ -239,6 +241,7 @@ private:
     void handleIncoming(BSConnection *);
 
     void sendAckRequest();
+    bool isStanzaTextWanted() const;
 
     class ClientPrivate;
     ClientPrivate *d;
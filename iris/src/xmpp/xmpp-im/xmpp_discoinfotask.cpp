@@ -34,6 +34,7 @@ using namespace XMPP;
 class DiscoInfoTask::Private {
 public:
     bool                allowCache = true;
+    int                 cacheTtl   = 0;
     Jid                 jid;
     QString             node;
     DiscoItem::Identity ident;
@@ -46,6 +47,8 @@ DiscoInfoTask::~DiscoInfoTask() { delete d; }
 
 void DiscoInfoTask::setAllowCache(bool allow) { d->allowCache = allow; }
 
+void DiscoInfoTask::setCacheTtl(int ttl) { d->cacheTtl = ttl; }
+
 void DiscoInfoTask::get(const DiscoItem &item)
 {
     DiscoItem::Identity id;
@@ -81,9 +84,16 @@ const DiscoItem &DiscoInfoTask::item() const { return d->item; }
 
 void DiscoInfoTask::onGo()
 {
-    if (d->allowCache && client()->capsManager()->isEnabled()) {
-        d->item = client()->capsManager()->disco(d->jid);
-        if (!d->item.features().isEmpty() || d->item.identities().count()) {
+    if (d->allowCache) {
+        if (client()->capsManager()->isEnabled()) {
+            d->item = client()->capsManager()->disco(d->jid);
+        }
+        if (d->cacheTtl > 0 && d->item.features().isEmpty() && d->item.identities().isEmpty()) {
+            d->item = CapsRegistry::instance()->cachedDisco(d->jid, d->node);
+        }
+        bool hit = !d->item.features().isEmpty() || d->item.identities().count();
+        CapsRegistry::instance()->recordLookup(hit);
+        if (hit) {
             QTimer::singleShot(0, this, SLOT(cachedReady())); // to be consistent with network requests
             return;
         }
@@ -128,6 +138,9 @@ bool DiscoInfoTask::take(const QDomElement &x)
         if (d->allowCache && client()->capsManager()->isEnabled()) {
             client()->capsManager()->updateDisco(d->jid, d->item);
         }
+        if (d->allowCache && d->cacheTtl > 0 && !client()->capsManager()->capsEnabled(d->jid)) {
+            CapsRegistry::instance()->registerDisco(d->jid, d->node, d->item, d->cacheTtl);
+        }
 
         setSuccess();
     } else {
@@ -35,6 +35,8 @@ public:
 
     // Allow retreive result from cache and update cache on finish with new data
     void setAllowCache(bool allow = true);
+    // Cache result of entity without caps for ttl seconds. 0 (default) means caps cache only
+    void setCacheTtl(int ttl);
 
     void get(const Jid &, const QString &node = QString(), const DiscoItem::Identity = DiscoItem::Identity());
     void get(const DiscoItem &);
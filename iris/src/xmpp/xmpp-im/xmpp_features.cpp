@@ -23,214 +23,294 @@
 #include "jingle.h"
 
 #include <QCoreApplication>
+#include <QHash>
 #include <QMap>
+#include <QReadWriteLock>
 #include <QString>
 #include <QStringList>
 
+#include <algorithm>
+
 using namespace XMPP;
 
-Features::Features() { }
+#define FID_MULTICAST "http://jabber.org/protocol/address"
+#define FID_AHCOMMAND "http://jabber.org/protocol/commands"
+#define FID_REGISTER "jabber:iq:register"
+#define FID_SEARCH "jabber:iq:search"
+#define FID_GROUPCHAT "http://jabber.org/protocol/muc"
+#define FID_VOICE "http://www.google.com/xmpp/protocol/voice/v1"
+#define FID_GATEWAY "jabber:iq:gateway"
+#define FID_QUERYVERSION "jabber:iq:version"
+#define FID_DISCO "http://jabber.org/protocol/disco"
+#define FID_DISCO_INFO "http://jabber.org/protocol/disco#info"
+#define FID_DISCO_ITEMS "http://jabber.org/protocol/disco#items"
+#define FID_CHATSTATE "http://jabber.org/protocol/chatstates"
+#define FID_VCARD "vcard-temp"
+#define FID_VCARD4 "urn:ietf:params:xml:ns:vcard-4.0"
+#define FID_MESSAGECARBONS "urn:xmpp:carbons:2"
+#define FID_JINGLEICEUDP "urn:xmpp:jingle:transports:ice-udp:1"
+#define FID_JINGLEICE "urn:xmpp:jingle:transports:ice:0"
+#define NS_CAPS "http://jabber.org/protocol/caps"
+#define NS_CAPS_OPTIMIZE "http://jabber.org/protocol/caps#optimize"
+#define NS_DIRECT_MUC_INVITE "jabber:x:conference"
+#define FID_AVATAR_TO_VCARD_CONVERSION "urn:xmpp:pep-vcard-conversion:0"
 
-Features::Features(const QStringList &l) { setList(l); }
+// custom Psi actions
+#define FID_ADD "psi:add"
 
-Features::Features(const QSet<QString> &s) { setList(s); }
+namespace {
+// well-known features are interned first, so their ids are known at compile time
+enum KnownFeature {
+    KF_Multicast,
+    KF_Command,
+    KF_Register,
+    KF_Search,
+    KF_Groupchat,
+    KF_Voice,
+    KF_Gateway,
+    KF_QueryVersion,
+    KF_Disco,
+    KF_DiscoInfo,
+    KF_DiscoItems,
+    KF_ChatState,
+    KF_VCard,
+    KF_VCard4,
+    KF_MessageCarbons,
+    KF_JingleIceUdp,
+    KF_JingleIce,
+    KF_Caps,
+    KF_CapsOptimize,
+    KF_DirectMucInvite,
+    KF_AvatarConversion,
+    KF_Add,
+    KF_JingleFT
+};
 
-Features::Features(const QString &str)
-{
-    QSet<QString> l;
-    l << str;
+const char *const knownFeatures[] = { FID_MULTICAST,
+                                      FID_AHCOMMAND,
+                                      FID_REGISTER,
+                                      FID_SEARCH,
+                                      FID_GROUPCHAT,
+                                      FID_VOICE,
+                                      FID_GATEWAY,
+                                      FID_QUERYVERSION,
+                                      FID_DISCO,
+                                      FID_DISCO_INFO,
+                                      FID_DISCO_ITEMS,
+                                      FID_CHATSTATE,
+                                      FID_VCARD,
+                                      FID_VCARD4,
+                                      FID_MESSAGECARBONS,
+                                      FID_JINGLEICEUDP,
+                                      FID_JINGLEICE,
+                                      NS_CAPS,
+                                      NS_CAPS_OPTIMIZE,
+                                      NS_DIRECT_MUC_INVITE,
+                                      FID_AVATAR_TO_VCARD_CONVERSION,
+                                      FID_ADD };
+
+// Process-wide feature namespace <-> id table, shared by all the clients and threads.
+// Ids are never released. The number of distinct namespaces seen in practice is a few
+// hundred, the limit only stops a peer from filling it with made up ones.
+class FeatureRegistry {
+public:
+    static constexpr int MaxSize = 1024;
 
-    setList(l);
-}
+    FeatureRegistry()
+    {
+        for (const char *ns : knownFeatures)
+            intern(QLatin1String(ns));
+        intern(Jingle::FileTransfer::NS);
+    }
 
-Features::~Features() { }
+    int id(const QString &ns) const
+    {
+        QReadLocker locker(&lock_);
+        return ids_.value(ns, -1);
+    }
 
-QStringList Features::list() const
-{
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-    return QStringList(_list.begin(), _list.end());
-#else
-    return _list.toList();
-#endif
-}
+    // -1 if the table is full
+    int intern(const QString &ns)
+    {
+        int id = this->id(ns);
+        if (id != -1)
+            return id;
+
+        QWriteLocker locker(&lock_);
+        auto         it = ids_.constFind(ns); // might be added since we checked
+        if (it != ids_.constEnd())
+            return it.value();
+        if (names_.size() >= MaxSize)
+            return -1;
+        id = names_.size();
+        names_.append(ns);
+        ids_.insert(ns, id);
+        return id;
+    }
 
-void Features::setList(const QStringList &l)
-{
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-    _list = QSet<QString>(l.begin(), l.end());
-#else
-    _list = QSet<QString>::fromList(l);
-#endif
-}
+    QString name(int id) const
+    {
+        QReadLocker locker(&lock_);
+        return names_.at(id);
+    }
 
-void Features::setList(const QSet<QString> &l) { _list = l; }
+    int size() const
+    {
+        QReadLocker locker(&lock_);
+        return names_.size();
+    }
 
-void Features::addFeature(const QString &s) { _list += s; }
+private:
+    mutable QReadWriteLock lock_;
+    QHash<QString, int>    ids_;
+    QStringList            names_;
+};
 
-bool Features::test(const QStringList &ns) const
+FeatureRegistry &registry()
 {
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-    auto ss = QSet<QString>(ns.begin(), ns.end());
-#else
-    auto ss = QSet<QString>::fromList(ns);
-#endif
-    return _list.contains(ss);
+    static FeatureRegistry r;
+    return r;
 }
+} // namespace
 
-bool Features::test(const QSet<QString> &ns) const { return _list.contains(ns); }
+Features::Features() { }
 
-bool Features::test(const QString &ns) const { return _list.contains(ns); }
+Features::Features(const QStringList &l) { setList(l); }
 
-#define FID_MULTICAST "http://jabber.org/protocol/address"
-bool Features::hasMulticast() const
-{
-    QSet<QString> ns;
-    ns << FID_MULTICAST;
+Features::Features(const QSet<QString> &s) { setList(s); }
 
-    return test(ns);
-}
+Features::Features(const QString &str) { addFeature(str); }
 
-#define FID_AHCOMMAND "http://jabber.org/protocol/commands"
-bool Features::hasCommand() const
-{
-    QSet<QString> ns;
-    ns << FID_AHCOMMAND;
+Features::~Features() { }
 
-    return test(ns);
+QStringList Features::list() const
+{
+    QStringList l;
+    for (int i = 0; i < _bits.size(); ++i) {
+        if (_bits.testBit(i))
+            l.append(registry().name(i));
+    }
+    return l + _extra;
 }
 
-#define FID_REGISTER "jabber:iq:register"
-bool Features::hasRegister() const
+void Features::setList(const QStringList &l)
 {
-    QSet<QString> ns;
-    ns << FID_REGISTER;
-
-    return test(ns);
+    _bits.clear();
+    _extra.clear();
+    for (const QString &f : l)
+        addFeature(f);
 }
 
-#define FID_SEARCH "jabber:iq:search"
-bool Features::hasSearch() const
+void Features::setList(const QSet<QString> &l)
 {
-    QSet<QString> ns;
-    ns << FID_SEARCH;
-
-    return test(ns);
+    _bits.clear();
+    _extra.clear();
+    for (const QString &f : l)
+        addFeature(f);
 }
 
-#define FID_GROUPCHAT "http://jabber.org/protocol/muc"
-bool Features::hasGroupchat() const
+void Features::addFeature(const QString &s)
 {
-    QSet<QString> ns;
-    ns << FID_GROUPCHAT;
-
-    return test(ns);
+    int id = registry().intern(s);
+    if (id != -1) {
+        setId(id);
+        return;
+    }
+    auto it = std::lower_bound(_extra.begin(), _extra.end(), s);
+    if (it == _extra.end() || *it != s)
+        _extra.insert(it, s);
 }
 
-#define FID_VOICE "http://www.google.com/xmpp/protocol/voice/v1"
-bool Features::hasVoice() const
+void Features::setId(int id)
 {
-    QSet<QString> ns;
-    ns << FID_VOICE;
-
-    return test(ns);
+    if (id < 0)
+        return;
+    if (id >= _bits.size())
+        _bits.resize(id + 1);
+    _bits.setBit(id);
 }
 
-#define FID_GATEWAY "jabber:iq:gateway"
-bool Features::hasGateway() const
+bool Features::test(const QStringList &ns) const
 {
-    QSet<QString> ns;
-    ns << FID_GATEWAY;
-
-    return test(ns);
+    for (const QString &f : ns) {
+        if (!test(f))
+            return false;
+    }
+    return true;
 }
 
-#define FID_QUERYVERSION "jabber:iq:version"
-bool Features::hasVersion() const
+bool Features::test(const QSet<QString> &ns) const
 {
-    QSet<QString> ns;
-    ns << FID_QUERYVERSION;
-
-    return test(ns);
+    for (const QString &f : ns) {
+        if (!test(f))
+            return false;
+    }
+    return true;
 }
 
-#define FID_DISCO "http://jabber.org/protocol/disco"
-bool Features::hasDisco() const
+bool Features::test(const QString &ns) const
 {
-    QSet<QString> ns;
-    ns << FID_DISCO;
-    ns << "http://jabber.org/protocol/disco#info";
-    ns << "http://jabber.org/protocol/disco#items";
-
-    return test(ns);
+    int id = registry().id(ns);
+    if (id != -1)
+        return testId(id);
+    return !_extra.isEmpty() && std::binary_search(_extra.cbegin(), _extra.cend(), ns);
 }
 
-#define FID_CHATSTATE "http://jabber.org/protocol/chatstates"
-bool Features::hasChatState() const
-{
-    QSet<QString> ns;
-    ns << FID_CHATSTATE;
+bool Features::hasMulticast() const { return testId(KF_Multicast); }
 
-    return test(ns);
-}
+bool Features::hasCommand() const { return testId(KF_Command); }
 
-#define FID_VCARD "vcard-temp"
-bool Features::hasVCard() const
-{
-    QSet<QString> ns;
-    ns << FID_VCARD;
+bool Features::hasRegister() const { return testId(KF_Register); }
 
-    return test(ns);
-}
+bool Features::hasSearch() const { return testId(KF_Search); }
 
-#define FID_VCARD4 "urn:ietf:params:xml:ns:vcard-4.0"
-bool Features::hasVCard4() const
-{
-    QSet<QString> ns;
-    ns << FID_VCARD4;
+bool Features::hasGroupchat() const { return testId(KF_Groupchat); }
 
-    return test(ns);
-}
+bool Features::hasVoice() const { return testId(KF_Voice); }
 
-#define FID_MESSAGECARBONS "urn:xmpp:carbons:2"
-bool Features::hasMessageCarbons() const
-{
-    QStringList ns;
-    ns << FID_MESSAGECARBONS;
+bool Features::hasGateway() const { return testId(KF_Gateway); }
 
-    return test(ns);
-}
+bool Features::hasVersion() const { return testId(KF_QueryVersion); }
 
-bool Features::hasJingleFT() const
-{
-    QStringList ns;
-    ns << Jingle::FileTransfer::NS;
+bool Features::hasDisco() const { return testId(KF_Disco) && testId(KF_DiscoInfo) && testId(KF_DiscoItems); }
 
-    return test(ns);
-}
+bool Features::hasChatState() const { return testId(KF_ChatState); }
 
-#define FID_JINGLEICEUDP "urn:xmpp:jingle:transports:ice-udp:1"
-bool Features::hasJingleIceUdp() const { return test(QStringList() << QLatin1String(FID_JINGLEICEUDP)); }
+bool Features::hasVCard() const { return testId(KF_VCard); }
 
-#define FID_JINGLEICE "urn:xmpp:jingle:transports:ice:0"
-bool Features::hasJingleIce() const { return test(QStringList() << QLatin1String(FID_JINGLEICE)); }
+bool Features::hasVCard4() const { return testId(KF_VCard4); }
 
-#define NS_CAPS "http://jabber.org/protocol/caps"
-bool Features::hasCaps() const { return test(QStringList() << QLatin1String(NS_CAPS)); }
+bool Features::hasMessageCarbons() const { return testId(KF_MessageCarbons); }
 
-#define NS_CAPS_OPTIMIZE "http://jabber.org/protocol/caps#optimize"
-bool Features::hasCapsOptimize() const { return test(QStringList() << QLatin1String(NS_CAPS_OPTIMIZE)); }
+bool Features::hasJingleFT() const { return testId(KF_JingleFT); }
 
-#define NS_DIRECT_MUC_INVITE "jabber:x:conference"
-bool Features::hasDirectMucInvite() const { return test(QStringList() << QLatin1String(NS_DIRECT_MUC_INVITE)); }
+bool Features::hasJingleIceUdp() const { return testId(KF_JingleIceUdp); }
 
-#define FID_AVATAR_TO_VCARD_CONVERSION "urn:xmpp:pep-vcard-conversion:0"
-bool Features::hasAvatarConversion() const
+bool Features::hasJingleIce() const { return testId(KF_JingleIce); }
+
+bool Features::hasCaps() const { return testId(KF_Caps); }
+
+bool Features::hasCapsOptimize() const { return testId(KF_CapsOptimize); }
+
+bool Features::hasDirectMucInvite() const { return testId(KF_DirectMucInvite); }
+
+bool Features::hasAvatarConversion() const { return testId(KF_AvatarConversion); }
+
+Features &Features::operator+=(const Features &other)
 {
-    return test(QStringList() << QLatin1String(FID_AVATAR_TO_VCARD_CONVERSION));
+    if (other._bits.size() > _bits.size())
+        _bits.resize(other._bits.size());
+    if (!other._bits.isEmpty()) {
+        QBitArray o = other._bits;
+        o.resize(_bits.size());
+        _bits |= o;
+    }
+    for (const QString &f : other._extra)
+        addFeature(f);
+    return *this;
 }
 
-// custom Psi actions
-#define FID_ADD "psi:add"
+int Features::internedCount() { return registry().size(); }
 
 class Features::FeatureName : public QObject {
     Q_OBJECT
@@ -281,7 +361,7 @@ static Features::FeatureName *featureName = nullptr;
 
 long Features::id() const
 {
-    if (_list.count() > 1)
+    if (_bits.count(true) > 1)
         return FID_Invalid;
     else if (hasRegister())
         return FID_Register;
@@ -297,7 +377,7 @@ long Features::id() const
         return FID_VCard;
     else if (hasCommand())
         return FID_AHCommand;
-    else if (test(QStringList(FID_ADD)))
+    else if (testId(KF_Add))
         return FID_Add;
     else if (hasVersion())
         return FID_QueryVersion;
@@ -307,7 +387,9 @@ long Features::id() const
 
 long Features::id(const QString &feature)
 {
-    Features f(feature);
+    // just a lookup, a namespace we don't know is none of the ones with an id
+    Features f;
+    f.setId(registry().id(feature));
     return f.id();
 }
 
@@ -321,7 +403,7 @@ QString Features::feature(long id)
 
 Features &Features::operator<<(const QString &feature)
 {
-    _list << feature;
+    addFeature(feature);
     return *this;
 }
 
@@ -335,10 +417,6 @@ QString Features::name(long id)
 
 QString Features::name() const { return name(id()); }
 
-QString Features::name(const QString &feature)
-{
-    Features f(feature);
-    return f.name(f.id());
-}
+QString Features::name(const QString &feature) { return name(id(feature)); }
 
 #include "xmpp_features.moc"
@@ -20,12 +20,18 @@
 #ifndef XMPP_FEATURES_H
 #define XMPP_FEATURES_H
 
+#include <QBitArray>
 #include <QSet>
 #include <QStringList>
 
 class QString;
 
 namespace XMPP {
+// Feature namespaces are interned to small integer ids and a feature list is a bitset over
+// those ids. Copies share the bitset, so all entities with the same caps hash share one
+// instance (see CapsRegistry), and testing a feature doesn't allocate anything.
+// The process-wide table is bounded. Namespaces seen after it's full are kept as strings
+// in the list that has them.
 class Features {
 public:
     Features();
@@ -40,7 +46,7 @@ public:
     void        addFeature(const QString &);
 
     // features
-    inline bool isEmpty() const { return _list.isEmpty(); }
+    inline bool isEmpty() const { return _bits.isEmpty() && _extra.isEmpty(); }
 
     bool hasRegister() const;
     bool hasSearch() const;
@@ -107,17 +113,21 @@ public:
     static QString feature(long id);
 
     Features   &operator<<(const QString &feature);
-    inline bool operator==(const Features &other) const { return _list == other._list; }
-    Features   &operator+=(const Features &other)
-    {
-        _list += other._list;
-        return *this;
-    }
+    inline bool operator==(const Features &other) const { return _bits == other._bits && _extra == other._extra; }
+    Features   &operator+=(const Features &other);
+
+    static int internedCount(); // size of the namespace table, for diagnostics
 
     class FeatureName;
 
 private:
-    QSet<QString> _list;
+    bool testId(int id) const { return id >= 0 && id < _bits.size() && _bits.testBit(id); }
+    void setId(int id);
+
+    // bit per interned feature id. the highest bit is always set, so equal lists have equal arrays
+    QBitArray _bits;
+    // sorted namespaces that didn't fit in the table
+    QStringList _extra;
 };
 } // namespace XMPP
 
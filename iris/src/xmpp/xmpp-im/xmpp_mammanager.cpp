@@ -19,15 +19,27 @@
 
 #include "xmpp_mammanager.h"
 
+#include <QHash>
+
 using namespace XMPP;
 
 class MAMManager::Private {
 public:
+    struct PendingSync {
+        Jid  archive;
+        bool allowMUCArchives;
+    };
+
     int     mamPageSize;
     int     mamMaxMessages;
     bool    flipPages;
     bool    backwards;
     Client *client;
+
+    int                       maxConcurrentSyncs = 3;
+    QList<PendingSync>        pendingSyncs;
+    QHash<QString, MAMTask *> runningSyncs; // by bare archive jid
+    QHash<QString, QString>   cursors;      // by bare archive jid
 };
 
 MAMManager::MAMManager(Client *client, int mamPageSize, int mamMaxMessages, bool flipPages, bool backwards)
@@ -86,3 +98,83 @@ MAMTask *MAMManager::getMessagesBeforeID(const Jid &j, const QString &toID, cons
     task->get(j, QString(), toID, allowMUCArchives, d->mamPageSize, amount, true, true);
     return task;
 }
+
+void MAMManager::setPageSize(int mamPageSize) { d->mamPageSize = mamPageSize; }
+
+int MAMManager::pageSize() const { return d->mamPageSize; }
+
+void MAMManager::setMaxMessages(int mamMaxMessages) { d->mamMaxMessages = mamMaxMessages; }
+
+int MAMManager::maxMessages() const { return d->mamMaxMessages; }
+
+void MAMManager::setSyncCursor(const Jid &archive, const QString &stanzaId)
+{
+    d->cursors.insert(archive.bare(), stanzaId);
+}
+
+QString MAMManager::syncCursor(const Jid &archive) const { return d->cursors.value(archive.bare()); }
+
+void MAMManager::setMaxConcurrentSyncs(int count)
+{
+    d->maxConcurrentSyncs = qMax(1, count);
+    startPendingSyncs();
+}
+
+int MAMManager::maxConcurrentSyncs() const { return d->maxConcurrentSyncs; }
+
+void MAMManager::synchronize(const Jid &archive, bool allowMUCArchives)
+{
+    const QString key = archive.bare();
+    if (d->runningSyncs.contains(key))
+        return;
+    for (const auto &p : std::as_const(d->pendingSyncs)) {
+        if (p.archive.bare() == key)
+            return;
+    }
+
+    d->pendingSyncs.append({ archive.withResource(QString()), allowMUCArchives });
+    startPendingSyncs();
+}
+
+void MAMManager::startPendingSyncs()
+{
+    while (d->runningSyncs.size() < d->maxConcurrentSyncs && !d->pendingSyncs.isEmpty()) {
+        const auto    sync   = d->pendingSyncs.takeFirst();
+        const QString key    = sync.archive.bare();
+        const QString cursor = d->cursors.value(key);
+
+        auto task = new MAMTask(d->client->rootTask());
+        task->setKeepArchive(false);
+        // with a cursor go forward, so the last result of each page is the newest one.
+        // otherwise take the latest messages, newest page first and newest result first
+        bool forward = !cursor.isEmpty();
+        if (forward)
+            task->get(sync.archive, cursor, QString(), sync.allowMUCArchives, d->mamPageSize, d->mamMaxMessages,
+                      false, false);
+        else
+            task->get(sync.archive, QString(), QString(), sync.allowMUCArchives, d->mamPageSize, d->mamMaxMessages,
+                      true, true);
+
+        connect(task, &MAMTask::pageReady, this, [this, key, forward](const QList<QDomElement> &page) {
+            const Jid archive(key);
+            emit      pageReceived(archive, page);
+
+            // fetching backwards, only the first result of the first page is newer than anything we had
+            if (!forward && !d->cursors.value(key).isEmpty())
+                return;
+            const QString id = (forward ? page.last() : page.first()).attribute(QLatin1String("id"));
+            if (!id.isEmpty()) {
+                d->cursors.insert(key, id);
+                emit syncCursorChanged(archive, id);
+            }
+        });
+        connect(task, &MAMTask::finished, this, [this, task, key]() {
+            d->runningSyncs.remove(key);
+            emit synchronized(Jid(key), task->success());
+            startPendingSyncs();
+        });
+
+        d->runningSyncs.insert(key, task);
+        task->go(true);
+    }
+}
@@ -23,6 +23,7 @@
 #include "xmpp_client.h"
 #include "xmpp_mamtask.h"
 
+#include <QList>
 #include <QObject>
 #include <QString>
 
@@ -44,7 +45,31 @@ public:
     MAMTask *getMessagesBeforeID(const Jid &j, const QString &toID, const bool allowMUCArchives = true,
                                  int amount = 100);
 
+    void setPageSize(int mamPageSize);
+    int  pageSize() const;
+    void setMaxMessages(int mamMaxMessages); // zero means unlimited
+    int  maxMessages() const;
+
+    // Streaming catch-up of an archive. Everything newer than the archive's sync cursor
+    // (the last known stanza-id) is fetched forward and delivered page by page through
+    // pageReceived(). The cursor advances after every page, so an interrupted catch-up
+    // resumes where it stopped. Without a cursor the latest maxMessages() are fetched
+    // backwards, newest page first. At most maxConcurrentSyncs() archives are fetched
+    // at once, the rest is queued.
+    void    synchronize(const Jid &archive, bool allowMUCArchives = true);
+    void    setSyncCursor(const Jid &archive, const QString &stanzaId);
+    QString syncCursor(const Jid &archive) const;
+    void    setMaxConcurrentSyncs(int count);
+    int     maxConcurrentSyncs() const;
+
+signals:
+    void pageReceived(const XMPP::Jid &archive, const QList<QDomElement> &page);
+    void syncCursorChanged(const XMPP::Jid &archive, const QString &stanzaId); // persist it to resume later
+    void synchronized(const XMPP::Jid &archive, bool success);
+
 private:
+    void startPendingSyncs();
+
     class Private;
     Private *d;
 };
@@ -24,13 +24,15 @@ using namespace XMPP;
 
 class MAMTask::Private {
 public:
-    int  mamPageSize;    // TODO: this is the max page size for MAM request. Should be made into a config option in Psi+
-    int  mamMaxMessages; // maximum mam pages total, also should be config. zero means unlimited
+    int  mamPageSize;    // max page size for MAM request, see MAMManager::setPageSize()
+    int  mamMaxMessages; // maximum messages total. zero means unlimited
     int  messagesFetched;
     bool flipPages;
     bool backwards;
     bool allowMUCArchives;
     bool metadataFetched;
+    bool keepArchive = true;
+    bool reachedEnd  = false;
     Jid  j;
     MAMTask           *q;
     QString            firstID;
@@ -44,18 +46,26 @@ public:
     QDateTime          from;
     QDateTime          to;
     QList<QDomElement> archive;
+    QList<QDomElement> page;
 
     void  getPage();
+    void  finishPage(bool complete);
     void  getArchiveMetadata();
     XData makeMAMFilter();
 };
 
-MAMTask::MAMTask(Task *parent) : Task(parent) { d = new Private; }
+MAMTask::MAMTask(Task *parent) : Task(parent)
+{
+    d    = new Private;
+    d->q = this;
+}
 MAMTask::MAMTask(const MAMTask &x) : Task(x.parent()) { d = x.d; }
 MAMTask::~MAMTask() { delete d; }
 
 const QList<QDomElement> &MAMTask::archive() const { return d->archive; }
 
+void MAMTask::setKeepArchive(bool keep) { d->keepArchive = keep; }
+
 XData MAMTask::Private::makeMAMFilter()
 {
     XData::FieldList fl;
@@ -124,7 +134,10 @@ void MAMTask::Private::getPage()
     XData x = makeMAMFilter();
 
     SubsetsClientManager rsm;
-    rsm.setMax(mamMaxMessages);
+    int                  max = mamPageSize;
+    if (mamMaxMessages > 0)
+        max = qMin(max, mamMaxMessages - messagesFetched);
+    rsm.setMax(max);
 
     if (flipPages)
         query.appendChild(emptyTag(q->doc(), QLatin1String("flip-page")));
@@ -151,6 +164,23 @@ void MAMTask::Private::getPage()
     q->send(iq);
 }
 
+void MAMTask::Private::finishPage(bool complete)
+{
+    bool empty = page.isEmpty();
+    if (!empty) {
+        if (keepArchive)
+            archive += page;
+        QList<QDomElement> ready = page;
+        page.clear();
+        emit q->pageReady(ready);
+    }
+
+    if (complete || empty || reachedEnd || (mamMaxMessages > 0 && messagesFetched >= mamMaxMessages))
+        q->setSuccess();
+    else
+        getPage();
+}
+
 void MAMTask::Private::getArchiveMetadata()
 {
     // Craft a query to get the first and last messages in an archive
@@ -171,8 +201,10 @@ void MAMTask::get(const Jid &j, const QDateTime &from, const QDateTime &to, cons
                   int mamPageSize, int mamMaxMessages, bool flipPages, bool backwards)
 {
     d->archive         = {};
+    d->page            = {};
     d->messagesFetched = 0;
     d->metadataFetched = false;
+    d->reachedEnd      = false;
 
     d->j                = j;
     d->from             = from;
@@ -182,7 +214,6 @@ void MAMTask::get(const Jid &j, const QDateTime &from, const QDateTime &to, cons
     d->mamMaxMessages   = mamMaxMessages;
     d->flipPages        = flipPages;
     d->backwards        = backwards;
-    d->q                = this;
 }
 
 // Filter by id range
@@ -190,8 +221,10 @@ void MAMTask::get(const Jid &j, const QString &fromID, const QString &toID, cons
                   int mamPageSize, int mamMaxMessages, bool flipPages, bool backwards)
 {
     d->archive         = {};
+    d->page            = {};
     d->messagesFetched = 0;
     d->metadataFetched = false;
+    d->reachedEnd      = false;
 
     d->j                = j;
     d->fromID           = fromID;
@@ -209,36 +242,38 @@ bool MAMTask::take(const QDomElement &x)
 {
     if (d->metadataFetched) {
         if (iqVerify(x, QString(), d->currentPageQueryIQID)) {
-            if (!x.elementsByTagNameNS(QLatin1String("urn:ietf:params:xml:ns:xmpp-stanzas"),
-                                       QLatin1String("item-not-found"))
-                     .isEmpty()) {
-                setError(2, "First or last stanza UID of filter was not found in the archive");
+            if (x.attribute(QLatin1String("type")) == QLatin1String("error")) {
+                if (!x.elementsByTagNameNS(QLatin1String("urn:ietf:params:xml:ns:xmpp-stanzas"),
+                                           QLatin1String("item-not-found"))
+                         .isEmpty())
+                    setError(2, "First or last stanza UID of filter was not found in the archive");
+                else
+                    setError(x);
                 return true;
-            } else if (!x.elementsByTagNameNS(XMPP_MAM_NAMESPACE, QLatin1String("fin")).isEmpty()) {
-                // We are done?
-                //setSuccess();
-                //return true;
-                return false; // TODO: testing
             }
-            // Probably ignore it
-            return false;
+
+            // the iq result comes after all the page's messages
+            QDomElement fin = x.firstChildElement(QLatin1String("fin"));
+            if (fin.isNull() || fin.namespaceURI() != XMPP_MAM_NAMESPACE) {
+                setError(1, "Malformed server response");
+                return true;
+            }
+            d->finishPage(fin.attribute(QLatin1String("complete")) == QLatin1String("true"));
+            return true;
         }
 
         QDomElement result = x.firstChildElement("result");
         if (result != QDomElement() && result.namespaceURI() == XMPP_MAM_NAMESPACE
             && result.attribute(QLatin1String("queryid")) == d->currentPageQueryID) {
 
-            d->archive.append(result);
+            d->page.append(result);
             d->lastArchiveID   = result.attribute(QLatin1String("id"));
             d->messagesFetched = d->messagesFetched + 1;
-
-            // Check if we are done
-            if (result.attribute(QLatin1String("id")) == d->lastID || d->messagesFetched >= d->mamMaxMessages) {
-                setSuccess();
-            } else if (d->messagesFetched % d->mamPageSize == 0) {
-                d->getPage();
-            }
+            if (d->lastArchiveID == d->lastID)
+                d->reachedEnd = true;
+            return true;
         }
+        return false;
     } else {
         if (!iqVerify(x, QString(), d->mainQueryID))
             return false;
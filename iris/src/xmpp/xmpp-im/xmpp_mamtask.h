@@ -43,7 +43,10 @@ public:
     MAMTask(const MAMTask &x);
     ~MAMTask();
 
+    // all fetched results. stays empty if keepArchive is disabled and pages are only
+    // consumed through pageReady()
     const QList<QDomElement> &archive() const;
+    void                      setKeepArchive(bool keep);
 
     // Time filter
     void get(const Jid &j, const QDateTime &from = QDateTime(), const QDateTime &to = QDateTime(),
@@ -58,6 +61,10 @@ public:
     void onGo();
     bool take(const QDomElement &);
 
+signals:
+    // emitted for every page as soon as the server finished it, in the order the results arrived
+    void pageReady(const QList<QDomElement> &page);
+
 private:
     class Private;
     Private *d;
@@ -24,6 +24,9 @@
 #include "xmpp_tasks.h"
 
 namespace XMPP {
+// server and service features rarely change, so their disco#info survives reconnects and restarts
+static const int DiscoCacheTtl = 24 * 3600;
+
 ServerInfoManager::ServerInfoManager(Client *client) : QObject(client), _client(client), _canMessageCarbons(false)
 {
     deinitialize();
@@ -48,6 +51,7 @@ void ServerInfoManager::initialize()
     {
         JT_DiscoInfo *jt = new JT_DiscoInfo(_client->rootTask());
         connect(jt, &JT_DiscoInfo::finished, this, &ServerInfoManager::server_disco_finished);
+        jt->setCacheTtl(DiscoCacheTtl);
         jt->get(_client->jid().domain());
         jt->go(true);
     }
@@ -55,6 +59,7 @@ void ServerInfoManager::initialize()
     {
         JT_DiscoInfo *jt = new JT_DiscoInfo(_client->rootTask());
         connect(jt, &JT_DiscoInfo::finished, this, &ServerInfoManager::account_disco_finished);
+        jt->setCacheTtl(DiscoCacheTtl);
         jt->get(_client->jid().bare());
         jt->go(true);
     }
@@ -204,6 +209,7 @@ void ServerInfoManager::checkPendingServiceQueries()
                     }
                     checkPendingServiceQueries();
                 });
+                jtinfo->setCacheTtl(DiscoCacheTtl);
                 jtinfo->get(Jid(*jidIt), si.value().item.node());
                 jtinfo->go(true);
             }
@@ -93,6 +93,7 @@ static Roster xmlReadRoster(const QDomElement &q, bool push)
         }
     }
 
+    r.setVersion(q.attribute(QStringLiteral("ver")));
     return r;
 }
 
@@ -351,6 +352,7 @@ public:
     Roster             roster;
     QString            groupsDelimiter;
     QList<QDomElement> itemList;
+    bool               unchanged = false;
 };
 
 JT_Roster::JT_Roster(Task *parent) : Task(parent)
@@ -370,6 +372,12 @@ void JT_Roster::get()
     iq.appendChild(query);
 }
 
+void JT_Roster::get(const QString &version)
+{
+    get();
+    iq.firstChildElement().setAttribute(QStringLiteral("ver"), version);
+}
+
 void JT_Roster::set(const Jid &jid, const QString &name, const QStringList &groups)
 {
     type = Set;
@@ -449,6 +457,8 @@ void JT_Roster::onGo()
 
 const Roster &JT_Roster::roster() const { return d->roster; }
 
+bool JT_Roster::rosterUnchanged() const { return d->unchanged; }
+
 QString JT_Roster::groupsDelimiter() const { return d->groupsDelimiter; }
 
 QString JT_Roster::toString() const
@@ -494,7 +504,11 @@ bool JT_Roster::take(const QDomElement &x)
     if (type == Get) {
         if (x.attribute("type") == "result") {
             QDomElement q = queryTag(x);
-            d->roster     = xmlReadRoster(q, false);
+            // XEP-0237: an empty result means our version is up to date
+            //   and possible changes come as pushes
+            d->unchanged = q.isNull();
+            if (!d->unchanged)
+                d->roster = xmlReadRoster(q, false);
             setSuccess();
         } else {
             setError(x);
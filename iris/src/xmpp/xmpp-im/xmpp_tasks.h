@@ -94,6 +94,7 @@ public:
     ~JT_Roster();
 
     void get();
+    void get(const QString &version); // XEP-0237. empty version requests the full roster
     void set(const Jid &, const QString &name, const QStringList &groups);
     void remove(const Jid &);
 
@@ -102,6 +103,7 @@ public:
     void setGroupsDelimiter(const QString &groupsDelimiter);
 
     const Roster &roster() const;
+    bool          rosterUnchanged() const; // server confirmed our cached version is current
     QString       groupsDelimiter() const;
 
     QString toString() const;
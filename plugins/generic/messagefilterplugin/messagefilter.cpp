@@ -134,12 +134,12 @@ bool MessageFilter::incomingStanza(int account, const QDomElement &stanza)
                 break;
 
             case Contains:
-                if (!val.contains(QRegularExpression(condition.text)))
+                if (!val.contains(condition.regexp))
                     match = false;
                 break;
 
             case NotContains:
-                if (val.contains(QRegularExpression(condition.text)))
+                if (val.contains(condition.regexp))
                     match = false;
                 break;
             }
@@ -174,7 +174,9 @@ void MessageFilter::loadRules()
             condition.type = static_cast<ConditionType>(_optionHost->getPluginOption(optionName1 + "type").toInt());
             condition.comparison
                 = static_cast<Comparison>(_optionHost->getPluginOption(optionName1 + "comparison").toInt());
-            condition.text = _optionHost->getPluginOption(optionName1 + "text").toString();
+            condition.text   = _optionHost->getPluginOption(optionName1 + "text").toString();
+            condition.regexp = QRegularExpression(condition.text);
+            condition.regexp.optimize();
             rule.conditions << condition;
         }
         _rules << rule;
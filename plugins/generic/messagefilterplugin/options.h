@@ -23,6 +23,7 @@
 
 #include <QList>
 #include <QMetaType>
+#include <QRegularExpression>
 #include <QWidget>
 
 class OptionAccessingHost;
@@ -35,9 +36,10 @@ enum ConditionType { From, To, FromFull, ToFull, Message };
 enum Comparison { Equal, NotEqual, Contains, NotContains };
 
 struct Condition {
-    ConditionType type;
-    Comparison    comparison;
-    QString       text;
+    ConditionType      type;
+    Comparison         comparison;
+    QString            text;
+    QRegularExpression regexp; // compiled text for Contains and NotContains
 };
 
 struct Rule {
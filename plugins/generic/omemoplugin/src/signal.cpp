@@ -21,6 +21,7 @@
 #include "signal.h"
 #include "crypto.h"
 #include <QMessageBox>
+#include <QSet>
 
 extern "C" {
 #include "key_helper.h"
@@ -155,6 +156,7 @@ void Signal::processBundle(const QString &from, uint32_t deviceId, const Bundle
 
                     if (session_builder_create(&session_builder, m_storage.storeContext(), &addr, m_signalContext)
                         == SG_SUCCESS) {
+                        Storage::Batch batch(m_storage);
                         session_builder_process_pre_key_bundle(session_builder, pre_key_bundle);
                         session_builder_free(session_builder);
                     }
@@ -214,23 +216,42 @@ bool Signal::sessionIsValid(const signal_protocol_address &addr) const
 
 QList<EncryptedKey> Signal::encryptKey(const QString &ownJid, const QString &recipient, const QByteArray &key)
 {
-    QList<EncryptedKey> results;
-    const QByteArray   &recipientUtf8 = recipient.toUtf8();
-    const QByteArray   &ownJidUtf8    = ownJid.toUtf8();
+    return encryptKey(ownJid, QStringList { recipient }, key);
+}
 
-    QSet<uint32_t> ownDevices       = m_storage.getDeviceList(ownJid);
-    QSet<uint32_t> recipientDevices = m_storage.getDeviceList(recipient);
+QList<EncryptedKey> Signal::encryptKey(const QString &ownJid, const QStringList &recipients, const QByteArray &key)
+{
+    QList<EncryptedKey> results;
 
-    if (recipientDevices.isEmpty()) {
+    // every device gets the key once, however many recipients share it. that includes own devices,
+    // which may be among the recipients too (a note to self, carbons)
+    QList<QPair<QByteArray, uint32_t>> devices;
+    QSet<QPair<QByteArray, uint32_t>>  seen;
+    const QByteArray                  &ownJidUtf8 = ownJid.toUtf8();
+
+    auto const addDevices = [&](const QString &jid) {
+        const QByteArray jidUtf8 = jid.toUtf8();
+        const auto       ids     = m_storage.getDeviceList(jid);
+        for (auto deviceId : ids) {
+            auto device = qMakePair(jidUtf8, deviceId);
+            if (!(jidUtf8 == ownJidUtf8 && deviceId == m_deviceId) && !seen.contains(device)) {
+                seen.insert(device);
+                devices.append(device);
+            }
+        }
+    };
+    for (const QString &recipient : recipients) {
+        addDevices(recipient);
+    }
+    if (devices.isEmpty()) {
         return results;
     }
+    addDevices(ownJid);
 
-    QSet<uint32_t> devices;
-    devices.unite(ownDevices).unite(recipientDevices).remove(m_deviceId);
-
-    for (auto deviceId : devices) {
-        const QByteArray       &name = recipientDevices.contains(deviceId) ? recipientUtf8 : ownJidUtf8;
-        signal_protocol_address addr = getAddress(deviceId, name);
+    // every session_cipher_encrypt() advances and stores the ratchet, write them all at once
+    Storage::Batch batch(m_storage);
+    for (const auto &device : std::as_const(devices)) {
+        signal_protocol_address addr = getAddress(device.second, device.first);
         if (!sessionIsValid(addr))
             continue;
 
@@ -259,6 +280,7 @@ QPair<QByteArray, bool> Signal::decryptKey(const QString &sender, const Encrypte
 
     const QByteArray       &senderUtf8  = sender.toUtf8();
     signal_protocol_address sender_addr = getAddress(encryptedKey.deviceId, senderUtf8);
+    Storage::Batch          batch(m_storage);
 
     if (encryptedKey.isPreKey) {
         session_builder *session_builder = nullptr;
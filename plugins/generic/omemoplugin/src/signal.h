@@ -72,6 +72,7 @@ public:
     uint32_t getDeviceId();
     void updateDeviceList(const QString &user, const QSet<uint32_t> &actualIds, QMap<uint32_t, QString> &deviceLabels);
     QList<EncryptedKey>     encryptKey(const QString &ownJid, const QString &recipient, const QByteArray &key);
+    QList<EncryptedKey>     encryptKey(const QString &ownJid, const QStringList &recipients, const QByteArray &key);
     QPair<QByteArray, bool> decryptKey(const QString &sender, const EncryptedKey &encryptedKey);
     QVector<uint32_t>       invalidSessions(const QString &recipient);
     uint32_t                preKeyCount();
@@ -43,6 +43,7 @@ void Storage::init(signal_context *ctx, const QString &dataPath, const QString &
 
     initializeDB(ctx);
     QSqlQuery(db()).exec("VACUUM");
+    loadCache();
 
     signal_protocol_session_store        session_store        = { /*.load_session_func =*/&loadSession,
                                                     /*.get_sub_device_sessions_func =*/nullptr,
@@ -80,6 +81,13 @@ void Storage::init(signal_context *ctx, const QString &dataPath, const QString &
 
 void Storage::deinit()
 {
+    flush();
+    m_storeSessionQuery   = QSqlQuery();
+    m_storeIdentityQuery  = QSqlQuery();
+    m_removeIdentityQuery = QSqlQuery();
+    m_lookupDevicesQuery  = QSqlQuery();
+    clearCache();
+
     QSqlQuery(db()).exec("VACUUM");
     QSqlDatabase::database(m_databaseConnectionName).close();
     QSqlDatabase::removeDatabase(m_databaseConnectionName);
@@ -206,8 +214,108 @@ void Storage::migrateDatabase()
     storeValue("db_ver", 4);
 }
 
+void Storage::loadCache()
+{
+    QSqlDatabase _db = db();
+
+    m_storeSessionQuery = QSqlQuery(_db);
+    m_storeSessionQuery.prepare("INSERT OR REPLACE INTO session_store (jid, device_id, session) VALUES (?, ?, ?)");
+    m_storeIdentityQuery = QSqlQuery(_db);
+    m_storeIdentityQuery.prepare("INSERT OR REPLACE INTO identity_key_store (key, jid, device_id) VALUES (?, ?, ?)");
+    m_removeIdentityQuery = QSqlQuery(_db);
+    m_removeIdentityQuery.prepare("DELETE FROM identity_key_store WHERE jid IS ? AND device_id IS ?");
+    m_lookupDevicesQuery = QSqlQuery(_db);
+    m_lookupDevicesQuery.prepare("SELECT device_id, trust FROM devices WHERE jid IS ?");
+
+    QSqlQuery q(_db);
+    q.exec("SELECT jid, device_id, session FROM session_store");
+    while (q.next()) {
+        m_sessions.insert(qMakePair(q.value(0).toString(), q.value(1).toUInt()), q.value(2).toByteArray());
+    }
+    q.exec("SELECT jid, device_id, key FROM identity_key_store");
+    while (q.next()) {
+        m_identities.insert(qMakePair(q.value(0).toString(), q.value(1).toUInt()), q.value(2).toByteArray());
+    }
+}
+
+void Storage::clearCache()
+{
+    m_sessions.clear();
+    m_identities.clear();
+    m_dirtySessions.clear();
+    m_dirtyIdentities.clear();
+    m_values.clear();
+    m_devices.clear();
+}
+
+bool Storage::flush()
+{
+    if (m_dirtySessions.isEmpty() && m_dirtyIdentities.isEmpty()) {
+        return true;
+    }
+
+    QSqlDatabase _db = db();
+    bool         ok  = true;
+    _db.transaction();
+    for (const Address &addr : std::as_const(m_dirtySessions)) {
+        m_storeSessionQuery.bindValue(0, addr.first);
+        m_storeSessionQuery.bindValue(1, addr.second);
+        m_storeSessionQuery.bindValue(2, m_sessions.value(addr));
+        ok = m_storeSessionQuery.exec() && ok;
+    }
+    for (const Address &addr : std::as_const(m_dirtyIdentities)) {
+        auto it = m_identities.constFind(addr);
+        if (it != m_identities.constEnd()) {
+            m_storeIdentityQuery.bindValue(0, it.value());
+            m_storeIdentityQuery.bindValue(1, addr.first);
+            m_storeIdentityQuery.bindValue(2, addr.second);
+            ok = m_storeIdentityQuery.exec() && ok;
+        } else {
+            m_removeIdentityQuery.bindValue(0, addr.first);
+            m_removeIdentityQuery.bindValue(1, addr.second);
+            ok = m_removeIdentityQuery.exec() && ok;
+        }
+    }
+    ok = _db.commit() && ok;
+    if (!ok) {
+        qWarning() << "Failed to write OMEMO sessions:" << _db.lastError();
+    }
+
+    m_dirtySessions.clear();
+    m_dirtyIdentities.clear();
+    return ok;
+}
+
+Storage::Batch::Batch(Storage &storage) : m_storage(storage) { ++m_storage.m_batchLevel; }
+
+Storage::Batch::~Batch()
+{
+    if (--m_storage.m_batchLevel == 0) {
+        m_storage.flush();
+    }
+}
+
 QSqlDatabase Storage::db() const { return QSqlDatabase::database(m_databaseConnectionName); }
 
+QHash<uint32_t, TRUST_STATE> Storage::devices(const QString &user)
+{
+    auto it = m_devices.constFind(user);
+    if (it != m_devices.constEnd()) {
+        return it.value();
+    }
+
+    QHash<uint32_t, TRUST_STATE> result;
+    m_lookupDevicesQuery.bindValue(0, user);
+    m_lookupDevicesQuery.exec();
+    while (m_lookupDevicesQuery.next()) {
+        result.insert(m_lookupDevicesQuery.value(0).toUInt(),
+                      static_cast<TRUST_STATE>(m_lookupDevicesQuery.value(1).toInt()));
+    }
+    m_lookupDevicesQuery.finish();
+    m_devices.insert(user, result);
+    return result;
+}
+
 QMap<uint32_t, QByteArray> Storage::getKeysMap(const QString &user)
 {
     QSqlQuery q(db());
@@ -224,34 +332,24 @@ QMap<uint32_t, QByteArray> Storage::getKeysMap(const QString &user)
 
 QSet<uint32_t> Storage::getDeviceList(const QString &user, bool onlyTrusted)
 {
-    QSqlQuery q(db());
-    if (onlyTrusted) {
-        q.prepare("SELECT device_id FROM devices WHERE jid IS ? AND trust IS ?");
-        q.bindValue(1, TRUSTED);
-    } else {
-        q.prepare("SELECT device_id FROM devices WHERE jid IS ?");
-    }
-    q.bindValue(0, user);
-    q.exec();
-
+    const auto     list = devices(user);
     QSet<uint32_t> knownIds;
-    while (q.next()) {
-        knownIds.insert(q.value(0).toUInt());
+    for (auto it = list.constBegin(); it != list.constEnd(); ++it) {
+        if (!onlyTrusted || it.value() == TRUSTED) {
+            knownIds.insert(it.key());
+        }
     }
     return knownIds;
 }
 
 QSet<uint32_t> Storage::getUndecidedDeviceList(const QString &user)
 {
-    QSqlQuery q(db());
-    q.prepare("SELECT device_id FROM devices WHERE jid IS ? AND trust IS ?");
-    q.addBindValue(user);
-    q.addBindValue(UNDECIDED);
-    q.exec();
-
+    const auto     list = devices(user);
     QSet<uint32_t> ids;
-    while (q.next()) {
-        ids.insert(q.value(0).toUInt());
+    for (auto it = list.constBegin(); it != list.constEnd(); ++it) {
+        if (it.value() == UNDECIDED) {
+            ids.insert(it.key());
+        }
     }
     return ids;
 }
@@ -334,6 +432,8 @@ void Storage::updateDeviceList(const QString &user, const QSet<uint32_t> &actual
         }
         _db.commit();
     }
+
+    m_devices.remove(user);
 }
 
 QVector<QPair<uint32_t, QByteArray>> Storage::loadAllPreKeys(int limit)
@@ -406,14 +506,11 @@ int Storage::toSignalBuffer(const QVariant &q, signal_buffer **record)
     return 1;
 }
 
-QSqlQuery Storage::lookupSession(const signal_protocol_address *address, const void *user_data)
+Storage *Storage::fromUserData(void *user_data) { return static_cast<Storage *>(user_data); }
+
+Storage::Address Storage::addressOf(const signal_protocol_address *address)
 {
-    QSqlQuery q = getQuery(user_data);
-    q.prepare("SELECT session FROM session_store WHERE jid IS ? AND device_id IS ?");
-    q.addBindValue(addrName(address));
-    q.addBindValue(address->device_id);
-    q.exec();
-    return q;
+    return qMakePair(addrName(address), static_cast<uint32_t>(address->device_id));
 }
 
 #ifdef OLD_SIGNAL
@@ -425,8 +522,9 @@ int Storage::loadSession(signal_buffer **record, signal_buffer **user_record, co
 {
     (void)user_record;
 #endif
-    QSqlQuery q = lookupSession(address, user_data);
-    return q.next() ? toSignalBuffer(q.value(0), record) : 0;
+    Storage *storage = fromUserData(user_data);
+    auto     it      = storage->m_sessions.constFind(addressOf(address));
+    return it != storage->m_sessions.constEnd() ? toSignalBuffer(it.value(), record) : 0;
 }
 
 #ifdef OLD_SIGNAL
@@ -439,18 +537,19 @@ int Storage::storeSession(const signal_protocol_address *address, uint8_t *recor
     (void)user_record;
     (void)user_record_len;
 #endif
-    QSqlQuery q = getQuery(user_data);
-    q.prepare("INSERT OR REPLACE INTO session_store (jid, device_id, session) VALUES (?, ?, ?)");
-    q.addBindValue(addrName(address));
-    q.addBindValue(address->device_id);
-    q.addBindValue(QByteArray(reinterpret_cast<char *>(record), static_cast<int>(record_len)));
-    return q.exec() ? SG_SUCCESS : -1;
+    Storage      *storage = fromUserData(user_data);
+    const Address addr    = addressOf(address);
+    storage->m_sessions.insert(addr, QByteArray(reinterpret_cast<char *>(record), static_cast<int>(record_len)));
+    storage->m_dirtySessions.insert(addr);
+    if (storage->m_batchLevel == 0) {
+        return storage->flush() ? SG_SUCCESS : -1;
+    }
+    return SG_SUCCESS;
 }
 
 int Storage::containsSession(const signal_protocol_address *address, void *user_data)
 {
-    QSqlQuery q = lookupSession(address, user_data);
-    return q.next() ? 1 : 0;
+    return fromUserData(user_data)->m_sessions.contains(addressOf(address)) ? 1 : 0;
 }
 
 int Storage::loadPreKey(signal_buffer **record, uint32_t pre_key_id, void *user_data)
@@ -501,11 +600,19 @@ int Storage::getIdentityKeyPair(signal_buffer **public_data, signal_buffer **pri
 
 QVariant Storage::lookupValue(void *user_data, const QString &key)
 {
+    Storage *storage = fromUserData(user_data);
+    auto     it      = storage->m_values.constFind(key);
+    if (it != storage->m_values.constEnd()) {
+        return it.value();
+    }
+
     QSqlQuery q = getQuery(user_data);
     q.prepare("SELECT value FROM simple_store WHERE key IS ?");
     q.addBindValue(key);
     q.exec();
-    return q.next() ? q.value(0) : QVariant();
+    QVariant value = q.next() ? q.value(0) : QVariant();
+    storage->m_values.insert(key, value);
+    return value;
 }
 
 void Storage::storeValue(const QString &key, const QVariant &value)
@@ -515,6 +622,7 @@ void Storage::storeValue(const QString &key, const QVariant &value)
     q.addBindValue(key);
     q.addBindValue(value);
     q.exec();
+    m_values.insert(key, value);
 }
 
 int Storage::getLocalRegistrationId(void *user_data, uint32_t *registration_id)
@@ -529,27 +637,23 @@ int Storage::getLocalRegistrationId(void *user_data, uint32_t *registration_id)
 
 bool Storage::identityExists(const signal_protocol_address *addr_p) const
 {
-    QSqlQuery q(db());
-    q.prepare("SELECT COUNT(*) FROM identity_key_store WHERE jid IS ? AND device_id IS ?");
-    q.addBindValue(addrName(addr_p));
-    q.addBindValue(addr_p->device_id);
-    q.exec();
-    return q.next() && q.value(0).toInt() == 1;
+    return m_identities.contains(addressOf(addr_p));
 }
 
 int Storage::saveIdentity(const signal_protocol_address *addr_p, uint8_t *key_data, size_t key_len, void *user_data)
 {
-    QSqlQuery q = getQuery(user_data);
-
+    Storage      *storage = fromUserData(user_data);
+    const Address addr    = addressOf(addr_p);
     if (key_data != nullptr) {
-        q.prepare("INSERT OR REPLACE INTO identity_key_store (key, jid, device_id) VALUES (?, ?, ?)");
-        q.addBindValue(QByteArray(reinterpret_cast<char *>(key_data), static_cast<int>(key_len)));
+        storage->m_identities.insert(addr, QByteArray(reinterpret_cast<char *>(key_data), static_cast<int>(key_len)));
     } else {
-        q.prepare("DELETE FROM identity_key_store WHERE jid IS ? AND device_id IS ?");
+        storage->m_identities.remove(addr);
     }
-    q.addBindValue(addrName(addr_p));
-    q.addBindValue(addr_p->device_id);
-    return q.exec() ? SG_SUCCESS : -1;
+    storage->m_dirtyIdentities.insert(addr);
+    if (storage->m_batchLevel == 0) {
+        return storage->flush() ? SG_SUCCESS : -1;
+    }
+    return SG_SUCCESS;
 }
 
 int Storage::isTrustedIdentity(const signal_protocol_address *addr_p, uint8_t *key_data, size_t key_len,
@@ -566,27 +670,12 @@ signal_protocol_store_context *Storage::storeContext() const { return m_storeCon
 
 bool Storage::isTrusted(QString const &user, uint32_t deviceId)
 {
-    QSqlQuery q(db());
-    q.prepare("SELECT trust FROM devices where jid IS ? AND device_id IS ?");
-    q.addBindValue(user);
-    q.addBindValue(deviceId);
-    q.exec();
-    return q.next() && q.value(0).toInt() == TRUSTED;
+    return devices(user).value(deviceId, UNDECIDED) == TRUSTED;
 }
 
 QByteArray Storage::loadDeviceIdentity(const QString &user, uint32_t deviceId)
 {
-    QSqlQuery q(db());
-    q.prepare("SELECT key FROM identity_key_store WHERE jid IS ? AND device_id IS ?");
-    q.addBindValue(user);
-    q.addBindValue(deviceId);
-    q.exec();
-
-    QByteArray res;
-    if (q.next()) {
-        res = q.value(0).toByteArray();
-    }
-    return res;
+    return m_identities.value(qMakePair(user, deviceId));
 }
 
 void Storage::removeDevice(const QString &user, uint32_t deviceId)
@@ -612,6 +701,8 @@ void Storage::removeDevice(const QString &user, uint32_t deviceId)
         // q.exec();
     }
     _db.commit();
+
+    m_devices.remove(user);
 }
 
 void Storage::setDeviceTrust(const QString &user, uint32_t deviceId, bool trusted)
@@ -622,6 +713,8 @@ void Storage::setDeviceTrust(const QString &user, uint32_t deviceId, bool truste
     q.addBindValue(user);
     q.addBindValue(deviceId);
     q.exec();
+
+    m_devices.remove(user);
 }
 
 void Storage::removeCurrentDevice()
@@ -639,6 +732,8 @@ void Storage::removeCurrentDevice()
         q.exec("DROP TABLE simple_store");
     }
     _db.commit();
+
+    clearCache();
 }
 
 bool Storage::isEnabledForUser(const QString &user)
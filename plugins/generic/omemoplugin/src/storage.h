@@ -31,8 +31,23 @@ extern "C" {
 namespace psiomemo {
 enum TRUST_STATE { UNDECIDED, TRUSTED, UNTRUSTED };
 
+// Sessions, identities, device lists and simple values are kept in memory; the database is
+// only read once. Writes coming from libsignal inside a Batch are written back in a single
+// transaction when the outermost Batch ends, other writes go straight to the database.
 class Storage {
 public:
+    class Batch {
+    public:
+        explicit Batch(Storage &storage);
+        ~Batch();
+
+        Batch(const Batch &)            = delete;
+        Batch &operator=(const Batch &) = delete;
+
+    private:
+        Storage &m_storage;
+    };
+
     void init(signal_context *ctx, const QString &dataPath, const QString &accountId);
     void deinit();
 
@@ -62,12 +77,32 @@ public:
     void                           setDisabledForUser(const QString &user, bool value);
 
 private:
+    using Address = QPair<QString, uint32_t>;
+
     QString m_databaseConnectionName;
 
     signal_protocol_store_context *m_storeContext = nullptr;
 
+    QHash<Address, QByteArray>                   m_sessions;
+    QHash<Address, QByteArray>                   m_identities;
+    QSet<Address>                                m_dirtySessions;
+    QSet<Address>                                m_dirtyIdentities; // removed if absent from m_identities
+    QHash<QString, QVariant>                     m_values;
+    QHash<QString, QHash<uint32_t, TRUST_STATE>> m_devices; // loaded on demand per jid
+    int                                          m_batchLevel = 0;
+
+    QSqlQuery m_storeSessionQuery;
+    QSqlQuery m_storeIdentityQuery;
+    QSqlQuery m_removeIdentityQuery;
+    QSqlQuery m_lookupDevicesQuery;
+
     void initializeDB(signal_context *signalContext);
     void migrateDatabase();
+    void loadCache();
+    void clearCache();
+    bool flush();
+
+    QHash<uint32_t, TRUST_STATE> devices(const QString &user);
 
     QSqlDatabase     db() const;
     static QSqlQuery getQuery(const void *user_data);
@@ -75,7 +110,8 @@ private:
     static QString   addrName(const signal_protocol_address *address);
 
     static int       toSignalBuffer(const QVariant &q, signal_buffer **record);
-    static QSqlQuery lookupSession(const signal_protocol_address *address, const void *user_data);
+    static Storage  *fromUserData(void *user_data);
+    static Address   addressOf(const signal_protocol_address *address);
 #ifdef OLD_SIGNAL
     static int loadSession(signal_buffer **record, const signal_protocol_address *address, void *user_data);
     static int storeSession(const signal_protocol_address *address, uint8_t *record, size_t record_len,
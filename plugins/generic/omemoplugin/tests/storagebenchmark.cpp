@@ -0,0 +1,107 @@
+/*
+ * OMEMO Plugin for Psi
+ * Copyright (C) 2026 Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "crypto.h"
+#include "storage.h"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+extern "C" {
+#include "session_record.h"
+}
+
+using namespace psiomemo;
+
+// a message to a group chat: one session per recipient device is ratcheted and stored
+static const int Devices = 50;
+
+class StorageBenchmark : public QObject {
+    Q_OBJECT
+
+private:
+    Crypto          crypto;
+    signal_context *ctx = nullptr;
+    QTemporaryDir   dir;
+    QByteArray      name;
+
+    signal_protocol_address address(int device)
+    {
+        return { name.constData(), size_t(name.size()), int32_t(device + 1) };
+    }
+
+    void storeSessions(Storage &storage)
+    {
+        for (int i = 0; i < Devices; ++i) {
+            session_record *record = nullptr;
+            QCOMPARE(session_record_create(&record, nullptr, ctx), SG_SUCCESS);
+            signal_protocol_address addr = address(i);
+            QCOMPARE(signal_protocol_session_store_session(storage.storeContext(), &addr, record), SG_SUCCESS);
+            SIGNAL_UNREF(record);
+        }
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(crypto.isSupported());
+        QVERIFY(dir.isValid());
+        signal_context_create(&ctx, this);
+        crypto.initCryptoProvider(ctx);
+    }
+
+    void cleanupTestCase() { signal_context_destroy(ctx); }
+
+    void benchmarkStoreSessions_data()
+    {
+        QTest::addColumn<bool>("batched");
+        QTest::newRow("batched") << true;
+        QTest::newRow("unbatched") << false;
+    }
+
+    void benchmarkStoreSessions()
+    {
+        QFETCH(bool, batched);
+        name = QString("room-%1@muc.example.com").arg(batched).toUtf8();
+
+        Storage storage;
+        storage.init(ctx, dir.path(), "bench");
+        QBENCHMARK
+        {
+            if (batched) {
+                Storage::Batch batch(storage);
+                storeSessions(storage);
+            } else {
+                storeSessions(storage);
+            }
+        }
+        storage.deinit();
+
+        // everything reached the database
+        storage.init(ctx, dir.path(), "bench");
+        for (int i = 0; i < Devices; ++i) {
+            signal_protocol_address addr = address(i);
+            QCOMPARE(signal_protocol_session_contains_session(storage.storeContext(), &addr), 1);
+        }
+        storage.deinit();
+    }
+};
+
+QTEST_GUILESS_MAIN(StorageBenchmark)
+#include "storagebenchmark.moc"
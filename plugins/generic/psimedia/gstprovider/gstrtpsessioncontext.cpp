@@ -35,6 +35,13 @@ QObject *GstRtpSessionContext::qobject() { return this; }
 
 void GstRtpSessionContext::cleanup()
 {
+    if (control) {
+        auto preview = frameStats(RwControlFrame::Preview);
+        auto output  = frameStats(RwControlFrame::Output);
+        qDebug("video frames: preview %d rendered / %d dropped, output %d rendered / %d dropped", preview.rendered,
+               preview.dropped, output.rendered, output.dropped);
+    }
+
     if (outputWidget)
         outputWidget->show_frame(QImage());
     if (previewWidget)
@@ -295,6 +302,23 @@ RtpChannelContext *GstRtpSessionContext::audioRtpChannel() { return &audioRtp; }
 
 RtpChannelContext *GstRtpSessionContext::videoRtpChannel() { return &videoRtp; }
 
+RwControlFrameStats GstRtpSessionContext::frameStats(RwControlFrame::Type type)
+{
+    RwControlFrameStats stats;
+    if (control)
+        stats = control->frameStats(type);
+
+#ifdef QT_GUI_LIB
+    // frames delivered by the control but replaced before the widget painted them
+    GstVideoWidget *widget = type == RwControlFrame::Preview ? previewWidget : outputWidget;
+    if (widget) {
+        stats.rendered = widget->framesPainted;
+        stats.dropped += widget->framesDropped;
+    }
+#endif
+    return stats;
+}
+
 void GstRtpSessionContext::dumpPipeline(std::function<void(const QStringList &)> callback)
 {
     if (control)
@@ -115,6 +115,9 @@ public:
     RtpChannelContext  *videoRtpChannel() override;
     void                dumpPipeline(std::function<void(const QStringList &)> callback) override;
 
+    // frames delivered/dropped on the way to the preview or output widget
+    RwControlFrameStats frameStats(RwControlFrame::Type type);
+
     // channel calls this, which may be in another thread
     void push_packet_for_write(GstRtpChannel *from, const PRtpPacket &rtp);
 
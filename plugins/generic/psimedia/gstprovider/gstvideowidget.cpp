@@ -39,7 +39,13 @@ GstVideoWidget::GstVideoWidget(VideoWidgetContext *_context, QObject *parent) :
 
 void GstVideoWidget::show_frame(const QImage &image)
 {
-    curImage = image;
+    // if the previous frame wasn't painted yet, just replace it. update()
+    //   is already scheduled, so the widget paints the newest one only.
+    if (framePending && !curImage.isNull())
+        ++framesDropped;
+
+    curImage     = image;
+    framePending = !image.isNull();
     context->qwidget()->update();
 }
 
@@ -50,6 +56,11 @@ void GstVideoWidget::context_paintEvent(QPainter *p)
     if (curImage.isNull())
         return;
 
+    if (framePending) {
+        framePending = false;
+        ++framesPainted;
+    }
+
     QSize size    = context->qwidget()->size();
     QSize newSize = curImage.size();
     newSize.scale(size, Qt::KeepAspectRatio);
@@ -36,6 +36,9 @@ class GstVideoWidget : public QObject {
 public:
     VideoWidgetContext *context;
     QImage              curImage;
+    bool                framePending  = false; // curImage wasn't painted yet
+    int                 framesPainted = 0;
+    int                 framesDropped = 0; // replaced before they got painted
 
     explicit GstVideoWidget(VideoWidgetContext *_context, QObject *parent = nullptr);
 
@@ -1772,11 +1772,28 @@ bool RtpWorker::updateVp8Config()
     return false;
 }
 
+// keeps the sample alive (and its buffer mapped) for as long as some QImage
+//   refers to the mapped memory
+struct MappedSample {
+    GstSample *sample;
+    GstMapInfo map;
+};
+
+static void releaseMappedSample(void *info)
+{
+    auto ms = static_cast<MappedSample *>(info);
+    gst_buffer_unmap(gst_sample_get_buffer(ms->sample), &ms->map);
+    gst_sample_unref(ms->sample);
+    delete ms;
+}
+
 RtpWorker::Frame RtpWorker::Frame::pullFromSink(GstAppSink *appsink)
 {
     Frame      frame;
     int        width, height;
     GstSample *sample = gst_app_sink_pull_sample(appsink);
+    if (!sample)
+        return frame;
     GstCaps   *caps   = gst_sample_get_caps(sample);
     GstBuffer *buffer = gst_sample_get_buffer(sample);
 
@@ -1791,22 +1808,32 @@ RtpWorker::Frame RtpWorker::Frame::pullFromSink(GstAppSink *appsink)
     gst_structure_get_int(capsStruct, "width", &width);
     gst_structure_get_int(capsStruct, "height", &height);
 
-    if (gsize(width * height * 4) == gst_buffer_get_size(buffer)) {
-        QImage image(width, height, QImage::Format_RGB32);
-#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
-        gst_buffer_extract(buffer, 0, image.bits(), gsize(image.sizeInBytes()));
-#else
-        gst_buffer_extract(buffer, 0, image.bits(), image.byteCount());
-#endif
-        frame.image = image;
-    } else {
+    if (gsize(width * height * 4) != gst_buffer_get_size(buffer)) {
         qDebug("wrong size of received buffer: %x != %lx", (width * height * 4), gst_buffer_get_size(buffer));
         gchar *capsstr;
         capsstr = gst_caps_to_string(caps);
         qDebug("recv video frame caps: %s", capsstr);
         g_free(capsstr);
+        gst_sample_unref(sample);
+        return frame;
     }
-    gst_sample_unref(sample);
+
+    // wrap the buffer memory instead of copying it. the image is read-only
+    //   (const data), so any attempt to modify it detaches to a private copy,
+    //   and the sample is released once the last QImage sharing it goes away.
+    auto ms    = new MappedSample;
+    ms->sample = sample;
+    if (!gst_buffer_map(buffer, &ms->map, GST_MAP_READ)) {
+        qDebug("failed to map received video buffer");
+        gst_sample_unref(sample);
+        delete ms;
+        return frame;
+    }
+
+    frame.image = QImage(static_cast<const uchar *>(ms->map.data), width, height, width * 4, QImage::Format_RGB32,
+                         releaseMappedSample, ms);
+    if (frame.image.isNull()) // cleanup function isn't called for a null image
+        releaseMappedSample(ms);
 
     return frame;
 }
@@ -44,6 +44,9 @@ public:
     public:
         QImage image;
 
+        // the returned image wraps the mapped sample memory without copying
+        //   it. the sample is held until the last copy of the image is gone,
+        //   so don't keep frames around longer than needed.
         static Frame pullFromSink(GstAppSink *appsink);
     };
 
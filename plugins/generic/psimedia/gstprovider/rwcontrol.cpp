@@ -25,11 +25,13 @@
 #include "rtpworker.h"
 #include <QPointer>
 
-// note: queuing frames doesn't really make much sense, since if the UI
-//   receives 5 frames at once, they'll just get painted on each other in
-//   succession and you'd only really see the last one.  however, we'll queue
-//   frames in case we ever want to do timestamped frames.
-#define QUEUE_FRAME_MAX 10
+// note: queuing frames doesn't make much sense, since if the UI receives 5
+//   frames at once, they'll just get painted on each other in succession and
+//   you'd only really see the last one.  also, frames share their memory with
+//   the gstreamer buffer pool, so every queued frame keeps a pool buffer busy.
+//   therefore only the latest frame of each type is kept and older ones are
+//   dropped.
+#define QUEUE_FRAME_MAX 1
 
 namespace PsiMedia {
 
@@ -217,6 +219,12 @@ void RwControlLocal::setRecord(const RwControlRecord &record)
     remote_->postMessage(msg);
 }
 
+RwControlFrameStats RwControlLocal::frameStats(RwControlFrame::Type type)
+{
+    QMutexLocker locker(&in_mutex);
+    return type == RwControlFrame::Preview ? previewStats : outputStats;
+}
+
 void RwControlLocal::rtpAudioIn(const PRtpPacket &packet) { remote_->rtpAudioIn(packet); }
 
 void RwControlLocal::rtpVideoIn(const PRtpPacket &packet) { remote_->rtpVideoIn(packet); }
@@ -270,6 +278,9 @@ void RwControlLocal::processMessages()
     if (fmsg) {
         QImage i = fmsg->frame.image;
         delete fmsg;
+        in_mutex.lock();
+        ++previewStats.rendered;
+        in_mutex.unlock();
         emit previewFrame(i);
         if (!self) {
             qDeleteAll(list);
@@ -282,6 +293,9 @@ void RwControlLocal::processMessages()
     if (fmsg) {
         QImage i = fmsg->frame.image;
         delete fmsg;
+        in_mutex.lock();
+        ++outputStats.rendered;
+        in_mutex.unlock();
         emit outputFrame(i);
         if (!self) {
             qDeleteAll(list);
@@ -341,8 +355,10 @@ void RwControlLocal::postMessage(RwControlMessage *msg)
     if (msg->type == RwControlMessage::Frame) {
         auto fmsg     = static_cast<RwControlFrameMessage *>(msg);
         int  firstPos = -1;
-        if (queuedFrameInfo(in, fmsg->frame.type, &firstPos) >= QUEUE_FRAME_MAX)
-            in.removeAt(firstPos);
+        if (queuedFrameInfo(in, fmsg->frame.type, &firstPos) >= QUEUE_FRAME_MAX) {
+            delete in.takeAt(firstPos);
+            ++(fmsg->frame.type == RwControlFrame::Preview ? previewStats : outputStats).dropped;
+        }
     }
 
     in += msg;
@@ -181,6 +181,13 @@ public:
     QImage image;
 };
 
+// per-stream frame delivery counters
+class RwControlFrameStats {
+public:
+    int rendered = 0; // frames handed over to the video widget
+    int dropped  = 0; // frames superseded by a newer one before being shown
+};
+
 // internal
 class RwControlMessage {
 public:
@@ -301,6 +308,8 @@ public:
     void (*cb_recordData)(const QByteArray &packet, void *app)  = nullptr;
 
     void dumpPipeline(std::function<void(const QStringList &)> callback);
+
+    RwControlFrameStats frameStats(RwControlFrame::Type type);
 signals:
     // response to start, stop, updateCodecs, or it could be spontaneous
     void statusReady(const RwControlStatus &status);
@@ -324,6 +333,8 @@ private:
 
     QMutex                    in_mutex;
     QList<RwControlMessage *> in;
+    RwControlFrameStats       previewStats;
+    RwControlFrameStats       outputStats;
 
     static gboolean cb_doCreateRemote(gpointer data);
     static gboolean cb_doDestroyRemote(gpointer data);
@@ -0,0 +1,31 @@
+#ifndef HIGHLIGHTRULEACCESSINGHOST_H
+#define HIGHLIGHTRULEACCESSINGHOST_H
+
+#include <QtPlugin>
+#include <functional>
+
+class QObject;
+class QRegularExpression;
+class QString;
+
+/**
+ * Rules are matched by Psi against the body of every groupchat message, together
+ * with own nick and the highlight words, so plugins don't have to scan bodies themselves.
+ */
+class HighlightRuleAccessingHost {
+public:
+    using Handler = std::function<void(int account, const QString &roomJid, const QString &nick, const QString &body)>;
+
+    virtual ~HighlightRuleAccessingHost() { }
+
+    // replaces the plugin's rule with the same id. alert makes matching messages highlighted.
+    // handler is called for each matching live message of others until context is destroyed.
+    virtual void addHighlightRule(const QString &id, const QRegularExpression &pattern, bool alert,
+                                  QObject *context = nullptr, Handler handler = Handler())
+        = 0;
+    virtual void removeHighlightRule(const QString &id) = 0;
+};
+
+Q_DECLARE_INTERFACE(HighlightRuleAccessingHost, "org.psi-im.HighlightRuleAccessingHost/0.1");
+
+#endif // HIGHLIGHTRULEACCESSINGHOST_H
@@ -0,0 +1,17 @@
+#ifndef HIGHLIGHTRULEACCESSOR_H
+#define HIGHLIGHTRULEACCESSOR_H
+
+#include <QtPlugin>
+
+class HighlightRuleAccessingHost;
+
+class HighlightRuleAccessor {
+public:
+    virtual ~HighlightRuleAccessor() { }
+
+    virtual void setHighlightRuleAccessingHost(HighlightRuleAccessingHost *host) = 0;
+};
+
+Q_DECLARE_INTERFACE(HighlightRuleAccessor, "org.psi-im.HighlightRuleAccessor/0.1");
+
+#endif // HIGHLIGHTRULEACCESSOR_H
@@ -20,6 +20,8 @@ list(APPEND PLUGINS_INCLUDES
     ${CMAKE_CURRENT_LIST_DIR}/include/eventcreator.h
     ${CMAKE_CURRENT_LIST_DIR}/include/eventfilter.h
     ${CMAKE_CURRENT_LIST_DIR}/include/gctoolbariconaccessor.h
+    ${CMAKE_CURRENT_LIST_DIR}/include/highlightruleaccessinghost.h
+    ${CMAKE_CURRENT_LIST_DIR}/include/highlightruleaccessor.h
     ${CMAKE_CURRENT_LIST_DIR}/include/iconfactoryaccessinghost.h
     ${CMAKE_CURRENT_LIST_DIR}/include/iconfactoryaccessor.h
     ${CMAKE_CURRENT_LIST_DIR}/include/iqfilter.h
@@ -42,6 +42,8 @@ HEADERS += \
     $$psi_plugins_include_dir/soundaccessinghost.h \
     $$psi_plugins_include_dir/chattabaccessor.h \
     $$psi_plugins_include_dir/webkitaccessor.h \
-    $$psi_plugins_include_dir/webkitaccessinghost.h
+    $$psi_plugins_include_dir/webkitaccessinghost.h \
+    $$psi_plugins_include_dir/highlightruleaccessor.h \
+    $$psi_plugins_include_dir/highlightruleaccessinghost.h
 
 OTHER_FILES += $$PWD/psiplugin.pri
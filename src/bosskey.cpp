@@ -38,6 +38,7 @@ void BossKey::shortCutActivated()
         doHide();
         isHidden_ = true;
     }
+    emit hiddenChanged(isHidden_);
 }
 
 void BossKey::doHide()
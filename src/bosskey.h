@@ -29,6 +29,11 @@ public:
     BossKey(QObject *p = nullptr);
     ~BossKey() {};
 
+    bool isHidden() const { return isHidden_; }
+
+signals:
+    void hiddenChanged(bool hidden);
+
 public slots:
     void shortCutActivated();
 
@@ -144,6 +144,7 @@ void ChatDlg::init()
     chatView()->setLocalNickname(account()->nick());
 #ifdef WEBKIT
     chatView()->setAccount(account());
+    connect(chatView(), &ChatView::hibernationChanged, this, &ChatDlg::invalidateTab);
 #else
     chatView()->setMediaOpener(account()->fileSharingDeviceOpener());
 #endif
@@ -302,10 +303,7 @@ void ChatDlg::hideEvent(QHideEvent *e)
     TabbableWidget::hideEvent(e);
 }
 
-void ChatDlg::showEvent(QShowEvent *)
-{
-    //
-}
+void ChatDlg::showEvent(QShowEvent *e) { TabbableWidget::showEvent(e); }
 
 void ChatDlg::logSelectionChanged()
 {
@@ -330,6 +328,22 @@ void ChatDlg::deactivated()
     setChatState(XMPP::StateInactive);
 }
 
+bool ChatDlg::hibernate()
+{
+#ifdef WEBKIT
+    return chatView()->hibernate();
+#else
+    return false;
+#endif
+}
+
+void ChatDlg::wakeUp()
+{
+#ifdef WEBKIT
+    chatView()->wakeUp();
+#endif
+}
+
 void ChatDlg::activated()
 {
     TabbableWidget::activated();
@@ -628,6 +642,15 @@ QString ChatDlg::desiredCaption() const
     return cap;
 }
 
+QString ChatDlg::tabToolTip() const
+{
+#ifdef WEBKIT
+    return chatView()->hibernationReport();
+#else
+    return QString();
+#endif
+}
+
 void ChatDlg::invalidateTab() { TabbableWidget::invalidateTab(); }
 
 void ChatDlg::updateRealJid() { realJid_ = account()->realJid(jid()); }
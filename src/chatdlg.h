@@ -75,6 +75,7 @@ public:
     TabbableWidget::State state() const override;
     int                   unreadMessageCount() const override;
     QString               desiredCaption() const override;
+    QString               tabToolTip() const override;
     void                  ensureTabbedCorrectly() override;
 
 public:
@@ -118,6 +119,8 @@ public slots:
     // reimplemented
     virtual void deactivated() override;
     virtual void activated() override;
+    virtual bool hibernate() override;
+    virtual void wakeUp() override;
 
     virtual void optionsUpdate();
     void         updateContact(const XMPP::Jid &, bool);
@@ -43,6 +43,7 @@
 
 #include <QAction>
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QJsonDocument>
@@ -52,6 +53,7 @@
 #include <QMetaProperty>
 #include <QNetworkReply>
 #include <QPalette>
+#include <QTimer>
 #include <QWidget>
 #ifdef WEBENGINE
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -59,6 +61,7 @@
 #elif QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
 #include <QWebEngineContextMenuData>
 #endif
+#include <QWebChannel>
 #include <QWebEngineSettings>
 #else
 #include <QNetworkRequest>
@@ -94,6 +97,15 @@ public:
     ChatViewThemeProvider    *themeProvider = nullptr;
     QString                   localNickName;
 
+    // a bounded model of what the page shows, to rebuild it after hibernation
+    QList<QVariantMap> journal_;
+    QVariantMap        jsHooks_;          // plugin hooks, survive clear()
+    int                journalLimit_ = 0; // 0 if the view never hibernates
+    bool               hibernated_   = false;
+
+    QElapsedTimer loadTimer_; // until the theme is ready to show messages
+    const char   *loadKind_ = "";
+
     static QString closeIconTags(const QString &richText)
     {
         static QRegularExpression mIcon("(<icon [^>]+>)");
@@ -142,10 +154,43 @@ public:
 
     void sendJsObject(const QVariantMap &map)
     {
+        if (journalLimit_) {
+            record(map);
+        }
+        if (hibernated_) {
+            return; // replayed from the journal on wake up
+        }
         jsBuffer_.append(map);
         checkJsBuffer();
     }
 
+    void record(const QVariantMap &map)
+    {
+        auto type = map.value(QLatin1String("type")).toString();
+        if (type == QLatin1String("receivehooks")) {
+            jsHooks_ = map;
+        } else if (type == QLatin1String("clear")) {
+            journal_.clear();
+        } else {
+            journal_.append(map);
+            if (journal_.size() > journalLimit_) {
+                journal_.removeFirst();
+            }
+        }
+    }
+
+    // rough size of the journal in bytes
+    qint64 journalSize() const
+    {
+        qint64 size = 0;
+        for (auto const &map : journal_) {
+            for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+                size += it.key().size() + it.value().toString().size();
+            }
+        }
+        return size * qint64(sizeof(QChar));
+    }
+
     void checkJsBuffer();
 
     void sendReactionsToUI(const QString &nick, const QString &messageId, const QSet<QString> &reactions)
@@ -498,16 +543,106 @@ protected:
 
 #endif
 
+//----------------------------------------------------------------------------
+// WebViewPool
+// web views with their pages created in idle time, so a new chat or
+// groupchat doesn't wait for that
+//----------------------------------------------------------------------------
+class WebViewPool : public QObject {
+    static const int RefillDelay = 1000; // ms
+
+    QList<WebView *> views_;
+    QTimer           refillTimer_;
+    bool             quitting_ = false;
+
+public:
+    static WebViewPool *instance()
+    {
+        static QPointer<WebViewPool> pool;
+        if (!pool) {
+            pool = new WebViewPool(qApp);
+        }
+        return pool;
+    }
+
+    ~WebViewPool() { qDeleteAll(views_); }
+
+    void startRefill()
+    {
+        if (!refillTimer_.isActive()) {
+            refillTimer_.start();
+        }
+    }
+
+    // a preloaded view if there is one, a new view otherwise
+    WebView *take(QWidget *parent, bool *preloaded)
+    {
+        WebView *view = views_.isEmpty() ? nullptr : views_.takeFirst();
+        *preloaded    = view != nullptr;
+        if (view) {
+            view->setParent(parent);
+        } else {
+            view = create(parent);
+        }
+        startRefill();
+        return view;
+    }
+
+private:
+    WebViewPool(QObject *parent) : QObject(parent)
+    {
+        refillTimer_.setSingleShot(true);
+        refillTimer_.setInterval(RefillDelay);
+        connect(&refillTimer_, &QTimer::timeout, this, &WebViewPool::refill);
+        // web engine wants its pages gone before the application
+        connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
+            quitting_ = true;
+            qDeleteAll(views_);
+            views_.clear();
+        });
+    }
+
+    static WebView *create(QWidget *parent)
+    {
+        auto view = new WebView(parent);
+        view->setFocusPolicy(Qt::NoFocus);
+        view->setPage(new ChatViewPage(view));
+        view->connectPageActions();
+        return view;
+    }
+
+    // one view per timeout, not to stall the ui
+    void refill()
+    {
+        int size = PsiOptions::instance()->getOption("options.ui.chat.preloaded-views").toInt();
+        while (views_.size() > qMax(0, size)) {
+            delete views_.takeLast();
+        }
+        if (views_.size() < size && !quitting_) {
+            auto view = create(nullptr);
+#ifdef WEBENGINE
+            view->page()->load(QUrl(QLatin1String("about:blank"))); // gets the web contents running
+#endif
+            views_.append(view);
+            refillTimer_.start();
+        }
+    }
+};
+
 //----------------------------------------------------------------------------
 // ChatView
 //----------------------------------------------------------------------------
 ChatView::ChatView(QWidget *parent) : QFrame(parent), d(new ChatViewPrivate(this))
 {
-    d->jsObject = new ChatViewJSObject(this); /* It's a session bridge between html and c++ part */
-    d->webView  = new WebView(this);
-    d->webView->setFocusPolicy(Qt::NoFocus);
-    d->webView->setPage(new ChatViewPage(d->webView));
-    d->webView->connectPageActions();
+    bool preloaded;
+    d->loadTimer_.start();
+    d->jsObject  = new ChatViewJSObject(this); /* It's a session bridge between html and c++ part */
+    d->webView   = WebViewPool::instance()->take(this, &preloaded);
+    d->loadKind_ = preloaded ? "preloaded view" : "new view";
+    auto o = PsiOptions::instance();
+    if (o->getOption("options.ui.tabs.hibernation.inactive-time").toInt() > 0) {
+        d->journalLimit_ = qMax(1, o->getOption("options.ui.tabs.hibernation.restore-size").toInt());
+    }
 
     d->quoteAction = new QAction(tr("Quote"), this);
     d->quoteAction->setShortcut(QKeySequence(tr("Ctrl+S")));
@@ -568,6 +703,9 @@ void ChatView::init()
         return;
     }
     d->theme = curTheme;
+    if (d->hibernated_) {
+        return; // wakeUp() will load it
+    }
 
 #ifndef WEBENGINE
     ((ChatViewPage *)d->webView->page())->setCVPrivate(d.data());
@@ -667,7 +805,13 @@ void ChatView::sessionInited()
 {
     qDebug("Session is initialized");
     d->sessionReady_ = true;
+    int queued       = d->jsBuffer_.size();
     d->checkJsBuffer();
+    if (d->loadTimer_.isValid()) {
+        qDebug("ChatView %s is ready in %lld ms (%s), %d updates queued", qPrintable(d->jid_.full()),
+               d->loadTimer_.elapsed(), d->loadKind_, queued);
+        d->loadTimer_.invalidate();
+    }
 }
 
 bool ChatView::handleCopyEvent(QObject *object, QEvent *event, ChatEdit *chatEdit)
@@ -865,6 +1009,79 @@ QWidget *ChatView::realTextWidget() { return d->webView; }
 
 QObject *ChatView::jsBridge() { return d->jsObject; }
 
+/**
+ * Releases the web page of a view nobody looks at. Whatever is dispatched to the view
+ * meanwhile goes to the journal only, and wakeUp() rebuilds the page from it.
+ * Returns false if the view can't be rebuilt and so is kept as is.
+ */
+bool ChatView::hibernate()
+{
+    if (d->hibernated_ || !d->journalLimit_ || !d->theme.isValid()) {
+        return false;
+    }
+
+    QPointer<QObject> oldPage = d->webView->page();
+#ifdef WEBENGINE
+    if (auto channel = d->webView->page()->webChannel()) {
+        if (auto util = channel->registeredObjects().value(QLatin1String("srvUtil"))) {
+            util->deleteLater();
+        }
+        channel->deleteLater();
+    }
+#endif
+    d->hibernated_   = true;
+    d->sessionReady_ = false;
+    d->jsBuffer_.clear();
+    d->webView->setPage(new ChatViewPage(d->webView)); // blank until wakeUp()
+    d->webView->connectPageActions();
+    if (oldPage) {
+        oldPage->deleteLater();
+    }
+#ifndef HAVE_X11
+    psiOptionChanged("options.ui.automatically-copy-selected-text");
+#endif
+    emit hibernationChanged();
+    return true;
+}
+
+void ChatView::wakeUp()
+{
+    if (!d->hibernated_) {
+        return;
+    }
+    d->hibernated_ = false;
+    d->jsBuffer_   = d->journal_;
+    if (!d->jsHooks_.isEmpty()) {
+        d->jsBuffer_.prepend(d->jsHooks_);
+    }
+    d->loadKind_ = "restored view";
+    d->loadTimer_.start();
+    init();
+    emit hibernationChanged();
+}
+
+bool ChatView::isHibernated() const { return d->hibernated_; }
+
+/**
+ * Starts filling the pool of preloaded views, so the first chats and the
+ * autojoined groupchats don't wait for a new web view.
+ */
+void ChatView::preloadViews() { WebViewPool::instance()->startRefill(); }
+
+/**
+ * Describes for the tab's tooltip the memory an unloaded view kept to be restored.
+ * Empty if the view is loaded.
+ */
+QString ChatView::hibernationReport() const
+{
+    if (!d->hibernated_) {
+        return QString();
+    }
+    return tr("Unloaded to save memory, %1 updates (~%2 KiB) kept to restore it")
+        .arg(d->journal_.size())
+        .arg(d->journalSize() / 1024);
+}
+
 void ChatView::outgoingReaction(const QString &messageId, const QString &reaction)
 {
     auto n         = d->isMuc_ ? d->localNickName : QString::fromLatin1("l");
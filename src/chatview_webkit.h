@@ -67,6 +67,13 @@ public:
     QWidget *realTextWidget();
     QObject *jsBridge();
 
+    bool    hibernate();
+    void    wakeUp();
+    bool    isHibernated() const;
+    QString hibernationReport() const;
+
+    static void preloadViews();
+
 public slots:
     void scrollUp();
     void scrollDown();
@@ -103,6 +110,7 @@ signals:
     void forwardMessageRequested(const QString &messageId, const QString &nick, const QString &text);
     void openInfoRequested(const QString &nickname);
     void openChatRequested(const QString &nickname);
+    void hibernationChanged();
 
 private:
     friend class ChatViewPrivate;
@@ -109,6 +109,9 @@ bool ChatViewThemePrivate::load(const QString &style, std::function<void(bool)>
     qDebug("Starting loading \"%s\" theme at \"%s\" for %s", qPrintable(id), qPrintable(filepath),
            isMuc() ? "muc" : "chat");
     state = Theme::State::Loading;
+#ifdef WEBENGINE
+    ChatViewCon::instance()->invalidateThemeFiles(); // it may have been edited or reinstalled since
+#endif
     if (jsUtil.isNull()) {
         jsLoader.reset(new ChatViewJSLoader(this));
         jsUtil.reset(new ChatViewThemeJSUtil(this));
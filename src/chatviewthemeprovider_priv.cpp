@@ -22,6 +22,7 @@
 #include "avatars.h"
 #include "psicon.h"
 #include "psiiconset.h"
+#include "psioptions.h"
 #include "psithemeprovider.h"
 #include "xmpp_vcard.h"
 #ifdef WEBENGINE
@@ -31,6 +32,7 @@
 #endif
 
 #include <QBuffer>
+#include <QFileSystemWatcher>
 #include <QPointer>
 #include <QUrlQuery>
 #ifdef WEBENGINE
@@ -69,70 +71,69 @@ void ChatViewUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo &i
 ChatViewCon::ChatViewCon(PsiCon *pc) : QObject(pc), pc(pc)
 {
 #ifdef WEBENGINE
+    // served theme files are cached by the web server until they change on disk
+    themeFilesWatcher = new QFileSystemWatcher(this);
+    connect(themeFilesWatcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &fileName) {
+        themeFilesWatcher->removePath(fileName);
+        this->pc->webServer()->invalidateResources(themeFileUrls.take(fileName));
+    });
+
     // handler reading data from themes directory
-    WebServer::Handler themesDirHandler
-        = [&](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
-        QString fn = req->url().path().mid(sizeof("/psi/themes"));
+    WebServer::ResourceHandler themesDirHandler = [this](const QString &path, WebServer::Resource &resource) -> bool {
+        QString fn = path.mid(sizeof("/psi/themes"));
         fn.replace("..", ""); // a little security
         fn = PsiThemeProvider::themePath(fn);
 
         if (!fn.isEmpty()) {
             QFile f(fn);
             if (f.open(QIODevice::ReadOnly)) {
-                res->setStatusCode(qhttp::ESTATUS_OK);
                 if (fn.endsWith(QLatin1String(".js"))) {
-                    res->headers().insert("Content-Type", "application/javascript;charset=utf-8");
+                    resource.contentType = "application/javascript;charset=utf-8";
                 }
                 if (fn.endsWith(QLatin1String(".css"))) {
-                    res->headers().insert("Content-Type", "text/css;charset=utf-8");
+                    resource.contentType = "text/css;charset=utf-8";
                 }
-                res->end(f.readAll());
+                resource.data = f.readAll();
                 f.close();
+                watchThemeFile(fn, path);
                 return true;
             }
         }
         return false;
     };
 
-    WebServer::Handler iconsHandler = [&](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
-        QString name = req->url().path().mid(sizeof("/psi/icon"));
+    WebServer::ResourceHandler iconsHandler = [](const QString &path, WebServer::Resource &resource) -> bool {
+        QString name = path.mid(sizeof("/psi/icon"));
         auto    icon = IconsetFactory::iconPtr(name);
 
         if (icon) {
-            auto ba = icon->raw();
-            res->addHeader("Content-Type", icon->mimeType().toLatin1());
-            res->addHeader("Content-Length", QByteArray::number(ba.size()));
-            if (ba.size() > 1 && std::uint8_t(ba.at(0)) == 0x1f && std::uint8_t(ba.at(1)) == 0x8b) {
-                res->addHeader("Content-Encoding", "gzip");
+            resource.data        = icon->raw();
+            resource.contentType = icon->mimeType().toLatin1();
+            if (resource.data.size() > 1 && std::uint8_t(resource.data.at(0)) == 0x1f
+                && std::uint8_t(resource.data.at(1)) == 0x8b) {
+                resource.contentEncoding = "gzip";
             }
-            res->setStatusCode(qhttp::ESTATUS_OK);
-            res->end(ba);
             return true;
         }
         return false;
     };
 
-    WebServer::Handler avatarsHandler
-        = [&](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
-        QString    hash = req->url().path().mid(sizeof("/psi/avatar")); // no / because of null pointer
-        QByteArray ba;
+    WebServer::ResourceHandler avatarsHandler = [](const QString &path, WebServer::Resource &resource) -> bool {
+        QString hash = path.mid(sizeof("/psi/avatar")); // no / because of null pointer
         if (hash == QLatin1String("default.png")) {
             QPixmap p;
-            QBuffer buffer(&ba);
+            QBuffer buffer(&resource.data);
             buffer.open(QIODevice::WriteOnly);
             p = IconsetFactory::icon("psi/default_avatar").pixmap();
             if (p.save(&buffer, "PNG")) {
-                res->setStatusCode(qhttp::ESTATUS_OK);
-                res->headers().insert("Content-Type", "image/png");
-                res->end(ba);
+                resource.contentType = "image/png";
                 return true;
             }
         } else {
             AvatarFactory::AvatarData ad = AvatarFactory::avatarDataByHash(QByteArray::fromHex(hash.toLatin1()));
             if (!ad.data.isEmpty()) {
-                res->setStatusCode(qhttp::ESTATUS_OK);
-                res->headers().insert("Content-Type", ad.metaType.toLatin1());
-                res->end(ad.data);
+                resource.data        = ad.data;
+                resource.contentType = ad.metaType.toLatin1();
                 return true;
             }
         }
@@ -140,27 +141,18 @@ ChatViewCon::ChatViewCon(PsiCon *pc) : QObject(pc), pc(pc)
         return false;
     };
 
-    WebServer::Handler qwebchannelHandler
-        = [&](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
-        if (req->method() != qhttp::EHTTP_GET)
-            return false;
+    WebServer::ResourceHandler qwebchannelHandler = [](const QString &, WebServer::Resource &resource) -> bool {
         QFile qwcjs(":/qtwebchannel/qwebchannel.js");
         if (qwcjs.open(QIODevice::ReadOnly)) {
-            res->setStatusCode(qhttp::ESTATUS_OK);
-            res->headers().insert("Content-Type", "application/javascript;charset=utf-8");
-            res->end(qwcjs.readAll());
-        } else {
-            res->setStatusCode(qhttp::ESTATUS_NOT_FOUND);
+            resource.data        = qwcjs.readAll();
+            resource.contentType = "application/javascript;charset=utf-8";
+            return true;
         }
-        return true;
+        return false;
     };
 
-    WebServer::Handler faviconHandler
-        = [&](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
-        if (req->method() != qhttp::EHTTP_GET)
-            return false;
-        res->setStatusCode(qhttp::ESTATUS_OK);
-        res->end(IconsetFactory::icon(QLatin1String("psi/logo_16")).raw());
+    WebServer::ResourceHandler faviconHandler = [](const QString &, WebServer::Resource &resource) -> bool {
+        resource.data = IconsetFactory::icon(QLatin1String("psi/logo_16")).raw();
         return true;
     };
 
@@ -217,11 +209,17 @@ ChatViewCon::ChatViewCon(PsiCon *pc) : QObject(pc), pc(pc)
 
     auto ws = pc->webServer();
     ws->setDefaultHandler(defaultHandler);
-    ws->route("/psi/themes/", themesDirHandler);
-    ws->route("/psi/icon/", iconsHandler);
-    ws->route("/psi/avatar/", avatarsHandler);
-    ws->route("/psi/static/qwebchannel.js", qwebchannelHandler);
-    ws->route("/favicon.ico", faviconHandler);
+    ws->routeResource("/psi/themes/", themesDirHandler);
+    ws->routeResource("/psi/icon/", iconsHandler);
+    ws->routeResource("/psi/avatar/", avatarsHandler);
+    ws->routeResource("/psi/static/qwebchannel.js", qwebchannelHandler);
+    ws->routeResource("/favicon.ico", faviconHandler);
+    // icons with the same name come from another iconset now
+    PsiOptions::instance()->watchOptions({ QLatin1String("options.iconsets.") }, this, [ws](const QSet<QString> &) {
+        ws->invalidateResources(QLatin1String("/psi/icon/"));
+        ws->invalidateResources(QLatin1String("/psi/avatar/default.png"));
+        ws->invalidateResources(QLatin1String("/favicon.ico"));
+    });
 
     requestInterceptor = new ChatViewUrlRequestInterceptor(this);
 #if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
@@ -353,4 +351,21 @@ QString ChatViewCon::registerSessionHandler(const WebServer::Handler &handler)
 void ChatViewCon::unregisterSessionHandler(const QString &path) { sessionHandlers.remove(path); }
 
 QUrl ChatViewCon::serverUrl() const { return pc->webServer()->serverUrl(); }
+
+void ChatViewCon::watchThemeFile(const QString &fileName, const QString &urlPath)
+{
+    if (themeFileUrls.contains(fileName) || themeFilesWatcher->addPath(fileName))
+        themeFileUrls.insert(fileName, urlPath);
+}
+
+/**
+ * Makes the web server read theme files again, e.g. when a theme is (re)loaded.
+ */
+void ChatViewCon::invalidateThemeFiles()
+{
+    if (!themeFileUrls.isEmpty())
+        themeFilesWatcher->removePaths(themeFileUrls.keys());
+    themeFileUrls.clear();
+    pc->webServer()->invalidateResources(QLatin1String("/psi/themes/"));
+}
 #endif
@@ -29,6 +29,7 @@
 #endif
 
 class PsiCon;
+class QFileSystemWatcher;
 class ThemeServer;
 
 #ifdef WEBENGINE
@@ -48,6 +49,10 @@ class ChatViewCon : public QObject {
 #ifdef WEBENGINE
     QMap<QString, WebServer::Handler> sessionHandlers;
     int                               handlerSeed = 0;
+    QFileSystemWatcher               *themeFilesWatcher;
+    QMap<QString, QString>            themeFileUrls; // served theme file -> its path on the web server
+
+    void watchThemeFile(const QString &fileName, const QString &urlPath);
 #endif
     ChatViewCon(PsiCon *pc);
 
@@ -59,6 +64,7 @@ public:
     QString registerSessionHandler(const WebServer::Handler &handler);
     void    unregisterSessionHandler(const QString &path);
     QUrl    serverUrl() const;
+    void    invalidateThemeFiles();
 #endif
     static ChatViewCon *instance();
     static void         init(PsiCon *pc);
@@ -27,9 +27,20 @@
 #include "psicontact.h"
 #include "userlist.h"
 
+#include <QCollator>
 #include <QCoreApplication>
 #include <QTextDocument>
 
+static const QCollator &nameCollator()
+{
+    static const QCollator collator = []() {
+        QCollator c;
+        c.setCaseSensitivity(Qt::CaseInsensitive);
+        return c;
+    }();
+    return collator;
+}
+
 ContactListItem::ContactListItem(ContactListModel *model, Type type, SpecialGroupType specialGropType) :
     AbstractTreeItem(), _model(model), _type(type), _specialGroupType(specialGropType), _editing(false),
     _selfValid(true), _contact(nullptr), _account(nullptr), _expanded(true), _internalName(), _displayName(),
@@ -164,15 +175,17 @@ bool ContactListItem::lessThan(const ContactListItem *other) const
         if (_specialGroupType != other->_specialGroupType) {
             return _specialGroupType < other->_specialGroupType;
         } else {
-            return QString::localeAwareCompare(_displayName.toLower(), other->_displayName.toLower()) < 0;
+            return compareNames(other) < 0;
         }
     } else if (_type == Type::ContactType && other->_type == Type::ContactType) {
-        int rank = rankStatus(_contact->status().type()) - rankStatus(other->_contact->status().type());
+        sortKey(); // caches the status ranks as well
+        other->sortKey();
+        int rank = _statusRank - other->_statusRank;
         if (rank == 0)
-            rank = QString::localeAwareCompare(_contact->name().toLower(), other->_contact->name().toLower());
+            rank = compareNames(other);
         return rank < 0;
     } else if (_type == Type::AccountType && other->_type == Type::AccountType) {
-        return QString::localeAwareCompare(_account->name().toLower(), other->_account->name().toLower()) < 0;
+        return compareNames(other) < 0;
     } else if (_type == Type::ContactType && other->_type == Type::GroupType) {
         return _contact->isSelf();
     } else if (_type == Type::GroupType && other->_type == Type::ContactType) {
@@ -182,6 +195,37 @@ bool ContactListItem::lessThan(const ContactListItem *other) const
     return false;
 }
 
+/**
+ * Compares names case-insensitively with the collation of the current locale.
+ * Uses cached sort keys, so it doesn't allocate.
+ */
+int ContactListItem::compareNames(const ContactListItem *other) const { return sortKey().compare(other->sortKey()); }
+
+const QCollatorSortKey &ContactListItem::sortKey() const
+{
+    if (!_sortKey) {
+        _sortName   = name();
+        _statusRank = _type == Type::ContactType && _contact ? rankStatus(_contact->status().type()) : 0;
+        _sortKey.emplace(nameCollator().sortKey(_sortName));
+    }
+    return *_sortKey;
+}
+
+/**
+ * Drops the cached sort key if the name or the status changed since it was made.
+ * Returns \c true when the item may have to move.
+ */
+bool ContactListItem::refreshSortKey()
+{
+    if (!_sortKey)
+        return true;
+    int rank = _type == Type::ContactType && _contact ? rankStatus(_contact->status().type()) : 0;
+    if (rank == _statusRank && name() == _sortName)
+        return false;
+    _sortKey.reset();
+    return true;
+}
+
 QString ContactListItem::name() const
 {
     QString name;
@@ -219,6 +263,7 @@ void ContactListItem::setName(const QString &name)
     default:
         break;
     }
+    refreshSortKey();
 }
 
 QString ContactListItem::internalName() const
@@ -243,11 +288,19 @@ bool ContactListItem::editing() const { return _editing; }
 
 void ContactListItem::setEditing(bool editing) { _editing = editing; }
 
-void ContactListItem::setContact(PsiContact *contact) { _contact = contact; }
+void ContactListItem::setContact(PsiContact *contact)
+{
+    _contact = contact;
+    _sortKey.reset();
+}
 
 PsiContact *ContactListItem::contact() const { return _contact; }
 
-void ContactListItem::setAccount(PsiAccount *account) { _account = account; }
+void ContactListItem::setAccount(PsiAccount *account)
+{
+    _account = account;
+    _sortKey.reset();
+}
 
 PsiAccount *ContactListItem::account() const
 {
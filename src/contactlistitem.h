@@ -21,10 +21,12 @@
 
 #include "abstracttreeitem.h"
 
+#include <QCollatorSortKey>
 #include <QObject>
 #include <QPointer>
 #include <QString>
 #include <QVariant>
+#include <optional>
 
 class ContactListItem;
 class ContactListItemMenu;
@@ -78,6 +80,8 @@ public:
     bool isFixedSize() const;
 
     bool lessThan(const ContactListItem *other) const;
+    int  compareNames(const ContactListItem *other) const;
+    bool refreshSortKey();
 
     bool editing() const;
     void setEditing(bool editing);
@@ -130,6 +134,12 @@ private:
     mutable int          _onlineContacts;
     mutable bool         _shouldBeVisible;
     bool                 _hidden;
+
+    // cached by sortKey(), dropped by refreshSortKey()
+    const QCollatorSortKey                 &sortKey() const;
+    mutable std::optional<QCollatorSortKey> _sortKey;
+    mutable QString                         _sortName;
+    mutable int                             _statusRank = 0;
 };
 
 Q_DECLARE_METATYPE(ContactListItem *)
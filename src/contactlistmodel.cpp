@@ -28,6 +28,7 @@
 
 #include <QColor>
 #include <QIcon>
+#include <QMap>
 #include <QMessageBox>
 #include <QModelIndex>
 #include <QTextDocument>
@@ -147,39 +148,52 @@ void ContactListModel::Private::updateContacts(const QList<PsiContact *> &contac
     if (contacts.isEmpty())
         return;
 
-    // prepare ranges for updating to reduce 'emit dataChanged' invoking
-    QHash<QModelIndex, QPair<int, int>> ranges;
-    QModelIndexList                     indexes;
+    // collect changed rows per parent. rows whose sort key didn't change are reported
+    // with explicit roles, so the proxy model re-filters them but doesn't re-sort
+    QHash<QModelIndex, QMap<int, bool>> rows; // parent -> row -> may move
     for (const PsiContact *contact : contacts) {
-        QModelIndexList indexes2 = q->indexesFor(contact);
-        indexes += indexes2;
-
-        for (const QModelIndex &index : std::as_const(indexes2)) {
-            QModelIndex parent = index.parent();
-            int         row    = index.row();
-            if (ranges.contains(parent)) {
-                if (index.row() < ranges.value(parent).first)
-                    ranges[parent].first = row;
-                else if (index.row() > ranges.value(parent).second)
-                    ranges[parent].second = row;
-            } else {
-                ranges.insert(parent, QPair<int, int>(row, row));
-            }
+        const QModelIndexList indexes = q->indexesFor(contact);
+        for (const QModelIndex &index : indexes) {
+            rows[index.parent()].insert(index.row(), q->toItem(index)->refreshSortKey());
         }
     }
 
-    QHashIterator<QModelIndex, QPair<int, int>> it(ranges);
-    while (it.hasNext()) {
-        it.next();
-        int         row1  = it.value().first;
-        int         row2  = it.value().second;
-        QModelIndex index = it.key();
-
-        // update contact
-        emit q->dataChanged(q->index(row1, 0, index), q->index(row2, 0, index));
+    static const QVector<int> contentRoles = []() {
+        QVector<int> roles { Qt::DisplayRole, Qt::DecorationRole, Qt::ToolTipRole };
+        for (int role = JidRole; role <= UsingSSLRole; ++role)
+            roles << role;
+        return roles;
+    }();
+
+    for (auto it = rows.constBegin(); it != rows.constEnd(); ++it) {
+        const QModelIndex &parent  = it.key();
+        const auto        &changed = it.value();
+
+        // update contacts, emitting one signal per run of adjacent rows of the same kind
+        int  first = -1, last = -1;
+        bool moved = false;
+        auto flush = [&]() {
+            if (first < 0)
+                return;
+            if (moved)
+                emit q->dataChanged(q->index(first, 0, parent), q->index(last, 0, parent));
+            else
+                emit q->dataChanged(q->index(first, 0, parent), q->index(last, 0, parent), contentRoles);
+        };
+        for (auto row = changed.constBegin(); row != changed.constEnd(); ++row) {
+            if (first >= 0 && row.key() == last + 1 && row.value() == moved) {
+                last = row.key();
+                continue;
+            }
+            flush();
+            first = last = row.key();
+            moved        = row.value();
+        }
+        flush();
 
         // Update group
-        emit q->dataChanged(index, index);
+        if (parent.isValid())
+            emit q->dataChanged(parent, parent, contentRoles);
     }
 }
 
@@ -692,6 +706,7 @@ void ContactListModel::updateItem(ContactListItem *item, bool notifyModel)
 {
     Q_ASSERT(item);
 
+    item->refreshSortKey();
     QModelIndex index = toModelIndex(item);
     if (notifyModel)
         emit dataChanged(index, index);
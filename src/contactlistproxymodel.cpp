@@ -29,6 +29,9 @@
 
 ContactListProxyModel::ContactListProxyModel(QObject *parent) : QSortFilterProxyModel(parent)
 {
+    // lessThan() works on items. the role is never reported changed alone, so the model
+    // signals a possible change of position by emitting dataChanged() without roles
+    setSortRole(ContactListModel::ContactListItemRole);
     sort(0, Qt::AscendingOrder);
 
     // False by default on Qt4
@@ -44,6 +47,7 @@ void ContactListProxyModel::setSourceModel(QAbstractItemModel *model)
     connect(model, SIGNAL(showTransportsChanged()), SLOT(filterParametersChanged()));
     connect(model, SIGNAL(showHiddenChanged()), SLOT(filterParametersChanged()));
     connect(model, SIGNAL(contactSortStyleChanged()), SLOT(updateSorting()));
+    updateSorting();
 }
 
 bool ContactListProxyModel::showOffline() const
@@ -147,16 +151,15 @@ bool ContactListProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &s
 
 bool ContactListProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
 {
-    ContactListItem *item1 = qvariant_cast<ContactListItem *>(left.data(ContactListModel::ContactListItemRole));
-    ContactListItem *item2 = qvariant_cast<ContactListItem *>(right.data(ContactListModel::ContactListItemRole));
+    ContactListItem *item1 = static_cast<ContactListItem *>(left.internalPointer());
+    ContactListItem *item2 = static_cast<ContactListItem *>(right.internalPointer());
     if (!item1 || !item2)
         return false;
 
-    ContactListModel *model = qobject_cast<ContactListModel *>(sourceModel());
-    if (model->contactSortStyle() == "status" || !item1->isContact() || !item2->isContact()) {
+    if (sortByStatus_ || !item1->isContact() || !item2->isContact()) {
         return item1->lessThan(item2);
     } else {
-        return item1->name().toLower() < item2->name().toLower();
+        return item1->compareNames(item2) < 0;
     }
 }
 
@@ -166,4 +169,9 @@ void ContactListProxyModel::filterParametersChanged()
     emit recalculateSize();
 }
 
-void ContactListProxyModel::updateSorting() { invalidate(); }
+void ContactListProxyModel::updateSorting()
+{
+    ContactListModel *model = qobject_cast<ContactListModel *>(sourceModel());
+    sortByStatus_           = model && model->contactSortStyle() == "status";
+    invalidate();
+}
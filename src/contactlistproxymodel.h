@@ -48,6 +48,9 @@ protected:
 
 private slots:
     void filterParametersChanged();
+
+private:
+    bool sortByStatus_ = false;
 };
 
 #endif // CONTACTLISTPROXYMODEL_H
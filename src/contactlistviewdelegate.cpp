@@ -31,15 +31,18 @@
 #include "psioptions.h"
 
 #include <QApplication>
+#include <QDataStream>
 #include <QKeyEvent>
 #include <QLineEdit>
 #include <QMutableSetIterator>
 #include <QPainter>
 #include <QSetIterator>
 #include <QSortFilterProxyModel>
+#include <memory>
 
 #define ALERT_INTERVAL 100 /* msecs */
 #define ANIM_INTERVAL 300  /* msecs */
+#define ROW_CACHE_SIZE (24 * 1024 * 1024) /* bytes of rendered contact rows */
 
 #define PSI_HIDPI computeScaleFactor(contactList)
 // #define PSI_HIDPI (2) // for testing purposes
@@ -127,15 +130,27 @@ ContactListViewDelegate::Private::Private(ContactListViewDelegate *parent, Conta
     animTimer->setSingleShot(false);
     connect(animTimer, SIGNAL(timeout()), SLOT(updateAnim()));
 
-    connect(PsiOptions::instance(), SIGNAL(optionChanged(const QString &)), SLOT(optionChanged(const QString &)));
+    rowCache_.setMaxCost(ROW_CACHE_SIZE);
+
+    PsiOptions::instance()->watchOptions(
+        { contactListFontOptionPath, contactListBackgroundOptionPath, showStatusMessagesOptionPath,
+          showClientIconsPath, showMoodIconsPath, showActivityIconsPath, showTuneIconsPath, showGeolocIconsPath,
+          showAvatarsPath, useDefaultAvatarPath, avatarAtLeftOptionPath, avatarSizeOptionPath, avatarRadiusOptionPath,
+          showStatusIconsPath, statusIconsOverAvatarsPath, allClientsOptionPath, enableGroupsOptionPath,
+          slimGroupsOptionPath, outlinedGroupsOptionPath, statusSingleOptionPath },
+        this, [this](const QSet<QString> &options) { optionsChanged(options); });
     connect(ColorOpt::instance(), SIGNAL(changed(const QString &)), SLOT(colorOptionChanged(const QString &)));
     connect(PsiIconset::instance(), SIGNAL(rosterIconsSizeChanged(int)), SLOT(rosterIconsSizeChanged(int)));
+    PsiOptions::instance()->watchOptions({ QStringLiteral("options.iconsets.") }, this, [this](const QSet<QString> &) {
+        invalidateRowCache();
+        this->contactList->viewport()->update();
+    });
 
     statusIconSize_ = PsiIconset::instance()
                           ->roster.value(PsiOptions::instance()->getOption(statusIconsetOptionPath).toString())
                           .iconSize();
 
-    optionChanged("*");
+    optionsChanged({ QStringLiteral("*") });
     colorOptionChanged("*");
 
     recomputeGeometry();
@@ -144,117 +159,96 @@ ContactListViewDelegate::Private::Private(ContactListViewDelegate *parent, Conta
 
 ContactListViewDelegate::Private::~Private() { }
 
-void ContactListViewDelegate::Private::optionChanged(const QString &option)
+void ContactListViewDelegate::Private::optionsChanged(const QSet<QString> &options)
 {
-    bool bulkUpdate     = (option == "*");
+    bool bulkUpdate     = options.contains(QStringLiteral("*"));
     bool updateGeometry = false;
     bool updateViewport = false;
-    bool updated        = false;
 
-    if (bulkUpdate || (!updated && option == contactListFontOptionPath)) {
+    if (bulkUpdate || options.contains(contactListFontOptionPath)) {
         font_.fromString(PsiOptions::instance()->getOption(contactListFontOptionPath).toString());
         fontMetrics_ = QFontMetrics(font_);
         statusFont_.setPointSize(qMax(font_.pointSize() - 2, 7));
         statusFontMetrics_ = QFontMetrics(statusFont_);
-        updated            = true;
         updateGeometry     = true;
     }
-    if (bulkUpdate || (!updated && option == contactListBackgroundOptionPath)) {
+    if (bulkUpdate || options.contains(contactListBackgroundOptionPath)) {
         QPalette p = contactList->palette();
         p.setColor(QPalette::Base, ColorOpt::instance()->color(contactListBackgroundOptionPath));
         contactList->setPalette(p);
-        updated        = true;
         updateViewport = true;
     }
-    if (bulkUpdate || (!updated && option == showStatusMessagesOptionPath)) {
+    if (bulkUpdate || options.contains(showStatusMessagesOptionPath)) {
         showStatusMessages_ = PsiOptions::instance()->getOption(showStatusMessagesOptionPath).toBool();
-        updated             = true;
         updateGeometry      = true;
     }
-    if (bulkUpdate || (!updated && option == showClientIconsPath)) {
+    if (bulkUpdate || options.contains(showClientIconsPath)) {
         showClientIcons_ = PsiOptions::instance()->getOption(showClientIconsPath).toBool();
-        updated          = true;
         updateGeometry   = true;
     }
-    if (bulkUpdate || (!updated && option == showMoodIconsPath)) {
+    if (bulkUpdate || options.contains(showMoodIconsPath)) {
         showMoodIcons_ = PsiOptions::instance()->getOption(showMoodIconsPath).toBool();
-        updated        = true;
         updateGeometry = true;
     }
-    if (bulkUpdate || (!updated && option == showActivityIconsPath)) {
+    if (bulkUpdate || options.contains(showActivityIconsPath)) {
         showActivityIcons_ = PsiOptions::instance()->getOption(showActivityIconsPath).toBool();
-        updated            = true;
         updateGeometry     = true;
     }
-    if (bulkUpdate || (!updated && option == showTuneIconsPath)) {
+    if (bulkUpdate || options.contains(showTuneIconsPath)) {
         showTuneIcons_ = PsiOptions::instance()->getOption(showTuneIconsPath).toBool();
-        updated        = true;
         updateGeometry = true;
     }
-    if (bulkUpdate || (!updated && option == showGeolocIconsPath)) {
+    if (bulkUpdate || options.contains(showGeolocIconsPath)) {
         showGeolocIcons_ = PsiOptions::instance()->getOption(showGeolocIconsPath).toBool();
-        updated          = true;
         updateGeometry   = true;
     }
-    if (bulkUpdate || (!updated && option == showAvatarsPath)) {
+    if (bulkUpdate || options.contains(showAvatarsPath)) {
         showAvatars_   = PsiOptions::instance()->getOption(showAvatarsPath).toBool();
-        updated        = true;
         updateGeometry = true;
     }
-    if (bulkUpdate || (!updated && option == useDefaultAvatarPath)) {
+    if (bulkUpdate || options.contains(useDefaultAvatarPath)) {
         useDefaultAvatar_ = PsiOptions::instance()->getOption(useDefaultAvatarPath).toBool();
-        updated           = true;
         updateViewport    = true;
     }
-    if (bulkUpdate || (!updated && option == avatarAtLeftOptionPath)) {
+    if (bulkUpdate || options.contains(avatarAtLeftOptionPath)) {
         avatarAtLeft_  = PsiOptions::instance()->getOption(avatarAtLeftOptionPath).toBool();
-        updated        = true;
         updateGeometry = true;
     }
-    if (bulkUpdate || (!updated && option == avatarSizeOptionPath)) {
+    if (bulkUpdate || options.contains(avatarSizeOptionPath)) {
         int s = pointToPixel(PsiOptions::instance()->getOption(avatarSizeOptionPath).toInt());
         avatarRect_.setSize(QSize(s, s));
-        updated        = true;
         updateGeometry = true;
     }
-    if (bulkUpdate || (!updated && option == avatarRadiusOptionPath)) {
+    if (bulkUpdate || options.contains(avatarRadiusOptionPath)) {
         avatarRadius_  = pointToPixel(PsiOptions::instance()->getOption(avatarRadiusOptionPath).toInt());
-        updated        = true;
         updateViewport = true;
     }
-    if (bulkUpdate || (!updated && option == showStatusIconsPath)) {
+    if (bulkUpdate || options.contains(showStatusIconsPath)) {
         showStatusIcons_ = PsiOptions::instance()->getOption(showStatusIconsPath).toBool();
-        updated          = true;
         updateGeometry   = true;
     }
-    if (bulkUpdate || (!updated && option == statusIconsOverAvatarsPath)) {
+    if (bulkUpdate || options.contains(statusIconsOverAvatarsPath)) {
         statusIconsOverAvatars_ = PsiOptions::instance()->getOption(statusIconsOverAvatarsPath).toBool();
-        updated                 = true;
         updateGeometry          = true;
     }
-    if (bulkUpdate || (!updated && option == allClientsOptionPath)) {
+    if (bulkUpdate || options.contains(allClientsOptionPath)) {
         allClients_    = PsiOptions::instance()->getOption(allClientsOptionPath).toBool();
-        updated        = true;
         updateViewport = true;
     }
-    if (bulkUpdate || (!updated && option == enableGroupsOptionPath)) {
+    if (bulkUpdate || options.contains(enableGroupsOptionPath)) {
         enableGroups_  = PsiOptions::instance()->getOption(enableGroupsOptionPath).toBool();
-        updated        = true;
         updateViewport = true;
     }
-    if (bulkUpdate || (!updated && option == slimGroupsOptionPath)) {
+    if (bulkUpdate || options.contains(slimGroupsOptionPath)) {
         slimGroup_     = PsiOptions::instance()->getOption(slimGroupsOptionPath).toBool();
-        updated        = true;
         updateViewport = true;
     }
-    if (bulkUpdate || (!updated && option == outlinedGroupsOptionPath)) {
+    if (bulkUpdate || options.contains(outlinedGroupsOptionPath)) {
         outlinedGroup_ = PsiOptions::instance()->getOption(outlinedGroupsOptionPath).toBool();
-        updated        = true;
         updateViewport = true;
     }
-    if (bulkUpdate || (!updated && option == statusSingleOptionPath)) {
-        statusSingle_ = !PsiOptions::instance()->getOption(statusSingleOptionPath).toBool();
-        // updated = true;
+    if (bulkUpdate || options.contains(statusSingleOptionPath)) {
+        statusSingle_  = !PsiOptions::instance()->getOption(statusSingleOptionPath).toBool();
         updateGeometry = true;
     }
 
@@ -264,6 +258,7 @@ void ContactListViewDelegate::Private::optionChanged(const QString &option)
             updateViewport = true;
         }
         if (updateViewport) {
+            invalidateRowCache();
             contactList->viewport()->update();
         }
     }
@@ -329,6 +324,7 @@ void ContactListViewDelegate::Private::colorOptionChanged(const QString &option)
         // updated = true;
         updateViewPort = true;
     }
+    invalidateRowCache();
     if (!bulkUpdate && updateViewPort)
         contactList->viewport()->update();
 }
@@ -350,10 +346,20 @@ void ContactListViewDelegate::Private::updateAlerts()
 
         // Clean invalid indexes
         if (!index.isValid()) {
+            alertIconRects_.remove(index);
             it.remove();
             continue;
         }
 
+        // rows painted from the cache get only their alert icon repainted
+        auto iconRect = alertIconRects_.constFind(index);
+        if (iconRect != alertIconRects_.constEnd()) {
+            QRect rowRect = contactList->visualRect(index);
+            if (rowRect.isValid())
+                contactList->viewport()->update(iconRect->translated(rowRect.topLeft()));
+            continue;
+        }
+
         QModelIndex parent = index.parent();
         int         row    = index.row();
         if (ranges.contains(parent)) {
@@ -523,7 +529,102 @@ QPixmap ContactListViewDelegate::Private::rosterIndicator(const QString iconName
     return pix;
 }
 
-void ContactListViewDelegate::Private::drawContact(QPainter *painter, const QModelIndex &index)
+/**
+ * Paints a contact row from the row cache, rendering it first if needed.
+ * An alerting status icon is animated, so it isn't cached but painted over the row.
+ */
+void ContactListViewDelegate::Private::paintContact(QPainter *painter, const QModelIndex &index)
+{
+    // the background is painted from the left edge of the viewport, see drawBackground()
+    QRect area(0, opt.rect.top(), opt.rect.right() + 1, opt.rect.height());
+    if (area.isEmpty()) {
+        drawContact(painter, index);
+        return;
+    }
+
+    qreal dpr   = painter->device()->devicePixelRatioF();
+    bool  alert = index.data(ContactListModel::IsAlertingRole).toBool();
+    bool  anim  = index.data(ContactListModel::IsAnimRole).toBool();
+    setAnimEnabled(index, anim);
+
+    QByteArray                 key = contactStateKey(index, area, dpr, anim);
+    CachedRow                 *row = rowCache_.object(key);
+    std::unique_ptr<CachedRow> uncached;
+    if (!row) {
+        auto fresh    = std::make_unique<CachedRow>();
+        fresh->pixmap = QPixmap(area.size() * dpr);
+        fresh->pixmap.setDevicePixelRatio(dpr);
+        fresh->pixmap.fill(contactList->palette().color(QPalette::Base));
+
+        QPainter p(&fresh->pixmap);
+        p.translate(-area.topLeft());
+        QRect statusRect;
+        drawContact(&p, index, alert ? &statusRect : nullptr);
+        p.end();
+        fresh->statusRect = statusRect.translated(-opt.rect.topLeft());
+
+        int cost = fresh->pixmap.width() * fresh->pixmap.height() * fresh->pixmap.depth() / 8;
+        if (cost <= rowCache_.maxCost()) {
+            row = fresh.get();
+            rowCache_.insert(key, fresh.release(), cost);
+        } else {
+            uncached = std::move(fresh);
+            row      = uncached.get();
+        }
+    }
+
+    painter->drawPixmap(area.topLeft(), row->pixmap);
+
+    if (alert && row->statusRect.isValid()) {
+        alertIconRects_.insert(index, row->statusRect);
+        QRect   statusRect = row->statusRect.translated(opt.rect.topLeft());
+        QPixmap frame      = statusPixmap(index, statusRect.size());
+        if (!frame.isNull())
+            painter->drawPixmap(statusRect, frame);
+    } else {
+        alertIconRects_.remove(index);
+        setAlertEnabled(index, alert);
+    }
+}
+
+QByteArray ContactListViewDelegate::Private::contactStateKey(const QModelIndex &index, const QRect &area, qreal dpr,
+                                                             bool anim)
+{
+    static const int roles[]
+        = { Qt::DisplayRole,
+            ContactListModel::JidRole,
+            ContactListModel::StatusTextRole,
+            ContactListModel::StatusTypeRole,
+            ContactListModel::PresenceErrorRole,
+            ContactListModel::IsAgentRole,
+            ContactListModel::AuthorizesToSeeStatusRole,
+            ContactListModel::AskingForAuthRole,
+            ContactListModel::IsAlertingRole,
+            ContactListModel::BlockRole,
+            ContactListModel::IsMucRole,
+            ContactListModel::MucMessagesRole,
+            ContactListModel::ClientRole,
+            ContactListModel::TuneRole,
+            ContactListModel::GeolocationRole,
+            ContactListModel::IsSecureRole };
+
+    QByteArray  key;
+    QDataStream s(&key, QIODevice::WriteOnly);
+    s << area.size() << opt.rect.left() << dpr << PSI_HIDPI << opt.state.testFlag(QStyle::State_Selected)
+      << opt.state.testFlag(QStyle::State_Enabled) << opt.state.testFlag(QStyle::State_Active) << int(opt.direction)
+      << opt.palette.cacheKey() << backgroundColor(opt, index).rgba() << (anim && animPhase);
+    for (int role : roles)
+        s << index.data(role);
+    s << index.data(ContactListModel::MoodRole).value<Mood>().typeValue()
+      << activityIconName(index.data(ContactListModel::ActivityRole).value<Activity>())
+      << index.data(ContactListModel::AvatarRole).value<QPixmap>().cacheKey();
+    return key;
+}
+
+void ContactListViewDelegate::Private::invalidateRowCache() { rowCache_.clear(); }
+
+void ContactListViewDelegate::Private::drawContact(QPainter *painter, const QModelIndex &index,
+                                                   QRect *deferredStatusRect)
 {
     /* We have a few possible ways to draw contact
      * 1) Avatar is hidden or on the left or on the right
@@ -622,7 +723,9 @@ void ContactListViewDelegate::Private::drawContact(QPainter *painter, const QMod
                 secondLineRect.setLeft(nickRect.left()); // we don't want status under icon
             }
         }
-        if (r.intersects(statusIconRect)) {
+        if (deferredStatusRect) {
+            *deferredStatusRect = statusIconRect; // the caller paints it
+        } else if (r.intersects(statusIconRect)) {
             painter->drawPixmap(statusIconRect, statusPixmap);
         }
     }
@@ -918,6 +1021,7 @@ void ContactListViewDelegate::Private::recomputeGeometry()
     nickRect_.moveTop(firstLineRect_.top() + (firstLineRect_.height() - nickRect_.height()) / 2);
     statusLineRect_.moveTop(secondLineRect_.top() + (secondLineRect_.height() - statusLineRect_.height()) / 2);
 
+    invalidateRowCache();
     emit geometryUpdated();
 }
 
@@ -1250,7 +1354,7 @@ void ContactListViewDelegate::paint(QPainter *painter, const QStyleOptionViewIte
 
     switch (type) {
     case ContactListItem::Type::ContactType:
-        d->drawContact(painter, index);
+        d->paintContact(painter, index);
         break;
     case ContactListItem::Type::GroupType:
         d->drawGroup(painter, index);
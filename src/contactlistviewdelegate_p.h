@@ -3,9 +3,11 @@
 #include "contactlistview.h"
 #include "contactlistviewdelegate.h"
 
+#include <QCache>
 #include <QColor>
 #include <QFont>
 #include <QFontMetrics>
+#include <QHash>
 #include <QIcon>
 #include <QList>
 #include <QModelIndex>
@@ -25,13 +27,13 @@ signals:
     void geometryUpdated();
 
 public slots:
-    void optionChanged(const QString &option);
     void colorOptionChanged(const QString &option);
     void updateAlerts();
     void updateAnim();
     void rosterIconsSizeChanged(int size);
 
 public:
+    void  optionsChanged(const QSet<QString> &options);
     void  recomputeGeometry();
     QSize sizeHint(const QModelIndex &index) const;
     int   avatarSize() const;
@@ -41,7 +43,11 @@ public:
     virtual QList<QPixmap> clientPixmap(const QModelIndex &index);
     virtual QPixmap        avatarIcon(const QModelIndex &index);
 
-    void drawContact(QPainter *painter, const QModelIndex &index);
+    void       paintContact(QPainter *painter, const QModelIndex &index);
+    QByteArray contactStateKey(const QModelIndex &index, const QRect &area, qreal dpr, bool anim);
+    void       invalidateRowCache();
+
+    void drawContact(QPainter *painter, const QModelIndex &index, QRect *deferredStatusRect = nullptr);
     void drawGroup(QPainter *painter, const QModelIndex &index);
     void drawAccount(QPainter *painter, const QModelIndex &index);
 
@@ -106,6 +112,14 @@ public:
     mutable QSet<QPersistentModelIndex> alertingIndexes;
     mutable QSet<QPersistentModelIndex> animIndexes;
 
+    // rendered contact rows keyed by everything that affects them
+    struct CachedRow {
+        QPixmap pixmap;
+        QRect   statusRect; // relative to the row. alert frames are painted there over the pixmap
+    };
+    QCache<QByteArray, CachedRow>       rowCache_;
+    QHash<QPersistentModelIndex, QRect> alertIconRects_; // relative to the row
+
     // Colors
     QColor _awayColor;
     QColor _dndColor;
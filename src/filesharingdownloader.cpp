@@ -34,11 +34,17 @@
 
 #include <QByteArray>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QNetworkReply>
 #include <QTimer>
 #include <QUrlQuery>
 #include <QVariant>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <limits>
 
 class AbstractFileShareDownloader : public QObject {
     Q_OBJECT
@@ -59,7 +65,10 @@ protected:
         emit failed();
     }
 
-    Jid selectOnlineJid(const QList<Jid> &jids) const
+    Jid selectOnlineJid(const QList<Jid> &jids) const { return selectOnlineJid(acc, jids); }
+
+public:
+    static Jid selectOnlineJid(PsiAccount *acc, const QList<Jid> &jids)
     {
         for (auto const &j : jids) {
             if (j == acc->client()->jid()) // skip self
@@ -76,7 +85,6 @@ protected:
         return Jid();
     }
 
-public:
     AbstractFileShareDownloader(PsiAccount *acc, const QString &uri, QObject *parent) :
         QObject(parent), acc(acc), sourceUri(uri)
     {
@@ -110,6 +118,7 @@ class JingleFileShareDownloader : public AbstractFileShareDownloader {
     Jingle::FileTransfer::Application *app = nullptr;
     XMPP::Jingle::FileTransfer::File   file;
     QList<Jid>                         jids;
+    Jid                                dataSource;
 
 public:
     JingleFileShareDownloader(PsiAccount *acc_, const QString &uri, const XMPP::Jingle::FileTransfer::File &file,
@@ -118,6 +127,9 @@ public:
     {
     }
 
+    // skips source selection and downloads from the given entity
+    void setDataSource(const Jid &jid) { dataSource = jid; }
+
     void start()
     {
         QUrl    uriToOpen(sourceUri);
@@ -129,7 +141,8 @@ public:
         auto sourceJids = jids;
         if (entity.isValid() && !entity.node().isEmpty())
             sourceJids.prepend(entity);
-        Jid dataSource = selectOnlineJid(sourceJids);
+        if (!dataSource.isValid())
+            dataSource = selectOnlineJid(sourceJids);
         if (!dataSource.isValid()) {
             downloadError(tr("Jingle data source is offline"));
             return;
@@ -429,9 +442,315 @@ public:
     std::optional<std::uint64_t> fileSize() const { return _totalSize; }
 };
 
+/*
+ * Downloads one file by ranges from several sources at once.
+ * The file is split into segments which idle sources take in file order, so the beginning of the file
+ * is completed first and can be streamed while the rest is still downloading. When nothing is left to take,
+ * an idle source steals the tail of the segment which is expected to finish last.
+ */
+class SegmentedFileShareDownloader : public QObject {
+    Q_OBJECT
+
+    static constexpr quint64 MinSegmentSize    = 1024 * 1024;
+    static constexpr quint64 MaxSegmentSize    = 16 * 1024 * 1024;
+    static constexpr quint64 MinStealSize      = 256 * 1024;
+    static constexpr qint64  ReadChunk         = 64 * 1024;
+    static constexpr int     SampleInterval    = 500;  // msecs between throughput updates
+    static constexpr int     RetryDelay        = 1000; // msecs
+    static constexpr int     MaxSourceFailures = 2;
+
+    struct Segment {
+        quint64 start;
+        quint64 pos; // next byte to write
+        quint64 end; // exclusive
+        int     owner = -1;
+    };
+
+    struct Source {
+        QString                      uri;
+        Jid                          jid; // jingle only
+        AbstractFileShareDownloader *downloader  = nullptr;
+        int                          segment     = -1;
+        double                       throughput  = 0; // bytes per second, smoothed
+        quint64                      sampleBytes = 0;
+        QElapsedTimer                sampleTimer;
+        int                          failures = 0;
+        bool                         dead     = false;
+    };
+
+    PsiAccount                      *acc;
+    XMPP::Jingle::FileTransfer::File file;
+    QFile                           *dst;
+    quint64                          totalSize;
+    quint64                          _completedPrefix = 0;
+    quint64                          _downloaded      = 0;
+    std::vector<Source>              sources;
+    std::vector<Segment>             segments;
+    QString                          _lastError;
+    bool                             done = false;
+
+public:
+    SegmentedFileShareDownloader(PsiAccount *acc, const XMPP::Jingle::FileTransfer::File &file, QFile *dst,
+                                 QObject *parent) :
+        QObject(parent), acc(acc), file(file), dst(dst), totalSize(file.size().value_or(0))
+    {
+    }
+
+    ~SegmentedFileShareDownloader() { abort(); }
+
+    void addSource(const QString &uri, const Jid &jid = Jid())
+    {
+        Source src;
+        src.uri = uri;
+        src.jid = jid;
+        sources.push_back(src);
+    }
+
+    int  sourceCount() const { return int(sources.size()); }
+    void setDestination(QFile *file) { dst = file; }
+
+    void start()
+    {
+        quint64 segmentSize = qBound(MinSegmentSize, totalSize / (sources.size() * 4), MaxSegmentSize);
+        for (quint64 start = 0; start < totalSize; start += segmentSize) {
+            segments.push_back({ start, start, qMin(start + segmentSize, totalSize) });
+        }
+        dispatch();
+    }
+
+    void abort()
+    {
+        done = true;
+        for (auto &src : sources) {
+            stopSource(src, true);
+        }
+    }
+
+    // all bytes before this offset are written to the file
+    quint64        completedPrefix() const { return _completedPrefix; }
+    quint64        downloaded() const { return _downloaded; }
+    const QString &lastError() const { return _lastError; }
+
+signals:
+    void prefixChanged();
+    void finished();
+    void failed();
+
+private:
+    void dispatch()
+    {
+        for (int i = 0; i < int(sources.size()) && !done; i++) {
+            if (!sources[i].dead && sources[i].segment < 0)
+                assignWork(i);
+        }
+    }
+
+    void assignWork(int i)
+    {
+        int s = -1;
+        for (int k = 0; k < int(segments.size()); k++) {
+            auto const &seg = segments[k];
+            if (seg.owner < 0 && seg.pos < seg.end && (s < 0 || seg.start < segments[s].start))
+                s = k;
+        }
+        if (s < 0)
+            s = stealSegment(i);
+        if (s >= 0)
+            startSource(i, s);
+    }
+
+    // splits the segment expected to finish last, so both parts finish at about the same time
+    int stealSegment(int thief)
+    {
+        int    victim  = -1;
+        double slowest = 0;
+        for (int k = 0; k < int(segments.size()); k++) {
+            auto const &seg = segments[k];
+            if (seg.owner < 0 || seg.end - seg.pos < 2 * MinStealSize)
+                continue;
+            double rate = sources[seg.owner].throughput;
+            double eta  = rate > 0 ? double(seg.end - seg.pos) / rate : std::numeric_limits<double>::max();
+            if (eta > slowest) {
+                slowest = eta;
+                victim  = k;
+            }
+        }
+        if (victim < 0)
+            return -1;
+
+        auto   &seg       = segments[victim];
+        double  theirs    = sources[seg.owner].throughput;
+        double  mine      = sources[thief].throughput;
+        quint64 remaining = seg.end - seg.pos;
+        quint64 keep      = remaining / 2;
+        if (theirs > 0 && mine > 0) {
+            keep = quint64(double(remaining) * theirs / (theirs + mine));
+        }
+        keep = qBound(MinStealSize, keep, remaining - MinStealSize);
+
+        Segment tail { seg.pos + keep, seg.pos + keep, seg.end };
+        seg.end = tail.start; // the victim's request still runs past it, readSource() stops it in time
+        segments.push_back(tail);
+        return int(segments.size()) - 1;
+    }
+
+    void startSource(int i, int s)
+    {
+        auto &src = sources[i];
+        auto &seg = segments[s];
+        if (FileSharingItem::sourceType(src.uri) == FileSharingItem::SourceType::Jingle) {
+            auto jdl = new JingleFileShareDownloader(acc, src.uri, file, { src.jid }, this);
+            jdl->setDataSource(src.jid);
+            src.downloader = jdl;
+        } else {
+            src.downloader = new NAMFileShareDownloader(acc, src.uri, this);
+        }
+        seg.owner       = i;
+        src.segment     = s;
+        src.sampleBytes = 0;
+        src.sampleTimer.start();
+
+        auto dl = src.downloader;
+        dl->setRequestRange(FileShareDownloader::Range { seg.pos, seg.end - seg.pos });
+        connect(dl, &AbstractFileShareDownloader::metaDataChanged, this, [this, i]() {
+            auto const &src = sources[i];
+            if (src.segment < 0)
+                return;
+            auto const range = src.downloader->responseRange();
+            if (!range || range->start != segments[src.segment].pos) {
+                sourceFailed(i, QLatin1String("Ranged download is not supported by ") + src.uri, true);
+            }
+        });
+        connect(dl, &AbstractFileShareDownloader::readyRead, this, [this, i]() { readSource(i); });
+        connect(dl, &AbstractFileShareDownloader::disconnected, this, [this, i]() {
+            readSource(i);
+            if (sources[i].segment >= 0) // closed before the whole range was received
+                sourceFailed(i, tr("Download source disconnected prematurely"));
+        });
+        connect(dl, &AbstractFileShareDownloader::failed, this,
+                [this, i]() { sourceFailed(i, sources[i].downloader->lastError()); });
+        dl->start();
+    }
+
+    void stopSource(Source &src, bool isFailure)
+    {
+        if (src.segment >= 0) {
+            segments[src.segment].owner = -1;
+            src.segment                 = -1;
+        }
+        if (src.downloader) {
+            src.downloader->disconnect(this);
+            if (isFailure) {
+                src.downloader->abort(true, QString());
+            } else {
+                src.downloader->close();
+                src.downloader->abort();
+            }
+            src.downloader->deleteLater();
+            src.downloader = nullptr;
+        }
+    }
+
+    void readSource(int i)
+    {
+        auto &src = sources[i];
+        if (src.segment < 0 || !src.downloader)
+            return;
+
+        auto      &seg = segments[src.segment];
+        QByteArray buf;
+        qint64     avail;
+        while (seg.pos < seg.end && (avail = src.downloader->bytesAvailable()) > 0) {
+            buf.resize(int(qMin(qMin(avail, ReadChunk), qint64(seg.end - seg.pos))));
+            qint64 bytesRead = src.downloader->read(buf.data(), buf.size());
+            if (bytesRead <= 0)
+                break;
+            if (!dst->seek(qint64(seg.pos)) || dst->write(buf.constData(), bytesRead) != bytesRead) {
+                _lastError = dst->errorString();
+                abort();
+                emit failed();
+                return;
+            }
+            seg.pos += quint64(bytesRead);
+            _downloaded += quint64(bytesRead);
+            src.sampleBytes += quint64(bytesRead);
+        }
+
+        auto elapsed = src.sampleTimer.elapsed();
+        if (elapsed >= SampleInterval) {
+            double rate     = double(src.sampleBytes) * 1000.0 / double(elapsed);
+            src.throughput  = src.throughput > 0 ? src.throughput * 0.7 + rate * 0.3 : rate;
+            src.sampleBytes = 0;
+            src.sampleTimer.restart();
+        }
+
+        updatePrefix();
+        if (seg.pos == seg.end) {
+            stopSource(src, false);
+            if (_completedPrefix == totalSize) {
+                done = true;
+                emit finished();
+                return;
+            }
+            assignWork(i);
+        }
+    }
+
+    void sourceFailed(int i, const QString &err, bool permanent = false)
+    {
+        auto &src = sources[i];
+        qDebug("FSD segmented source %s failed: %s", qPrintable(src.uri), qPrintable(err));
+        if (!err.isEmpty())
+            _lastError = err;
+        stopSource(src, true);
+        if (permanent || ++src.failures >= MaxSourceFailures) {
+            src.dead = true;
+        } else {
+            QTimer::singleShot(RetryDelay, this, [this, i]() {
+                if (!done && !sources[i].dead && sources[i].segment < 0)
+                    assignWork(i);
+            });
+        }
+
+        if (std::all_of(sources.cbegin(), sources.cend(), [](const Source &s) { return s.dead; })) {
+            done = true;
+            emit failed();
+            return;
+        }
+        dispatch(); // let idle sources pick up the released range
+    }
+
+    void updatePrefix()
+    {
+        std::vector<const Segment *> ordered;
+        ordered.reserve(segments.size());
+        for (auto const &seg : segments)
+            ordered.push_back(&seg);
+        std::sort(ordered.begin(), ordered.end(), [](auto a, auto b) { return a->start < b->start; });
+
+        // segments never overlap, so the prefix ends in the first incomplete one
+        quint64 prefix = _completedPrefix;
+        for (auto seg : ordered) {
+            if (seg->end <= prefix)
+                continue;
+            if (seg->start > prefix)
+                break;
+            prefix = seg->pos;
+            if (seg->pos < seg->end)
+                break;
+        }
+        if (prefix != _completedPrefix) {
+            _completedPrefix = prefix;
+            emit prefixChanged();
+        }
+    }
+};
+
 class FileShareDownloader::Private : public QObject {
     Q_OBJECT
 public:
+    static constexpr quint64 SegmentedThreshold = 8 * 1024 * 1024;
+
     FileShareDownloader                      *q   = nullptr;
     PsiAccount                               *acc = nullptr;
     QList<XMPP::Hash>                         sums;
@@ -445,11 +764,14 @@ public:
     std::optional<FileShareDownloader::Range> responseRange;
     std::optional<quint64>                    bytesLeft;
     AbstractFileShareDownloader              *downloader  = nullptr;
-    bool                                      metaReady   = false;
-    bool                                      finished    = false;
-    bool                                      success     = false;
-    bool                                      selfDelete  = false;
-    FileSharingItem::SourceType               currentType = FileSharingItem::SourceType::None;
+    SegmentedFileShareDownloader             *segmented   = nullptr;
+    std::unique_ptr<QFile>                    readFile; // segmented mode: sequential reads of the completed prefix
+    bool                                      metaReady    = false;
+    bool                                      finished     = false;
+    bool                                      success      = false;
+    bool                                      selfDelete   = false;
+    bool                                      cachePending = false; // segmented mode: complete but still being read
+    FileSharingItem::SourceType               currentType  = FileSharingItem::SourceType::None;
 
     void finishWithError(const QString &errStr)
     {
@@ -463,6 +785,7 @@ public:
 
             tmpFile.reset();
         }
+        readFile.reset();
         dstFileName.clear();
         if (selfDelete) {
             q->deleteLater();
@@ -488,6 +811,135 @@ public:
         }
     }
 
+    qint64 segmentedBytesAvailable() const
+    {
+        return readFile ? qint64(segmented->completedPrefix()) - readFile->pos() : 0;
+    }
+
+    // large files with several rangeable sources are fetched in parallel segments
+    bool startSegmented()
+    {
+        if (requestRange || sums.isEmpty() || !file.size() || *file.size() < SegmentedThreshold)
+            return false;
+
+        auto seg = new SegmentedFileShareDownloader(acc, file, nullptr, q);
+
+        QString    jingleUri;
+        QList<Jid> candidates;
+        for (auto const &uri : std::as_const(uris)) {
+            switch (FileSharingItem::sourceType(uri)) {
+            case FileSharingItem::SourceType::HTTP:
+            case FileSharingItem::SourceType::FTP:
+                seg->addSource(uri);
+                break;
+            case FileSharingItem::SourceType::Jingle: {
+                jingleUri    = uri;
+                QString path = QUrl(uri).path();
+                if (path.startsWith('/'))
+                    path = path.mid(1);
+                Jid entity = JIDUtil::fromString(path);
+                if (entity.isValid() && !entity.node().isEmpty())
+                    candidates.append(entity);
+                break;
+            }
+            default:
+                break; // BOB can't do ranges
+            }
+        }
+        if (!jingleUri.isEmpty()) {
+            candidates += jids;
+            QList<Jid> used;
+            for (auto const &j : std::as_const(candidates)) {
+                if (!used.contains(j) && AbstractFileShareDownloader::selectOnlineJid(acc, { j }).isValid()) {
+                    used.append(j);
+                    seg->addSource(jingleUri, j);
+                }
+            }
+        }
+        if (seg->sourceCount() < 2) {
+            delete seg;
+            return false;
+        }
+
+        auto partDir = QDir(acc->psi()->fileSharingManager()->cacheDir() + "/partial");
+        partDir.mkpath(".");
+        dstFileName = partDir.absoluteFilePath(QString::fromLatin1(sums.value(0).data().toHex()));
+        tmpFile.reset(new QFile(dstFileName));
+        readFile.reset(new QFile(dstFileName));
+        // unbuffered: the reader must never see data the writer hasn't flushed yet
+        if (!tmpFile->open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Unbuffered)
+            || !tmpFile->resize(qint64(*file.size())) || !readFile->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            delete seg;
+            finishWithError(tmpFile->errorString());
+            return true;
+        }
+
+        segmented = seg;
+        segmented->setDestination(tmpFile.get());
+        connect(segmented, &SegmentedFileShareDownloader::prefixChanged, q, [this]() {
+            emit q->progress(size_t(segmented->downloaded()), size_t(*file.size()));
+            emit q->readyRead();
+        });
+        connect(segmented, &SegmentedFileShareDownloader::failed, q,
+                [this]() { finishWithError(segmented->lastError()); });
+        connect(segmented, &SegmentedFileShareDownloader::finished, q, [this]() { verifySegmented(); });
+
+        metaReady = true;
+        QMetaObject::invokeMethod(q, &FileShareDownloader::metaDataChanged, Qt::QueuedConnection);
+        segmented->start();
+        return true;
+    }
+
+    // the file was assembled from different sources, so make sure it's what was shared
+    void verifySegmented()
+    {
+        auto it = std::find_if(sums.cbegin(), sums.cend(), [](const XMPP::Hash &h) { return h.isValid(); });
+        if (it == sums.cend()) {
+            segmentedReady();
+            return;
+        }
+        tmpFile->close();
+
+        auto watcher = new QFutureWatcher<XMPP::Hash>(q);
+        connect(watcher, &QFutureWatcher<XMPP::Hash>::finished, q, [this, watcher, expected = *it]() {
+            watcher->deleteLater();
+            if (finished)
+                return; // aborted meanwhile
+            if (watcher->result() == expected) {
+                segmentedReady();
+            } else {
+                finishWithError(tr("Downloaded file doesn't match its checksum"));
+            }
+        });
+        watcher->setFuture(QtConcurrent::run([type = it->type(), fileName = dstFileName]() {
+            return XMPP::Hash::from(type, QFileInfo(fileName));
+        }));
+    }
+
+    void segmentedReady()
+    {
+        tmpFile.reset();
+        finished     = true;
+        success      = true;
+        cachePending = true;
+        emit q->disconnected();
+        if (readFile->pos() == qint64(*file.size()))
+            segmentedCacheReady();
+    }
+
+    // the file is moved to the cache, which fails on Windows while the reader still has it open
+    void segmentedCacheReady()
+    {
+        if (!cachePending)
+            return;
+        cachePending = false;
+        readFile.reset();
+        emit q->cacheReady();
+        if (selfDelete) {
+            q->deleteLater();
+        }
+    }
+
     void startNextDownloader()
     {
         if (downloader) {
@@ -579,13 +1031,21 @@ FileShareDownloader::FileShareDownloader(PsiAccount *acc, const QList<XMPP::Hash
 
 FileShareDownloader::~FileShareDownloader()
 {
+    d->selfDelete = false;
+    d->segmentedCacheReady(); // closed without reading till the end
     abort();
     qDebug("FSD destroyed");
 }
 
 bool FileShareDownloader::isSuccess() const { return d->success; }
 
-bool FileShareDownloader::isConnected() const { return d->downloader ? d->downloader->isConnected() : false; }
+bool FileShareDownloader::isConnected() const
+{
+    if (d->segmented) { // connected until the whole file is read
+        return d->readFile && quint64(d->readFile->pos()) < *d->file.size();
+    }
+    return d->downloader ? d->downloader->isConnected() : false;
+}
 
 bool FileShareDownloader::open(QIODevice::OpenMode mode)
 {
@@ -597,13 +1057,23 @@ bool FileShareDownloader::open(QIODevice::OpenMode mode)
         return true;
 
     QIODevice::open(mode);
-    d->startNextDownloader();
+    if (!d->startSegmented())
+        d->startNextDownloader();
 
     return true;
 }
 
+void FileShareDownloader::close()
+{
+    d->segmentedCacheReady();
+    QIODevice::close();
+}
+
 void FileShareDownloader::abort()
 {
+    if (d->segmented) {
+        d->segmented->abort();
+    }
     if (d->downloader) {
         d->downloader->abort();
     }
@@ -629,6 +1099,13 @@ const Jingle::FileTransfer::File &FileShareDownloader::jingleFile() const { retu
 
 qint64 FileShareDownloader::readData(char *data, qint64 maxSize)
 {
+    if (d->segmented) {
+        qint64 toRead    = qMin(maxSize, d->segmentedBytesAvailable());
+        qint64 bytesRead = toRead > 0 ? d->readFile->read(data, toRead) : 0;
+        if (d->cachePending && d->readFile->pos() == qint64(*d->file.size()))
+            QMetaObject::invokeMethod(this, [this]() { d->segmentedCacheReady(); }, Qt::QueuedConnection);
+        return bytesRead;
+    }
     if (!maxSize || !d->downloader) // wtf?
         return 0;
 
@@ -656,7 +1133,13 @@ qint64 FileShareDownloader::writeData(const char *, qint64)
 
 bool FileShareDownloader::isSequential() const { return true; }
 
-qint64 FileShareDownloader::bytesAvailable() const { return d->downloader ? d->downloader->bytesAvailable() : 0; }
+qint64 FileShareDownloader::bytesAvailable() const
+{
+    if (d->segmented) {
+        return d->segmentedBytesAvailable();
+    }
+    return d->downloader ? d->downloader->bytesAvailable() : 0;
+}
 
 void FileShareDownloader::setSelfDelete(bool enable) { d->selfDelete = enable; }
 
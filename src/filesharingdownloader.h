@@ -53,6 +53,7 @@ public:
     bool                        isSuccess() const;
     bool                        isConnected() const;
     bool                        open(QIODevice::OpenMode mode = QIODevice::ReadOnly) override;
+    void                        close() override;
     void                        abort();
     void                        setRequestRange(const std::optional<Range> &range);
     const std::optional<Range> &requestRange() const;
@@ -29,17 +29,26 @@
 #include "psicon.h"
 #ifdef HAVE_WEBSERVER
 #include "qhttpfwd.hpp"
+#include "qhttpserverconnection.hpp"
 #include "qhttpserverresponse.hpp"
 #include "webserver.h"
+
+#include <QTcpSocket>
 #endif
 
 #include <QFileInfo>
 #include <QNetworkReply>
 #include <QPointer>
+#include <QRandomGenerator>
 
 #include <cstring>
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <sys/sendfile.h>
+#endif
 
 #define HTTP_CHUNK (512 * 1024)
+#define SENDFILE_WAKEUP_CHUNK (16 * 1024)
 
 template <typename Impl> class ControlBase : public QObject {
 
@@ -55,27 +64,46 @@ public:
         ServiceUnavailable, // 503
     };
 
+    // a piece of a cached file response: some bytes generated in memory followed by a span of the file
+    struct CachePart {
+        QByteArray head; // multipart headers
+        quint64    offset = 0;
+        quint64    size   = 0;
+    };
+
     PsiAccount                           *acc;
     FileSharingItem                      *item = nullptr;
+    QString                               localFile; // served instead of an item, see FileSharingProxy::serveFile()
+    QString                               localMimeType;
     QPointer<FileShareDownloader>         downloader;
     std::optional<FileSharingItem::Range> requestedRange;
+    QList<FileSharingItem::Range>         requestedRanges; // multipart/byteranges request, cached files only
+    QFile                                *cacheFile = nullptr;
+    QList<CachePart>                      cacheParts;
     std::optional<quint64>                bytesLeft; // if not set - unknown
-    qint64                                totalTranferred = 0;
-    bool                                  headersSent     = false;
-    bool                                  dataHungry      = true;
-    bool                                  finished        = false;
+    qint64                                totalTranferred   = 0;
+    bool                                  headersSent       = false;
+    bool                                  dataHungry        = true;
+    bool                                  finished          = false;
+    bool                                  sendingCacheParts = false;
+    bool                                  cacheWritable     = false; // became writable while sending
 
     ControlBase(PsiAccount *acc, const QString &sourceIdHex, QObject *parent) :
         QObject(parent), acc(acc), item(acc->psi()->fileSharingManager()->item(XMPP::Hash::from(sourceIdHex)))
     {
     }
 
+    ControlBase(const QString &fileName, const QString &mimeType, QObject *parent) :
+        QObject(parent), acc(nullptr), localFile(fileName), localMimeType(mimeType)
+    {
+    }
+
     ~ControlBase() { qDebug("FSP destroyed. Total transferred bytes: %lld", totalTranferred); }
 
     void process()
     {
         auto self = static_cast<Impl *>(this);
-        if (!item) {
+        if (!item && localFile.isEmpty()) {
             _finishWithMetadataError(StatusCode::NotFound);
             return;
         }
@@ -90,8 +118,7 @@ public:
             }
         }
 
-        auto cache = item->cache();
-        if (cache) {
+        if (hasLocalFile()) {
             proxyCache();
             return; // handled with success
         }
@@ -110,10 +137,40 @@ public:
         downloader->open();
     }
 
+    bool    hasLocalFile() const { return !localFile.isEmpty() || item->cache(); }
+    QString fileName() const { return localFile.isEmpty() ? item->fileName() : localFile; }
+    QString mimeType() const { return localFile.isEmpty() ? item->mimeType() : localMimeType; }
+
+    std::optional<quint64> fileSize() const
+    {
+        if (localFile.isEmpty())
+            return item->fileSize();
+        return quint64(QFileInfo(localFile).size());
+    }
+
     // returns <parsed,list of start/size>
     StatusCode parseHttpRangeRequest(const QByteArray &rangeValue)
     {
-        auto const [parseResult, start, size] = Http::parseRangeHeader(rangeValue, item->fileSize());
+        if (rangeValue.contains(',') && hasLocalFile()) { // we can serve any ranges from the local file
+            auto const [parseResult, ranges] = Http::parseMultiRangeHeader(rangeValue, fileSize());
+            if (parseResult == Http::Parsed) {
+                for (auto const &[start, size] : ranges) {
+                    requestedRanges.append(FileSharingItem::Range { start, size });
+                }
+                if (requestedRanges.size() == 1) { // the rest was out of range
+                    requestedRange = requestedRanges.takeFirst();
+                }
+                return StatusCode::Ok;
+            }
+            if (parseResult == Http::OutOfRange) {
+                static_cast<Impl *>(this)->setResponseHeader("Content-Range",
+                                                             QByteArray("bytes */") + QByteArray::number(*fileSize()));
+                return StatusCode::RangeNotSatisfied;
+            }
+            return parseResult == Http::Unparsed ? StatusCode::BadRequest : StatusCode::NotImplemented;
+        }
+
+        auto const [parseResult, start, size] = Http::parseRangeHeader(rangeValue, fileSize());
 
         switch (parseResult) {
         case Http::Parsed:
@@ -127,7 +184,7 @@ public:
             return StatusCode::NotImplemented;
         case Http::OutOfRange:
             static_cast<Impl *>(this)->setResponseHeader(
-                "Content-Range", QByteArray("bytes */") + QByteArray::number(quint64(*item->fileSize())));
+                "Content-Range", QByteArray("bytes */") + QByteArray::number(*fileSize()));
             return StatusCode::RangeNotSatisfied;
         }
         return StatusCode::NotImplemented;
@@ -135,57 +192,131 @@ public:
 
     void proxyCache()
     {
-        // auto status = qhttp::TStatusCode(parseHttpRangeRequest());
-        //  if (status != qhttp::ESTATUS_OK) {
-        //      response->setStatusCode(status);
-        //      qWarning("http range parse failed: %d", status);
-        //      emit request->end();
-        //      return; // handled with error
-        //  }
         auto      self = static_cast<Impl *>(this);
-        QFile    *file = new QFile(item->fileName(), this);
-        QFileInfo fi(*file);
-        if (!file->open(QIODevice::ReadOnly)) {
-            qWarning("FSP failed to open cached file: %s", qPrintable(file->errorString()));
+        QFileInfo fi(fileName());
+        cacheFile = new QFile(fileName(), this);
+        if (!cacheFile->open(QIODevice::ReadOnly)) {
+            qWarning("FSP failed to open cached file: %s", qPrintable(cacheFile->errorString()));
             _finishWithMetadataError(StatusCode::NotFound);
             return; // handled with error
         }
-        auto size        = quint64(fi.size());
-        auto actualRange = requestedRange;
-        if (requestedRange) {
-            if (requestedRange->start >= size) {
+        auto const size = quint64(fi.size());
+
+        // clamps the range to the file. returns false if it's not satisfiable
+        auto const fitRange = [size](FileSharingItem::Range &range) {
+            if (range.start >= size)
+                return false;
+            if (!range.size || range.start + range.size > size)
+                range.size = size - range.start;
+            return true;
+        };
+
+        if (requestedRanges.size()) {
+            QByteArray boundary = QByteArray("psi-") + QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+            QByteArray partType = mimeType().toLatin1();
+            quint64    length   = 0;
+            for (auto range : std::as_const(requestedRanges)) {
+                if (!fitRange(range))
+                    continue;
+                CachePart part;
+                part.head = "\r\n--" + boundary + "\r\n";
+                if (partType.size())
+                    part.head += "Content-Type: " + partType + "\r\n";
+                part.head += "Content-Range: bytes " + QByteArray::number(range.start) + '-'
+                    + QByteArray::number(range.start + range.size - 1) + '/' + QByteArray::number(size) + "\r\n\r\n";
+                part.offset = range.start;
+                part.size   = range.size;
+                length += quint64(part.head.size()) + part.size;
+                cacheParts.append(part);
+            }
+            if (cacheParts.isEmpty()) {
                 self->setResponseHeader("Content-Range", QByteArray("bytes */") + QByteArray::number(size));
-                self->setResponseHeader("Content-Length", "0");
                 _finishWithMetadataError(StatusCode::RangeNotSatisfied);
                 return;
             }
-            if (requestedRange->size)
-                actualRange->size = qint64(requestedRange->start + requestedRange->size) > fi.size()
-                    ? quint64(fi.size()) - requestedRange->start
-                    : requestedRange->size;
-            else // remaining part
-                actualRange->size = quint64(fi.size()) - requestedRange->start;
-            file->seek(requestedRange->start);
-        }
-        // TODO If-Modified-Since
-        setupHeaders(fi.size(), item->mimeType(), fi.lastModified(), actualRange);
-        self->connectReadyWrite(file, [this, file, size]() {
-            qint64 toWrite = (requestedRange ? requestedRange->start : 0) + size - file->pos();
-            if (!toWrite) {
+            CachePart tail;
+            tail.head = "\r\n--" + boundary + "--\r\n";
+            length += quint64(tail.head.size());
+            cacheParts.append(tail);
+
+            if (fi.lastModified().isValid())
+                self->setResponseHeader("Last-Modified", fi.lastModified().toString(Qt::RFC2822Date).toLatin1());
+            self->setResponseHeader("Accept-Ranges", "bytes");
+            self->setResponseHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+            self->setResponseHeader("Content-Length", QByteArray::number(length));
+            self->setResponseHeader("Connection", "keep-alive");
+            self->setResponseStatusCode(StatusCode::PartialContent);
+        } else {
+            auto actualRange = requestedRange;
+            if (actualRange && !fitRange(*actualRange)) {
+                self->setResponseHeader("Content-Range", QByteArray("bytes */") + QByteArray::number(size));
+                self->setResponseHeader("Content-Length", "0");
+                _finishWithMetadataError(StatusCode::RangeNotSatisfied);
                 return;
             }
-            if (toWrite > HTTP_CHUNK)
-                _write(file->read(HTTP_CHUNK));
-            else {
-                _write(file->read(toWrite));
+            // TODO If-Modified-Since
+            setupHeaders(size, mimeType(), fi.lastModified(), actualRange);
+            CachePart part;
+            part.offset = actualRange ? actualRange->start : 0;
+            part.size   = actualRange ? actualRange->size : size;
+            cacheParts.append(part);
+        }
+
+        self->connectReadyWrite(this, [this]() { sendCacheParts(); });
+        sendCacheParts();
+    }
+
+    // writes cached parts until the peer can't accept more.
+    // the file data goes directly from the file to the socket when the transport allows it
+    void sendCacheParts()
+    {
+        if (sendingCacheParts) { // sendFile() flushes the socket, which may report it's writable right away
+            cacheWritable = true;
+            return;
+        }
+        sendingCacheParts = true;
+        auto self         = static_cast<Impl *>(this);
+        while (!finished) {
+            cacheWritable = false;
+            if (cacheParts.isEmpty()) {
                 _finish();
+                break;
+            }
+            if (cacheParts.first().head.size()) {
+                _write(cacheParts.first().head);
+                cacheParts.first().head.clear();
+            }
+            if (!cacheParts.first().size) {
+                cacheParts.removeFirst();
+                continue;
             }
-        });
 
-        if (size < HTTP_CHUNK) {
-            _write(file->read(size));
-            _finish();
+            qint64 sent = self->sendFile(cacheFile, cacheParts.first().offset, cacheParts.first().size);
+            if (sent == 0) {
+                break; // the socket is full. wait for readyWrite
+            }
+            auto &part     = cacheParts.first();
+            bool  buffered = sent < 0;
+            if (buffered) { // no direct path to the socket. copy it
+                cacheFile->seek(qint64(part.offset));
+                auto data = cacheFile->read(qint64(qMin(part.size, quint64(HTTP_CHUNK))));
+                if (data.isEmpty()) {
+                    qWarning("FSP failed to read cached file: %s", qPrintable(cacheFile->errorString()));
+                    _finish();
+                    break;
+                }
+                _write(data);
+                sent = data.size();
+            } else {
+                totalTranferred += sent;
+            }
+            part.offset += quint64(sent);
+            part.size -= quint64(sent);
+            if (buffered && Impl::HasWriteBackpressure && !cacheWritable) {
+                break; // wait for readyWrite
+            }
         }
+        sendingCacheParts = false;
     }
 
     void onMetadataChanged()
@@ -518,6 +649,10 @@ public:
         });
     }
     void write(const QByteArray &data) { return reply->appendData(data); }
+
+    // the reply buffers everything in memory. there is nothing to send directly to
+    static constexpr bool HasWriteBackpressure = false;
+    qint64                sendFile(QFile *, quint64, quint64) { return -1; }
 };
 #ifdef HAVE_WEBSERVER
 class HTTPProxy : public ControlBase<HTTPProxy> {
@@ -536,6 +671,12 @@ public:
                qPrintable(request->url().toString()), qPrintable(request->headers().value("range")));
     }
 
+    HTTPProxy(const QString &fileName, const QString &mimeType, qhttp::server::QHttpRequest *request,
+              qhttp::server::QHttpResponse *response) :
+        ControlBase<HTTPProxy>(fileName, mimeType, response), request(request), response(response)
+    {
+    }
+
     static qhttp::TStatusCode mapStatusCode(ControlBase::StatusCode code)
     {
         switch (code) {
@@ -574,6 +715,58 @@ public:
         connect(response, &qhttp::server::QHttpResponse::allBytesWritten, ctx, std::move(callback));
     }
     void write(const QByteArray &data) { response->write(data); }
+
+    static constexpr bool HasWriteBackpressure = true;
+
+    // Sends file data with sendfile(2). Returns the number of bytes consumed from the file,
+    // 0 if the socket can't accept anything now or -1 if direct sending is not possible.
+    qint64 sendFile(QFile *file, quint64 offset, quint64 size)
+    {
+#ifdef Q_OS_LINUX
+        auto socket = response->connection()->tcpSocket();
+        if (!socket) {
+            return -1;
+        }
+        response->write(QByteArray()); // make sure the headers are queued before the file data
+        socket->flush();
+        if (socket->bytesToWrite()) {
+            return 0; // the previously written data goes first
+        }
+
+        off_t  off  = off_t(offset);
+        qint64 sent = 0;
+        while (quint64(sent) < size) {
+            auto ret = ::sendfile(int(socket->socketDescriptor()), file->handle(), &off, size_t(size) - size_t(sent));
+            if (ret > 0) {
+                sent += ret;
+            } else if (ret < 0 && errno == EINTR) {
+                continue;
+            } else {
+                break;
+            }
+        }
+        if (sent) {
+            return sent;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1; // let the fallback deal with it
+        }
+        // The socket is full and Qt doesn't watch it since its own buffer is empty.
+        // Queue a small piece through the socket so we are notified when it's writable again.
+        file->seek(qint64(offset));
+        auto data = file->read(qint64(qMin(size, quint64(SENDFILE_WAKEUP_CHUNK))));
+        if (data.isEmpty()) {
+            return -1;
+        }
+        response->write(data);
+        return data.size();
+#else
+        Q_UNUSED(file)
+        Q_UNUSED(offset)
+        Q_UNUSED(size)
+        return -1;
+#endif
+    }
 };
 #endif
 }
@@ -585,6 +778,16 @@ void proxify(PsiAccount *acc, const QString &sourceIdHex, qhttp::server::QHttpRe
 {
     (new HTTPProxy(acc, sourceIdHex, request, response))->process();
 }
+
+/**
+ * Serves a local file the way cached shared files are served, i.e. with
+ * (multi)range support and sendfile(2) where available.
+ */
+void serveFile(const QString &fileName, const QString &mimeType, qhttp::server::QHttpRequest *request,
+               qhttp::server::QHttpResponse *response)
+{
+    (new HTTPProxy(fileName, mimeType, request, response))->process();
+}
 #endif
 QNetworkReply *proxify(PsiAccount *acc, const QString &sourceIdHex, const QNetworkRequest &req)
 {
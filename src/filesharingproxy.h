@@ -35,6 +35,8 @@ namespace FileSharingProxy {
 #ifdef HAVE_WEBSERVER
 void proxify(PsiAccount *acc, const QString &sourceIdHex, qhttp::server::QHttpRequest *request,
              qhttp::server::QHttpResponse *response);
+void serveFile(const QString &fileName, const QString &mimeType, qhttp::server::QHttpRequest *request,
+               qhttp::server::QHttpResponse *response);
 #endif
 QNetworkReply *proxify(PsiAccount *acc, const QString &sourceIdHex, const QNetworkRequest &req);
 
@@ -308,7 +308,8 @@ private:
 //----------------------------------------------------------------------------
 
 GCUserModel::GCUserModel(PsiAccount *account, const Jid selfJid, QObject *parent) :
-    QAbstractItemModel(parent), _account(account), _selfJid(selfJid), _selfContact(nullptr)
+    QAbstractItemModel(parent), _account(account), _selfJid(selfJid), _selfContact(nullptr),
+    _sortStyle(PsiOptions::instance(), QStringLiteral("options.ui.muc.userlist.contact-sort-style"))
 {
 }
 
@@ -522,8 +523,7 @@ void GCUserModel::updateEntry(const QString &nick, const Status &s)
     if (!contactIndex.isValid() || newGroupRole != contactIndex.parent().row()) {
         // either new contact or move between groups. we need to find destination position
 
-        bool doStatusSort = PsiOptions::instance()->getOption("options.ui.muc.userlist.contact-sort-style").toString()
-            == QLatin1String("status");
+        bool doStatusSort = _sortStyle.value() == QLatin1String("status");
         int insertRowNum = 0;
         if (contacts[newGroupRole].size()) {
             // TODO use sorting filter model instad of code below.
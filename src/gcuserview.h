@@ -22,6 +22,7 @@
 #define GCUSERVIEW_H
 
 #include "iris/xmpp_status.h"
+#include "optionstree.h"
 
 #include <QAbstractItemModel>
 #include <QTreeView>
@@ -88,10 +89,11 @@ private:
 private:
     QList<MUCContact::Ptr> contacts[LastGroupRole]; // splitted into groups
 
-    PsiAccount     *_account;
-    Jid             _selfJid;
-    QString         _selfNick;
-    MUCContact::Ptr _selfContact;
+    PsiAccount           *_account;
+    Jid                   _selfJid;
+    QString               _selfNick;
+    MUCContact::Ptr       _selfContact;
+    OptionHandle<QString> _sortStyle;
 };
 
 class GCUserView : public QTreeView {
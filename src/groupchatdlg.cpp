@@ -30,6 +30,7 @@
 #include "filesharingmanager.h"
 #include "gcuserview.h"
 #include "groupchattopicdlg.h"
+#include "highlightrules.h"
 #include "iconaction.h"
 #include "iconselect.h"
 #include "iconwidget.h"
@@ -200,7 +201,14 @@ class GCMainDlg::Private : public QObject, public MCmdProviderIface {
 public:
     enum { Connecting, Connected, Idle, ForcedLeave };
     enum { TitleBM, TitleDisco, TitleVCard, TitleJid, TitleNone };
-    Private(GCMainDlg *d) : mCmdManager(&mCmdSite), tabCompletion(this)
+    Private(GCMainDlg *d) :
+        mCmdManager(&mCmdSite),
+        useEmoticons(PsiOptions::instance(), QStringLiteral("options.ui.emoticons.use-emoticons")),
+        soundEveryMessage(PsiOptions::instance(),
+                          QStringLiteral("options.ui.notifications.sounds.notify-every-muc-message")),
+        popupEveryMessage(PsiOptions::instance(),
+                          QStringLiteral("options.ui.notifications.passive-popups.notify-every-muc-message")),
+        renderHtml(PsiOptions::instance(), QStringLiteral("options.html.muc.render")), tabCompletion(this)
     {
         dlg           = d;
         nickSeparator = ":";
@@ -261,6 +269,12 @@ public:
     int logHeight;
     int chateditHeight;
 
+    // options consulted for every incoming message
+    OptionHandle<bool>        useEmoticons;
+    OptionHandle<bool>        soundEveryMessage;
+    OptionHandle<bool>        popupEveryMessage;
+    OptionHandle<bool>        renderHtml;
+
 public:
     bool trackBar;
     bool tabmode;
@@ -896,6 +910,7 @@ GCMainDlg::GCMainDlg(PsiAccount *pa, const Jid &j, TabManager *tabManager) : Tab
     ui_.log->setLocalNickname(d->self);
 #ifdef WEBKIT
     ui_.log->setAccount(account());
+    connect(ui_.log, &ChatView::hibernationChanged, this, &GCMainDlg::invalidateTab);
 #else
     ui_.log->setMediaOpener(account()->fileSharingDeviceOpener());
 #endif
@@ -1253,6 +1268,22 @@ void GCMainDlg::deactivated()
     d->trackBar = true;
 }
 
+bool GCMainDlg::hibernate()
+{
+#ifdef WEBKIT
+    return ui_.log->hibernate();
+#else
+    return false;
+#endif
+}
+
+void GCMainDlg::wakeUp()
+{
+#ifdef WEBKIT
+    ui_.log->wakeUp();
+#endif
+}
+
 void GCMainDlg::activated()
 {
     TabbableWidget::activated();
@@ -2150,8 +2181,6 @@ void GCMainDlg::message(const Message &_m, const PsiEvent::Ptr &e)
         updateConfiguration();
     }
 
-    PsiOptions *options = PsiOptions::instance();
-
     QString topic;
     if (!dm.subjectMap().isEmpty() && dm.isPureSubject()) {
         d->subjectMap.clear();
@@ -2178,7 +2207,7 @@ void GCMainDlg::message(const Message &_m, const PsiEvent::Ptr &e)
         d->lastTopic           = topic;
         QString subjectTooltip = TextUtil::plain2rich(topic);
         subjectTooltip         = TextUtil::linkify(subjectTooltip);
-        if (options->getOption("options.ui.emoticons.use-emoticons").toBool()) {
+        if (d->useEmoticons) {
             subjectTooltip = TextUtil::emoticonify(subjectTooltip);
         }
 
@@ -2221,34 +2250,25 @@ void GCMainDlg::message(const Message &_m, const PsiEvent::Ptr &e)
         return;
 
     // code to determine if the speaker was addressing this client in chat
-    if (dm.body().contains(d->self))
+    auto highlight = HighlightRules::instance()->match(dm.body(), d->self);
+    if (highlight.alert)
         d->alert = true;
 
-    if (dm.body().left(d->self.length()) == d->self)
+    if (highlight.addressed)
         d->lastReferrer = dm.from().resource();
 
-    if (options->getOption("options.ui.muc.use-highlighting").toBool()) {
-        QStringList highlightWords = options->getOption("options.ui.muc.highlight-words").toStringList();
-        for (const QString &word : highlightWords) {
-            if (dm.body().contains((word), Qt::CaseInsensitive)) {
-                d->alert = true;
-            }
-        }
-    }
+    if (from != d->self && !dm.spooled())
+        HighlightRules::instance()->notify(highlight, account(), dm.from(), dm.body());
 
     // play sound?
     if (from == d->self) {
         if (!dm.spooled())
             account()->playSound(PsiAccount::eSend);
     } else {
-        if (d->alert
-            || (options->getOption("options.ui.notifications.sounds.notify-every-muc-message").toBool() && !dm.spooled()
-                && !from.isEmpty()))
+        if (d->alert || (d->soundEveryMessage && !dm.spooled() && !from.isEmpty()))
             account()->playSound(PsiAccount::eGroupChat);
 
-        if (d->alert
-            || (options->getOption("options.ui.notifications.passive-popups.notify-every-muc-message").toBool()
-                && !dm.spooled() && !from.isEmpty())) {
+        if (d->alert || (d->popupEveryMessage && !dm.spooled() && !from.isEmpty())) {
             if (!dm.spooled() && !isActiveTab() && !dm.from().resource().isEmpty()) {
                 XMPP::Jid    jid = dm.from() /*.withDomain("")*/;
                 UserListItem i;
@@ -2292,7 +2312,7 @@ bool GCMainDlg::isLastMessageAlert() const { return d->alert; }
 void GCMainDlg::appendSysMsg(const QString &str, bool alert)
 {
     MessageView mv = MessageView::systemMessage(str);
-    mv.setAlert(alert && PsiOptions::instance()->getOption(QStringLiteral("options.ui.muc.use-highlighting")).toBool());
+    mv.setAlert(alert && d->useHighlighting);
     dispatchMessage(mv);
 }
 
@@ -2334,13 +2354,12 @@ void GCMainDlg::appendMessage(const Message &m, bool alert)
     }
 
     MessageView mv(MessageView::Message);
-    if (dm.containsHTML() && PsiOptions::instance()->getOption("options.html.muc.render").toBool()
-        && !dm.html().text().isEmpty()) {
+    if (dm.containsHTML() && d->renderHtml && !dm.html().text().isEmpty()) {
         mv.setHtml(dm.html().toString("span"));
     } else {
         mv.setPlainText(dm.body());
     }
-    if (!PsiOptions::instance()->getOption("options.ui.muc.use-highlighting").toBool())
+    if (!d->useHighlighting)
         alert = false;
     mv.setMessageId(dm.id());
     mv.setAlert(alert);
@@ -2400,6 +2419,15 @@ QString GCMainDlg::desiredCaption() const
     return cap;
 }
 
+QString GCMainDlg::tabToolTip() const
+{
+#ifdef WEBKIT
+    return ui_.log->hibernationReport();
+#else
+    return QString();
+#endif
+}
+
 void GCMainDlg::setLooks()
 {
     const QString css = PsiOptions::instance()->getOption("options.ui.chat.css").toString();
@@ -75,6 +75,7 @@ public:
     virtual int                   unreadMessageCount() const;
     const QString                &getDisplayName() const;
     virtual QString               desiredCaption() const;
+    virtual QString               tabToolTip() const;
     virtual void                  setVSplitterPosition(int log, int chat);
 
 protected:
@@ -98,6 +99,8 @@ public slots:
     // reimplemented
     virtual void deactivated();
     virtual void activated();
+    virtual bool hibernate();
+    virtual void wakeUp();
     virtual void ensureTabbedCorrectly();
 
     void optionsUpdate();
@@ -0,0 +1,260 @@
+/*
+ * highlightrules.cpp - compiled groupchat highlight rules
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "highlightrules.h"
+
+#include "iris/xmpp_jid.h"
+#include "psioptions.h"
+
+#include <algorithm>
+
+static const QString UseHighlightingOption = QStringLiteral("options.ui.muc.use-highlighting");
+static const QString HighlightWordsOption  = QStringLiteral("options.ui.muc.highlight-words");
+static const int     NickCacheSize         = 64; // rooms with distinct own nicks
+
+HighlightRules *HighlightRules::instance_ = nullptr;
+
+/**
+ * \class HighlightRules
+ * \brief Decides which groupchat messages deserve attention
+ *
+ * Own nick, highlight words from the options and patterns registered by plugins
+ * are compiled into a single regular expression, so a message body is scanned
+ * once no matter how many words and rules there are. The expression is rebuilt
+ * only when the options or the rules change, and kept per own nick since it
+ * differs between rooms.
+ */
+
+HighlightRules *HighlightRules::instance()
+{
+    if (!instance_) {
+        instance_ = new HighlightRules(PsiOptions::instance());
+    }
+    return instance_;
+}
+
+HighlightRules::HighlightRules(QObject *parent) : QObject(parent)
+{
+    cache_.setMaxCost(NickCacheSize);
+
+    auto readOptions = [this]() {
+        auto o = PsiOptions::instance();
+        words_.clear();
+        if (o->getOption(UseHighlightingOption).toBool()) {
+            const auto words = o->getOption(HighlightWordsOption).toStringList();
+            for (auto const &word : words) {
+                if (!word.isEmpty())
+                    words_ << word;
+            }
+        }
+        invalidate();
+    };
+    PsiOptions::instance()->watchOptions({ UseHighlightingOption, HighlightWordsOption }, this,
+                                         [readOptions](const QSet<QString> &) { readOptions(); });
+    readOptions();
+}
+
+/**
+ * Registers \a pattern under \a id, replacing a rule of \a owner with the same id.
+ * If \a alert is true a match alerts the user like a highlight word does.
+ * \a handler is called for every groupchat message the pattern matches.
+ * The rule is removed with \a context.
+ */
+void HighlightRules::addRule(QObject *owner, const QString &id, const QRegularExpression &pattern, bool alert,
+                             QObject *context, const Handler &handler)
+{
+    if (!pattern.isValid()) {
+        qWarning("HighlightRules: invalid pattern \"%s\": %s", qPrintable(pattern.pattern()),
+                 qPrintable(pattern.errorString()));
+        return;
+    }
+    removeRule(owner, id);
+    rules_.append(Rule { owner, id, pattern, alert, context, handler });
+    if (context) {
+        connect(context, &QObject::destroyed, this, [this](QObject *obj) {
+            auto it = std::remove_if(rules_.begin(), rules_.end(), [obj](const Rule &r) { return r.context == obj; });
+            if (it != rules_.end()) {
+                rules_.erase(it, rules_.end());
+                invalidate();
+            }
+        });
+    }
+    invalidate();
+}
+
+void HighlightRules::removeRule(QObject *owner, const QString &id)
+{
+    auto it = std::find_if(rules_.begin(), rules_.end(),
+                           [owner, &id](const Rule &r) { return r.owner == owner && r.id == id; });
+    if (it != rules_.end()) {
+        rules_.erase(it);
+        invalidate();
+    }
+}
+
+void HighlightRules::removeRules(QObject *owner)
+{
+    auto it = std::remove_if(rules_.begin(), rules_.end(), [owner](const Rule &r) { return r.owner == owner; });
+    if (it != rules_.end()) {
+        rules_.erase(it, rules_.end());
+        invalidate();
+    }
+}
+
+void HighlightRules::invalidate() { cache_.clear(); }
+
+// Patterns which can't be put inside a group of a bigger expression as is:
+// numbered back references would point to other groups, a comment could eat the closing parenthesis
+// and \Q would quote it.
+static bool isEmbeddable(const QRegularExpression &pattern)
+{
+    static const QRegularExpression unsafe(QStringLiteral(R"(\\[1-9gQ]|\(\?[+-]?[0-9R])"));
+    return !(pattern.patternOptions() & QRegularExpression::ExtendedPatternSyntaxOption)
+        && !unsafe.match(pattern.pattern()).hasMatch();
+}
+
+static QString inlineOptions(QRegularExpression::PatternOptions options)
+{
+    QString on, off;
+    (options & QRegularExpression::CaseInsensitiveOption ? on : off) += QLatin1Char('i');
+    (options & QRegularExpression::DotMatchesEverythingOption ? on : off) += QLatin1Char('s');
+    (options & QRegularExpression::MultilineOption ? on : off) += QLatin1Char('m');
+    (options & QRegularExpression::InvertedGreedinessOption ? on : off) += QLatin1Char('U');
+    return QLatin1String("(?") + on + (off.isEmpty() ? QString() : QLatin1Char('-') + off) + QLatin1Char(')');
+}
+
+HighlightRules::Compiled *HighlightRules::compiled(const QString &nick)
+{
+    if (auto c = cache_.object(nick)) {
+        return c;
+    }
+
+    auto        c = new Compiled;
+    QStringList alternatives;
+    int         groups = 0;
+    auto const  add    = [&](const QRegularExpression &pattern, bool alert, int rule) {
+        Part part { pattern, -1, alert, rule };
+        if (isEmbeddable(pattern)) {
+            part.group = ++groups;
+            groups += pattern.captureCount();
+            alternatives << QLatin1Char('(') + inlineOptions(pattern.patternOptions()) + pattern.pattern()
+                    + QLatin1Char(')');
+        }
+        c->parts.append(part);
+    };
+
+    if (!nick.isEmpty()) {
+        add(QRegularExpression(QRegularExpression::escape(nick)), true, -1);
+    }
+    if (!words_.isEmpty()) {
+        QStringList escaped;
+        for (auto const &word : std::as_const(words_)) {
+            escaped << QRegularExpression::escape(word);
+        }
+        add(QRegularExpression(escaped.join(QLatin1Char('|')), QRegularExpression::CaseInsensitiveOption), true, -1);
+    }
+    for (int i = 0; i < rules_.size(); i++) {
+        auto const &rule = rules_[i];
+        if (rule.alert || rule.handler) {
+            add(rule.pattern, rule.alert, i);
+        }
+    }
+
+    if (!alternatives.isEmpty()) {
+        c->combined.setPattern(alternatives.join(QLatin1Char('|')));
+        c->combined.optimize();
+        if (!c->combined.isValid()) { // e.g. two rules use the same group name
+            c->combined = QRegularExpression();
+            for (auto &part : c->parts) {
+                part.group = -1;
+            }
+        }
+    }
+    cache_.insert(nick, c);
+    return c;
+}
+
+/**
+ * Matches a groupchat message \a body against all rules, with \a nick being
+ * own nick in the room.
+ */
+HighlightRules::Match HighlightRules::match(const QString &body, const QString &nick)
+{
+    Match ret;
+    if (body.isEmpty()) {
+        return ret;
+    }
+    ret.addressed = !nick.isEmpty() && body.startsWith(nick);
+
+    Compiled      *c = compiled(nick);
+    QVector<bool>  seen(c->parts.size(), false);
+    bool           hit = false;
+    if (!c->combined.pattern().isEmpty()) {
+        auto it = c->combined.globalMatch(body);
+        while (it.hasNext()) {
+            auto m = it.next();
+            hit    = true;
+            for (int i = 0; i < c->parts.size(); i++) {
+                auto const &part = c->parts[i];
+                if (part.group >= 0 && !seen[i] && m.capturedStart(part.group) >= 0) {
+                    seen[i] = true;
+                    ret.alert |= part.alert;
+                }
+            }
+        }
+    }
+
+    // An alternative hides the others overlapping its match, so whatever still matters is
+    // checked separately. That's needed only when something has matched already.
+    for (int i = 0; i < c->parts.size(); i++) {
+        auto const &part = c->parts[i];
+        if (seen[i] || (part.group >= 0 && !hit)) {
+            continue;
+        }
+        if ((part.alert && !ret.alert) || (part.rule >= 0 && rules_[part.rule].handler)) {
+            seen[i] = part.pattern.match(body).hasMatch();
+            ret.alert |= seen[i] && part.alert;
+        }
+    }
+
+    for (int i = 0; i < c->parts.size(); i++) {
+        auto const &part = c->parts[i];
+        if (seen[i] && part.rule >= 0 && rules_[part.rule].handler) {
+            ret.rules << part.rule;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Calls handlers of the rules found by match(). Must be called before the rules change.
+ */
+void HighlightRules::notify(const Match &match, PsiAccount *account, const XMPP::Jid &from,
+                            const QString &body) const
+{
+    QList<Handler> handlers; // a handler may remove rules
+    for (int i : match.rules) {
+        if (i < rules_.size())
+            handlers << rules_[i].handler;
+    }
+    for (auto const &handler : std::as_const(handlers)) {
+        if (handler)
+            handler(account, from, body);
+    }
+}
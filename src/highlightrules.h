@@ -0,0 +1,93 @@
+/*
+ * highlightrules.h - compiled groupchat highlight rules
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HIGHLIGHTRULES_H
+#define HIGHLIGHTRULES_H
+
+#include <QCache>
+#include <QList>
+#include <QObject>
+#include <QRegularExpression>
+#include <QVector>
+
+#include <functional>
+
+class PsiAccount;
+
+namespace XMPP {
+class Jid;
+}
+
+class HighlightRules : public QObject {
+    Q_OBJECT
+public:
+    using Handler = std::function<void(PsiAccount *account, const XMPP::Jid &from, const QString &body)>;
+
+    struct Match {
+        bool       alert     = false; // own nick, a highlight word or an alerting rule
+        bool       addressed = false; // the message starts with own nick
+        QList<int> rules;             // indexes of matched rules with handlers
+    };
+
+    static HighlightRules *instance();
+
+    void addRule(QObject *owner, const QString &id, const QRegularExpression &pattern, bool alert,
+                 QObject *context = nullptr, const Handler &handler = Handler());
+    void removeRule(QObject *owner, const QString &id);
+    void removeRules(QObject *owner);
+
+    Match match(const QString &body, const QString &nick);
+    void  notify(const Match &match, PsiAccount *account, const XMPP::Jid &from, const QString &body) const;
+
+private:
+    explicit HighlightRules(QObject *parent = nullptr);
+
+    struct Rule {
+        QObject           *owner;
+        QString            id;
+        QRegularExpression pattern;
+        bool               alert;
+        QObject           *context;
+        Handler            handler;
+    };
+
+    // one alternative of the combined expression
+    struct Part {
+        QRegularExpression pattern; // for the second pass
+        int                group; // capture group in the combined expression, -1 if matched separately
+        bool               alert;
+        int                rule; // index in rules_ or -1
+    };
+
+    struct Compiled {
+        QRegularExpression combined;
+        QVector<Part>      parts;
+    };
+
+    Compiled *compiled(const QString &nick);
+    void      invalidate();
+
+    QList<Rule>               rules_;
+    QStringList               words_;
+    QCache<QString, Compiled> cache_; // by own nick, which differs between rooms
+
+    static HighlightRules *instance_;
+};
+
+#endif // HIGHLIGHTRULES_H
@@ -65,6 +65,32 @@ std::tuple<ParseResult, quint64, quint64> parseRangeHeader(const QByteArray &ran
     return { Parsed, start, end ? (*end - start + 1) : 0 };
 }
 
+std::tuple<ParseResult, QList<std::pair<quint64, quint64>>> parseMultiRangeHeader(const QByteArray      &rangesBa,
+                                                                                 std::optional<quint64> fileSize)
+{
+    if (!rangesBa.startsWith("bytes=")) {
+        return { NotImplementedRangeType, {} };
+    }
+
+    QList<std::pair<quint64, quint64>> ranges;
+    bool                               outOfRange = false;
+    for (auto const &piece : rangesBa.mid(sizeof("bytes")).split(',')) {
+        auto const [result, start, size] = parseRangeHeader(QByteArray("bytes=") + piece.trimmed(), fileSize);
+        if (result == OutOfRange) {
+            outOfRange = true;
+            continue;
+        }
+        if (result != Parsed) {
+            return { result, {} };
+        }
+        ranges.append({ start, size });
+    }
+    if (ranges.isEmpty()) {
+        return { outOfRange ? OutOfRange : Unparsed, {} };
+    }
+    return { Parsed, ranges };
+}
+
 std::optional<std::tuple<quint64, quint64, std::optional<quint64>>> parseContentRangeHeader(const QByteArray &value)
 {
     auto arr = value.split(' ');
@@ -18,6 +18,7 @@
  */
 
 #include <QByteArray>
+#include <QList>
 
 #include <optional>
 #include <tuple>
@@ -44,6 +45,17 @@ enum ParseResult {
 std::tuple<ParseResult, quint64, quint64> parseRangeHeader(const QByteArray      &value,
                                                            std::optional<quint64> fileSize = -1);
 
+/**
+ * @brief parseMultiRangeHeader parses http bytes "Range" header with one or more ranges
+ * @param value    - heder value
+ * @param fileSize - if destination file size is known it will be checked
+ * @return (result, list of (start, size)). size is 0 when the range lasts till the end of file
+ *
+ * Ranges starting beyond the end of file are skipped. OutOfRange is returned only if nothing is left.
+ */
+std::tuple<ParseResult, QList<std::pair<quint64, quint64>>> parseMultiRangeHeader(const QByteArray      &value,
+                                                                                 std::optional<quint64> fileSize = -1);
+
 std::optional<std::tuple<quint64, quint64, std::optional<quint64>>> parseContentRangeHeader(const QByteArray &value);
 
 }
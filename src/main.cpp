@@ -96,6 +96,8 @@ PsiMain::PsiMain(const QHash<QString, QString> &commandline, QObject *par) : QOb
     lastProfile = s.value("last_profile", lastProfile).toString();
     lastLang    = s.value("last_lang", lastLang).toString();
     autoOpen    = s.value("auto_open", autoOpen).toBool();
+
+    Iconset::setDecodedCacheDir(ApplicationInfo::makeSubhomePath("iconsets", ApplicationInfo::CacheLocation));
 }
 
 PsiMain::~PsiMain() { delete pcon; }
@@ -10,6 +10,7 @@
 #include "textutil.h"
 #include "ui_opt_plugins.h"
 
+#include <QAction>
 #include <QHeaderView>
 #include <QSignalMapper>
 #include <QToolButton>
@@ -84,6 +85,14 @@ QWidget *OptionsTabPlugins::widget()
     listPlugins();
     connect(d->tw_Plugins, &QTreeWidget::itemChanged, this, &OptionsTabPlugins::itemChanged);
 
+    auto resetFilterTime = new QAction(tr("Reset Filter Time"), d->tw_Plugins);
+    d->tw_Plugins->addAction(resetFilterTime);
+    d->tw_Plugins->setContextMenuPolicy(Qt::ActionsContextMenu);
+    connect(resetFilterTime, &QAction::triggered, this, [this]() {
+        PluginManager::instance()->resetFilterStats();
+        listPlugins();
+    });
+
     return w;
 }
 
@@ -125,6 +134,15 @@ void OptionsTabPlugins::listPlugins()
         item->setText(C_NAME, truncatedPluginName);
         item->setText(C_VERSION, pm->version(shortName));
         item->setTextAlignment(C_VERSION, Qt::AlignHCenter);
+        const quint64 calls = pm->filterCalls(shortName);
+        if (calls) {
+            const qint64 nsecs = pm->filterTime(shortName);
+            item->setText(C_FILTERTIME, tr("%1 ms").arg(double(nsecs) / 1e6, 0, 'f', 1));
+            item->setToolTip(C_FILTERTIME, tr("%1 stanzas, %2 \u00B5s per stanza")
+                                               .arg(calls)
+                                               .arg(double(nsecs) / calls / 1e3, 0, 'f', 1));
+        }
+        item->setTextAlignment(C_FILTERTIME, Qt::AlignRight | Qt::AlignVCenter);
         item->setToolTip(C_NAME, toolTip);
         item->setCheckState(C_NAME, state);
         if (!enabled && !icon.isNull()) {
@@ -154,6 +172,7 @@ void OptionsTabPlugins::listPlugins()
         d->tw_Plugins->sortItems(C_NAME, Qt::AscendingOrder);
         d->tw_Plugins->header()->setSectionResizeMode(C_NAME, QHeaderView::Stretch);
         d->tw_Plugins->resizeColumnToContents(C_VERSION);
+        d->tw_Plugins->resizeColumnToContents(C_FILTERTIME);
         d->tw_Plugins->resizeColumnToContents(C_ABOUT);
         d->tw_Plugins->resizeColumnToContents(C_SETTS);
     }
@@ -21,6 +21,8 @@
 #include "globalshortcut/globalshortcutmanager.h"
 #include "grepshortcutkeydialog.h"
 #include "groupchatdlg.h"
+#include "highlightruleaccessor.h"
+#include "highlightrules.h"
 #include "iconfactoryaccessor.h"
 #include "iqfilter.h"
 #include "iqnamespacefilter.h"
@@ -53,6 +55,7 @@
 #include <QAction>
 #include <QByteArray>
 #include <QDomElement>
+#include <QElapsedTimer>
 #include <QKeySequence>
 #include <QObject>
 #include <QPluginLoader>
@@ -277,8 +280,10 @@ bool PluginHost::load()
             // Check it's the right sort of plugin
             PsiPlugin *psiPlugin = qobject_cast<PsiPlugin *>(plugin);
             if (psiPlugin) {
-                plugin_ = plugin;
-                valid_  = true;
+                plugin_       = plugin;
+                valid_        = true;
+                stanzaFilter_ = qobject_cast<StanzaFilter *>(plugin_);
+                manager_->invalidateXmlDispatch();
                 // loaded_ = true;
                 // enabled_ = false;
                 name_ = psiPlugin->name();
@@ -333,8 +338,10 @@ bool PluginHost::unload()
             iconset_.clear();
             connected_ = false;
             delete loader_;
-            plugin_ = nullptr;
-            loader_ = nullptr;
+            plugin_       = nullptr;
+            loader_       = nullptr;
+            stanzaFilter_ = nullptr;
+            manager_->invalidateXmlDispatch();
 #ifndef PLUGINS_NO_DEBUG
             qDebug("Plugin unloaded: %s", qPrintable(name_));
 #endif
@@ -510,6 +517,10 @@ bool PluginHost::enable()
             if (pma) {
                 pma->setPsiMediaHost(this);
             }
+            auto hra = qobject_cast<HighlightRuleAccessor *>(plugin_);
+            if (hra) {
+                hra->setHighlightRuleAccessingHost(this);
+            }
 
             connected_ = true;
         }
@@ -539,6 +550,7 @@ bool PluginHost::disable()
         enabled_ = !qobject_cast<PsiPlugin *>(plugin_)->disable();
         if (!enabled_) {
             delete enableHandler;
+            HighlightRules::instance()->removeRules(this);
             emit disabled();
         }
     }
@@ -562,79 +574,114 @@ bool PluginHost::isEnabled() const { return enabled_; }
  *
  * \param account Identifier of the PsiAccount responsible
  * \param xml Incoming XML (may be modified)
+ * \param iqNs Namespace of the iq payload, resolved once by PluginManager
+ * \param iqHandler IqNamespaceFilter method matching iq type or nullptr if it's not an iq
  * \return Continue processing the XML stanza; true if the stanza should be silently discarded.
  */
-bool PluginHost::incomingXml(int account, const QDomElement &e)
+bool PluginHost::incomingXml(int account, const QDomElement &e, const QString &iqNs, IqHandler iqHandler)
 {
+    if (!plugin_) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
     bool handled = false;
 
     // try stanza filter first
-    StanzaFilter *sf = qobject_cast<StanzaFilter *>(plugin_);
-    if (sf && sf->incomingStanza(account, e)) {
+    if (stanzaFilter_ && stanzaFilter_->incomingStanza(account, e)) {
         handled = true;
     }
     // try iq filters
-    else if (e.tagName() == "iq") {
-        // get iq namespace
-        QString ns;
-        for (QDomNode n = e.firstChild(); !n.isNull(); n = n.nextSibling()) {
-            QDomElement i = n.toElement();
-            if (!i.isNull() && !i.namespaceURI().isNull()) {
-                ns = i.namespaceURI();
+    else if (iqHandler) {
+        // normal filters
+        for (auto it = iqNsFilters_.constFind(iqNs); it != iqNsFilters_.constEnd() && it.key() == iqNs; ++it) {
+            if ((it.value()->*iqHandler)(account, e)) {
+                handled = true;
                 break;
             }
         }
 
-        // choose handler function depending on iq type
-        bool (IqNamespaceFilter::*handler)(int account, const QDomElement &xml) = nullptr;
-        const QString type                                                      = e.attribute("type");
-        if (type == "get") {
-            handler = &IqNamespaceFilter::iqGet;
-        } else if (type == "set") {
-            handler = &IqNamespaceFilter::iqSet;
-        } else if (type == "result") {
-            handler = &IqNamespaceFilter::iqResult;
-        } else if (type == "error") {
-            handler = &IqNamespaceFilter::iqError;
-        }
-
-        if (handler) {
-            // normal filters
-            const auto &items = iqNsFilters_.values(ns);
-            for (IqNamespaceFilter *f : items) {
-                if ((f->*handler)(account, e)) {
-                    handled = true;
-                    break;
-                }
-            }
-
-            // regex filters
+        // regex filters
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-            QMapIterator<QRegularExpression, IqNamespaceFilter *> i(iqNsxFilters_);
+        QMapIterator<QRegularExpression, IqNamespaceFilter *> i(iqNsxFilters_);
 #else
-            QMultiMapIterator<QRegularExpression, IqNamespaceFilter *> i(iqNsxFilters_);
+        QMultiMapIterator<QRegularExpression, IqNamespaceFilter *> i(iqNsxFilters_);
 #endif
-            while (!handled && i.hasNext()) {
-                if (i.key().match(ns).hasMatch() && (i.value()->*handler)(account, e)) {
-                    handled = true;
-                }
+        while (!handled && i.hasNext()) {
+            i.next();
+            if (i.key().match(iqNs).hasMatch() && (i.value()->*iqHandler)(account, e)) {
+                handled = true;
             }
         }
     }
 
+    ++filterCalls_;
+    filterTime_ += timer.nsecsElapsed();
     return handled;
 }
 
+/**
+ * \brief Give plugin the opportunity to process outgoing xml.
+ *
+ * If plugin implements StanzaFilter interface,
+ * this will call its outgoingStanza() handler.
+ * Handler may then modify the stanza and may cause the stanza to be
+ * silently discarded.
+ *
+ * \param account Identifier of the PsiAccount responsible
+ * \param xml Outgoing XML (may be modified)
+ * \return Continue processing the XML stanza; true if the stanza should be silently discarded.
+ */
 bool PluginHost::outgoingXml(int account, QDomElement &e)
 {
-    bool          handled = false;
-    StanzaFilter *ef      = qobject_cast<StanzaFilter *>(plugin_);
-    if (ef && ef->outgoingStanza(account, e)) {
-        handled = true;
+    if (!stanzaFilter_) {
+        return false;
     }
+
+    QElapsedTimer timer;
+    timer.start();
+    bool handled = stanzaFilter_->outgoingStanza(account, e);
+    ++filterCalls_;
+    filterTime_ += timer.nsecsElapsed();
     return handled;
 }
 
+/**
+ * \brief Returns true if the loaded plugin implements StanzaFilter.
+ */
+bool PluginHost::hasStanzaFilter() const { return stanzaFilter_ != nullptr; }
+
+/**
+ * \brief Returns true if plugin registered any regular expression iq filter.
+ * Such plugins have to be offered iqs of every namespace.
+ */
+bool PluginHost::hasIqRegexFilters() const { return !iqNsxFilters_.isEmpty(); }
+
+/**
+ * \brief Returns the namespaces plugin registered plain iq filters for.
+ */
+QStringList PluginHost::iqNamespaces() const { return iqNsFilters_.uniqueKeys(); }
+
+/**
+ * \brief Returns how many stanzas were offered to plugin's filters.
+ */
+quint64 PluginHost::filterCalls() const { return filterCalls_; }
+
+/**
+ * \brief Returns total time in nanoseconds plugin's filters took to process stanzas.
+ */
+qint64 PluginHost::filterTime() const { return filterTime_; }
+
+/**
+ * \brief Starts counting filter calls and time from zero.
+ */
+void PluginHost::resetFilterStats()
+{
+    filterCalls_ = 0;
+    filterTime_  = 0;
+}
+
 //-- for EventFilter ------------------------------------------------
 
 /**
@@ -792,6 +839,7 @@ void PluginHost::addIqNamespaceFilter(const QString &ns, IqNamespaceFilter *filt
 #endif
     } else {
         iqNsFilters_.insert(ns, filter);
+        manager_->invalidateXmlDispatch();
     }
 }
 
@@ -823,6 +871,7 @@ void PluginHost::addIqNamespaceFilter(const QRegularExpression &ns, IqNamespaceF
 #endif
     } else {
         iqNsxFilters_.insert(ns, filter);
+        manager_->invalidateXmlDispatch();
     }
 }
 
@@ -834,7 +883,9 @@ void PluginHost::addIqNamespaceFilter(const QRegularExpression &ns, IqNamespaceF
  */
 void PluginHost::removeIqNamespaceFilter(const QString &ns, IqNamespaceFilter *filter)
 {
-    iqNsFilters_.remove(ns, filter);
+    if (iqNsFilters_.remove(ns, filter)) {
+        manager_->invalidateXmlDispatch();
+    }
 }
 
 /**
@@ -845,7 +896,9 @@ void PluginHost::removeIqNamespaceFilter(const QString &ns, IqNamespaceFilter *f
  */
 void PluginHost::removeIqNamespaceFilter(const QRegularExpression &ns, IqNamespaceFilter *filter)
 {
-    iqNsxFilters_.remove(ns, filter);
+    if (iqNsxFilters_.remove(ns, filter)) {
+        manager_->invalidateXmlDispatch();
+    }
 }
 
 //-- OptionAccessor -------------------------------------------------
@@ -1426,6 +1479,29 @@ void PluginHost::setMediaProvider(PsiMedia::Provider *provider)
     MediaDeviceWatcher::instance()->setup();
 }
 
+//-- HighlightRuleAccessor ------------------------------------------
+
+/**
+ * \brief Adds a pattern to the groupchat highlight rules.
+ *
+ * The pattern is compiled together with own nick, highlight words and rules of
+ * other plugins, so adding a rule costs little per message. Rules of the plugin
+ * are removed when it's disabled.
+ */
+void PluginHost::addHighlightRule(const QString &id, const QRegularExpression &pattern, bool alert,
+                                  QObject *context, Handler handler)
+{
+    HighlightRules::Handler h;
+    if (handler) {
+        h = [this, handler](PsiAccount *account, const XMPP::Jid &from, const QString &body) {
+            handler(manager_->accountIds_.id(account), from.bare(), from.resource(), body);
+        };
+    }
+    HighlightRules::instance()->addRule(this, id, pattern, alert, context, h);
+}
+
+void PluginHost::removeHighlightRule(const QString &id) { HighlightRules::instance()->removeRule(this, id); }
+
 //-- helpers --------------------------------------------------------
 
 static bool operator<(const QRegularExpression &a, const QRegularExpression &b) { return a.pattern() < b.pattern(); }
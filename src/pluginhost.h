@@ -14,9 +14,11 @@
 #include "contactstateaccessinghost.h"
 #include "encryptionsupport.h"
 #include "eventcreatinghost.h"
+#include "highlightruleaccessinghost.h"
 #include "iconfactoryaccessinghost.h"
 #include "iconset.h"
 #include "iqfilteringhost.h"
+#include "iqnamespacefilter.h"
 #include "optionaccessinghost.h"
 #include "pluginaccessinghost.h"
 #include "popupaccessinghost.h"
@@ -37,8 +39,8 @@
 #include <QTextEdit>
 #include <QVariant>
 
-class IqNamespaceFilter;
 class PluginManager;
+class StanzaFilter;
 class QPluginLoader;
 class QWidget;
 namespace PsiMedia {
@@ -63,12 +65,14 @@ class PluginHost : public QObject,
                    public EncryptionSupport,
                    public PluginAccessingHost,
                    public WebkitAccessingHost,
-                   public PsiMediaHost {
+                   public PsiMediaHost,
+                   public HighlightRuleAccessingHost {
     Q_OBJECT
     Q_INTERFACES(StanzaSendingHost IqFilteringHost OptionAccessingHost ShortcutAccessingHost IconFactoryAccessingHost
                      ActiveTabAccessingHost ApplicationInfoAccessingHost AccountInfoAccessingHost PopupAccessingHost
                          ContactStateAccessingHost PsiAccountControllingHost EventCreatingHost ContactInfoAccessingHost
-                             SoundAccessingHost EncryptionSupport PluginAccessingHost WebkitAccessingHost PsiMediaHost)
+                             SoundAccessingHost EncryptionSupport PluginAccessingHost WebkitAccessingHost PsiMediaHost
+                                 HighlightRuleAccessingHost)
 
 public:
     PluginHost(PluginManager *manager, const QString &pluginFile);
@@ -104,9 +108,20 @@ public:
     bool isEnabled() const;
 
     // for StanzaFilter and IqNamespaceFilter
-    bool incomingXml(int account, const QDomElement &e);
+    using IqHandler = bool (IqNamespaceFilter::*)(int account, const QDomElement &xml);
+    bool incomingXml(int account, const QDomElement &e, const QString &iqNs, IqHandler iqHandler);
     bool outgoingXml(int account, QDomElement &e);
 
+    // used by PluginManager to build its stanza dispatch table
+    bool        hasStanzaFilter() const;
+    bool        hasIqRegexFilters() const;
+    QStringList iqNamespaces() const;
+
+    // time spent in stanza and iq filters of this plugin
+    quint64 filterCalls() const;
+    qint64  filterTime() const; // nanoseconds
+    void    resetFilterStats();
+
     // for EventFilter
     bool processEvent(int account, QDomElement &e);
     bool processMessage(int account, const QString &jidFrom, const QString &body, const QString &subject);
@@ -271,6 +286,11 @@ public:
     void selectMediaDevices(const QString &audioInput, const QString &audioOutput, const QString &videoInput) override;
     void setMediaProvider(PsiMedia::Provider *provider) override;
 
+    // HighlightRuleAccessingHost
+    void addHighlightRule(const QString &id, const QRegularExpression &pattern, bool alert, QObject *context = nullptr,
+                          Handler handler = Handler()) override;
+    void removeHighlightRule(const QString &id) override;
+
 private:
     bool loadPlugin(QObject *pluginObject);
 
@@ -302,6 +322,10 @@ private:
     bool    hasInfo_   = false;
     QString infoString_;
 
+    StanzaFilter *stanzaFilter_ = nullptr;
+    quint64       filterCalls_  = 0;
+    qint64        filterTime_   = 0;
+
     QMultiMap<QString, IqNamespaceFilter *>            iqNsFilters_;
     QMultiMap<QRegularExpression, IqNamespaceFilter *> iqNsxFilters_;
     QList<QVariantHash>                                buttons_;
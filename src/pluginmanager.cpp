@@ -528,14 +528,84 @@ QList<OAH_PluginOptionsTab *> PluginManager::settingsPages() const { return sett
  */
 bool PluginManager::incomingXml(int account, const QDomElement &xml)
 {
-    bool handled = false;
+    if (!xmlDispatch_.valid) {
+        buildXmlDispatch();
+    }
+
+    QList<PluginHost *>   hosts = xmlDispatch_.stanza; // copy, a filter may (un)register filters
+    QString               ns;
+    PluginHost::IqHandler handler = nullptr;
+    if (xml.tagName() == QLatin1String("iq")) {
+        // get iq namespace
+        for (QDomNode n = xml.firstChild(); !n.isNull(); n = n.nextSibling()) {
+            QDomElement i = n.toElement();
+            if (!i.isNull() && !i.namespaceURI().isNull()) {
+                ns = i.namespaceURI();
+                break;
+            }
+        }
+
+        // choose handler function depending on iq type
+        const QString type = xml.attribute("type");
+        if (type == QLatin1String("get")) {
+            handler = &IqNamespaceFilter::iqGet;
+        } else if (type == QLatin1String("set")) {
+            handler = &IqNamespaceFilter::iqSet;
+        } else if (type == QLatin1String("result")) {
+            handler = &IqNamespaceFilter::iqResult;
+        } else if (type == QLatin1String("error")) {
+            handler = &IqNamespaceFilter::iqError;
+        }
+
+        hosts = xmlDispatch_.iqByNs.value(ns, xmlDispatch_.iq);
+    }
+
+    for (PluginHost *host : std::as_const(hosts)) {
+        if (host->incomingXml(account, xml, ns, handler)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Marks stanza dispatch table outdated. Called by PluginHost when plugin
+ * gets (un)loaded or changes its iq filters.
+ */
+void PluginManager::invalidateXmlDispatch() { xmlDispatch_.valid = false; }
+
+void PluginManager::buildXmlDispatch()
+{
+    xmlDispatch_ = XmlDispatch();
+
+    QList<std::pair<PluginHost *, QStringList>> loaded;
+    QSet<QString>                               namespaces;
     for (PluginHost *host : std::as_const(pluginsByPriority_)) {
-        if (host->incomingXml(account, xml)) {
-            handled = true;
-            break;
+        if (!host->isLoaded()) {
+            continue;
+        }
+        QStringList hostNs = host->iqNamespaces();
+        loaded.append({ host, hostNs });
+        for (const QString &ns : std::as_const(hostNs)) {
+            namespaces.insert(ns);
+        }
+        if (host->hasStanzaFilter()) {
+            xmlDispatch_.stanza.append(host);
+        }
+        if (host->hasStanzaFilter() || host->hasIqRegexFilters()) {
+            xmlDispatch_.iq.append(host);
         }
     }
-    return handled;
+
+    for (const QString &ns : std::as_const(namespaces)) {
+        QList<PluginHost *> &hosts = xmlDispatch_.iqByNs[ns];
+        for (const auto &[host, hostNs] : std::as_const(loaded)) {
+            if (host->hasStanzaFilter() || host->hasIqRegexFilters() || hostNs.contains(ns)) {
+                hosts.append(host);
+            }
+        }
+    }
+    xmlDispatch_.valid = true;
 }
 
 /**
@@ -866,6 +936,33 @@ QString PluginManager::pluginInfo(const QString &plugin) const
     return info;
 }
 
+/**
+ * Returns how many stanzas were offered to plugin's stanza and iq filters.
+ */
+quint64 PluginManager::filterCalls(const QString &plugin) const
+{
+    auto it = hosts_.find(plugin);
+    return it == hosts_.end() ? 0 : it.value()->filterCalls();
+}
+
+/**
+ * Returns time in nanoseconds spent in plugin's stanza and iq filters.
+ */
+qint64 PluginManager::filterTime(const QString &plugin) const
+{
+    auto it = hosts_.find(plugin);
+    return it == hosts_.end() ? 0 : it.value()->filterTime();
+}
+
+/**
+ * Starts counting filter calls and time of all plugins from zero.
+ */
+void PluginManager::resetFilterStats()
+{
+    for (PluginHost *host : std::as_const(hosts_))
+        host->resetFilterStats();
+}
+
 QIcon PluginManager::icon(const QString &plugin) const
 {
     QIcon icon;
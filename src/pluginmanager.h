@@ -106,6 +106,9 @@ public:
 
     QString     pluginInfo(const QString &plugin) const;
     bool        hasInfoProvider(const QString &plugin) const;
+    quint64     filterCalls(const QString &plugin) const;
+    qint64      filterTime(const QString &plugin) const;
+    void        resetFilterStats();
     QIcon       icon(const QString &plugin) const;
     QStringList pluginFeatures() const;
 
@@ -149,6 +152,17 @@ private:
     // sorted by priority
     QList<PluginHost *> pluginsByPriority_;
 
+    // loaded plugins to offer incoming stanzas to, sorted by priority.
+    // rebuilt on first stanza after a plugin was (un)loaded or changed its iq filters
+    struct XmlDispatch {
+        bool                                valid = false;
+        QList<PluginHost *>                 stanza; // message and presence: StanzaFilter only
+        QList<PluginHost *>                 iq;     // iq of unknown namespace: StanzaFilter or regex iq filters
+        QHash<QString, QList<PluginHost *>> iqByNs; // the same plus plain iq filters of the namespace
+    } xmlDispatch_;
+    void invalidateXmlDispatch();
+    void buildXmlDispatch();
+
     QList<QCA::DirWatch *> dirWatchers_;
 
     // Options widget provides by plugin on opt_plugins
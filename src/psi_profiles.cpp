@@ -164,6 +164,10 @@ void UserAccount::fromOptions(OptionsTree *o, QString base)
     // read scram salted password options
     storeSaltedHashedPassword = o->getOption(base + ".scram.store-salted-password").toBool();
     scramSaltedHashPassword   = o->getOption(base + ".scram.salted-password").toString();
+    // the salt and iteration count are kept apart, so older versions can still use the key
+    QString scramParams = o->getOption(base + ".scram.salted-password-params", QString()).toString();
+    if (!scramParams.isEmpty() && !scramSaltedHashPassword.isEmpty() && !scramSaltedHashPassword.contains(':'))
+        scramSaltedHashPassword = scramParams + ':' + scramSaltedHashPassword;
 
     // read password (we must do this after reading the jid, to decode properly)
     QString tmp = o->getOption(base + ".password", QString()).toString();
@@ -312,7 +316,10 @@ void UserAccount::toOptions(OptionsTree *o, QString base)
     o->setOption(base + ".custom-auth.realm", realm);
 
     o->setOption(base + ".scram.store-salted-password", storeSaltedHashedPassword);
-    o->setOption(base + ".scram.salted-password", scramSaltedHashPassword);
+    // "i:salt:key" is split into the plain key and "i:salt"
+    int scramKeyPos = scramSaltedHashPassword.lastIndexOf(':');
+    o->setOption(base + ".scram.salted-password", scramSaltedHashPassword.mid(scramKeyPos + 1));
+    o->setOption(base + ".scram.salted-password-params", scramSaltedHashPassword.left(qMax(0, scramKeyPos)));
 
 #ifdef HAVE_KEYCHAIN
     if (!isKeychainEnabled()) {
@@ -366,15 +373,9 @@ void UserAccount::toOptions(OptionsTree *o, QString base)
         qFatal("unknown allow_plain enum value in UserAccount::toOptions");
     }
 
-    int idx = 0;
-    for (const RosterItem &ri : std::as_const(roster)) {
-        QString rbase = base + ".roster-cache.a" + QString::number(idx++);
-        o->setOption(rbase + ".jid", ri.jid().full());
-        o->setOption(rbase + ".name", ri.name());
-        o->setOption(rbase + ".subscription", ri.subscription().toString());
-        o->setOption(rbase + ".ask", ri.ask());
-        o->setOption(rbase + ".groups", ri.groups());
-    }
+    // the roster is cached in a per-account snapshot file now (see RosterSnapshot).
+    // roster-cache is only read to migrate older profiles
+    o->removeOption(base + ".roster-cache", true);
 
     // now we check for redundant entries
     QStringList   groupList;
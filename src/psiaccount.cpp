@@ -97,12 +97,14 @@
 #include "iris/xmpp_captcha.h"
 #include "iris/xmpp_carbons.h"
 #include "iris/xmpp_forwarding.h"
+#include "iris/xmpp_mammanager.h"
 #include "iris/xmpp_serverinfomanager.h"
 #include "iris/xmpp_tasks.h"
 #include "iris/xmpp_xmlcommon.h"
 #include "rc.h"
 #include "registrationdlg.h"
 #include "rosteritemexchangetask.h"
+#include "rostersnapshot.h"
 #include "searchdlg.h"
 #include "statusdlg.h"
 #include "systeminfo.h"
@@ -116,6 +118,7 @@
 #include "voicecalldlg.h"
 #include "voicecaller.h"
 #include "xmlconsole.h"
+#include "xmltracebuffer.h"
 #ifdef FILETRANSFER
 #include "filetransdlg.h"
 #include "iris/filetransfer.h"
@@ -137,6 +140,7 @@
 #endif
 
 #include <QApplication>
+#include <QDataStream>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFrame>
@@ -153,8 +157,10 @@
 #include <QPointer>
 #include <QPushButton>
 #include <QQueue>
+#include <QSaveFile>
 #include <QTimer>
 #include <QUrl>
+#include <QUuid>
 #include <QtCrypto>
 #include <qca.h>
 #ifdef HAVE_KEYCHAIN
@@ -338,6 +344,13 @@ struct ReconnectData {
 };
 
 static const int RECONNECT_TIMEOUT_ERROR = -10;
+static const int XmlTraceSize            = 1024 * 1024; // bytes of raw stream data kept for the XML console
+static const int XmlTraceCompactSize     = 16 * 1024;
+
+static const quint32 UnackedMagic   = 0x50534d51; // "PSMQ", file of unacknowledged messages
+static const quint32 UnackedVersion = 1;
+static const quint32 MAMMagic       = 0x50534d43; // "PSMC", file of MAM sync cursors
+static const quint32 MAMVersion     = 1;
 
 static QList<ReconnectData> reconnectData()
 {
@@ -363,7 +376,7 @@ static QList<ReconnectData> reconnectData()
 class PsiAccount::Private : public Alertable {
     Q_OBJECT
 public:
-    Private(PsiAccount *parent) : Alertable(parent), account(parent), xmlRingbuf(1000)
+    Private(PsiAccount *parent) : Alertable(parent), account(parent), xmlTrace(XmlTraceSize)
     {
         reconnectTimeoutTimer_ = new QTimer(this);
         reconnectTimeoutTimer_->setSingleShot(true);
@@ -374,6 +387,21 @@ public:
         updateOnlineContactsCountTimer_->setSingleShot(true);
         connect(updateOnlineContactsCountTimer_, &QTimer::timeout, this, &Private::updateOnlineContactsCountTimeout);
 
+        rosterSnapshotTimer = new QTimer(this);
+        rosterSnapshotTimer->setInterval(5000);
+        rosterSnapshotTimer->setSingleShot(true);
+        connect(rosterSnapshotTimer, &QTimer::timeout, this, &Private::saveRosterSnapshot);
+
+        unackedTimer = new QTimer(this);
+        unackedTimer->setInterval(1000);
+        unackedTimer->setSingleShot(true);
+        connect(unackedTimer, &QTimer::timeout, this, &Private::saveUnackedMessages);
+
+        mamCursorsTimer = new QTimer(this);
+        mamCursorsTimer->setInterval(5000);
+        mamCursorsTimer->setSingleShot(true);
+        connect(mamCursorsTimer, &QTimer::timeout, this, &Private::saveMAMCursors);
+
         logoutTimer = new QTimer(this);
         logoutTimer->setInterval(1000);
         logoutTimer->setSingleShot(true);
@@ -413,6 +441,9 @@ public:
     int                      currentConnectionErrorCondition = -1;
     QTimer                  *updateOnlineContactsCountTimer_ = nullptr;
     QTimer                  *logoutTimer                     = nullptr;
+    QTimer                  *rosterSnapshotTimer             = nullptr;
+    QTimer                  *unackedTimer                    = nullptr;
+    QTimer                  *mamCursorsTimer                 = nullptr;
 
     // Tune
     Tune lastTune;
@@ -449,6 +480,11 @@ public:
     // PubSub
     PEPManager *pepManager = nullptr;
 
+    // XEP-0313 catch-up of the history. cursors are by bare contact jid and kept per account
+    MAMManager             *mamManager = nullptr;
+    QHash<QString, QString> mamCursors;
+    QSet<QString>           mamBaselines; // first sync of these, what it fetches is in the history already
+
     // Bookmarks
     BookmarkManager *bookmarkManager = nullptr;
 
@@ -464,10 +500,13 @@ public:
     QPointer<ClientStream>      stream;
     QPointer<QCA::TLS>          tls;
     QPointer<QCATLSHandler>     tlsHandler;
-    bool                        usingSSL = false;
+    bool                        usingSSL     = false;
+    bool                        clientActive = true; // XEP-0352 state
+    FastToken                   fastToken;           // XEP-0484, kept in memory only
+    ClientStream::CSIStats      lastCSIStats;        // XEP-0352, of the last closed session
+    QList<QByteArray>           unackedMessages;     // XEP-0198, sent again with the next stream
 
-    QVector<xmlRingElem> xmlRingbuf;
-    int                  xmlRingbufWrite = 0;
+    XmlTraceBuffer xmlTrace;
 
     QHostAddress localAddress;
 
@@ -585,6 +624,196 @@ public:
             + JIDUtil::encode(acc.id).toLower() + ".xml";
     }
 
+    static QString pathToProfileRoster(const QString &accountId)
+    {
+        return pathToProfile(activeProfile, ApplicationInfo::CacheLocation) + "/roster-"
+            + JIDUtil::encode(accountId).toLower() + ".dat";
+    }
+
+    static QString pathToProfileUnacked(const QString &accountId)
+    {
+        return pathToProfile(activeProfile, ApplicationInfo::DataLocation) + "/unacked-"
+            + JIDUtil::encode(accountId).toLower() + ".dat";
+    }
+
+    static QString pathToProfileMAMCursors(const QString &accountId)
+    {
+        return pathToProfile(activeProfile, ApplicationInfo::DataLocation) + "/mam-"
+            + JIDUtil::encode(accountId).toLower() + ".dat";
+    }
+
+    void scheduleRosterSnapshot() { rosterSnapshotTimer->start(); }
+
+    // not restarted by every stanza, or it would never fire on a busy stream
+    void scheduleUnackedMessages()
+    {
+        if (!unackedTimer->isActive())
+            unackedTimer->start();
+    }
+
+    void saveUnackedMessages()
+    {
+        unackedTimer->stop();
+        if (stream)
+            unackedMessages = stream->unacknowledgedMessages();
+
+        const QString fileName = pathToProfileUnacked(acc.id);
+        if (unackedMessages.isEmpty()
+            || !PsiOptions::instance()->getOption("options.stream-management.keep-on-disk").toBool()) {
+            QFile::remove(fileName);
+            return;
+        }
+        QSaveFile f(fileName);
+        if (!f.open(QIODevice::WriteOnly)) {
+            qWarning("Failed to save unacknowledged messages for %s", qPrintable(acc.jid));
+            return;
+        }
+        QDataStream out(&f);
+        out.setVersion(QDataStream::Qt_5_9);
+        out << UnackedMagic << UnackedVersion << unackedMessages;
+        f.commit();
+    }
+
+    // a clean logout isn't a lost stream. what the server hasn't acked yet has most likely
+    // reached it, so it's not sent again with the next login
+    void discardUnackedMessages()
+    {
+        unackedTimer->stop();
+        unackedMessages.clear();
+        QFile::remove(pathToProfileUnacked(acc.id));
+    }
+
+    void loadUnackedMessages()
+    {
+        QFile f(pathToProfileUnacked(acc.id));
+        if (!PsiOptions::instance()->getOption("options.stream-management.keep-on-disk").toBool()
+            || !f.open(QIODevice::ReadOnly))
+            return;
+        QDataStream in(&f);
+        in.setVersion(QDataStream::Qt_5_9);
+        quint32           magic, version;
+        QList<QByteArray> messages;
+        in >> magic >> version;
+        if (magic != UnackedMagic || version != UnackedVersion)
+            return;
+        in >> messages;
+        if (in.status() == QDataStream::Ok)
+            unackedMessages = messages;
+    }
+
+    bool canSyncHistory() const
+    {
+        return acc.opt_log && account->isConnected()
+            && client->serverInfoManager()->accountFeatures().test(QStringList { XMPP_MAM_NAMESPACE });
+    }
+
+    // fetches what the server archived with the contact since the last sync. the first sync
+    //   only finds the latest archived message to go on from
+    void syncHistory(const Jid &jid)
+    {
+        if (!canSyncHistory())
+            return;
+        if (!mamCursors.contains(jid.bare()))
+            mamBaselines += jid.bare();
+        mamManager->synchronize(jid, false);
+    }
+
+    void syncAllHistory()
+    {
+        if (!canSyncHistory())
+            return;
+        for (auto it = mamCursors.cbegin(); it != mamCursors.cend(); ++it)
+            mamManager->synchronize(Jid(it.key()), false);
+    }
+
+    void mamPageReceived(const Jid &archive, const QList<QDomElement> &page)
+    {
+        if (mamBaselines.contains(archive.bare()))
+            return;
+
+        for (const QDomElement &result : page) {
+            Forwarding f;
+            if (!f.fromXml(result.firstChildElement(QLatin1String("forwarded")), client))
+                continue;
+            Message m = f.message();
+            // what this session sent is logged already
+            if (m.body().isEmpty() || m.type() == Message::Type::Groupchat || m.from().compare(client->jid()))
+                continue;
+
+            MessageEvent::Ptr me(new MessageEvent(m, account));
+            me->setOriginLocal(m.from().compare(client->jid(), false));
+            me->setTimeStamp(f.timeStamp().isValid() ? f.timeStamp().toLocalTime() : m.timeStamp());
+            account->logEvent(archive, me, EDB::Contact);
+        }
+    }
+
+    // a live message with a stanza-id from our archive moves the cursor past it,
+    //   so the next sync doesn't fetch it again
+    void mamMessageSeen(const Message &m)
+    {
+        const Message::StanzaId &sid = m.stanzaId();
+        if (sid.id.isEmpty() || !sid.by.compare(client->jid(), false))
+            return;
+        const Jid with = m.from().compare(client->jid(), false) ? m.to() : m.from();
+        if (!mamCursors.contains(with.bare()) || mamBaselines.contains(with.bare()))
+            return;
+        mamManager->setSyncCursor(with, sid.id);
+        mamCursorChanged(with, sid.id);
+    }
+
+    void mamCursorChanged(const Jid &archive, const QString &stanzaId)
+    {
+        mamCursors.insert(archive.bare(), stanzaId);
+        mamCursorsTimer->start();
+    }
+
+    void saveMAMCursors()
+    {
+        mamCursorsTimer->stop();
+        QSaveFile f(pathToProfileMAMCursors(acc.id));
+        if (!f.open(QIODevice::WriteOnly)) {
+            qWarning("Failed to save MAM sync cursors for %s", qPrintable(acc.jid));
+            return;
+        }
+        QDataStream out(&f);
+        out.setVersion(QDataStream::Qt_5_9);
+        out << MAMMagic << MAMVersion << mamCursors;
+        f.commit();
+    }
+
+    void loadMAMCursors()
+    {
+        QFile f(pathToProfileMAMCursors(acc.id));
+        if (!f.open(QIODevice::ReadOnly))
+            return;
+        QDataStream in(&f);
+        in.setVersion(QDataStream::Qt_5_9);
+        quint32                 magic, version;
+        QHash<QString, QString> cursors;
+        in >> magic >> version;
+        if (magic != MAMMagic || version != MAMVersion)
+            return;
+        in >> cursors;
+        if (in.status() != QDataStream::Ok)
+            return;
+        mamCursors = cursors;
+        for (auto it = cursors.cbegin(); it != cursors.cend(); ++it)
+            mamManager->setSyncCursor(Jid(it.key()), it.value());
+    }
+
+    void saveRosterSnapshot()
+    {
+        rosterSnapshotTimer->stop();
+
+        Roster r;
+        r.reserve(client->roster().count());
+        for (const LiveRosterItem &i : client->roster())
+            r += i;
+        r.setVersion(client->roster().version());
+        if (!RosterSnapshot::save(pathToProfileRoster(acc.id), r))
+            qWarning("Failed to save roster snapshot for %s", qPrintable(acc.jid));
+    }
+
 private slots:
     void updateOnlineContactsCountTimeout()
     {
@@ -665,8 +894,6 @@ public:
     }
 
 public slots:
-    void queueChanged() { eventQueue->toFile(pathToProfileEvents()); }
-
     void loadQueue()
     {
         bool soundEnabled = PsiOptions::instance()->getOption("options.ui.notifications.sounds.enable").toBool();
@@ -677,6 +904,7 @@ public slots:
         QFileInfo fi(pathToProfileEvents());
         if (fi.exists())
             eventQueue->fromFile(pathToProfileEvents());
+        eventQueue->setStorageFile(pathToProfileEvents()); // further changes are journaled
 
         PsiOptions::instance()->setOption("options.ui.notifications.sounds.enable", soundEnabled);
         doPopups_ = true;
@@ -699,25 +927,11 @@ public slots:
     {
         logoutTimer->stop();
         account->cleanupStream();
+        discardUnackedMessages();
         account->isDisconnecting = false;
         emit account->disconnected();
     }
 
-    void client_xmlIncoming(const QString &s)
-    {
-        xmlRingbuf[xmlRingbufWrite].type = RingXmlIn;
-        xmlRingbuf[xmlRingbufWrite].xml  = s;
-        xmlRingbuf[xmlRingbufWrite].time = QDateTime::currentDateTime();
-        xmlRingbufWrite                  = (xmlRingbufWrite + 1) % xmlRingbuf.count();
-    }
-    void client_xmlOutgoing(const QString &s)
-    {
-        xmlRingbuf[xmlRingbufWrite].type = RingXmlOut;
-        xmlRingbuf[xmlRingbufWrite].xml  = s;
-        xmlRingbuf[xmlRingbufWrite].time = QDateTime::currentDateTime();
-        xmlRingbufWrite                  = (xmlRingbufWrite + 1) % xmlRingbuf.count();
-    }
-
     void client_stanzaElementOutgoing(QDomElement &s)
     {
 #ifdef PSI_PLUGINS
@@ -773,13 +987,13 @@ public:
     // implementation for QList<PsiAccount::xmlRingElem> PsiAccount::dumpRingbuf()
     QList<xmlRingElem> dumpRingbuf()
     {
-        xmlRingElem        el;
         QList<xmlRingElem> ret;
-        for (int i = 0; i < xmlRingbuf.count(); i++) {
-            el = xmlRingbuf[(xmlRingbufWrite + i) % xmlRingbuf.count()];
-            if (!el.xml.isEmpty()) {
-                ret += el;
-            }
+        for (auto const &r : xmlTrace.records()) {
+            xmlRingElem el;
+            el.type = r.incoming ? RingXmlIn : RingXmlOut;
+            el.time = r.time;
+            el.xml  = r.xml;
+            ret += el;
         }
         return ret;
     }
@@ -1053,7 +1267,6 @@ PsiAccount::PsiAccount(const UserAccount &acc, PsiContactList *parent, TabManage
 
     d->eventQueue = new EventQueue(this);
     connect(d->eventQueue, &EventQueue::queueChanged, this, &PsiAccount::queueChanged);
-    connect(d->eventQueue, &EventQueue::queueChanged, d, &Private::queueChanged);
     connect(d->eventQueue, &EventQueue::eventFromXml, this, &PsiAccount::eventFromXml);
     d->self = UserListItem(true);
     d->self.setSubscription(Subscription::Both);
@@ -1105,20 +1318,21 @@ PsiAccount::PsiAccount(const UserAccount &acc, PsiContactList *parent, TabManage
     connect(d->client, &Client::rosterItemAdded, this, &PsiAccount::client_rosterItemUpdated);
     connect(d->client, &Client::rosterItemUpdated, this, &PsiAccount::client_rosterItemUpdated);
     connect(d->client, &Client::rosterItemRemoved, this, &PsiAccount::client_rosterItemRemoved);
+    connect(d->client, &Client::rosterRequestFinished, d, &Private::scheduleRosterSnapshot);
+    connect(d->client, &Client::rosterItemAdded, d, &Private::scheduleRosterSnapshot);
+    connect(d->client, &Client::rosterItemUpdated, d, &Private::scheduleRosterSnapshot);
+    connect(d->client, &Client::rosterItemRemoved, d, &Private::scheduleRosterSnapshot);
     connect(d->client, &Client::resourceAvailable, this, &PsiAccount::client_resourceAvailable);
     connect(d->client, &Client::resourceUnavailable, this, &PsiAccount::client_resourceUnavailable);
     connect(d->client, &Client::presenceError, this, &PsiAccount::client_presenceError);
     connect(d->client, &Client::messageReceived, this, &PsiAccount::client_messageReceived);
     connect(d->client, &Client::subscription, this, &PsiAccount::client_subscription);
-    connect(d->client, &Client::debugText, this, &PsiAccount::client_debugText);
     connect(d->client, &Client::groupChatJoined, this, &PsiAccount::client_groupChatJoined);
     connect(d->client, &Client::groupChatLeft, this, &PsiAccount::client_groupChatLeft);
     connect(d->client, &Client::groupChatPresence, this, &PsiAccount::client_groupChatPresence);
     connect(d->client, &Client::groupChatError, this, &PsiAccount::client_groupChatError);
     connect(d->client, &Client::beginImportRoster, this, &PsiAccount::beginBulkContactUpdate);
     connect(d->client, &Client::endImportRoster, this, &PsiAccount::endBulkContactUpdate);
-    connect(d->client, &Client::xmlIncoming, d, &Private::client_xmlIncoming);
-    connect(d->client, &Client::xmlOutgoing, d, &Private::client_xmlOutgoing);
     connect(d->client, &Client::stanzaElementOutgoing, d, &Private::client_stanzaElementOutgoing);
 
     // Privacy manager
@@ -1152,6 +1366,14 @@ PsiAccount::PsiAccount(const UserAccount &acc, PsiContactList *parent, TabManage
     connect(d->pepManager, &PEPManager::itemRetracted, this, &PsiAccount::itemRetracted);
     d->pepAvailable = false;
 
+    // Message archive
+    d->mamManager = new MAMManager(d->client, 50, 500);
+    connect(d->mamManager, &MAMManager::pageReceived, d, &Private::mamPageReceived);
+    connect(d->mamManager, &MAMManager::syncCursorChanged, d, &Private::mamCursorChanged);
+    connect(d->mamManager, &MAMManager::synchronized, d,
+            [this](const Jid &archive, bool) { d->mamBaselines.remove(archive.bare()); });
+    d->loadMAMCursors();
+
 #ifdef WHITEBOARDING
     // Initialize SXE manager
     d->sxeManager = new SxeManager(d->client, this);
@@ -1193,14 +1415,24 @@ PsiAccount::PsiAccount(const UserAccount &acc, PsiContactList *parent, TabManage
 
     d->selfContact = new PsiContact(d->self, this, true);
 
-    // restore cached roster
-    for (const auto &it : std::as_const(acc.roster))
+    // restore cached roster. the snapshot also keeps the roster version, so an unchanged
+    //   roster isn't downloaded again. roster-cache from the options is left for older profiles
+    //   and moved to a snapshot right away, since it's dropped with the next options save
+    Roster cachedRoster;
+    if (!RosterSnapshot::load(Private::pathToProfileRoster(acc.id), cachedRoster)) {
+        cachedRoster = acc.roster;
+        if (!cachedRoster.isEmpty() && !RosterSnapshot::save(Private::pathToProfileRoster(acc.id), cachedRoster))
+            qWarning("Failed to save roster snapshot for %s", qPrintable(acc.jid));
+    }
+    d->client->restoreRoster(cachedRoster);
+    for (const auto &it : std::as_const(cachedRoster))
         client_rosterItemUpdated(it);
 
     // restore pgp key bindings
     setKnownPgpKeys(acc.pgpKnownKeys);
 
     setUserAccount(acc);
+    d->loadUnackedMessages(); // left by a crash
     connect(ProxyManager::instance(), &ProxyManager::proxyRemoved, d, &Private::pm_proxyRemoved);
 
     connect(d->psi, &PsiCon::emitOptionsUpdate, this, &PsiAccount::optionsUpdate);
@@ -1259,6 +1491,11 @@ PsiAccount::~PsiAccount()
 {
     logout(true, loggedOutStatus());
 
+    if (d->rosterSnapshotTimer->isActive())
+        d->saveRosterSnapshot();
+    if (d->mamCursorsTimer->isActive())
+        d->saveMAMCursors();
+
     setRCEnabled(false);
 
     emit accountDestroyed();
@@ -1277,6 +1514,7 @@ PsiAccount::~PsiAccount()
     delete d->ahcManager;
     delete d->privacyManager;
     delete d->pepManager;
+    delete d->mamManager;
     delete d->client->serverInfoManager();
 #ifdef WHITEBOARDING
     delete d->wbManager;
@@ -1302,6 +1540,14 @@ PsiAccount::~PsiAccount()
 
 void PsiAccount::cleanupStream()
 {
+    if (d->stream) {
+        d->fastToken = d->stream->fastToken();
+        d->saveUnackedMessages();
+        // for the report after the stream is gone
+        d->lastCSIStats = d->stream->isClientStateIndicationSupported() ? d->stream->csiStats()
+                                                                        : ClientStream::CSIStats();
+    }
+
     // GSOC: Get SM state out of stream
     delete d->stream;
 
@@ -1451,6 +1697,8 @@ void PsiAccount::setUserAccount(const UserAccount &_acc)
         oldfname = d->pathToProfileEvents();
     }
 
+    if (d->acc.jid != acc.jid || d->acc.pass != acc.pass)
+        d->fastToken = FastToken();
     d->acc = acc;
     d->setEnabled(enabled());
 
@@ -1462,6 +1710,8 @@ void PsiAccount::setUserAccount(const UserAccount &_acc)
             QDir dir = oldfi.dir();
             dir.rename(oldfi.fileName(), newfi.fileName());
         }
+        if (!d->eventQueue->storageFile().isEmpty()) // already loaded
+            d->eventQueue->setStorageFile(newfi.filePath());
     }
 
     if (d->stream) {
@@ -1531,11 +1781,27 @@ void PsiAccount::updateClientVersionInfo()
 
 void PsiAccount::deleteQueueFile()
 {
+    d->eventQueue->setStorageFile(QString());
     QFileInfo fi(d->pathToProfileEvents());
     if (fi.exists()) {
         QDir dir = fi.dir();
         dir.remove(fi.fileName());
+        dir.remove(fi.fileName() + ".journal");
     }
+
+    d->discardUnackedMessages();
+}
+
+void PsiAccount::deleteRosterSnapshot()
+{
+    d->rosterSnapshotTimer->stop();
+    QFile::remove(Private::pathToProfileRoster(d->acc.id));
+}
+
+void PsiAccount::deleteMAMCursors()
+{
+    d->mamCursorsTimer->stop();
+    QFile::remove(Private::pathToProfileMAMCursors(d->acc.id));
 }
 
 const Jid &PsiAccount::jid() const { return d->jid; }
@@ -1706,6 +1972,7 @@ void PsiAccount::login()
     }
 
     d->stream = new ClientStream(d->conn, d->tlsHandler);
+    d->stream->setTraceHandler([this](bool incoming, const QByteArray &data) { d->xmlTrace.append(incoming, data); });
     d->stream->setRequireMutualAuth(d->acc.req_mutual_auth);
     d->stream->setSSFRange(d->acc.security_level, 256);
     d->stream->setAllowPlain(d->acc.allow_plain);
@@ -1727,6 +1994,22 @@ void PsiAccount::login()
 
     Jid j = d->jid.withResource((d->acc.opt_automatic_resource ? localHostName() : d->acc.resource));
     d->stream->setSMEnabled(d->acc.opt_sm);
+    auto o = PsiOptions::instance();
+    d->stream->setSMQueueLimit(o->getOption("options.stream-management.queue-size").toInt() * 1024,
+                               o->getOption("options.stream-management.drop-messages").toBool());
+    d->stream->setSMAckRequestCadence(o->getOption("options.stream-management.ack-request-stanzas").toInt(),
+                                      o->getOption("options.stream-management.ack-request-size").toInt() * 1024);
+    d->stream->setUnacknowledgedMessages(d->unackedMessages);
+    connect(d->stream, &ClientStream::stanzaWritten, d, &Private::scheduleUnackedMessages);
+    connect(d->stream, &ClientStream::stanzasAcked, d, &Private::scheduleUnackedMessages);
+    d->stream->setClientActive(d->clientActive);
+    QUuid uaId(d->acc.id);
+    d->stream->setUserAgent(uaId.isNull() ? d->acc.id : uaId.toString(QUuid::WithoutBraces), ApplicationInfo::name(),
+                            localHostName());
+    if (d->acc.opt_automatic_resource)
+        d->stream->setBindTag(ApplicationInfo::name()); // the server picks the resource then
+    d->stream->setCarbonsInline(true);
+    d->stream->setFastToken(d->fastToken);
     d->client->connectToServer(d->stream, j);
 }
 
@@ -1951,10 +2234,12 @@ void PsiAccount::cs_authenticated()
         return;
     }
 
-    if (d->acc.storeSaltedHashedPassword) {
-        d->acc.scramSaltedHashPassword = d->stream->getSCRAMStoredSaltedHash();
+    QString saltedHash = d->stream->getSCRAMStoredSaltedHash();
+    if (d->acc.storeSaltedHashedPassword && !saltedHash.isEmpty()) { // empty when logged in with a FAST token
+        d->acc.scramSaltedHashPassword = saltedHash;
         d->acc.pass                    = "";
     }
+    d->fastToken = d->stream->fastToken();
 
     d->reconnectConnection = QMetaObject::Connection();
 
@@ -1971,6 +2256,9 @@ void PsiAccount::cs_authenticated()
                                                  : d->stream->jid().resource());
 
     d->client->start(d->jid.domain(), d->jid.node(), d->acc.pass, resource);
+    if (d->stream->isCarbonsEnabledInline()) {
+        d->client->carbonsManager()->setEnabledInline();
+    }
     if (d->client->isSessionRequired()) {
         JT_Session *j = new JT_Session(d->client->rootTask());
         connect(j, &JT_Session::finished, this, &PsiAccount::sessionStart_finished);
@@ -2318,7 +2606,13 @@ int PsiAccount::currentConnectionErrorCondition() const { return d->currentConne
 
 void PsiAccount::client_rosterRequestFinished(bool success, int, const QString &)
 {
-    if (success) {
+    if (success && d->client->isRosterUnchanged()) {
+        // our cached roster is up to date, changes (if any) arrive as pushes
+        for (UserListItem *u : std::as_const(d->userList))
+            u->setFlagForDelete(false);
+
+        d->stopReconnect();
+    } else if (success) {
         // printf("PsiAccount: [%s] roster retrieved ok.  %d entries.\n", name().latin1(), d->client->roster().count());
 
         // delete flagged items
@@ -2390,6 +2684,8 @@ void PsiAccount::serverFeaturesChanged()
         d->client->carbonsManager()->setEnabled(true);
     }
 
+    d->syncAllHistory();
+
     if (d->client->serverInfoManager()->serverFeatures().hasVCard() && !d->vcardChecked) {
         // Get the vcard
         const auto vcard = VCardFactory::instance()->vcard(d->jid);
@@ -2857,6 +3153,8 @@ void PsiAccount::processIncomingMessage(const Message &_m)
         && dm.retraction().isEmpty())
         return;
 
+    d->mamMessageSeen(dm);
+
     // skip headlines?
     if (dm.type() == Message::Type::Headline
         && PsiOptions::instance()->getOption("options.messages.ignore-headlines").toBool())
@@ -3039,13 +3337,6 @@ void PsiAccount::client_subscription(const Jid &j, const QString &str, const QSt
     handleEvent(ae, IncomingStanza);
 }
 
-void PsiAccount::client_debugText(const QString &txt)
-{
-    Q_UNUSED(txt);
-    // printf("%s\n", qPrintable(txt));
-    // fflush(stdout);
-}
-
 #ifdef GOOGLE_FT
 void PsiAccount::incomingGoogleFileTransfer(GoogleFileTransfer *ft)
 {
@@ -3393,6 +3684,46 @@ void PsiAccount::publishTune(const Tune &tune)
 
 void PsiAccount::setAutoAwayStatus(AutoAway status) { d->setAutoAway(status); }
 
+/**
+ * Tells the server whether the user is around (XEP-0352), so it may hold back
+ * presence updates and other traffic which can wait while they are not.
+ */
+void PsiAccount::setClientActive(bool active)
+{
+    d->clientActive = active;
+    if (d->stream)
+        d->stream->setClientActive(active);
+}
+
+/**
+ * Returns what Client State Indication did in the current session, or the last one
+ * if offline. The server doesn't tell what it held back, so that is only estimated
+ * from the traffic while active. Empty if the server doesn't support it.
+ */
+QString PsiAccount::clientStateReport() const
+{
+    ClientStream::CSIStats stats = d->lastCSIStats;
+    if (d->stream)
+        stats = d->stream->isClientStateIndicationSupported() ? d->stream->csiStats() : ClientStream::CSIStats();
+    if (!stats.activeMsecs && !stats.inactiveMsecs)
+        return QString();
+
+    auto const size = [](quint64 bytes) {
+        qlonglong div;
+        QString   unit = TextUtil::sizeUnit(qlonglong(bytes), &div);
+        return TextUtil::roundedNumber(qlonglong(bytes), div) + unit;
+    };
+    QString report = tr("Inactive for %1 min, %2 received meanwhile")
+                         .arg(stats.inactiveMsecs / 60000)
+                         .arg(size(stats.inactiveBytes));
+    if (stats.inactiveMsecs && stats.activeMsecs >= 60000) {
+        double expected = double(stats.activeBytes) * double(stats.inactiveMsecs) / double(stats.activeMsecs);
+        report += tr(" (estimated %1 held back by the server)")
+                      .arg(size(quint64(qMax(0.0, expected - double(stats.inactiveBytes)))));
+    }
+    return report;
+}
+
 void PsiAccount::playSound(PsiAccount::SoundType _onevent)
 {
     int onevent = static_cast<int>(_onevent);
@@ -4041,6 +4372,7 @@ ChatDlg *PsiAccount::ensureChatDlg(const Jid &j)
     if (!c) {
         // create the chatbox
         c = ChatDlg::create(j, this, d->tabManager);
+        d->syncHistory(j);
         connect(c, &ChatDlg::aSend, this, [this](XMPP::Message &msg) { dj_sendMessage(msg); });
         connect(c, &ChatDlg::messagesRead, this, &PsiAccount::chatMessagesRead);
         connect(c, &ChatDlg::aInfo, this, [this](const XMPP::Jid &jid) { actionInfo(jid); });
@@ -6474,9 +6806,7 @@ QList<PsiAccount::xmlRingElem> PsiAccount::dumpRingbuf() { return d->dumpRingbuf
  */
 void PsiAccount::clearRingbuf()
 {
-    d->xmlRingbuf.clear();
-    d->xmlRingbufWrite = 0;
-    d->xmlRingbuf.resize(10);
+    d->xmlTrace.reset(XmlTraceCompactSize);
 }
 
 /**
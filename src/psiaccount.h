@@ -111,8 +111,10 @@ public:
     static PsiAccount *create(const UserAccount &acc, PsiContactList *parent, TabManager *tabManager);
     virtual ~PsiAccount();
 
-    bool enabled() const;
-    void setEnabled(bool e = true);
+    bool    enabled() const;
+    void    setEnabled(bool e = true);
+    void    setClientActive(bool active);
+    QString clientStateReport() const;
 
     bool           isAvailable() const;
     bool           isActive() const;
@@ -276,6 +278,8 @@ public:
                              bool *_needAlert);
 
     void deleteQueueFile();
+    void deleteRosterSnapshot();
+    void deleteMAMCursors();
 
     PEPManager        *pepManager();
     ServerInfoManager *serverInfoManager();
@@ -449,7 +453,6 @@ private slots:
     void client_presenceError(const Jid &, int, const QString &);
     void client_messageReceived(const Message &);
     void client_subscription(const Jid &, const QString &, const QString &);
-    void client_debugText(const QString &);
     void client_groupChatJoined(const Jid &);
     void client_groupChatLeft(const Jid &);
     void client_groupChatPresence(const Jid &, const Status &);
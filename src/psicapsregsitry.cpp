@@ -3,11 +3,36 @@
 #include "applicationinfo.h"
 #include "iodeviceopener.h"
 
+#include <QDataStream>
+#include <QDomDocument>
+#include <QSaveFile>
+
+#include <limits>
+
+static const quint32 journalMagic   = 0x50534443; // "PSDC"
+static const quint32 journalVersion = 1;
+
+static QString legacyFileName() { return ApplicationInfo::homeDir(ApplicationInfo::CacheLocation) + "/caps.xml"; }
+
+static QString journalFileName() { return ApplicationInfo::homeDir(ApplicationInfo::CacheLocation) + "/disco.cache"; }
+
+static void writeRecord(QDataStream &out, const QString &key, const XMPP::CapsInfo &info)
+{
+    QDomDocument doc;
+    doc.appendChild(info.disco().toDiscoInfoResult(&doc));
+    out << key << info.lastSeen() << info.expires() << doc.toByteArray(-1);
+}
+
 PsiCapsRegistry::PsiCapsRegistry(QObject *parent) : CapsRegistry(parent) { }
 
+PsiCapsRegistry::~PsiCapsRegistry()
+{
+    qDebug("disco cache: %llu hits, %llu misses", stats().hits, stats().misses);
+}
+
 void PsiCapsRegistry::saveData(const QByteArray &data)
 {
-    QFile          file(ApplicationInfo::homeDir(ApplicationInfo::CacheLocation) + "/caps.xml");
+    QFile          file(legacyFileName());
     IODeviceOpener opener(&file, QIODevice::WriteOnly);
     if (!opener.isOpen()) {
         qWarning("Caps: Unable to open IO device");
@@ -18,7 +43,7 @@ void PsiCapsRegistry::saveData(const QByteArray &data)
 
 QByteArray PsiCapsRegistry::loadData()
 {
-    QFile file(ApplicationInfo::homeDir(ApplicationInfo::CacheLocation) + "/caps.xml");
+    QFile file(legacyFileName());
     if (file.exists()) {
         IODeviceOpener opener(&file, QIODevice::ReadOnly);
         if (opener.isOpen()) {
@@ -29,3 +54,106 @@ QByteArray PsiCapsRegistry::loadData()
     }
     return QByteArray();
 }
+
+void PsiCapsRegistry::load()
+{
+    int records = 0;
+    if (!loadJournal(records)) {
+        // first start with the journal. import caps.xml once
+        CapsRegistry::load();
+        save();
+        QFile::remove(legacyFileName());
+        return;
+    }
+
+    // most of records are superseded or expired
+    if (records > 2 * entries().size() + 64) {
+        save();
+    }
+}
+
+/**
+ * Rewrites the journal with live entries only
+ */
+void PsiCapsRegistry::save()
+{
+    QSaveFile file(journalFileName());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("CapsRegistry: Cannot write %s", qPrintable(journalFileName()));
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_9);
+    out << journalMagic << journalVersion;
+    const auto &all = entries();
+    for (auto it = all.constBegin(); it != all.constEnd(); ++it) {
+        if (!it.value().isExpired()) {
+            writeRecord(out, it.key(), it.value());
+        }
+    }
+    file.commit();
+}
+
+void PsiCapsRegistry::saveEntry(const QString &key, const XMPP::CapsInfo &info)
+{
+    QFile file(journalFileName());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning("CapsRegistry: Cannot append to %s", qPrintable(journalFileName()));
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_9);
+    if (file.size() == 0) {
+        out << journalMagic << journalVersion;
+    }
+    writeRecord(out, key, info);
+}
+
+/**
+ * Reads all the journal records, later ones replace earlier ones.
+ * Returns false if there is no journal of known version.
+ */
+bool PsiCapsRegistry::loadJournal(int &records)
+{
+    QFile file(journalFileName());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_9);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != journalMagic || version != journalVersion) {
+        return false;
+    }
+
+    // keep unseen caps for last 3 month, the same as CapsRegistry::load()
+    const QDateTime validTime = QDateTime::currentDateTime().addMonths(-3);
+    while (!in.atEnd()) {
+        QString    key;
+        QDateTime  lastSeen, expires;
+        QByteArray xml;
+        in >> key >> lastSeen >> expires >> xml;
+        if (in.status() != QDataStream::Ok) {
+            // likely truncated by a crash while appending. the next compaction drops the tail
+            qWarning("CapsRegistry: %s is truncated", qPrintable(journalFileName()));
+            records = std::numeric_limits<int>::max();
+            break;
+        }
+        ++records;
+
+        XMPP::CapsInfo info(XMPP::DiscoItem(), lastSeen, expires);
+        if (info.isExpired() || (!expires.isValid() && lastSeen < validTime)) {
+            continue;
+        }
+        QDomDocument doc;
+        if (!doc.setContent(xml)) {
+            continue;
+        }
+        addEntry(key, XMPP::CapsInfo(XMPP::DiscoItem::fromDiscoInfoResult(doc.documentElement()), lastSeen, expires));
+    }
+    return true;
+}
@@ -3,14 +3,29 @@
 
 #include "iris/xmpp_caps.h"
 
+/*
+ * Keeps the disco cache in a binary journal in the cache dir. New entries are appended as they
+ * come and the journal is compacted on load when it has grown too much.
+ */
 class PsiCapsRegistry : public XMPP::CapsRegistry {
     Q_OBJECT
 
 public:
     PsiCapsRegistry(QObject *parent = nullptr);
+    ~PsiCapsRegistry();
 
     void       saveData(const QByteArray &data);
     QByteArray loadData();
+
+public slots:
+    void load() override;
+    void save() override;
+
+protected:
+    void saveEntry(const QString &key, const XMPP::CapsInfo &info) override;
+
+private:
+    bool loadJournal(int &records);
 };
 
 #endif // PSICAPSREGSITRY_H
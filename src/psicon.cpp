@@ -106,6 +106,7 @@
 #endif
 #ifdef WEBKIT
 #include "avatars.h"
+#include "chatview_webkit.h"
 #include "chatviewthemeprovider.h"
 #endif
 #ifdef HAVE_SPARKLE
@@ -130,6 +131,7 @@
 #include <QPixmapCache>
 #include <QPointer>
 #include <QSessionManager>
+#include <QTimer>
 
 static const char *tunePublishOptionPath          = "options.extended-presence.tune.publish";
 static const char *tuneUrlFilterOptionPath        = "options.extended-presence.tune.url-filter";
@@ -332,15 +334,31 @@ public:
             awayAfter         = o->getOption("options.status.auto-away.away-after").toInt();
             menuXA            = o->getOption("options.ui.menu.status.xa").toBool();
             useIdleServer     = o->getOption("options.service-discovery.last-activity").toBool();
+            useCSI            = o->getOption("options.client-state-indication.enabled").toBool();
+            csiInactiveDelay  = o->getOption("options.client-state-indication.inactive-delay").toInt();
+            csiIdleAfter      = o->getOption("options.client-state-indication.idle-after").toInt();
         }
 
         bool useOffline = false, useNotAvailable = false, useAway = false, menuXA = false;
         int  offlineAfter = 0, notAvailableAfter = 0, awayAfter = 0;
         int  secondsIdle   = 0;
         bool useIdleServer = false;
+        bool useCSI        = false;
+        int  csiInactiveDelay = 0, csiIdleAfter = 0;
     };
 
     IdleSettings idleSettings_;
+
+    bool   clientActive = true; // XEP-0352 state of all accounts
+    QTimer clientInactiveTimer;
+
+    void setClientActive(bool active)
+    {
+        clientActive = active;
+        for (PsiAccount *account : contactList->accounts()) {
+            account->setClientActive(active);
+        }
+    }
 };
 
 //----------------------------------------------------------------------------
@@ -359,10 +377,7 @@ PsiCon::PsiCon() : QObject(nullptr)
     d->defaultMenuBar = new QMenuBar(nullptr);
 
     XMPP::CapsRegistry::setInstance(new PsiCapsRegistry(this));
-    XMPP::CapsRegistry *pcr = XMPP::CapsRegistry::instance();
-    connect(pcr, SIGNAL(destroyed(QObject *)), pcr, SLOT(save()));
-    connect(pcr, SIGNAL(registered(const XMPP::CapsSpec &)), pcr, SLOT(save()));
-    pcr->load();
+    XMPP::CapsRegistry::instance()->load(); // new entries are saved incrementally
 }
 
 PsiCon::~PsiCon()
@@ -617,6 +632,14 @@ bool PsiCon::init()
 
     connect(&d->idle, SIGNAL(secondsIdle(int)), SLOT(secondsIdle(int)));
 
+    // Client State Indication
+    d->clientInactiveTimer.setSingleShot(true);
+    connect(&d->clientInactiveTimer, &QTimer::timeout, this, [this]() { d->setClientActive(false); });
+    connect(qApp, &QGuiApplication::applicationStateChanged, this, &PsiCon::updateClientState);
+    connect(d->bossKey, &BossKey::hiddenChanged, this, &PsiCon::updateClientState);
+    connect(d->contactList, &PsiContactList::accountAdded, this,
+            [this](PsiAccount *account) { account->setClientActive(d->clientActive); });
+
     // PopupDurationsManager
     d->popupManager = new PopupManager(this);
 
@@ -744,6 +767,10 @@ bool PsiCon::init()
     // init spellchecker
     optionChanged("options.ui.spell-check.langs");
 
+#ifdef WEBKIT
+    ChatView::preloadViews(); // in the background, before autojoined groupchats need them
+#endif
+
     // try autologin if needed
     for (PsiAccount *account : d->contactList->accounts()) {
         account->autoLogin();
@@ -1426,12 +1453,13 @@ void PsiCon::optionChanged(const QString &option)
     // Idle server
     d->idleSettings_.update();
     if (d->idleSettings_.useAway || d->idleSettings_.useNotAvailable || d->idleSettings_.useOffline
-        || d->idleSettings_.useIdleServer)
+        || d->idleSettings_.useIdleServer || (d->idleSettings_.useCSI && d->idleSettings_.csiIdleAfter > 0))
         d->idle.start();
     else {
         d->idle.stop();
         d->idleSettings_.secondsIdle = 0;
     }
+    updateClientState();
 
     if (option == QString::fromLatin1("options.ui.notifications.alert-style")) {
         alertIconUpdateAlertStyle();
@@ -1981,6 +2009,31 @@ void PsiCon::secondsIdle(int sec)
 
         pa->setAutoAwayStatus(aa);
     }
+    updateClientState();
+}
+
+/**
+ * Decides whether the user is around: some Psi window has focus, the boss key
+ * hasn't hidden everything and there was input recently. Going back to active
+ * is immediate, while losing focus is reported after a delay, so switching
+ * between windows doesn't flood the server.
+ */
+void PsiCon::updateClientState()
+{
+    auto const &s      = d->idleSettings_;
+    bool        hidden = d->bossKey && d->bossKey->isHidden();
+    bool        idle   = s.csiIdleAfter > 0 && s.secondsIdle >= s.csiIdleAfter;
+    if (!s.useCSI || (qApp->applicationState() == Qt::ApplicationActive && !hidden && !idle)) {
+        d->clientInactiveTimer.stop();
+        if (!d->clientActive)
+            d->setClientActive(true);
+    } else if (hidden || idle) {
+        d->clientInactiveTimer.stop();
+        if (d->clientActive)
+            d->setClientActive(false);
+    } else if (d->clientActive && !d->clientInactiveTimer.isActive()) {
+        d->clientInactiveTimer.start(qMax(0, s.csiInactiveDelay) * 1000);
+    }
 }
 
 int PsiCon::idle() const { return d->idleSettings_.secondsIdle; }
@@ -190,6 +190,7 @@ public slots:
     void startBounce();
     void aboutToQuit();
     void secondsIdle(int);
+    void updateClientState();
     void proceedWithSleep();
     void networkSessionOpened();
 
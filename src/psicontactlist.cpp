@@ -206,6 +206,8 @@ void PsiContactList::removeAccount(PsiAccount *account)
 {
     emit accountRemoved(account);
     account->deleteQueueFile();
+    account->deleteRosterSnapshot();
+    account->deleteMAMCursors();
     delete account;
     emit saveAccounts();
 }
@@ -145,7 +145,8 @@ PsiContactListView::PsiContactListView(QWidget *parent) : ContactListDragView(pa
 
     d = new Private(this);
 
-    connect(PsiOptions::instance(), SIGNAL(optionChanged(QString)), SLOT(optionChanged(QString)));
+    PsiOptions::instance()->watchOptions({ groupIndentOption }, this,
+                                         [this](const QSet<QString> &) { optionChanged(groupIndentOption); });
     connect(delegate, SIGNAL(geometryUpdated()), d, SLOT(recalculateSize()));
     connect(this, SIGNAL(expanded(QModelIndex)), d, SLOT(recalculateSize()));
     connect(this, SIGNAL(collapsed(QModelIndex)), d, SLOT(recalculateSize()));
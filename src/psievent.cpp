@@ -33,9 +33,12 @@
 
 #include <QCoreApplication>
 #include <QDomElement>
+#include <QFile>
 #include <QList>
-#include <QSet>
 #include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
 
 using namespace XMLHelper;
 using namespace XMPP;
@@ -583,8 +586,10 @@ EventItem::EventItem(const PsiEvent::Ptr &_e)
 
 EventItem::EventItem(const EventItem &from)
 {
-    e    = from.e;
-    v_id = from.v_id;
+    e       = from.e;
+    v_id    = from.v_id;
+    jidKey  = from.jidKey;
+    fromKey = from.fromKey;
 }
 
 EventItem::~EventItem() { }
@@ -597,10 +602,43 @@ PsiEvent::Ptr EventItem::event() const { return e; }
 // EventQueue
 //----------------------------------------------------------------------------
 
+/**
+ * \class EventQueue
+ * \brief Pending events of an account, ordered by priority
+ *
+ * Events are indexed by bare JID, so per-contact queries don't scan the whole queue.
+ *
+ * Once setStorageFile() is called the queue is persisted incrementally: the file holds
+ * a snapshot and every change is appended to a journal next to it. The journal is
+ * folded into a new snapshot when it grows larger than the queue. Both carry a
+ * generation number, so a journal left over from an interrupted compaction is ignored.
+ * While the journal can't be opened every change rewrites the snapshot.
+ */
+
+static const int  CompactMinRecords = 256;
+static const int  CompactDelay      = 10000; // msecs
+static const char JournalMagic[]    = "psi-event-journal";
+
+static QString journalFileName(const QString &fname) { return fname + QLatin1String(".journal"); }
+
+// inserts after all items with higher or equal priority
+static void insertByPriority(QList<EventItem *> &list, EventItem *item)
+{
+    int  prior = item->event()->priority();
+    auto it    = std::find_if(list.begin(), list.end(),
+                              [prior](EventItem *ei) { return ei->event()->priority() < prior; });
+    list.insert(it, item);
+}
+
 EventQueue::EventQueue(PsiAccount *account) : psi_(nullptr), account_(nullptr), enabled_(false)
 {
     account_ = account;
     psi_     = account_->psi();
+
+    compactTimer_ = new QTimer(this);
+    compactTimer_->setSingleShot(true);
+    compactTimer_->setInterval(CompactDelay);
+    connect(compactTimer_, &QTimer::timeout, this, &EventQueue::compact);
 }
 
 EventQueue::EventQueue(const EventQueue &from) : QObject(), list_(), psi_(nullptr), account_(nullptr), enabled_(false)
@@ -624,6 +662,8 @@ EventQueue &EventQueue::operator=(const EventQueue &from)
 {
     while (!list_.isEmpty())
         delete list_.takeFirst();
+    byJid_.clear();
+    byFrom_.clear();
 
     psi_     = from.psi_;
     account_ = from.account_;
@@ -636,6 +676,43 @@ EventQueue &EventQueue::operator=(const EventQueue &from)
     return *this;
 }
 
+void EventQueue::insertItem(EventItem *i)
+{
+    i->jidKey  = i->event()->jid().bare();
+    i->fromKey = i->event()->from().bare();
+    insertByPriority(list_, i);
+    insertByPriority(byJid_[i->jidKey], i);
+    insertByPriority(byFrom_[i->fromKey], i);
+
+    QByteArray record; // serialized only if there is a journal to append it to
+    if (journal_) {
+        QDomDocument doc;
+        QDomElement  e = i->event()->toXml(&doc);
+        doc.appendChild(e);
+        record = '+' + QByteArray::number(i->id()) + ' ' + doc.toByteArray(-1).toBase64();
+    }
+    writeJournal(record);
+}
+
+// removes the item from the queue and deletes it
+void EventQueue::removeItem(EventItem *i)
+{
+    auto const unindex = [i](QHash<QString, QList<EventItem *>> &index, const QString &key) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->removeOne(i);
+            if (it->isEmpty())
+                index.erase(it);
+        }
+    };
+    list_.removeOne(i);
+    unindex(byJid_, i->jidKey);
+    unindex(byFrom_, i->fromKey);
+
+    writeJournal('-' + QByteArray::number(i->id()));
+    delete i;
+}
+
 int EventQueue::nextId() const
 {
     if (list_.isEmpty())
@@ -649,19 +726,16 @@ int EventQueue::nextId() const
 
 int EventQueue::count() const { return list_.count(); }
 
-int EventQueue::contactCount() const
-{
-    QSet<QString> set;
-    for (EventItem *i : list_) {
-        set.insert(i->event()->jid().bare());
-    }
-    return set.size();
-}
+int EventQueue::contactCount() const { return byJid_.size(); }
 
 int EventQueue::count(const Jid &j, bool compareRes) const
 {
+    auto const &items = byJid_.value(j.bare());
+    if (!compareRes)
+        return items.count();
+
     int total = 0;
-    for (EventItem *i : list_) {
+    for (EventItem *i : items) {
         Jid j2(i->event()->jid());
         if (j.compare(j2, compareRes))
             ++total;
@@ -671,24 +745,7 @@ int EventQueue::count(const Jid &j, bool compareRes) const
 
 void EventQueue::enqueue(const PsiEvent::Ptr &e)
 {
-    EventItem *i = new EventItem(e);
-
-    int  prior = e->priority();
-    bool found = false;
-
-    // skip all with higher or equal priority
-    for (EventItem *ei : std::as_const(list_)) {
-        if (ei && ei->event()->priority() < prior) {
-            list_.insert(list_.indexOf(ei), i);
-            found = true;
-            break;
-        }
-    }
-
-    // everything else
-    if (!found)
-        list_.append(i);
-
+    insertItem(new EventItem(e));
     emit queueChanged();
 }
 
@@ -697,25 +754,25 @@ void EventQueue::dequeue(const PsiEvent::Ptr &e)
     if (!e)
         return;
 
-    for (EventItem *i : std::as_const(list_)) {
-        if (e == i->event()) {
-            list_.removeAll(i);
-            emit queueChanged();
-            delete i;
+    auto const items = byJid_.value(e->jid().bare());
+    auto       it    = std::find_if(items.begin(), items.end(), [&e](EventItem *i) { return e == i->event(); });
+    if (it == items.end()) { // the jid was changed after enqueue
+        it = std::find_if(list_.cbegin(), list_.cend(), [&e](EventItem *i) { return e == i->event(); });
+        if (it == list_.cend())
             return;
-        }
     }
+    removeItem(*it);
+    emit queueChanged();
 }
 
 PsiEvent::Ptr EventQueue::dequeue(const Jid &j, bool compareRes)
 {
-    for (EventItem *i : std::as_const(list_)) {
+    for (EventItem *i : byJid_.value(j.bare())) {
         PsiEvent::Ptr e = i->event();
         Jid           j2(e->jid());
         if (j.compare(j2, compareRes)) {
-            list_.removeAll(i);
+            removeItem(i);
             emit queueChanged();
-            delete i;
             return e;
         }
     }
@@ -725,7 +782,7 @@ PsiEvent::Ptr EventQueue::dequeue(const Jid &j, bool compareRes)
 
 PsiEvent::Ptr EventQueue::peek(const Jid &j, bool compareRes) const
 {
-    for (EventItem *i : list_) {
+    for (EventItem *i : byJid_.value(j.bare())) {
         PsiEvent::Ptr e = i->event();
         Jid           j2(e->jid());
         if (j.compare(j2, compareRes)) {
@@ -745,9 +802,8 @@ PsiEvent::Ptr EventQueue::dequeueNext()
     if (!i)
         return PsiEvent::Ptr();
     PsiEvent::Ptr e = i->event();
-    list_.removeAll(i);
+    removeItem(i);
     emit queueChanged();
-    delete i;
     return e;
 }
 
@@ -764,7 +820,7 @@ PsiEvent::Ptr EventQueue::peekNext() const
 
 PsiEvent::Ptr EventQueue::peekFirstChat(const Jid &j, bool compareRes) const
 {
-    for (EventItem *i : list_) {
+    for (EventItem *i : byFrom_.value(j.bare())) {
         PsiEvent::Ptr e = i->event();
         if (e->type() == PsiEvent::Message) {
             MessageEvent::Ptr me = e.staticCast<MessageEvent>();
@@ -783,30 +839,20 @@ void EventQueue::extractChats(QList<PsiEvent::Ptr> *el, const Jid &j, bool compa
 {
     bool changed = false;
 
-    for (QList<EventItem *>::Iterator it = list_.begin(); it != list_.end();) {
-        PsiEvent::Ptr e       = (*it)->event();
-        bool          extract = false;
-        if (e->type() == PsiEvent::Message) {
-            MessageEvent::Ptr me = e.staticCast<MessageEvent>();
-            if (j.compare(me->from(), compareRes)
-                && me->message().displayMessage().type() == Message::Type::Chat) { // FIXME: refactor-refactor-refactor
-                extract = true;
-            }
-        }
+    for (EventItem *i : byFrom_.value(j.bare())) {
+        PsiEvent::Ptr e = i->event();
+        if (e->type() != PsiEvent::Message)
+            continue;
 
-        if (extract) {
+        MessageEvent::Ptr me = e.staticCast<MessageEvent>();
+        if (j.compare(me->from(), compareRes)
+            && me->message().displayMessage().type() == Message::Type::Chat) { // FIXME: refactor-refactor-refactor
             el->append(e);
+            if (removeEvents) {
+                removeItem(i);
+                changed = true;
+            }
         }
-
-        if (extract && removeEvents) {
-            EventItem *ei = *it;
-            it            = list_.erase(it);
-            delete ei;
-            changed = true;
-            continue;
-        }
-
-        ++it;
     }
 
     if (changed)
@@ -815,11 +861,8 @@ void EventQueue::extractChats(QList<PsiEvent::Ptr> *el, const Jid &j, bool compa
 
 void EventQueue::extractByJid(QList<PsiEvent::Ptr> *list, const XMPP::Jid &jid)
 {
-    for (QList<EventItem *>::Iterator it = list_.begin(); it != list_.end(); it++) {
-        PsiEvent::Ptr e = (*it)->event();
-        if (jid.compare(e->from(), false)) {
-            list->append(e);
-        }
+    for (EventItem *i : byFrom_.value(jid.bare())) {
+        list->append(i->event());
     }
 }
 
@@ -831,17 +874,13 @@ void EventQueue::extractByType(int type, QList<PsiEvent::Ptr> *el)
 {
     bool changed = false;
 
-    for (QList<EventItem *>::Iterator it = list_.begin(); it != list_.end();) {
-        PsiEvent::Ptr e = (*it)->event();
+    for (EventItem *i : QList<EventItem *>(list_)) {
+        PsiEvent::Ptr e = i->event();
         if (e->type() == type) {
             el->append(e);
-            EventItem *ei = *it;
-            it            = list_.erase(it);
-            delete ei;
+            removeItem(i);
             changed = true;
-            continue;
         }
-        ++it;
     }
 
     if (changed)
@@ -859,10 +898,11 @@ void EventQueue::printContent() const
 
 void EventQueue::clear()
 {
-    while (!list_.isEmpty()) {
-        EventItem *i = list_.takeFirst();
-        delete i;
-    }
+    qDeleteAll(list_);
+    list_.clear();
+    byJid_.clear();
+    byFrom_.clear();
+    writeJournal("0");
 
     emit queueChanged();
 }
@@ -872,16 +912,12 @@ void EventQueue::clear(const Jid &j, bool compareRes)
 {
     bool changed = false;
 
-    for (QList<EventItem *>::Iterator it = list_.begin(); it != list_.end();) {
-        PsiEvent::Ptr e = (*it)->event();
-        Jid           j2(e->jid());
+    for (EventItem *i : byJid_.value(j.bare())) {
+        Jid j2(i->event()->jid());
         if (j.compare(j2, compareRes)) {
-            EventItem *ei = *it;
-            it            = list_.erase(it);
-            delete ei;
+            removeItem(i);
             changed = true;
-        } else
-            ++it;
+        }
     }
 
     if (changed)
@@ -892,10 +928,12 @@ QDomElement EventQueue::toXml(QDomDocument *doc) const
 {
     QDomElement e = doc->createElement("eventQueue");
     e.setAttribute("version", "1.0");
+    e.setAttribute("generation", generation_);
     e.appendChild(textTag(doc, "progver", ApplicationInfo::version()));
 
     for (EventItem *i : list_) {
         QDomElement event = i->event()->toXml(doc);
+        event.setAttribute("qid", i->id()); // referenced by the journal
         e.appendChild(event);
     }
 
@@ -950,7 +988,7 @@ QList<EventQueue::PsiEventId> EventQueue::eventsFor(const XMPP::Jid &jid, bool c
 {
     QList<PsiEventId> result;
 
-    for (EventItem *i : std::as_const(list_)) {
+    for (EventItem *i : byFrom_.value(jid.bare())) {
         if (i->event()->from().compare(jid, compareRes))
             result << QPair<int, PsiEvent::Ptr>(i->id(), i->event());
     }
@@ -968,6 +1006,10 @@ bool EventQueue::toFile(const QString &fname)
     return f.saveDocument(doc);
 }
 
+/**
+ * Loads events saved with toFile() or setStorageFile(), including the changes
+ * journaled since the last snapshot.
+ */
 bool EventQueue::fromFile(const QString &fname)
 {
     AtomicXmlFile f(fname);
@@ -976,7 +1018,106 @@ bool EventQueue::fromFile(const QString &fname)
         return false;
 
     QDomElement base = doc.documentElement();
+    // continue the numbering, so the next snapshot never matches a journal of an older one
+    generation_ = base.attribute("generation").toInt();
+
+    QFile journal(journalFileName(fname));
+    if (journal.open(QIODevice::ReadOnly)) {
+        QList<QByteArray> header = journal.readLine().trimmed().split(' ');
+        if (header.value(0) == JournalMagic)
+            generation_ = qMax(generation_, header.value(1).toInt());
+        if (header.value(0) == JournalMagic && header.value(1) == base.attribute("generation").toLatin1()) {
+            QHash<QByteArray, QDomElement> events;
+            for (QDomElement e = base.firstChildElement("event"); !e.isNull(); e = e.nextSiblingElement("event"))
+                events.insert(e.attribute("qid").toLatin1(), e);
+
+            while (!journal.atEnd()) {
+                QByteArray line = journal.readLine();
+                if (!line.endsWith('\n'))
+                    break; // interrupted write
+                line.chop(1);
+                if (line == "0") {
+                    for (auto const &e : std::as_const(events))
+                        base.removeChild(e);
+                    events.clear();
+                } else if (line.startsWith('-')) {
+                    base.removeChild(events.take(line.mid(1)));
+                } else if (line.startsWith('+')) {
+                    int          sep = line.indexOf(' ');
+                    QDomDocument record;
+                    if (sep < 0 || !record.setContent(QByteArray::fromBase64(line.mid(sep + 1))))
+                        break;
+                    QDomElement e = doc.importNode(record.documentElement(), true).toElement();
+                    base.appendChild(e);
+                    events.insert(line.mid(1, sep - 1), e);
+                }
+            }
+        }
+    }
+
     return fromXml(&base);
 }
 
+/**
+ * Persists the queue in \a fname from now on. The current queue is written
+ * right away, further changes go to the journal. An empty name stops saving.
+ */
+void EventQueue::setStorageFile(const QString &fname)
+{
+    if (fname == storage_)
+        return;
+
+    QString old = storage_;
+    storage_    = fname;
+    delete journal_;
+    journal_ = nullptr;
+    compactTimer_->stop();
+
+    if (!storage_.isEmpty() && compact() && !old.isEmpty())
+        QFile::remove(journalFileName(old));
+}
+
+void EventQueue::writeJournal(const QByteArray &record)
+{
+    if (!journal_) {
+        // the journal couldn't be opened: save the whole queue instead and try to open it again
+        if (!storage_.isEmpty())
+            compact();
+        return;
+    }
+
+    journal_->write(record + '\n');
+    journal_->flush();
+    if (++journalRecords_ > qMax(CompactMinRecords, list_.count()) && !compactTimer_->isActive())
+        compactTimer_->start();
+}
+
+// writes a new snapshot and starts an empty journal
+bool EventQueue::compact()
+{
+    if (storage_.isEmpty())
+        return false;
+
+    compactTimer_->stop();
+    ++generation_;
+    if (!toFile(storage_)) {
+        qWarning("EventQueue: failed to save %s", qPrintable(storage_));
+        --generation_; // keep appending to the journal of the old snapshot
+        return false;
+    }
+
+    delete journal_;
+    journal_        = new QFile(journalFileName(storage_), this);
+    journalRecords_ = 0;
+    if (!journal_->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("EventQueue: failed to open %s", qPrintable(journal_->fileName()));
+        delete journal_;
+        journal_ = nullptr;
+        return false;
+    }
+    journal_->write(QByteArray(JournalMagic) + ' ' + QByteArray::number(generation_) + '\n');
+    journal_->flush();
+    return true;
+}
+
 #include "psievent.moc"
@@ -28,6 +28,7 @@
 #include <QDateTime>
 #include <QDomDocument>
 #include <QDomElement>
+#include <QHash>
 #include <QList>
 #include <QObject>
 #include <QPointer>
@@ -36,6 +37,8 @@ class AvCall;
 class PsiAccount;
 class PsiCon;
 class QDomElement;
+class QFile;
+class QTimer;
 
 namespace XMPP {
 class FileTransfer;
@@ -345,8 +348,12 @@ public:
     PsiEvent::Ptr event() const;
 
 private:
+    friend class EventQueue;
+
     PsiEvent::Ptr e;
     int           v_id;
+    QString       jidKey;  // bare jid() and from() at enqueue time, for EventQueue indexes
+    QString       fromKey;
 };
 
 // event queue
@@ -390,16 +397,31 @@ public:
 
     bool toFile(const QString &fname);
     bool fromFile(const QString &fname);
+    void    setStorageFile(const QString &fname);
+    QString storageFile() const { return storage_; }
 
 signals:
     void eventFromXml(const PsiEvent::Ptr &);
     void queueChanged();
 
 private:
-    QList<EventItem *> list_;
-    PsiCon            *psi_;
-    PsiAccount        *account_;
-    bool               enabled_;
+    void insertItem(EventItem *);
+    void removeItem(EventItem *);
+    void writeJournal(const QByteArray &record);
+    bool compact();
+
+    QList<EventItem *>                 list_;
+    QHash<QString, QList<EventItem *>> byJid_; // bare jid() -> items in queue order
+    QHash<QString, QList<EventItem *>> byFrom_; // bare from() -> items in queue order
+    PsiCon                            *psi_;
+    PsiAccount                        *account_;
+    bool                               enabled_;
+
+    QString storage_;
+    QFile  *journal_        = nullptr;
+    QTimer *compactTimer_   = nullptr;
+    int     journalRecords_ = 0;
+    int     generation_     = 0;
 };
 
 #endif // PSIEVENT_H
@@ -161,7 +161,13 @@ void PsiRosterWidget::setContactList(PsiContactList *contactList)
     Q_ASSERT(contactList);
     Q_ASSERT(!contactList_);
     contactList_ = contactList;
-    connect(PsiOptions::instance(), SIGNAL(optionChanged(const QString &)), SLOT(optionChanged(const QString &)));
+    PsiOptions::instance()->watchOptions({ contactSortStyleOptionPath, showAgentsOptionPath, showHiddenOptionPath,
+                                           showSelfOptionPath, showOfflineOptionPath, allowAutoResizeOptionPath,
+                                           showScrollBarOptionPath, enableGroupsOptionPath },
+                                         this, [this](const QSet<QString> &options) {
+                                             for (const QString &option : options)
+                                                 optionChanged(option);
+                                         });
 
     connect(contactList_, SIGNAL(showAgentsChanged(bool)), SLOT(showAgentsChanged(bool)));
     connect(contactList_, SIGNAL(showHiddenChanged(bool)), SLOT(showHiddenChanged(bool)));
@@ -0,0 +1,92 @@
+/*
+ * rostersnapshot.cpp - compact on-disk copy of the account roster
+ * Copyright (C) 2026  Psi+ Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "rostersnapshot.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+using namespace XMPP;
+
+static const quint32 snapshotMagic   = 0x50525354; // "PRST"
+static const quint32 snapshotVersion = 1;
+
+bool RosterSnapshot::load(const QString &fileName, Roster &roster)
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_9);
+
+    quint32 magic, version, count;
+    QString rosterVersion;
+    in >> magic >> version;
+    if (magic != snapshotMagic || version != snapshotVersion)
+        return false;
+
+    in >> rosterVersion >> count;
+
+    Roster r;
+    r.reserve(int(count));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString     jid, name, subscription, ask;
+        QStringList groups;
+        in >> jid >> name >> subscription >> ask >> groups;
+
+        RosterItem   item;
+        Subscription s;
+        s.fromString(subscription);
+        item.setJid(Jid(jid));
+        item.setName(name);
+        item.setSubscription(s);
+        item.setAsk(ask);
+        item.setGroups(groups);
+        r += item;
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning("RosterSnapshot: %s is truncated or corrupted", qPrintable(fileName));
+        return false;
+    }
+
+    r.setVersion(rosterVersion);
+    roster = r;
+    return true;
+}
+
+bool RosterSnapshot::save(const QString &fileName, const Roster &roster)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath()); // a profile from an older version may have no cache dir
+    QSaveFile f(fileName);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_9);
+    out << snapshotMagic << snapshotVersion << roster.version() << quint32(roster.count());
+    for (const RosterItem &item : roster)
+        out << item.jid().full() << item.name() << item.subscription().toString() << item.ask() << item.groups();
+
+    return f.commit();
+}
@@ -0,0 +1,38 @@
+/*
+ * rostersnapshot.h - compact on-disk copy of the account roster
+ * Copyright (C) 2026  Psi+ Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ROSTERSNAPSHOT_H
+#define ROSTERSNAPSHOT_H
+
+#include "iris/xmpp_roster.h"
+
+#include <QString>
+
+/**
+ * Binary copy of the roster together with its XEP-0237 version.
+ * It's loaded before the account connects, so with a server supporting
+ * roster versioning an unchanged roster costs just an empty result.
+ */
+class RosterSnapshot {
+public:
+    static bool load(const QString &fileName, XMPP::Roster &roster);
+    static bool save(const QString &fileName, const XMPP::Roster &roster);
+};
+
+#endif // ROSTERSNAPSHOT_H
@@ -152,6 +152,7 @@ list(APPEND HEADERS
     groupchatdlg.h
     groupchattopicdlg.h
     groupmenu.h
+    highlightrules.h
     historycontactlistmodel.h
     historydlg.h
     historyimp.h
@@ -232,6 +233,7 @@ list(APPEND HEADERS
     resourcemenu.h
     rosteravatarframe.h
     rosteritemexchangetask.h
+    rostersnapshot.h
     rtparse.h
     searchdlg.h
     sendbuttonmenu.h
@@ -259,6 +261,7 @@ list(APPEND HEADERS
     voicecaller.h
     xdata_widget.h
     xmlconsole.h
+    xmltracebuffer.h
     )
 
 if(UNIX OR IS_WEBENGINE)
@@ -397,6 +400,7 @@ list(APPEND SOURCES
     groupchatdlg.cpp
     groupchattopicdlg.cpp
     groupmenu.cpp
+    highlightrules.cpp
     historycontactlistmodel.cpp
     historydlg.cpp
     historyimp.cpp
@@ -472,6 +476,7 @@ list(APPEND SOURCES
     resourcemenu.cpp
     rosteravatarframe.cpp
     rosteritemexchangetask.cpp
+    rostersnapshot.cpp
     rtparse.cpp
     searchdlg.cpp
     sendbuttonmenu.cpp
@@ -497,6 +502,7 @@ list(APPEND SOURCES
     voicecalldlg.cpp
     xdata_widget.cpp
     xmlconsole.cpp
+    xmltracebuffer.cpp
     )
 
 include(${PROJECT_SOURCE_DIR}/3rdparty/qite/libqite/libqite.cmake)
@@ -28,6 +28,19 @@ using namespace XMPP;
 
 // The maxlength of a chdata that gets put in one edit
 enum { MAXCHDATA = 1024 };
+// The chdata length after which queued edits are sent without waiting for flush()
+enum { MAXQUEUEDCHDATA = 16 * MAXCHDATA };
+// How long to wait for more incoming edits before reporting them (ms)
+enum { REMOTEUPDATEDELAY = 50 };
+
+// QDomNode can't be hashed, but copies of a node share its d-pointer
+class SxeNodeKey : public QDomNode {
+public:
+    SxeNodeKey(const QDomNode &node) : QDomNode(node) { }
+    const void *key() const { return impl; }
+};
+
+static const void *nodeKey(const QDomNode &node) { return SxeNodeKey(node).key(); }
 
 //----------------------------------------------------------------------------
 // SxeSession
@@ -35,11 +48,16 @@ enum { MAXCHDATA = 1024 };
 
 SxeSession::SxeSession(SxeManager *manager, const Jid &target, const QString &session, const Jid &ownJid,
                        bool groupChat, bool serverSupport, const QList<QString> &features) :
-    QObject(manager), session_(session), target_(target), ownJid_(ownJid), groupChat_(groupChat),
-    serverSupport_(serverSupport), queueing_(false), importing_(false), features_(features), uuidMaxPostfix_(0)
+    QObject(manager), session_(session), target_(target), ownJid_(ownJid), queuedOutgoingSize_(0),
+    groupChat_(groupChat), serverSupport_(serverSupport), queueing_(false), importing_(false), features_(features),
+    uuidMaxPostfix_(0)
 
 {
     setUUIDPrefix();
+
+    remoteUpdateTimer_.setSingleShot(true);
+    remoteUpdateTimer_.setInterval(REMOTEUPDATEDELAY);
+    connect(&remoteUpdateTimer_, &QTimer::timeout, this, [this]() { emit documentUpdated(true); });
 }
 
 SxeSession::~SxeSession()
@@ -61,10 +79,11 @@ void SxeSession::initializeDocument(const QDomDocument &doc)
     const auto &metas = recordByNodeId_.values();
     for (SxeRecord *meta : metas)
         meta->deleteLater();
-    // recordByNode_.clear();
+    recordByNode_.clear();
     recordByNodeId_.clear();
     queuedIncomingEdits_.clear();
     queuedOutgoingEdits_.clear();
+    queuedOutgoingSize_ = 0;
 
     // import prolog
     doc_.setContent(parseProlog(doc));
@@ -89,14 +108,15 @@ void SxeSession::processIncomingSxeElement(const QDomElement &sxe, const QString
         return;
     }
 
-    if (processSxe(sxe, id))
-        emit documentUpdated(true);
+    // report a burst of edits at once, since the document is rerendered in whole
+    if (processSxe(sxe, id) && !remoteUpdateTimer_.isActive())
+        remoteUpdateTimer_.start();
 }
 
 bool SxeSession::processSxe(const QDomElement &sxe, const QString &id)
 {
     // Don't accept duplicates
-    if (!id.isEmpty() && usedSxeIds_.contains(id)) {
+    if (!id.isEmpty() && usedSxeIdSet_.contains(id)) {
         qDebug() << QString("Tried to process a duplicate %1 (received: %2).")
                         .arg(sxe.attribute("id"))
                         .arg(usedSxeIds_.size())
@@ -105,7 +125,7 @@ bool SxeSession::processSxe(const QDomElement &sxe, const QString &id)
     }
 
     if (!id.isEmpty())
-        usedSxeIds_ += id;
+        addUsedSxeId(id);
 
     // store incoming edits when queueing
     if (queueing_) {
@@ -413,17 +433,23 @@ void SxeSession::setAttribute(const QDomNode &node, const QString &attribute, co
 }
 
 void SxeSession::setNodeValue(const QDomNode &node, const QString &value, int from, int n)
+{
+    if (applyNodeValue(node, value, from, n))
+        emit documentUpdated(false);
+}
+
+bool SxeSession::applyNodeValue(const QDomNode &node, const QString &value, int from, int n)
 {
     SxeRecord *meta = record(node);
 
     if (!meta) {
         qDebug() << "Trying to set value of " << node.nodeName() << " (a non-existent node) to \"" << value << "\"";
-        return;
+        return false;
     }
 
     if (!(node.isAttr() || node.isText())) {
         qDebug() << "Trying to set value of a non-attr/text node " << node.nodeName();
-        return;
+        return false;
     }
 
     // Check whether anythings changing:
@@ -434,14 +460,14 @@ void SxeSession::setNodeValue(const QDomNode &node, const QString &value, int fr
                             .arg(from)
                             .arg(n)
                             .arg(node.nodeValue().length());
-            return;
+            return false;
         }
         newValue = node.nodeValue().replace(from, n, value);
     } else
         newValue = value;
 
     if (newValue == node.nodeValue())
-        return;
+        return false;
 
     // Create the appropriate RecordEdit
     QHash<SxeRecordEdit::Key, QString> changes;
@@ -460,7 +486,7 @@ void SxeSession::setNodeValue(const QDomNode &node, const QString &value, int fr
     // send the edit to others
     queueOutgoingEdit(edit);
 
-    emit documentUpdated(false);
+    return true;
 }
 
 void SxeSession::flush()
@@ -468,6 +494,8 @@ void SxeSession::flush()
     if (queuedOutgoingEdits_.isEmpty())
         return;
 
+    queuedOutgoingSize_ = 0;
+
     // create the sxe element
     QDomDocument *doc = static_cast<SxeManager *>(parent())->client()->doc();
     QDomElement   sxe = doc->createElementNS(SXENS, "sxe");
@@ -498,13 +526,10 @@ QDomNode SxeSession::generateNewNode(const QDomNode node, const QString &parent,
             QString  full  = clone.nodeValue();
             clone.setNodeValue("");
             QDomNode newNode = generateNewNode(clone, parent, primaryWeight);
-            flush();
 
-            // append the value
-            for (int i = 0; i < full.length(); i += MAXCHDATA) {
-                setNodeValue(newNode, full.mid(i, MAXCHDATA), i, 0);
-                flush();
-            }
+            // append the value. queueOutgoingEdit() splits it into reasonably sized <sxe/>'s
+            for (int i = 0; i < full.length(); i += MAXCHDATA)
+                applyNodeValue(newNode, full.mid(i, MAXCHDATA), i, 0);
         } else {
             SxeEdit *edit = new SxeNewEdit(rid, node, parent, primaryWeight, false);
 
@@ -646,13 +671,12 @@ void SxeSession::reposition(const QDomNode &node, bool remote)
     }
 }
 
-// void SxeSession::addToLookup(const QDomNode &node, bool, const QString &rid) {
-// recordByNode_[node]
-//     = recordByNodeId_[rid];
-// }
-
-void SxeSession::handleNodeToBeAdded(const QDomNode &node, bool remote)
+void SxeSession::handleNodeToBeAdded(const QDomNode &node, bool remote, const QString &rid)
 {
+    SxeRecord *meta = record(rid);
+    if (meta)
+        recordByNode_.insert(nodeKey(node), meta);
+
     emit nodeToBeAdded(node, remote);
     reposition(node, remote);
     emit nodeAdded(node, remote);
@@ -673,14 +697,9 @@ void SxeSession::handleNodeToBeRemoved(const QDomNode &node, bool remote)
 
 void SxeSession::removeRecord(const QDomNode &node)
 {
-    QMutableHashIterator<QString, SxeRecord *> i(recordByNodeId_);
-
-    while (i.hasNext()) {
-        if (node == i.next().value()->node()) {
-            i.remove();
-            return;
-        }
-    }
+    SxeRecord *meta = recordByNode_.take(nodeKey(node));
+    if (meta)
+        recordByNodeId_.remove(meta->rid());
 }
 
 bool SxeSession::removeSmaller(SxeRecord *meta1, SxeRecord *meta2)
@@ -701,7 +720,11 @@ bool SxeSession::removeSmaller(SxeRecord *meta1, SxeRecord *meta2)
     }
 }
 
-void SxeSession::addUsedSxeId(QString id) { usedSxeIds_ += id; }
+void SxeSession::addUsedSxeId(QString id)
+{
+    usedSxeIds_ += id;
+    usedSxeIdSet_ += id;
+}
 
 QList<QString> SxeSession::usedSxeIds() { return usedSxeIds_; }
 
@@ -710,6 +733,9 @@ void SxeSession::queueOutgoingEdit(SxeEdit *edit)
     if (!importing_) {
         QDomElement el = edit->xml(doc_);
         queuedOutgoingEdits_.append(static_cast<SxeManager *>(parent())->client()->doc()->importNode(el, true));
+        queuedOutgoingSize_ += el.attribute("chdata").length();
+        if (queuedOutgoingSize_ >= MAXQUEUEDCHDATA)
+            flush();
     }
 }
 
@@ -723,15 +749,13 @@ SxeRecord *SxeSession::createRecord(const QString &id)
     SxeRecord *m        = new SxeRecord(id);
     recordByNodeId_[id] = m;
 
-    // once the node is actually created, add it to the lookup table
-    // connect(m, SIGNAL(nodeAdded(QDomNode, bool, QString)), SLOT(addToLookup(const QDomNode &, bool, const QString
-    // &)));
-
     // remove the node in case of a conflicting edit
     connect(m, SIGNAL(nodeRemovalRequired(QDomNode)), SLOT(removeNode(QDomNode)));
 
     // reposition and emit public signals as needed when record is changed
-    connect(m, SIGNAL(nodeToBeAdded(QDomNode, bool, QString)), SLOT(handleNodeToBeAdded(const QDomNode &, bool)));
+    connect(m, SIGNAL(nodeToBeAdded(QDomNode, bool, QString)),
+            SLOT(handleNodeToBeAdded(const QDomNode &, bool, const QString &)));
+
     connect(m, SIGNAL(nodeToBeMoved(QDomNode, bool)), SLOT(handleNodeToBeMoved(const QDomNode &, bool)));
     connect(m, SIGNAL(nodeToBeRemoved(QDomNode, bool)), SLOT(handleNodeToBeRemoved(const QDomNode &, bool)));
     connect(m, SIGNAL(chdataToBeChanged(QDomNode, bool)), SIGNAL(chdataToBeChanged(const QDomNode &, bool)));
@@ -748,15 +772,7 @@ SxeRecord *SxeSession::record(const QDomNode &node) const
     if (node.isNull())
         return nullptr;
 
-    // go through all the SxeRecord's
-    const auto &metas = recordByNodeId_.values();
-    for (SxeRecord *meta : metas) {
-        // qDebug() << QString("id: %1").arg(meta->rid()).toLatin1();
-        if (node == meta->node())
-            return meta;
-    }
-
-    return nullptr;
+    return recordByNode_.value(nodeKey(node));
 }
 
 void SxeSession::setUUIDPrefix(const QString uuidPrefix)
@@ -24,9 +24,12 @@
 #include "sxerecord.h"
 
 #include <QDomNode>
+#include <QHash>
 #include <QList>
 #include <QObject>
 #include <QPointer>
+#include <QSet>
+#include <QTimer>
 
 #define SXENS "http://jabber.org/protocol/sxe"
 /*  ^^^^ make sure corresponds to NS used for parsing in iris/src/xmpp/xmpp-im/types.cpp ^^^^ */
@@ -141,7 +144,9 @@ signals:
     /*! \brief used to pass the new <sxe/> elements to sxemanager.*/
     void newSxeElement(const QDomElement &element, const Jid &, bool groupChat);
 
-    /*! \brief Emitted after each processed SXE element.*/
+    /*! \brief Emitted after SXE elements have been processed.
+     *  A burst of incoming elements is reported once.
+     */
     void documentUpdated(bool remote);
     /*! \brief Emitted just before \a node is inserted.*/
     void nodeToBeAdded(const QDomNode &node, bool remote);
@@ -170,14 +175,12 @@ signals:
     void sessionEnded(SxeSession *);
 
 private slots:
-    /*! \brief Adds \a node to the document tree and emits the appropriate public signals. */
-    void handleNodeToBeAdded(const QDomNode &node, bool remote);
+    /*! \brief Adds \a node to the lookup table and the document tree and emits the appropriate public signals. */
+    void handleNodeToBeAdded(const QDomNode &node, bool remote, const QString &rid);
     /*! \brief Moves \a node in the document tree and emits the appropriate public signals. */
     void handleNodeToBeMoved(const QDomNode &node, bool remote);
     /*! \brief Remove the record entry from the lookup tables and emit the appropriate public signals. */
     void handleNodeToBeRemoved(const QDomNode &node, bool remote);
-    /*! \brief Add a node node to the lookup table. */
-    // void addToLookup(const QDomNode &node, bool, const QString &rid);
 
 private:
     /*! \brief Inserts or moves a node according to it's record (parent and primary-weight). */
@@ -189,8 +192,13 @@ private:
     bool removeSmaller(SxeRecord *meta1, SxeRecord *meta2);
     /*! \brief Processes an incoming sxe element.*/
     bool processSxe(const QDomElement &sxe, const QString &id);
-    /*! \brief Queues an outgoing edit to be sent when flushed.*/
+    /*! \brief Queues an outgoing edit to be sent when flushed.
+     *  Flushes by itself once the queued edits get big.
+     */
     void queueOutgoingEdit(SxeEdit *edit);
+    /*! \brief Same as setNodeValue() but doesn't emit documentUpdated().
+     *  Returns true if the value was changed. */
+    bool applyNodeValue(const QDomNode &node, const QString &value, int from, int n);
     /*! \brief Creates the record of node with rid \a id. Returns a pointer to it. */
     SxeRecord *createRecord(const QString &id);
     /*! \brief Returns a pointer to the record of node with rid \a id. */
@@ -224,10 +232,16 @@ private:
 
     /*! \brief Hash used for rid -> SxeRecord* lookups.*/
     QHash<QString, SxeRecord *> recordByNodeId_;
+    /*! \brief Hash used for node -> SxeRecord* lookups, keyed by the node's d-pointer.*/
+    QHash<const void *, SxeRecord *> recordByNode_;
     /*! \brief List of queued incoming sxe elements.*/
     QList<IncomingEdit> queuedIncomingEdits_;
     /*! \brief List of queued outgoing sxe elements.*/
     QList<QDomNode> queuedOutgoingEdits_;
+    /*! \brief Total length of chdata in queuedOutgoingEdits_.*/
+    int queuedOutgoingSize_;
+    /*! \brief Delays documentUpdated(true) so a burst of incoming elements is reported once.*/
+    QTimer remoteUpdateTimer_;
     /*! \brief QDomDocument representing the the contents when queueing_ was set true.*/
     QList<SxeEdit *> snapshot_;
     /*! \brief True if the target is a groupchat.*/
@@ -242,6 +256,8 @@ private:
     QList<QString> features_;
     /*! \brief Identifiers for the <sxe/> elements that have been processed already.*/
     QList<QString> usedSxeIds_;
+    /*! \brief Same as usedSxeIds_ for fast lookups.*/
+    QSet<QString> usedSxeIdSet_;
     /*! \brief A unique id is generated as "uuidPrefix.counter".*/
     QString uuidPrefix_;
     int     uuidMaxPostfix_;
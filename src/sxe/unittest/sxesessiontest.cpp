@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "sxe/sxesession.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QSignalSpy>
+#include <QtTest/QtTest>
+
+static const int PathCount = 2000;
+
+class SxeSessionTest : public QObject {
+    Q_OBJECT
+
+private:
+    static QDomElement sxe(QDomDocument &doc)
+    {
+        QDomElement el = doc.createElementNS("urn:xmpp:tmp:sxe", "sxe");
+        doc.appendChild(el);
+        return el;
+    }
+
+    static void addNew(QDomElement &sxe, const QString &rid, const QString &type, const QString &name,
+                       const QString &parent, int weight, const QString &chdata = QString())
+    {
+        QDomElement el = sxe.ownerDocument().createElement("new");
+        el.setAttribute("rid", rid);
+        el.setAttribute("type", type);
+        el.setAttribute("name", name);
+        el.setAttribute("parent", parent);
+        el.setAttribute("primary-weight", weight);
+        if (!chdata.isEmpty())
+            el.setAttribute("chdata", chdata);
+        sxe.appendChild(el);
+    }
+
+    // a whiteboard with PathCount freehand strokes, one <sxe/> per stroke as they arrive when drawn
+    static QList<QDomDocument> drawing()
+    {
+        QList<QDomDocument> ret;
+
+        QDomDocument root;
+        QDomElement  el = sxe(root);
+        addNew(el, "root", "element", "svg", QString(), 0);
+        ret << root;
+
+        QString d = "M 0 0";
+        for (int i = 1; i < 200; i++)
+            d += QString(" L %1 %2").arg(i).arg(i % 17);
+
+        for (int i = 0; i < PathCount; i++) {
+            QDomDocument doc;
+            QDomElement  el = sxe(doc);
+            addNew(el, QString("p%1").arg(i), "element", "path", "root", i);
+            addNew(el, QString("d%1").arg(i), "attr", "d", QString("p%1").arg(i), 0, d);
+            ret << doc;
+        }
+        return ret;
+    }
+
+private slots:
+    void benchmarkReplay()
+    {
+        SxeSession                session(nullptr, Jid("a@b"), "s", Jid("me@b"), false, true, {});
+        const QList<QDomDocument> edits = drawing();
+
+        QBENCHMARK
+        {
+            session.startImporting();
+            for (const QDomDocument &doc : edits)
+                session.processIncomingSxeElement(doc.documentElement(), QString());
+            session.stopImporting();
+        }
+
+        QCOMPARE(session.document().documentElement().elementsByTagName("path").size(), PathCount);
+    }
+
+    void testIncomingBurst_UpdatesOnce()
+    {
+        SxeSession session(nullptr, Jid("a@b"), "s", Jid("me@b"), false, true, {});
+        QSignalSpy spy(&session, SIGNAL(documentUpdated(bool)));
+
+        QList<QDomDocument> edits = drawing().mid(0, 11);
+        for (int i = 0; i < edits.size(); i++)
+            session.processIncomingSxeElement(edits[i].documentElement(), QString("sxe%1").arg(i));
+
+        QDomDocument doc;
+        QDomElement  el     = sxe(doc);
+        QDomElement  remove = doc.createElement("remove");
+        remove.setAttribute("rid", "p3");
+        el.appendChild(remove);
+        QDomElement set = doc.createElement("set");
+        set.setAttribute("rid", "d5");
+        set.setAttribute("version", 1);
+        set.setAttribute("chdata", "M 1 1");
+        el.appendChild(set);
+        session.processIncomingSxeElement(el, "sxe-edit");
+
+        // duplicates are ignored
+        session.processIncomingSxeElement(edits[4].documentElement(), "sxe4");
+
+        QTRY_COMPARE(spy.count(), 1);
+        QCOMPARE(spy.at(0).at(0).toBool(), true);
+
+        QDomNodeList paths = session.document().documentElement().elementsByTagName("path");
+        QCOMPARE(paths.size(), 9);
+        QCOMPARE(paths.at(4).toElement().attribute("d"), QString("M 1 1"));
+        QCOMPARE(session.usedSxeIds().size(), 12);
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(SxeSessionTest);
+#include "sxesessiontest.moc"
@@ -34,7 +34,8 @@
 //----------------------------------------------------------------------------
 
 TabbableWidget::TabbableWidget(const Jid &jid, PsiAccount *pa, TabManager *tabManager) :
-    AdvancedWidget<QWidget>(nullptr), state_(ActivationState::Deactivated), jid_(jid), pa_(pa), tabManager_(tabManager)
+    AdvancedWidget<QWidget>(nullptr), state_(ActivationState::Deactivated), jid_(jid), pa_(pa), tabManager_(tabManager),
+    hibernated_(false)
 {
     if (TabbableWidget::chatsCount == 0) {
         TabbableWidget::templateMenu = new SendButtonTemplatesMenu(nullptr);
@@ -55,6 +56,7 @@ TabbableWidget::TabbableWidget(const Jid &jid, PsiAccount *pa, TabManager *tabMa
             deactivated();
         }
     });
+    hiddenTimer_.start();
     // QTimer::singleShot(0, this, SLOT(ensureTabbedCorrectly()));
 }
 
@@ -177,6 +179,27 @@ void TabbableWidget::deactivated() { }
 
 void TabbableWidget::activated() { }
 
+/**
+ * Called when the tab has been hidden long enough to release whatever
+ * can be restored later. Returns true if wakeUp() is needed to restore it.
+ */
+bool TabbableWidget::hibernate() { return false; }
+
+/**
+ * Restores what hibernate() released. Called when the tab is shown again.
+ */
+void TabbableWidget::wakeUp() { }
+
+/**
+ * Hibernates the tab if it hasn't been shown for \a msecs.
+ */
+void TabbableWidget::hibernateIfHidden(qint64 msecs)
+{
+    if (!hibernated_ && hiddenTimer_.isValid() && hiddenTimer_.elapsed() >= msecs) {
+        hibernated_ = hibernate();
+    }
+}
+
 /**
  * Returns true if this tab is active in the active window.
  */
@@ -202,6 +225,11 @@ TabbableWidget::State TabbableWidget::state() const { return TabbableWidget::Sta
 
 int TabbableWidget::unreadMessageCount() const { return 0; }
 
+/**
+ * Extra information shown in the tooltip of the tab, e.g. about its unloaded view.
+ */
+QString TabbableWidget::tabToolTip() const { return QString(); }
+
 /**
  * Use this to invalidate tab state.
  */
@@ -227,6 +255,22 @@ void TabbableWidget::changeEvent(QEvent *event)
     }
 }
 
+void TabbableWidget::showEvent(QShowEvent *e)
+{
+    hiddenTimer_.invalidate();
+    if (hibernated_) {
+        hibernated_ = false;
+        wakeUp();
+    }
+    AdvancedWidget<QWidget>::showEvent(e);
+}
+
+void TabbableWidget::hideEvent(QHideEvent *e)
+{
+    hiddenTimer_.start();
+    AdvancedWidget<QWidget>::hideEvent(e);
+}
+
 /**
  * Set the icon of the tab.
  */
@@ -24,6 +24,7 @@
 #include "iris/im.h" // ChatState
 #include "sendbuttonmenu.h"
 
+#include <QElapsedTimer>
 #include <QIcon>
 #include <QTimer>
 
@@ -66,8 +67,11 @@ public:
     virtual State   state() const              = 0;
     virtual int     unreadMessageCount() const = 0;
     virtual QString desiredCaption() const     = 0;
+    virtual QString tabToolTip() const;
     virtual void    setVSplitterPosition(int, int) { } // default implementation do nothing
 
+    void hibernateIfHidden(qint64 msecs);
+
     // Templates
     SendButtonTemplatesMenu *getTemplateMenu();
     void                     showTemplateEditor();
@@ -89,9 +93,13 @@ protected:
     virtual void setJid(const Jid &);
     virtual void deactivated();
     virtual void activated();
+    virtual bool hibernate();
+    virtual void wakeUp();
 
     // reimplemented
     void changeEvent(QEvent *e);
+    void showEvent(QShowEvent *e);
+    void hideEvent(QHideEvent *e);
 
 private:
     enum class ActivationState : char { Activated, Deactivated };
@@ -102,6 +110,9 @@ private:
     PsiAccount *pa_;
     TabManager *tabManager_;
     QIcon       icon_;
+
+    QElapsedTimer hiddenTimer_; // invalid while the tab is shown
+    bool          hibernated_;
     // Templates
     static int                                 chatsCount;
     static SendButtonTemplatesMenu            *templateMenu;
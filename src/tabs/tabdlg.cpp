@@ -562,7 +562,7 @@ QString TabDlg::captionForTab(TabbableWidget *tab) const
 
 void TabDlg::updateTab(TabbableWidget *chat)
 {
-    tabWidget_->setTabText(chat, captionForTab(chat));
+    tabWidget_->setTabText(chat, captionForTab(chat), chat->tabToolTip());
     // now set text colour based upon whether there are new messages/composing etc
 
     TabbableWidget::State state = chat->state();
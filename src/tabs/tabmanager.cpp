@@ -5,12 +5,18 @@
 #include "tabbablewidget.h"
 #include "tabdlg.h"
 
+#include <QTimer>
 #include <QtAlgorithms>
 
+static const int HibernationCheckInterval = 60000; // ms
+
 TabManager::TabManager(PsiCon *psiCon, QObject *parent) :
     QObject(parent), psiCon_(psiCon), tabDlgDelegate_(nullptr), userManagement_(true), tabSingles_(true),
     simplifiedCaption_(false)
 {
+    auto hibernationTimer = new QTimer(this);
+    connect(hibernationTimer, &QTimer::timeout, this, &TabManager::hibernateTabs);
+    hibernationTimer->start(HibernationCheckInterval);
 }
 
 TabManager::~TabManager() { deleteAll(); }
@@ -140,6 +146,19 @@ TabDlg *TabManager::getManagingTabs(const TabbableWidget *chat) const
 
 const QList<TabDlg *> &TabManager::tabSets() { return tabs_; }
 
+void TabManager::hibernateTabs()
+{
+    int minutes = PsiOptions::instance()->getOption("options.ui.tabs.hibernation.inactive-time").toInt();
+    if (minutes <= 0) {
+        return;
+    }
+    for (TabDlg *tabDlg : std::as_const(tabs_)) {
+        for (int i = 0; i < tabDlg->tabCount(); i++) {
+            tabDlg->getTab(i)->hibernateIfHidden(qint64(minutes) * 60000);
+        }
+    }
+}
+
 void TabManager::deleteAll()
 {
     qDeleteAll(tabs_);
@@ -117,6 +117,11 @@ public slots:
     void tabDestroyed(QObject *);
 
 private:
+    /**
+     * releases chat views of tabs which stay in the background for too long
+     */
+    void hibernateTabs();
+
     QMap<QChar, TabDlg *>   preferedTabsetForKind_;
     QMap<TabDlg *, QString> tabsetToKinds_;
     QList<TabDlg *>         tabs_;
@@ -29,14 +29,18 @@
 #include <QThread>
 #include <QTimer>
 
+#include <climits>
+#include <memory>
+
 /**
  * \class Anim
  * \brief Class for handling animations
  *
  * Anim is a class that can load animations. Generally, it looks like
- * QMovie but it loads animations in one pass and stores it in memory.
+ * QMovie but it keeps decoded frames in memory.
  *
- * Each frame of Anim is stored as Impix.
+ * Frames are decoded on demand, as the animation reaches them, and each
+ * decoded frame is stored as Impix.
  */
 
 static QThread *animMainThread = nullptr;
@@ -61,9 +65,16 @@ public:
         int   period = 100;
     };
 
-    QList<Frame> frames;
+    QList<Frame> frames; // decoded so far
     int          frame;
 
+    // on-demand decoding state
+    QByteArray                    data;
+    std::unique_ptr<QBuffer>      buffer;
+    std::unique_ptr<QImageReader> reader;
+    int                           totalFrames = 0;
+    int                           skipFrames  = 0; // stripped frames not decoded yet
+
 public:
     void init()
     {
@@ -89,6 +100,9 @@ public:
     {
         init();
 
+        const_cast<Private &>(from).decodeAll();
+        totalFrames = from.frames.count();
+
         speed             = from.speed;
         lasttimerinterval = from.lasttimerinterval;
         looping           = from.looping;
@@ -105,25 +119,20 @@ public:
     {
         init();
 
-        QBuffer buffer(const_cast<QByteArray *>(ba));
-        buffer.open(QBuffer::ReadOnly);
-        QImageReader reader(&buffer);
-
-        while (reader.canRead()) {
-            QImage image = reader.read();
-            if (!image.isNull()) {
-                Frame newFrame;
-                newFrame.impix  = Impix(image);
-                newFrame.period = reader.nextImageDelay();
-                frames.append(newFrame);
-            } else {
-                break;
-            }
-        }
+        data   = *ba;
+        buffer = std::make_unique<QBuffer>(&data);
+        buffer->open(QBuffer::ReadOnly);
+        reader = std::make_unique<QImageReader>(buffer.get());
 
-        looping = reader.loopCount();
+        // animated formats report their frame count without decoding pixels,
+        // so only the first frame is decoded here and the rest when shown
+        bool animated = reader->supportsAnimation();
+        bool lazy     = animated && reader->imageCount() > 1;
+        looping       = reader->loopCount();
+        totalFrames   = lazy ? reader->imageCount() : INT_MAX;
+        decodeTo(lazy ? 0 : INT_MAX - 1);
 
-        if (!reader.supportsAnimation() && (frames.count() == 1)) {
+        if (!animated && (frames.count() == 1)) {
             QImage frame = frames[0].impix.image();
 
             // we're gonna slice the single image we've got if we're absolutely sure
@@ -139,8 +148,9 @@ public:
                     newFrames.append(newFrame);
                 }
 
-                frames  = newFrames;
-                looping = 0;
+                frames      = newFrames;
+                totalFrames = frames.count();
+                looping     = 0;
             }
         }
     }
@@ -170,12 +180,60 @@ public:
             restartTimer();
     }
 
-    int numFrames() const { return frames.count(); }
+    int numFrames() const { return totalFrames; }
+
+    // decodes frames up to \a n, returns false if that frame doesn't exist
+    bool decodeTo(int n)
+    {
+        while (frames.count() <= n && frames.count() < totalFrames) {
+            if (!reader || !reader->canRead()) {
+                totalFrames = frames.count();
+                releaseReader();
+                break;
+            }
+            QImage image = reader->read();
+            if (image.isNull()) {
+                totalFrames = frames.count();
+                releaseReader();
+                break;
+            }
+            if (skipFrames > 0) {
+                --skipFrames;
+                continue;
+            }
+            Frame newFrame;
+            newFrame.impix  = Impix(image);
+            newFrame.period = reader->nextImageDelay();
+            frames.append(newFrame);
+        }
+        if (frames.count() == totalFrames) {
+            releaseReader();
+        }
+        return n < frames.count();
+    }
+
+    void decodeAll() { decodeTo(totalFrames - 1); }
+
+    void releaseReader()
+    {
+        reader.reset();
+        buffer.reset();
+        data.clear();
+    }
+
+    const Frame &frameAt(int n)
+    {
+        static const Frame none;
+        decodeTo(n);
+        if (frames.isEmpty())
+            return none; // nothing could be decoded
+        return frames[qBound(0, n, frames.count() - 1)];
+    }
 
     void restartTimer()
     {
         if (!paused && speed > 0) {
-            int frameperiod = frames[frame].period;
+            int frameperiod = frameAt(frame).period;
             int i           = frameperiod >= 0 ? frameperiod * 100 / speed : 0;
             if (i != lasttimerinterval || !frametimer->isActive()) {
                 lasttimerinterval = i;
@@ -193,7 +251,7 @@ public slots:
     void refresh()
     {
         frame++;
-        if (frame >= numFrames()) {
+        if (frame >= numFrames() || !decodeTo(frame)) {
             frame = 0;
 
             loop++;
@@ -233,17 +291,17 @@ Anim::~Anim() { }
 /**
  * Returns QPixmap of current frame.
  */
-const QPixmap &Anim::framePixmap() const { return d->frames[d->frame].impix.pixmap(); }
+const QPixmap &Anim::framePixmap() const { return frameImpix().pixmap(); }
 
 /**
  * Returns QImage of current frame.
  */
-const QImage &Anim::frameImage() const { return d->frames[d->frame].impix.image(); }
+const QImage &Anim::frameImage() const { return frameImpix().image(); }
 
 /**
  * Returns Impix of current frame.
  */
-const Impix &Anim::frameImpix() const { return d->frames[d->frame].impix; }
+const Impix &Anim::frameImpix() const { return const_cast<Private *>(d.constData())->frameAt(d->frame).impix; }
 
 /**
  * Returns total number of frames in animation.
@@ -258,7 +316,7 @@ int Anim::frameNumber() const { return d->frame; }
 /**
  * Returns Impix of animation frame number \a n.
  */
-const Impix &Anim::frame(int n) const { return d->frames[n].impix; }
+const Impix &Anim::frame(int n) const { return const_cast<Private *>(d.constData())->frameAt(n).impix; }
 
 /**
  * Returns \c true if numFrames() == 0 and \c false otherwise.
@@ -356,7 +414,15 @@ void Anim::stripFirstFrame()
 {
     detach();
     if (numFrames() > 1) {
-        d->frames.takeFirst();
+        if (d->frames.isEmpty()) {
+            d->skipFrames++;
+        } else {
+            d->frames.takeFirst();
+        }
+        d->totalFrames--;
+        if (d->frame >= d->totalFrames) {
+            d->frame = 0;
+        }
 
         if (!paused())
             restart();
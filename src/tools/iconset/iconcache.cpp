@@ -0,0 +1,293 @@
+/*
+ * iconcache.cpp - on-disk cache of decoded icons
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "iconcache.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QTimer>
+
+/**
+ * \class IconCache
+ * \brief Keeps decoded still icons of one iconset on disk
+ *
+ * The cache file is keyed by the iconset location, its modification time
+ * and the device pixel ratio. It is memory-mapped on load and the cached
+ * QImages point directly into the mapping, so icons found in the cache are
+ * neither inflated nor decoded.
+ *
+ * A mapped file stays open while its icons are in use and can't be replaced
+ * on Windows then, so every save writes a new generation of the file,
+ * <key hash>.<generation>.icache. Older generations are removed once nothing
+ * maps them.
+ *
+ * File layout: magic, version, count, then per icon its name, geometry,
+ * format and data offset, followed by the 16-byte aligned pixel data.
+ */
+
+static const quint32 CacheMagic   = 0x50534943; // "PSIC"
+static const quint32 CacheVersion = 1;
+static const int     SaveDelay    = 5000; // msecs
+
+static QMutex                                   registryMutex;
+static QString                                  cacheDir;
+static QHash<QString, std::weak_ptr<IconCache>> registry;
+
+struct IconCache::Mapping {
+    QFile  file;
+    uchar *data = nullptr;
+};
+
+/**
+ * Sets the directory for cache files. Caching is disabled while it is empty.
+ */
+void IconCache::setCacheDir(const QString &dir)
+{
+    QMutexLocker locker(&registryMutex);
+    cacheDir = dir;
+}
+
+/**
+ * Returns the cache of the iconset at \a source (directory, archive or resource)
+ * described by \a manifest, or \c nullptr when caching is disabled.
+ */
+std::shared_ptr<IconCache> IconCache::forSource(const QString &source, const QString &manifest)
+{
+    QMutexLocker locker(&registryMutex);
+    if (cacheDir.isEmpty()) {
+        return nullptr;
+    }
+
+    QFileInfo fi(source);
+    QDateTime stamp = fi.lastModified();
+    qint64    size  = fi.size();
+    if (fi.isDir()) {
+        // an image may be replaced without touching the manifest, so the newest file counts
+        stamp = QFileInfo(source + QLatin1Char('/') + manifest).lastModified();
+        size  = 0;
+        QDirIterator it(source, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            stamp = qMax(stamp, it.fileInfo().lastModified());
+            size += it.fileInfo().size();
+        }
+    }
+    if (!stamp.isValid()) { // compiled-in resources change with the binary only
+        stamp = QFileInfo(QCoreApplication::applicationFilePath()).lastModified();
+    }
+    qreal   dpr = qGuiApp ? qGuiApp->devicePixelRatio() : 1.0;
+    QString key = fi.absoluteFilePath() + QLatin1Char('|') + QString::number(stamp.toMSecsSinceEpoch())
+        + QLatin1Char('|') + QString::number(size) + QLatin1Char('|') + QString::number(dpr);
+
+    auto &weak  = registry[key];
+    auto  cache = weak.lock();
+    if (!cache) {
+        QString name = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+        cache.reset(new IconCache(cacheDir + QLatin1Char('/') + name));
+        weak = cache;
+    }
+    return cache;
+}
+
+IconCache::IconCache(const QString &baseName) : baseName_(baseName) { load(); }
+
+IconCache::~IconCache()
+{
+    if (dirty_) {
+        save();
+    }
+}
+
+/**
+ * Returns the cached image of icon \a name, or a null image.
+ */
+QImage IconCache::image(const QString &name) const
+{
+    QMutexLocker locker(&mutex_);
+    return images_.value(name);
+}
+
+/**
+ * Adds a freshly decoded icon. The file is rewritten a few seconds later.
+ */
+void IconCache::insert(const QString &name, const QImage &image)
+{
+    if (image.isNull()) {
+        return;
+    }
+    QMutexLocker locker(&mutex_);
+    if (images_.contains(name)) {
+        return;
+    }
+    images_.insert(name, image.convertToFormat(QImage::Format_ARGB32_Premultiplied));
+    dirty_ = true;
+    scheduleSave();
+}
+
+void IconCache::scheduleSave()
+{
+    if (saveScheduled_ || !QCoreApplication::instance()) {
+        return;
+    }
+    saveScheduled_ = true;
+    std::weak_ptr<IconCache> weak = shared_from_this();
+    QTimer::singleShot(SaveDelay, QCoreApplication::instance(), [weak]() {
+        if (auto cache = weak.lock()) {
+            cache->save();
+        }
+    });
+}
+
+QString IconCache::fileName(int generation) const
+{
+    return baseName_ + QLatin1Char('.') + QString::number(generation) + QLatin1String(".icache");
+}
+
+void IconCache::load()
+{
+    // pick the newest generation and clean up the rest
+    QFileInfo   base(baseName_);
+    QStringList files = base.dir().entryList({ base.fileName() + QLatin1String(".*.icache") }, QDir::Files);
+    for (auto const &file : std::as_const(files)) {
+        generation_ = qMax(generation_, file.section(QLatin1Char('.'), -2, -2).toInt());
+    }
+    for (auto const &file : std::as_const(files)) {
+        if (file.section(QLatin1Char('.'), -2, -2).toInt() != generation_) {
+            base.dir().remove(file);
+        }
+    }
+    if (files.isEmpty()) {
+        return;
+    }
+
+    fileName_    = fileName(generation_);
+    auto mapping = std::make_shared<Mapping>();
+    mapping->file.setFileName(fileName_);
+    if (!mapping->file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    qint64 size   = mapping->file.size();
+    mapping->data = mapping->file.map(0, size);
+    if (!mapping->data) {
+        return;
+    }
+
+    QByteArray  header = QByteArray::fromRawData(reinterpret_cast<const char *>(mapping->data), int(size));
+    QDataStream in(header);
+    in.setVersion(QDataStream::Qt_5_9);
+
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version >> count;
+    if (magic != CacheMagic || version != CacheVersion) {
+        return;
+    }
+
+    QHash<QString, QImage> images;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString name;
+        qint32  width, height, bytesPerLine, format;
+        quint64 offset;
+        in >> name >> width >> height >> bytesPerLine >> format >> offset;
+        // insert() stores everything as ARGB32_Premultiplied, 4 bytes a pixel
+        if (in.status() != QDataStream::Ok || width <= 0 || height <= 0 || width > 0x7fff || height > 0x7fff
+            || format != QImage::Format_ARGB32_Premultiplied || bytesPerLine < width * 4 || bytesPerLine % 4
+            || offset % 16 || offset + quint64(bytesPerLine) * quint64(height) > quint64(size)) {
+            qWarning("IconCache: %s is corrupted", qPrintable(fileName_));
+            return;
+        }
+        // the image borrows the mapped memory; keep the mapping alive while it is referenced
+        auto         keeper = new std::shared_ptr<Mapping>(mapping);
+        const uchar *bits   = mapping->data + offset; // read-only: QImage copies on write
+        images.insert(name,
+                      QImage(
+                          bits, width, height, bytesPerLine, QImage::Format(format),
+                          [](void *info) { delete static_cast<std::shared_ptr<Mapping> *>(info); }, keeper));
+    }
+
+    images_  = images;
+    mapping_ = mapping;
+}
+
+/**
+ * Writes all known icons to the cache file. Returns \c true on success.
+ */
+bool IconCache::save()
+{
+    QMutexLocker locker(&mutex_);
+    saveScheduled_ = false;
+    if (!dirty_) {
+        return true;
+    }
+    QDir().mkpath(QFileInfo(baseName_).absolutePath());
+
+    // offsets have a fixed width, so the index is serialized once to learn its size
+    auto writeIndex = [this](quint64 dataStart) {
+        QByteArray  index;
+        QDataStream out(&index, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_9);
+        out << CacheMagic << CacheVersion << quint32(images_.size());
+        quint64 offset = dataStart;
+        for (auto it = images_.cbegin(); it != images_.cend(); ++it) {
+            const QImage &img = it.value();
+            out << it.key() << qint32(img.width()) << qint32(img.height()) << qint32(img.bytesPerLine())
+                << qint32(img.format()) << offset;
+            offset += (quint64(img.sizeInBytes()) + 15) & ~quint64(15);
+        }
+        return index;
+    };
+    quint64    dataStart = (quint64(writeIndex(0).size()) + 15) & ~quint64(15);
+    QByteArray index     = writeIndex(dataStart);
+
+    QString   newFileName = fileName(generation_ + 1);
+    QSaveFile file(newFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(index);
+    file.write(QByteArray(int(dataStart - quint64(index.size())), '\0'));
+    for (auto it = images_.cbegin(); it != images_.cend(); ++it) {
+        const QImage &img     = it.value();
+        qint64        written = file.write(reinterpret_cast<const char *>(img.constBits()), img.sizeInBytes());
+        int           padding = int(((quint64(written) + 15) & ~quint64(15)) - quint64(written));
+        file.write(QByteArray(padding, '\0'));
+    }
+    if (!file.commit()) {
+        qWarning("IconCache: failed to write %s", qPrintable(newFileName));
+        return false;
+    }
+    // icons still using the old file keep it mapped. it's unmapped with the last of them,
+    // and removed here or with the next load
+    mapping_.reset();
+    if (!fileName_.isEmpty()) {
+        QFile::remove(fileName_);
+    }
+    fileName_ = newFileName;
+    generation_++;
+    dirty_ = false;
+    return true;
+}
@@ -0,0 +1,59 @@
+/*
+ * iconcache.h - on-disk cache of decoded icons
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+#include <memory>
+
+class IconCache : public std::enable_shared_from_this<IconCache> {
+public:
+    static void                       setCacheDir(const QString &dir);
+    static std::shared_ptr<IconCache> forSource(const QString &source, const QString &manifest);
+
+    ~IconCache();
+
+    QImage image(const QString &name) const;
+    void   insert(const QString &name, const QImage &image);
+    bool   save();
+
+private:
+    struct Mapping;
+
+    explicit IconCache(const QString &baseName);
+    QString fileName(int generation) const;
+    void    load();
+    void    scheduleSave();
+
+    mutable QMutex           mutex_;
+    QString                  baseName_;
+    QString                  fileName_; // the loaded file, if any
+    int                      generation_ = 0;
+    QHash<QString, QImage>   images_;
+    std::shared_ptr<Mapping> mapping_;
+    bool                     dirty_         = false;
+    bool                     saveScheduled_ = false;
+};
+
+#endif // ICONCACHE_H
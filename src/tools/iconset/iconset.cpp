@@ -29,6 +29,7 @@
 #include "iconset.h"
 
 #include "anim.h"
+#include "iconcache.h"
 #ifdef ICONSET_ZIP
 #include "zip/zip.h"
 #endif
@@ -43,6 +44,8 @@
 #include <QIcon>
 #include <QIconEngine>
 #include <QLocale>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QObject>
 #include <QPainter>
 #include <QRegularExpression>
@@ -274,6 +277,9 @@ public:
         anim.reset(from.anim ? new Anim(*from.anim) : nullptr);
         icon           = nullptr;
         activatedCount = from.activatedCount;
+        source         = from.source;
+        pending.reset(from.pending ? new DeferredData(*from.pending) : nullptr);
+        stripFirstFrame = from.stripFirstFrame;
     }
 
     void connectInstance(PsiIcon *icon)
@@ -293,8 +299,85 @@ signals:
     void iconModified();
 
 public:
+    // decodes the deferred image, if any. all shared copies benefit from it
+    void decode() const
+    {
+        if (pending) {
+            const_cast<Private *>(this)->decodePending();
+        }
+    }
+
+    void decodePending()
+    {
+        auto deferred = std::move(pending);
+        if (!deferred->image.isNull()) {
+            setImpix(deferred->image);
+            return;
+        }
+
+        QByteArray ba = deferred->data ? deferred->data() : QByteArray();
+        if (ba.isEmpty() || !setData(ba, deferred->isAnimation, deferred->isScalable)) {
+            qWarning("PsiIcon: failed to decode %s (%s)", qPrintable(name), qPrintable(mime));
+            return;
+        }
+        if (source) {
+            rawData.clear(); // raw() reads it again if ever needed
+        }
+        if (anim && stripFirstFrame) {
+            anim->stripFirstFrame();
+        }
+        if (!anim && !svgRenderer && deferred->decoded) {
+            deferred->decoded(impix.image());
+        }
+    }
+
+    bool setData(const QByteArray &ba, bool isAnim, bool isScalable)
+    {
+        rawData  = ba;
+        scalable = isScalable;
+        svgRenderer.reset();
+        if (scalable) {
+            svgRenderer = std::make_shared<QSvgRenderer>(ba);
+            if (!svgRenderer->isValid()) {
+                svgRenderer.reset();
+            }
+        }
+        if (svgRenderer) {
+            return true;
+        }
+
+        if (isAnim) {
+            anim = std::make_unique<Anim>(ba);
+            bool ok = anim->numFrames() > 0;
+            if (ok) {
+                setImpix(anim->frame(0));
+            }
+            if (anim->numFrames() < 2) {
+                anim.reset();
+            }
+            if (ok) {
+                return true;
+            }
+        }
+
+        Impix loaded;
+        if (loaded.loadFromData(ba)) {
+            setImpix(loaded);
+            return true;
+        }
+        return false;
+    }
+
+    void setImpix(const Impix &newImpix)
+    {
+        impix = newImpix;
+        delete icon;
+        icon = nullptr;
+    }
+
     QPixmap pixmap(const QSize &desiredSize = QSize()) const
     {
+        decode();
         if (svgRenderer) {
             QSize   sz = desiredSize.isEmpty() ? svgRenderer->defaultSize()
                                                : svgRenderer->defaultSize().scaled(desiredSize, Qt::KeepAspectRatio);
@@ -328,6 +411,10 @@ public:
     mutable QByteArray            rawData;
     bool                          scalable = false;
 
+    std::function<QByteArray()>   source; // encoded data of deferred icons
+    std::unique_ptr<DeferredData> pending;
+    bool                          stripFirstFrame = false;
+
     int activatedCount = 0;
     friend class PsiIcon;
 };
@@ -387,7 +474,11 @@ void PsiIcon::detach() { d.detach(); }
 /**
  * Returns \c true when icon contains animation.
  */
-bool PsiIcon::isAnimated() const { return d->anim != nullptr; }
+bool PsiIcon::isAnimated() const
+{
+    d->decode();
+    return d->anim != nullptr;
+}
 
 /**
  * Returns QPixmap of current frame.
@@ -399,6 +490,7 @@ QPixmap PsiIcon::pixmap(const QSize &desiredSize) const { return d->pixmap(desir
  */
 QImage PsiIcon::image(const QSize &desiredSize) const
 {
+    d->decode();
     if (d->anim) {
         return d->anim->frameImage();
     }
@@ -421,7 +513,11 @@ QImage PsiIcon::image(const QSize &desiredSize) const
  * Returns Impix of first animation frame.
  * \sa setImpix()
  */
-const Impix &PsiIcon::impix() const { return d->impix; }
+const Impix &PsiIcon::impix() const
+{
+    d->decode();
+    return d->impix;
+}
 
 /**
  * Returns Impix of current animation frame.
@@ -429,6 +525,7 @@ const Impix &PsiIcon::impix() const { return d->impix; }
  */
 const Impix &PsiIcon::frameImpix() const
 {
+    d->decode();
     if (d->anim) {
         return d->anim->frameImpix();
     }
@@ -441,6 +538,7 @@ const Impix &PsiIcon::frameImpix() const
  */
 QIcon PsiIcon::icon() const
 {
+    d->decode();
     if (d->icon) {
         return *d->icon;
     }
@@ -458,6 +556,9 @@ QIcon PsiIcon::icon() const
  */
 const QByteArray &PsiIcon::raw() const
 {
+    if (d->rawData.isEmpty() && d->source) {
+        d->rawData = d->source();
+    }
     if (d->rawData.isEmpty()) {
         QPixmap pix = impix().pixmap();
         if (!pix.isNull()) {
@@ -471,6 +572,7 @@ const QByteArray &PsiIcon::raw() const
 
 QSize PsiIcon::size(const QSize &desiredSize) const
 {
+    d->decode();
     if (d->scalable) {
         QSize origSize = d->svgRenderer ? d->svgRenderer->defaultSize() : d->impix.size();
         if (!desiredSize.width() && !desiredSize.height())
@@ -500,11 +602,8 @@ void PsiIcon::setImpix(const Impix &impix, bool doDetach)
         detach();
     }
 
-    d->impix = impix;
-    if (d->icon) {
-        delete d->icon;
-        d->icon = nullptr;
-    }
+    d->pending.reset();
+    d->setImpix(impix);
 
     emit d->pixmapChanged();
     emit d->iconModified();
@@ -513,7 +612,11 @@ void PsiIcon::setImpix(const Impix &impix, bool doDetach)
 /**
  * Returns pointer to Anim object, or \a 0 if PsiIcon doesn't contain an animation.
  */
-const Anim *PsiIcon::anim() const { return d->anim.get(); }
+const Anim *PsiIcon::anim() const
+{
+    d->decode();
+    return d->anim.get();
+}
 
 /**
  * Sets the animation for icon to \a anim. Also sets Impix to be the first frame of animation.
@@ -526,6 +629,7 @@ void PsiIcon::setAnim(const Anim &anim, bool doDetach)
         detach();
     }
 
+    d->pending.reset();
     d->anim.reset(new Anim(anim));
 
     if (d->anim->numFrames() > 0) {
@@ -555,6 +659,7 @@ void PsiIcon::removeAnim(bool doDetach)
         detach();
     }
 
+    d->decode();
     if (!d->anim) {
         return;
     }
@@ -574,6 +679,7 @@ void PsiIcon::removeAnim(bool doDetach)
  */
 int PsiIcon::frameNumber() const
 {
+    d->decode();
     if (d->anim) {
         return d->anim->frameNumber();
     }
@@ -708,28 +814,13 @@ bool PsiIcon::loadFromData(const QString &mime, const QByteArray &ba, bool isAni
         return ret;
 
     detach();
-    d->rawData     = ba;
-    d->scalable    = isScalable;
-    d->svgRenderer = nullptr;
-    if (d->scalable) {
-        d->svgRenderer = std::make_shared<QSvgRenderer>(ba);
-        if (!d->svgRenderer->isValid()) {
-            d->svgRenderer.reset();
-            d->svgRenderer = nullptr;
-        }
-    }
-    if (d->svgRenderer) {
-        ret = true;
-    } else {
-        if (isAnim) {
-            Anim *anim = new Anim(ba);
-            setAnim(*anim);
-            ret = anim->numFrames() > 0;
-            delete anim; // shared data rules ;)
-        }
+    d->pending.reset();
+    d->source = nullptr;
+    ret       = d->setData(ba, isAnim, isScalable);
 
-        if (!ret && d->impix.loadFromData(ba))
-            ret = true;
+    if (d->anim && d->activatedCount > 0) {
+        d->activatedCount = 0;
+        activated(false); // restart the animation, but don't play the sound
     }
 
     if (ret) {
@@ -741,6 +832,31 @@ bool PsiIcon::loadFromData(const QString &mime, const QByteArray &ba, bool isAni
     return ret;
 }
 
+/**
+ * Makes the icon read and decode its image only when it is used for the first time.
+ * Iconset::load uses this function, so icons that are never shown cost nothing
+ * but their description. If \a data has an image, it is used as is and only
+ * raw() ever reads the encoded data.
+ */
+void PsiIcon::setDeferredData(const DeferredData &data)
+{
+    detach();
+    d->pending     = std::make_unique<DeferredData>(data);
+    d->source      = data.data;
+    d->mime        = data.mime;
+    d->scalable    = data.isScalable;
+    d->svgRenderer = nullptr;
+    d->rawData.clear();
+
+    emit d->pixmapChanged();
+    emit d->iconModified();
+}
+
+/**
+ * Returns \c false while the image set with setDeferredData() wasn't decoded yet.
+ */
+bool PsiIcon::isDecoded() const { return !d->pending; }
+
 /**
  * You need to call this function, when PsiIcon is \e triggered, i.e. it is shown on screen
  * and it must start animation (if it has not animation, this function will do nothing).
@@ -752,6 +868,7 @@ bool PsiIcon::loadFromData(const QString &mime, const QByteArray &ba, bool isAni
  */
 void PsiIcon::activated(bool playSound)
 {
+    d->decode();
     d->activatedCount++;
 
 #ifdef ICONSET_SOUND
@@ -803,6 +920,10 @@ void PsiIcon::stripFirstAnimFrame()
 {
     detach();
 
+    if (d->pending) {
+        d->stripFirstFrame = true; // applied when decoded
+        return;
+    }
     if (d->anim) {
         d->anim->stripFirstFrame();
     }
@@ -992,6 +1113,85 @@ const QByteArray IconsetFactory::raw(const QString &name)
  * \sa IconsetFactory
  */
 
+//! \if _hide_doc_
+// Files of one iconset directory or archive, read on demand by deferred icons
+class IconsetSource {
+public:
+    explicit IconsetSource(const QString &dir) : dir_(dir), info_(dir) { }
+
+    bool contains(const QString &fileName)
+    {
+        QMutexLocker locker(&mutex_);
+        if (info_.isDir()) {
+            return QFileInfo::exists(dir_ + '/' + fileName);
+        }
+#ifdef ICONSET_ZIP
+        return openZip() && zip_->fileExists(zipPath(fileName));
+#else
+        return false;
+#endif
+    }
+
+    QByteArray data(const QString &fileName)
+    {
+        QMutexLocker locker(&mutex_);
+        QByteArray   ba;
+
+        if (!Iconset::isSourceAllowed(info_)) {
+            qWarning("%s is invalid icons source", qPrintable(dir_));
+            return ba;
+        }
+        if (info_.isDir()) {
+            QFile file(dir_ + '/' + fileName);
+            if (!file.open(QIODevice::ReadOnly)) {
+                qWarning("%s is not found in %s", qPrintable(fileName), qPrintable(dir_));
+                return ba;
+            }
+
+            ba = file.readAll();
+        }
+#ifdef ICONSET_ZIP
+        else if (openZip()) { // else its zip or jisp file
+            zip_->readFile(zipPath(fileName), &ba);
+        }
+#endif
+
+        return ba;
+    }
+
+    // releases the archive until the next access
+    void close()
+    {
+        QMutexLocker locker(&mutex_);
+#ifdef ICONSET_ZIP
+        zip_.reset();
+#endif
+    }
+
+private:
+#ifdef ICONSET_ZIP
+    QString zipPath(const QString &fileName) const { return info_.completeBaseName() + '/' + fileName; }
+
+    bool openZip()
+    {
+        if (!zip_) {
+            zip_ = std::make_unique<UnZip>(dir_);
+            if (!zip_->open()) {
+                zip_.reset();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::unique_ptr<UnZip> zip_;
+#endif
+    QMutex    mutex_;
+    QString   dir_;
+    QFileInfo info_;
+};
+//! \endif
+
 //! \if _hide_doc_
 class Iconset::Private : public QSharedData {
 private:
@@ -1013,7 +1213,9 @@ public:
     QList<PsiIcon *>           list; // sorted list
     QHash<QString, QString>    info;
     int                        iconSize_;
-    QHash<QString, QByteArray> zipCache;
+
+    std::shared_ptr<IconsetSource> source; // set while loading
+    std::shared_ptr<IconCache>     cache;
 
 public:
     Private() { init(); }
@@ -1061,36 +1263,6 @@ public:
         }
     }
 
-    QByteArray loadData(const QString &fileName, const QString &dir)
-    {
-        QByteArray ba;
-
-        QFileInfo fi(dir);
-        if (!Iconset::isSourceAllowed(fi)) {
-            qWarning("%s is invalid icons source", qPrintable(dir));
-            return ba;
-        }
-        if (fi.isDir()) {
-            QFile file(dir + '/' + fileName);
-            if (!file.open(QIODevice::ReadOnly)) {
-                qWarning("%s is not found in %s", qPrintable(fileName), qPrintable(dir));
-                return ba;
-            }
-
-            ba = file.readAll();
-        }
-#ifdef ICONSET_ZIP
-        else { // else its zip or jisp file
-            UnZip z(dir);
-            if (zipCache.isEmpty())
-                zipCache = z.unpackAll();
-            ba = zipCache.value(fi.completeBaseName() + '/' + fileName);
-        }
-#endif
-
-        return ba;
-    }
-
     void loadMeta(const QDomElement &i, const QString &dir)
     {
         Q_UNUSED(dir);
@@ -1231,6 +1403,7 @@ public:
         QHash<QString, QString>  graphic, sound, object; // mime => filename
 
         QString name       = QString::asprintf("icon_%04d", icon_counter++);
+        bool    isNamed    = false; // generated names differ between runs, so they can't be cached
         bool    isAnimated = false;
         bool    isImage    = false;
         bool    isScalable = false;
@@ -1256,7 +1429,8 @@ public:
             } else if (tag == "x") {
                 QString attr = e.attribute("xmlns");
                 if (attr == "name") {
-                    name = e.text();
+                    name    = e.text();
+                    isNamed = true;
                 } else if (attr == "type") {
                     if (e.text() == "animation") {
                         isAnimated = true;
@@ -1310,21 +1484,29 @@ public:
             }
         }
 
-        bool loadSuccess = std::any_of(preferredGraphic.begin(), preferredGraphic.end(), [&, this](const auto &mime) {
-            QString fileName = graphic.value(mime);
-            // if format supports animations, then load graphic as animation, and
-            // if there is only one frame, then later it would be converted to single Impix
-            QByteArray ba = this->loadData(fileName, dir);
-            Q_ASSERT(!dir.startsWith(QLatin1String(":/")) || !ba.isEmpty());
-            if (!ba.isEmpty()
-                && icon.loadFromData(mime, ba, isAnimated || (!isImage && animationMime.indexOf(mime) != -1),
-                                     isScalable || scalableMime.indexOf(mime) != -1))
-                return true;
-
-            qDebug("Iconset::load(): Couldn't load %s (%s) graphic for the %s icon for the %s iconset",
-                   qPrintable(mime), qPrintable(fileName), qPrintable(name), qPrintable(this->name));
-            return false;
-        });
+        // only check that the graphic exists, it is decoded when the icon is used for the first time
+        auto graphicIt   = std::find_if(preferredGraphic.cbegin(), preferredGraphic.cend(),
+                                        [&, this](const QString &mime) { return source->contains(graphic.value(mime)); });
+        bool loadSuccess = graphicIt != preferredGraphic.cend();
+        if (loadSuccess) {
+            const QString &mime     = *graphicIt;
+            QString        fileName = graphic.value(mime);
+
+            PsiIcon::DeferredData deferred;
+            deferred.mime        = mime;
+            deferred.data        = [source = source, fileName]() { return source->data(fileName); };
+            deferred.isAnimation = isAnimated || (!isImage && animationMime.indexOf(mime) != -1);
+            deferred.isScalable  = isScalable || scalableMime.indexOf(mime) != -1;
+            if (cache && isNamed && !deferred.isScalable) {
+                deferred.image   = cache->image(name);
+                deferred.decoded = [cache = cache, name](const QImage &image) { cache->insert(name, image); };
+            }
+            icon.setDeferredData(deferred);
+        } else {
+            Q_ASSERT(!dir.startsWith(QLatin1String(":/")));
+            qDebug("Iconset::load(): Couldn't find graphic for the %s icon for the %s iconset", qPrintable(name),
+                   qPrintable(this->name));
+        }
 
 #ifdef ICONSET_SOUND
         loadSuccess = loadSuccess
@@ -1356,7 +1538,7 @@ public:
                            file.open(QIODevice::WriteOnly);
                            QDataStream out(&file);
 
-                           QByteArray data = this->loadData(fileName, dir); // "this" for compatibility with old gcc
+                           QByteArray data = source->data(fileName);
                            if (data.isEmpty()) {
                                qDebug(
                                    "Iconset::load(): Couldn't load %s (%s) audio for the %s icon for the %s iconset. "
@@ -1600,7 +1782,11 @@ bool Iconset::load(const QString &dir, Format format)
         return false;
     }
 
-    ba = d->loadData(fileName, dir);
+    d->source = std::make_shared<IconsetSource>(dir);
+    if (format == Format::Psi) {
+        d->cache = IconCache::forSource(dir, fileName);
+    }
+    ba = d->source->data(fileName);
     if (!ba.isEmpty()) {
         QDomDocument doc;
         if (doc.setContent(ba, false)) {
@@ -1617,7 +1803,9 @@ bool Iconset::load(const QString &dir, Format format)
                    "Failed to load icondef.xml");
         qWarning("Iconset::load(\"%s\"): Failed to load icondef.xml", qPrintable(dir));
     }
-    d->zipCache.clear();
+    // icons keep their own references to read the data on demand
+    d->source->close();
+    d->source.reset();
 
     // QPixmap::setDefaultOptimization( optimization );
 
@@ -1800,4 +1988,11 @@ void Iconset::setSoundPrefs(QString unpackPath, QObject *receiver, const char *s
 #endif
 }
 
+/**
+ * Enables the on-disk cache of decoded icons in \a dir. Icons of iconsets
+ * loaded afterwards are taken from there instead of being decoded, and icons
+ * decoded during the session are added to it. An empty \a dir disables the cache.
+ */
+void Iconset::setDecodedCacheDir(const QString &dir) { IconCache::setCacheDir(dir); }
+
 #include "iconset.moc"
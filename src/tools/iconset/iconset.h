@@ -30,6 +30,8 @@
 #include <QString>
 #include <QStringList>
 
+#include <functional>
+
 class Anim;
 class QFileInfo;
 class QIcon;
@@ -157,6 +159,18 @@ public:
     bool blockSignals(bool);
     bool loadFromData(const QString &mime, const QByteArray &, bool isAnimation, bool isScalable = false);
 
+    //! Image source which is read and decoded only when the icon is used for the first time
+    struct DeferredData {
+        QString                             mime;
+        std::function<QByteArray()>         data; // returns the encoded image
+        bool                                isAnimation = false;
+        bool                                isScalable  = false;
+        QImage                              image;   // already decoded still image, if known
+        std::function<void(const QImage &)> decoded; // receives the decoded still image
+    };
+    void setDeferredData(const DeferredData &);
+    bool isDecoded() const;
+
     void stripFirstAnimFrame();
 
     virtual PsiIcon *copy() const;
@@ -232,6 +246,7 @@ public:
 
     static bool isSourceAllowed(const QFileInfo &fi);
     static void setSoundPrefs(QString unpackPath, QObject *receiver, const char *slot);
+    static void setDecodedCacheDir(const QString &dir);
 
     // Iconset copy() const;
     // void detach();
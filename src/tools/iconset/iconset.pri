@@ -3,8 +3,10 @@ DEPENDPATH  += $$PWD
 
 SOURCES += \
     $$PWD/iconset.cpp \
+    $$PWD/iconcache.cpp \
     $$PWD/anim.cpp
 
 HEADERS += \
     $$PWD/iconset.h \
+    $$PWD/iconcache.h \
     $$PWD/anim.h
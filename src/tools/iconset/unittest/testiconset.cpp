@@ -1,6 +1,7 @@
 #include "anim.h"
 #include "iconset.h"
 
+#include <QTemporaryDir>
 #include <QtTest/QtTest>
 
 class TestIconset : public QObject {
@@ -203,6 +204,84 @@ private slots:
         QIcon icon = chat->icon();
         QVERIFY(!icon.isNull());
     }
+
+    void testDeferredDecoding()
+    {
+        Iconset is;
+        QVERIFY(is.load("iconsets/roster/default.jisp"));
+        for (const PsiIcon *icon : is)
+            QVERIFY(!icon->isDecoded());
+
+        const PsiIcon *chat = is.icon("psi/chat");
+        QVERIFY(chat != 0);
+        QVERIFY(chat->isAnimated());
+        QVERIFY(chat->isDecoded());
+        QCOMPARE(chat->anim()->numFrames(), 15);
+        QVERIFY(!chat->raw().isEmpty());
+    }
+
+    void testDecodedCache()
+    {
+        QTemporaryDir dir;
+        Iconset::setDecodedCacheDir(dir.path());
+
+        QHash<QString, QSize> sizes;
+        {
+            Iconset is;
+            QVERIFY(is.load("iconsets/roster/default.jisp"));
+            for (const PsiIcon *icon : is)
+                sizes.insert(icon->name(), icon->impix().image().size());
+        } // the cache is written when the last user is gone
+
+        Iconset is;
+        QVERIFY(is.load("iconsets/roster/default.jisp"));
+        for (const PsiIcon *icon : is) {
+            if (!icon->isAnimated())
+                QCOMPARE(icon->impix().image().size(), sizes.value(icon->name()));
+        }
+
+        Iconset::setDecodedCacheDir(QString());
+    }
+
+    // startup cost: loading the iconset, then showing every icon once
+    void benchmarkLoad()
+    {
+        QBENCHMARK {
+            Iconset is;
+            QVERIFY(is.load("iconsets/emoticons/puz.jisp"));
+        }
+    }
+
+    void benchmarkLoadAndDecode()
+    {
+        QBENCHMARK {
+            Iconset is;
+            QVERIFY(is.load("iconsets/emoticons/puz.jisp"));
+            for (const PsiIcon *icon : is)
+                icon->impix();
+        }
+    }
+
+    void benchmarkLoadAndDecodeWarmCache()
+    {
+        QTemporaryDir dir;
+        Iconset::setDecodedCacheDir(dir.path());
+        {
+            Iconset is;
+            QVERIFY(is.load("iconsets/roster/default.jisp"));
+            for (const PsiIcon *icon : is)
+                icon->impix();
+        }
+
+        QBENCHMARK {
+            Iconset is;
+            QVERIFY(is.load("iconsets/roster/default.jisp"));
+            for (const PsiIcon *icon : is)
+                icon->impix();
+        }
+
+        Iconset::setDecodedCacheDir(QString());
+    }
 };
 
 QTEST_MAIN(TestIconset)
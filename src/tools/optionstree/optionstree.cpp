@@ -26,6 +26,16 @@
 #include <QDomDocument>
 #include <QDomElement>
 #include <QStringList>
+#include <QTimer>
+#include <algorithm>
+#include <utility>
+
+struct OptionsTree::Watcher {
+    QObject      *context;
+    ChangeHandler handler;
+    QStringList   paths;
+    QSet<QString> pending;
+};
 
 /**
  * Default constructor
@@ -35,7 +45,14 @@ OptionsTree::OptionsTree(QObject *parent) : QObject(parent) { }
 /**
  * Destructor
  */
-OptionsTree::~OptionsTree() { }
+OptionsTree::~OptionsTree()
+{
+    // handles outliving the tree (e.g. across a profile switch) fall back to their defaults
+    for (auto &cell : std::as_const(cells_)) {
+        cell->value = QVariant();
+        ++cell->serial;
+    }
+}
 
 /**
  * Returns the value of the specified option
@@ -74,10 +91,16 @@ void OptionsTree::setOption(const QString &name, const QVariant &value)
         emit optionAboutToBeInserted(name);
     }
     tree_.setValue(name, value);
+    auto cell = cells_.value(name);
+    if (cell) {
+        cell->value = value;
+        ++cell->serial;
+    }
     if (!prev.isValid()) {
         emit optionInserted(name);
     }
     emit optionChanged(name);
+    queueChange(name);
 }
 
 /**
@@ -102,10 +125,172 @@ bool OptionsTree::removeOption(const QString &name, bool internal_nodes)
 {
     emit optionAboutToBeRemoved(name);
     bool ok = tree_.remove(name, internal_nodes);
+    refreshCells(name);
     emit optionRemoved(name);
+    queueChange(name, true);
     return ok;
 }
 
+/**
+ * \brief Returns the shared cell of the named option used by OptionHandle.
+ * The path is resolved once here; the cell is updated in place by setOption(),
+ * removeOption() and loadOptions(), so holders never resolve the path again.
+ * \param name "Path" to the option
+ */
+std::shared_ptr<const OptionsTree::OptionCell> OptionsTree::optionCell(const QString &name)
+{
+    auto &cell = cells_[name];
+    if (!cell) {
+        cell        = std::make_shared<OptionCell>();
+        cell->value = tree_.getValue(name);
+    }
+    return cell;
+}
+
+/**
+ * Re-reads cells of \a prefix and its children (all cells if empty)
+ * after the tree was changed behind setOption().
+ */
+void OptionsTree::refreshCells(const QString &prefix)
+{
+    const QString childPrefix = prefix + QLatin1Char('.');
+    for (auto it = cells_.begin(); it != cells_.end(); ++it) {
+        if (!prefix.isEmpty() && it.key() != prefix && !it.key().startsWith(childPrefix)) {
+            continue;
+        }
+        QVariant value = tree_.getValue(it.key()); // missingValue is an invalid QVariant
+        auto    &cell  = it.value();
+        if (cell->value != value || cell->value.isValid() != value.isValid()) {
+            cell->value = value;
+            ++cell->serial;
+        }
+    }
+}
+
+/**
+ * \brief Calls \a handler once per event loop iteration with the changed options among \a paths.
+ * Paths are either full option names or subtree prefixes ending with '.'.
+ * Any number of changes made before control returns to the event loop
+ * (applying the options dialog, importing a file) is delivered as one batch.
+ * The subscription ends with unwatchOptions() or when \a context is destroyed.
+ */
+void OptionsTree::watchOptions(const QStringList &paths, QObject *context, const ChangeHandler &handler)
+{
+    Q_ASSERT(context);
+    bool known = std::any_of(watchers_.cbegin(), watchers_.cend(),
+                             [context](const WatcherPtr &w) { return w->context == context; });
+    if (!known) {
+        connect(context, &QObject::destroyed, this, [this, context]() { unwatchOptions(context); });
+    }
+
+    auto watcher = std::make_shared<Watcher>(Watcher { context, handler, paths, {} });
+    watchers_.append(watcher);
+    for (const QString &path : paths) {
+        if (path.endsWith(QLatin1Char('.'))) {
+            watchedPrefixes_[path].append(watcher);
+        } else {
+            watchedKeys_[path].append(watcher);
+        }
+    }
+}
+
+/**
+ * Drops all subscriptions made with \a context. Changes still pending for them are discarded.
+ */
+void OptionsTree::unwatchOptions(QObject *context)
+{
+    auto dropFrom = [context](QHash<QString, QList<WatcherPtr>> &index) {
+        for (auto it = index.begin(); it != index.end();) {
+            auto &list = it.value();
+            list.erase(std::remove_if(list.begin(), list.end(),
+                                      [context](const WatcherPtr &w) { return w->context == context; }),
+                       list.end());
+            it = list.isEmpty() ? index.erase(it) : std::next(it);
+        }
+    };
+    dropFrom(watchedKeys_);
+    dropFrom(watchedPrefixes_);
+    auto dropped = std::stable_partition(watchers_.begin(), watchers_.end(),
+                                         [context](const WatcherPtr &w) { return w->context != context; });
+    for (auto it = dropped; it != watchers_.end(); ++it) {
+        (*it)->context = nullptr; // may still sit in pendingWatchers_
+    }
+    watchers_.erase(dropped, watchers_.end());
+}
+
+void OptionsTree::markPending(const WatcherPtr &watcher, const QString &name)
+{
+    if (watcher->pending.isEmpty()) {
+        pendingWatchers_.append(watcher);
+    }
+    watcher->pending.insert(name);
+    if (!deliveryQueued_) {
+        deliveryQueued_ = true;
+        QTimer::singleShot(0, this, &OptionsTree::deliverChanges);
+    }
+}
+
+/**
+ * Marks watchers of \a name (and of its children if \a subtree) as pending.
+ */
+void OptionsTree::queueChange(const QString &name, bool subtree)
+{
+    if (watchers_.isEmpty()) {
+        return;
+    }
+    for (const auto &w : watchedKeys_.value(name)) {
+        markPending(w, name);
+    }
+    if (!watchedPrefixes_.isEmpty()) {
+        for (int dot = name.indexOf(QLatin1Char('.')); dot != -1; dot = name.indexOf(QLatin1Char('.'), dot + 1)) {
+            for (const auto &w : watchedPrefixes_.value(name.left(dot + 1))) {
+                markPending(w, name);
+            }
+        }
+    }
+    if (subtree) {
+        const QString childPrefix = name + QLatin1Char('.');
+        for (auto it = watchedKeys_.cbegin(); it != watchedKeys_.cend(); ++it) {
+            if (it.key().startsWith(childPrefix)) {
+                for (const auto &w : it.value()) {
+                    markPending(w, it.key());
+                }
+            }
+        }
+        for (auto it = watchedPrefixes_.cbegin(); it != watchedPrefixes_.cend(); ++it) {
+            if (it.key().startsWith(childPrefix)) {
+                for (const auto &w : it.value()) {
+                    markPending(w, name);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * The whole tree was replaced; every watcher gets all of its paths.
+ */
+void OptionsTree::queueAllWatchers()
+{
+    for (const auto &w : std::as_const(watchers_)) {
+        for (const QString &path : std::as_const(w->paths)) {
+            markPending(w, path);
+        }
+    }
+}
+
+void OptionsTree::deliverChanges()
+{
+    deliveryQueued_ = false;
+    const auto watchers = std::exchange(pendingWatchers_, {});
+    for (const auto &w : watchers) {
+        const auto changed = std::exchange(w->pending, {});
+        if (w->context && !changed.isEmpty()) {
+            w->handler(changed);
+        }
+    }
+}
+
 /**
  * Names of every stored option
  * \return Names of options
@@ -265,7 +450,10 @@ bool OptionsTree::loadOptions(const QString &fileName, const QString &configName
     AtomicXmlFile f(fileName);
     if (streamReader) {
         OptionsTreeReader reader(this);
-        return f.loadDocument(&reader);
+        bool              ok = f.loadDocument(&reader);
+        refreshCells();
+        queueAllWatchers();
+        return ok;
     }
 
     QDomDocument doc;
@@ -305,5 +493,7 @@ bool OptionsTree::loadOptions(const QDomElement &base, const QString &configName
 
     // Convert
     tree_.fromXml(base);
+    refreshCells();
+    queueAllWatchers();
     return true;
 }
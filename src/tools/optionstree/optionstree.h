@@ -22,6 +22,11 @@
 
 #include "varianttree.h"
 
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <functional>
+#include <memory>
 #include <optional>
 
 /**
@@ -33,6 +38,15 @@
 class OptionsTree : public QObject {
     Q_OBJECT
 public:
+    /**
+     * Resolved value of a single option shared with OptionHandle.
+     * \a serial is bumped every time the value changes.
+     */
+    struct OptionCell {
+        QVariant value;
+        quint64  serial = 1;
+    };
+
     OptionsTree(QObject *parent = nullptr);
     ~OptionsTree();
 
@@ -54,6 +68,13 @@ public:
 
     bool removeOption(const QString &name, bool internal_nodes = false);
 
+    std::shared_ptr<const OptionCell> optionCell(const QString &name);
+
+    // Coalesced change subscriptions. A path ending with '.' watches the whole subtree.
+    using ChangeHandler = std::function<void(const QSet<QString> &changed)>;
+    void watchOptions(const QStringList &paths, QObject *context, const ChangeHandler &handler);
+    void unwatchOptions(QObject *context);
+
     static bool isValidName(const QString &name);
 
     // Map helpers
@@ -80,9 +101,69 @@ signals:
     void optionRemoved(const QString &option);
 
 private:
-    VariantTree tree_;
+    struct Watcher;
+    using WatcherPtr = std::shared_ptr<Watcher>;
+
+    void refreshCells(const QString &prefix = QString());
+    void queueChange(const QString &name, bool subtree = false);
+    void queueAllWatchers();
+    void markPending(const WatcherPtr &watcher, const QString &name);
+    void deliverChanges();
+
+    VariantTree                                 tree_;
+    QHash<QString, std::shared_ptr<OptionCell>> cells_;
+    QList<WatcherPtr>                           watchers_;
+    QHash<QString, QList<WatcherPtr>>           watchedKeys_;
+    QHash<QString, QList<WatcherPtr>>           watchedPrefixes_;
+    QList<WatcherPtr>                           pendingWatchers_;
+    bool                                        deliveryQueued_ = false;
     friend class OptionsTreeReader;
     friend class OptionsTreeWriter;
 };
 
+/**
+ * \class OptionHandle
+ * \brief Pre-resolved, typed accessor of a single option
+ * The option path is looked up once; afterwards value() only compares
+ * the cell serial and converts the QVariant again after a change.
+ *
+ * \code
+ * OptionHandle<bool> useEmoticons(PsiOptions::instance(), "options.ui.emoticons.use-emoticons");
+ * if (useEmoticons) ...
+ * \endcode
+ */
+template <typename T> class OptionHandle {
+public:
+    OptionHandle(OptionsTree *tree, const QString &name, const T &defaultValue = T()) :
+        tree_(tree), name_(name), cell_(tree->optionCell(name)), default_(defaultValue), value_(defaultValue)
+    {
+    }
+
+    const QString &name() const { return name_; }
+
+    const T &value() const
+    {
+        if (serial_ != cell_->serial) {
+            serial_ = cell_->serial;
+            value_  = cell_->value.isValid() ? cell_->value.template value<T>() : default_;
+        }
+        return value_;
+    }
+    operator const T &() const { return value(); }
+
+    void setValue(const T &value)
+    {
+        if (tree_)
+            tree_->setOption(name_, QVariant::fromValue(value));
+    }
+
+private:
+    QPointer<OptionsTree>                          tree_;
+    QString                                        name_;
+    std::shared_ptr<const OptionsTree::OptionCell> cell_;
+    T                                              default_;
+    mutable T                                      value_;
+    mutable quint64                                serial_ = 0;
+};
+
 #endif // OPTIONSTREE_H
@@ -2,6 +2,7 @@
 #include "qttestutil/qttestutil.h"
 
 #include <QDebug>
+#include <QDomDocument>
 #include <QMap>
 #include <QMapIterator>
 #include <QObject>
@@ -96,6 +97,51 @@ private slots:
         verifyTree(&tree2);
     }
 
+    void optionHandleResetTest()
+    {
+        OptionsTree tree;
+        tree.setOption("verona.montague.romeo", QString("poisoned"));
+        OptionHandle<QString> romeo(&tree, "verona.montague.romeo", "alive");
+        QCOMPARE(romeo.value(), QString("poisoned"));
+
+        tree.removeOption("verona.montague.romeo");
+        QCOMPARE(romeo.value(), QString("alive"));
+        romeo.setValue("banished");
+        QCOMPARE(tree.getOption("verona.montague.romeo").toString(), QString("banished"));
+        QCOMPARE(romeo.value(), QString("banished"));
+
+        // the whole branch goes back to defaults
+        tree.removeOption("verona", true);
+        QCOMPARE(romeo.value(), QString("alive"));
+        tree.setOption("verona.montague.romeo", QString("married"));
+        QCOMPARE(romeo.value(), QString("married"));
+    }
+
+    void optionHandleProfileSwitchTest()
+    {
+        auto                  tree = new OptionsTree;
+        OptionHandle<bool>    city(tree, "verona.city");
+        OptionHandle<QString> romeo(tree, "verona.montague.romeo", "alive");
+        tree->setOption("verona.city", true);
+        QVERIFY(city.value());
+
+        // another profile loaded into the same tree
+        QDomDocument doc;
+        QVERIFY(doc.setContent(QString("<options><verona><city type=\"bool\">false</city>"
+                                       "<montague><romeo type=\"QString\">exiled</romeo></montague>"
+                                       "</verona></options>")));
+        QVERIFY(tree->loadOptions(doc.documentElement(), "options"));
+        QVERIFY(!city.value());
+        QCOMPARE(romeo.value(), QString("exiled"));
+
+        // the tree of the old profile is gone
+        delete tree;
+        QCOMPARE(romeo.value(), QString("alive"));
+        QVERIFY(!city.value());
+        romeo.setValue("ignored");
+        QCOMPARE(romeo.value(), QString("alive"));
+    }
+
 #if 0
     void stressTest() {
         bench_.startIteration();
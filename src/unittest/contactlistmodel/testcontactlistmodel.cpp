@@ -0,0 +1,134 @@
+#include "contactlistitem.h"
+#include "contactlistmodel.h"
+#include "contactlistproxymodel.h"
+#include "profiles.h"   // for UserAccount
+#include "psiaccount.h" // for PsiAccount
+#include "psicon.h"     // for PsiCon
+#include "psicontact.h"
+#include "psicontactlist.h"
+#include "userlist.h" // for UserListItem
+
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QtCrypto>
+#include <QtTest/QtTest>
+
+static const int Contacts = 3000;
+static const int Bursts   = 20;
+
+// Starts the clock when the model commits a batch of contact updates, so the
+// benchmark leaves out the interval the model waits to collect them.
+class CommitClock : public QObject {
+public:
+    QElapsedTimer clock;
+
+    bool eventFilter(QObject *obj, QEvent *e) override
+    {
+        if (e->type() == QEvent::Timer && obj->parent() && obj->parent()->inherits("ContactListModel::Private"))
+            clock.start();
+        return false;
+    }
+};
+
+class TestContactListModel : public QObject {
+    Q_OBJECT
+private:
+    QCA::Initializer      *qca_init = nullptr;
+    PsiCon                *psi      = nullptr;
+    ContactListModel      *model    = nullptr;
+    ContactListProxyModel *proxy    = nullptr;
+    QList<PsiContact *>    contacts;
+
+    // one presence wave: every second contact comes online or goes away
+    void presenceBurst(int burst)
+    {
+        Status status(burst % 4 < 2 ? Status::Online : Status::Away);
+        for (int i = burst % 2; i < contacts.size(); i += 2) {
+            UserListItem u = contacts[i]->userListItem();
+            u.userResourceList().clear();
+            u.userResourceList().append(UserResource(Resource("psi", status)));
+            contacts[i]->update(u);
+        }
+    }
+
+    bool isSorted() const
+    {
+        for (int row = 1; row < proxy->rowCount(); ++row) {
+            auto prev = static_cast<ContactListItem *>(proxy->mapToSource(proxy->index(row - 1, 0)).internalPointer());
+            auto item = static_cast<ContactListItem *>(proxy->mapToSource(proxy->index(row, 0)).internalPointer());
+            if (item->lessThan(prev))
+                return false;
+        }
+        return true;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+        qca_init = new QCA::Initializer();
+
+        psi = new PsiCon();
+        psi->init();
+        psi->contactList()->setShowOffline(true);
+
+        UserAccount acc;
+        acc.id          = "testcontactlistmodel";
+        acc.jid         = "bench@example.com";
+        acc.opt_enabled = true;
+        for (int i = 0; i < Contacts; ++i) {
+            RosterItem item(Jid(QString("contact%1@example.com").arg(i)));
+            item.setName(QString("Contact %1").arg((i * 7919) % Contacts)); // not in roster order
+            item.setSubscription(Subscription(Subscription::Both));
+            acc.roster += item;
+        }
+        psi->contactList()->loadAccounts(UserAccountList() << acc);
+        contacts = psi->contactList()->contacts();
+        QVERIFY(contacts.size() > Contacts);
+
+        model = new ContactListModel(psi->contactList());
+        model->invalidateLayout();
+        proxy = new ContactListProxyModel();
+        proxy->setSourceModel(model);
+    }
+
+    void cleanupTestCase()
+    {
+        delete proxy;
+        delete model;
+        delete psi;
+        QCA::unloadAllPlugins();
+        delete qca_init;
+    }
+
+    // re-sorting the whole list compares cached sort keys only
+    void benchmarkSort()
+    {
+        QBENCHMARK { proxy->invalidate(); }
+        QVERIFY(isSorted());
+    }
+
+    // the model commits a presence wave: the sort keys of the contacts that changed
+    // status are refreshed and only they are moved by the proxy model
+    void benchmarkPresenceBurst()
+    {
+        CommitClock commit;
+        qApp->installEventFilter(&commit);
+
+        qint64 total = 0;
+        for (int burst = 0; burst < Bursts; ++burst) {
+            QSignalSpy changed(model, &QAbstractItemModel::dataChanged);
+            presenceBurst(burst);
+            QVERIFY(changed.wait(5000));
+            total += commit.clock.nsecsElapsed();
+            QVERIFY(isSorted());
+        }
+
+        qApp->removeEventFilter(&commit);
+        QTest::setBenchmarkResult(qreal(total) / Bursts / 1000000, QTest::WalltimeMilliseconds);
+    }
+};
+
+QTEST_MAIN(TestContactListModel)
+#include "testcontactlistmodel.moc"
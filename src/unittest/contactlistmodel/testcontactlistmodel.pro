@@ -0,0 +1,4 @@
+TARGET = testcontactlistmodel
+SOURCES += testcontactlistmodel.cpp
+
+include(../half_of_psi.pri)
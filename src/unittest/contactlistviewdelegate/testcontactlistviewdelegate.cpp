@@ -0,0 +1,147 @@
+#include "contactlistitem.h"
+#include "contactlistmodel.h"
+#include "contactlistproxymodel.h"
+#include "contactlistviewdelegate.h"
+#include "profiles.h"   // for UserAccount
+#include "psiaccount.h" // for PsiAccount
+#include "psicon.h"     // for PsiCon
+#include "psicontact.h"
+#include "psicontactlist.h"
+#include "psicontactlistview.h"
+#include "userlist.h" // for UserListItem
+
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QtCrypto>
+#include <QtTest/QtTest>
+
+static const int Contacts = 200;
+
+class TestContactListViewDelegate : public QObject {
+    Q_OBJECT
+private:
+    QCA::Initializer      *qca_init = nullptr;
+    PsiCon                *psi      = nullptr;
+    ContactListModel      *model    = nullptr;
+    ContactListProxyModel *proxy    = nullptr;
+
+    PsiContactListView *createView()
+    {
+        auto view = new PsiContactListView(nullptr);
+        view->setModel(proxy);
+        view->resize(300, 600);
+        view->expandAll();
+        view->show();
+        return view;
+    }
+
+    static QImage grab(PsiContactListView *view) { return view->viewport()->grab().toImage(); }
+
+    // the first contact the view shows
+    PsiContact *topContact(PsiContactListView *view) const
+    {
+        for (int y = 0; y < view->viewport()->height(); y += 4) {
+            QModelIndex index = view->indexAt(QPoint(10, y));
+            auto item = qvariant_cast<ContactListItem *>(index.data(ContactListModel::ContactListItemRole));
+            if (item && item->isContact())
+                return item->contact();
+        }
+        return nullptr;
+    }
+
+    void rename(PsiContact *contact, const QString &name)
+    {
+        QSignalSpy   changed(model, &QAbstractItemModel::dataChanged);
+        UserListItem u = contact->userListItem();
+        u.setName(name);
+        contact->update(u);
+        QVERIFY(changed.wait(5000));
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+        qca_init = new QCA::Initializer();
+
+        psi = new PsiCon();
+        psi->init();
+        psi->contactList()->setShowOffline(true);
+
+        UserAccount acc;
+        acc.id          = "testcontactlistviewdelegate";
+        acc.jid         = "bench@example.com";
+        acc.opt_enabled = true;
+        for (int i = 0; i < Contacts; ++i) {
+            RosterItem item(Jid(QString("contact%1@example.com").arg(i)));
+            item.setName(QString("Contact %1").arg(i));
+            item.setSubscription(Subscription(Subscription::Both));
+            acc.roster += item;
+        }
+        psi->contactList()->loadAccounts(UserAccountList() << acc);
+
+        model = new ContactListModel(psi->contactList());
+        model->invalidateLayout();
+        proxy = new ContactListProxyModel();
+        proxy->setSourceModel(model);
+    }
+
+    void cleanupTestCase()
+    {
+        delete proxy;
+        delete model;
+        delete psi;
+        QCA::unloadAllPlugins();
+        delete qca_init;
+    }
+
+    // a row painted from the cache must look like one painted by a delegate
+    // that has never seen the contact before
+    void testRowCache_InvalidatedOnDataChange()
+    {
+        std::unique_ptr<PsiContactListView> view(createView());
+        QImage                              before = grab(view.get());
+        QCOMPARE(grab(view.get()), before);
+
+        PsiContact *contact = topContact(view.get());
+        QVERIFY(contact);
+        QString name = contact->name();
+        rename(contact, name + " (renamed)");
+
+        QImage after = grab(view.get());
+        QVERIFY(after != before);
+        std::unique_ptr<PsiContactListView> fresh(createView());
+        QCOMPARE(after, grab(fresh.get()));
+
+        // and the old state comes back from the cache unchanged
+        rename(contact, name);
+        QCOMPARE(grab(view.get()), before);
+    }
+
+    void benchmarkPaint_data()
+    {
+        QTest::addColumn<bool>("cached");
+        QTest::newRow("cached") << true;
+        QTest::newRow("uncached") << false;
+    }
+
+    // painting all visible rows, from the row cache or drawing each of them
+    void benchmarkPaint()
+    {
+        QFETCH(bool, cached);
+        std::unique_ptr<PsiContactListView> view(createView());
+        ContactListViewDelegate            *delegate = view->itemDelegate();
+        QPixmap                             pixmap(view->viewport()->size());
+        view->viewport()->render(&pixmap);
+
+        QBENCHMARK
+        {
+            if (!cached)
+                delegate->recomputeGeometry(); // drops the row cache
+            view->viewport()->render(&pixmap);
+        }
+    }
+};
+
+QTEST_MAIN(TestContactListViewDelegate)
+#include "testcontactlistviewdelegate.moc"
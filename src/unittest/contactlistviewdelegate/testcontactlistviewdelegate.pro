@@ -0,0 +1,4 @@
+TARGET = testcontactlistviewdelegate
+SOURCES += testcontactlistviewdelegate.cpp
+
+include(../half_of_psi.pri)
@@ -0,0 +1,141 @@
+#include "profiles.h"   // for UserAccount
+#include "psiaccount.h" // for PsiAccount
+#include "psicon.h"     // for PsiCon
+#include "psicontactlist.h"
+#include "psievent.h"
+
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtCrypto>
+#include <QtTest/QtTest>
+
+class TestEventQueue : public QObject {
+    Q_OBJECT
+private:
+    QCA::Initializer *qca_init = nullptr;
+    PsiCon           *psi      = nullptr;
+    PsiAccount       *account  = nullptr;
+    QTemporaryDir     dir;
+
+    MessageEvent::Ptr message(const QString &body)
+    {
+        XMPP::Message m(XMPP::Jid("juliet@example.com/balcony"));
+        m.setFrom(XMPP::Jid("juliet@example.com/balcony"));
+        m.setBody(body);
+        return MessageEvent::Ptr(new MessageEvent(m, account));
+    }
+
+    // bodies of the events a new queue loads from \a fname
+    QStringList load(const QString &fname)
+    {
+        EventQueue  queue(account);
+        QStringList bodies;
+        connect(&queue, &EventQueue::eventFromXml, this, [&bodies](const PsiEvent::Ptr &e) {
+            bodies << e.staticCast<MessageEvent>()->message().body();
+        });
+        if (!queue.fromFile(fname))
+            bodies << "failed";
+        return bodies;
+    }
+
+    static int journalLines(const QString &fname)
+    {
+        QFile f(fname + ".journal");
+        if (!f.open(QIODevice::ReadOnly))
+            return -1;
+        return f.readAll().count('\n');
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+        qca_init = new QCA::Initializer();
+        QVERIFY(dir.isValid());
+
+        psi = new PsiCon();
+        psi->init();
+
+        UserAccount acc;
+        acc.id  = "testeventqueue";
+        acc.jid = "romeo@example.com";
+        psi->contactList()->loadAccounts(UserAccountList() << acc);
+        account = psi->contactList()->accounts().first();
+    }
+
+    void cleanupTestCase()
+    {
+        delete psi;
+        QCA::unloadAllPlugins();
+        delete qca_init;
+    }
+
+    void testJournal_ReplayedAndCompacted()
+    {
+        QString    fname = dir.filePath("events.xml");
+        EventQueue queue(account);
+        queue.setStorageFile(fname);
+        QCOMPARE(journalLines(fname), 1); // just the header
+
+        auto first = message("first");
+        queue.enqueue(first);
+        queue.enqueue(message("second"));
+        queue.enqueue(message("third"));
+        queue.dequeue(first);
+        QCOMPARE(journalLines(fname), 5);
+        QCOMPARE(load(fname), QStringList({ "second", "third" }));
+
+        // moving the storage compacts the queue into a new snapshot
+        QString moved = dir.filePath("events-moved.xml");
+        queue.setStorageFile(moved);
+        QVERIFY(!QFile::exists(fname + ".journal"));
+        QCOMPARE(journalLines(moved), 1);
+        QCOMPARE(load(moved), QStringList({ "second", "third" }));
+
+        queue.enqueue(message("fourth"));
+        QCOMPARE(load(moved), QStringList({ "second", "third", "fourth" }));
+    }
+
+    void testJournal_StaleJournalIgnored()
+    {
+        QString fname = dir.filePath("stale.xml");
+        {
+            EventQueue queue(account);
+            queue.setStorageFile(fname);
+            queue.enqueue(message("kept"));
+        }
+        QFile::copy(fname + ".journal", dir.filePath("stale.journal.old"));
+        {
+            EventQueue queue(account);
+            queue.setStorageFile(dir.filePath("other.xml"));
+            queue.enqueue(message("kept"));
+            queue.setStorageFile(fname); // a new generation of the snapshot
+        }
+        // the journal of the previous generation comes back after a crash
+        QFile::remove(fname + ".journal");
+        QFile::copy(dir.filePath("stale.journal.old"), fname + ".journal");
+        QCOMPARE(load(fname), QStringList({ "kept" }));
+    }
+
+    void testJournal_UnavailableSavesSnapshot()
+    {
+        QString fname = dir.filePath("blocked.xml");
+        QVERIFY(QDir(dir.path()).mkdir("blocked.xml.journal")); // can't be opened as a file
+
+        EventQueue queue(account);
+        queue.setStorageFile(fname);
+        queue.enqueue(message("first"));
+        QCOMPARE(load(fname), QStringList({ "first" }));
+
+        // the journal is used again as soon as it can be opened
+        QVERIFY(QDir(dir.path()).rmdir("blocked.xml.journal"));
+        queue.enqueue(message("second"));
+        QCOMPARE(journalLines(fname), 1);
+        queue.enqueue(message("third"));
+        QCOMPARE(journalLines(fname), 2);
+        QCOMPARE(load(fname), QStringList({ "first", "second", "third" }));
+    }
+};
+
+QTEST_MAIN(TestEventQueue)
+#include "testeventqueue.moc"
@@ -0,0 +1,4 @@
+TARGET = testeventqueue
+SOURCES += testeventqueue.cpp
+
+include(../half_of_psi.pri)
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "rostersnapshot.h"
+#include "iris/xmpp_client.h"
+#include "iris/xmpp_liveroster.h"
+#include "iris/xmpp_task.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+using namespace XMPP;
+
+class RosterSnapshotTest : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+
+    static RosterItem item(const QString &jid, const QString &name, Subscription::SubType sub)
+    {
+        RosterItem i;
+        i.setJid(Jid(jid));
+        i.setName(name);
+        i.setSubscription(Subscription(sub));
+        i.setGroups(QStringList { "Friends" });
+        return i;
+    }
+
+    // what PsiAccount writes: the live roster of the client with its version
+    static Roster snapshotOf(const Client &client)
+    {
+        Roster r;
+        for (const LiveRosterItem &i : client.roster())
+            r += i;
+        r.setVersion(client.roster().version());
+        return r;
+    }
+
+    // a roster push as the server sends it, without 'from'
+    static QDomElement push(Client &client, const QString &id, const QString &ver, const QString &jid,
+                            const QString &subscription, const QString &name = QString())
+    {
+        QDomDocument *doc = client.doc();
+        QDomElement   iq  = doc->createElement("iq");
+        iq.setAttribute("type", "set");
+        iq.setAttribute("id", id);
+        QDomElement query = doc->createElementNS("jabber:iq:roster", "query");
+        query.setAttribute("ver", ver);
+        QDomElement i = doc->createElement("item");
+        i.setAttribute("jid", jid);
+        i.setAttribute("subscription", subscription);
+        if (!name.isEmpty())
+            i.setAttribute("name", name);
+        query.appendChild(i);
+        iq.appendChild(query);
+        return iq;
+    }
+
+private slots:
+    void initTestCase() { QVERIFY(dir.isValid()); }
+
+    void testSaveLoad()
+    {
+        Roster r;
+        r += item("alice@example.com", "Alice", Subscription::Both);
+        r += item("bob@example.com", QString(), Subscription::To);
+        r.setVersion("ver1");
+
+        QString fileName = dir.filePath("roster-saveload.dat");
+        QVERIFY(RosterSnapshot::save(fileName, r));
+
+        Roster loaded;
+        QVERIFY(RosterSnapshot::load(fileName, loaded));
+        QCOMPARE(loaded.version(), QString("ver1"));
+        QCOMPARE(loaded.count(), 2);
+        QCOMPARE(loaded[0].jid().full(), QString("alice@example.com"));
+        QCOMPARE(loaded[0].name(), QString("Alice"));
+        QCOMPARE(loaded[0].groups(), QStringList { "Friends" });
+        QCOMPARE(loaded[1].subscription().type(), Subscription::To);
+    }
+
+    void testLoadTruncated()
+    {
+        Roster r;
+        r += item("alice@example.com", "Alice", Subscription::Both);
+        QString fileName = dir.filePath("roster-truncated.dat");
+        QVERIFY(RosterSnapshot::save(fileName, r));
+
+        QFile f(fileName);
+        QVERIFY(f.resize(f.size() - 4));
+
+        Roster loaded;
+        QVERIFY(!RosterSnapshot::load(fileName, loaded));
+        QVERIFY(loaded.isEmpty());
+    }
+
+    // the cached roster is current (empty result to the versioned get) and the server sends the changes
+    //   as pushes. every one of them must reach the snapshot with the version of the last push
+    void testApplyPushDelta()
+    {
+        QString fileName = dir.filePath("roster-push.dat");
+        Roster  cached;
+        cached += item("alice@example.com", "Alice", Subscription::Both);
+        cached += item("bob@example.com", "Bob", Subscription::Both);
+        cached.setVersion("ver1");
+        QVERIFY(RosterSnapshot::save(fileName, cached));
+
+        Roster loaded;
+        QVERIFY(RosterSnapshot::load(fileName, loaded));
+
+        Client client;
+        client.start("example.com", "me", "", "test");
+        client.restoreRoster(loaded);
+        QCOMPARE(client.roster().version(), QString("ver1"));
+
+        QSignalSpy added(&client, &Client::rosterItemAdded);
+        QSignalSpy updated(&client, &Client::rosterItemUpdated);
+        QSignalSpy removed(&client, &Client::rosterItemRemoved);
+
+        QVERIFY(client.rootTask()->take(push(client, "p1", "ver2", "carol@example.com", "both", "Carol")));
+        QVERIFY(client.rootTask()->take(push(client, "p2", "ver3", "bob@example.com", "from", "Robert")));
+        QVERIFY(client.rootTask()->take(push(client, "p3", "ver4", "alice@example.com", "remove")));
+        QCOMPARE(added.count(), 1);
+        QCOMPARE(updated.count(), 1);
+        QCOMPARE(removed.count(), 1);
+        QCOMPARE(client.roster().version(), QString("ver4"));
+
+        QVERIFY(RosterSnapshot::save(fileName, snapshotOf(client)));
+        Roster saved;
+        QVERIFY(RosterSnapshot::load(fileName, saved));
+        QCOMPARE(saved.version(), QString("ver4"));
+        QCOMPARE(saved.count(), 2);
+        QVERIFY(saved.find(Jid("alice@example.com")) == saved.end());
+
+        auto bob = saved.find(Jid("bob@example.com"));
+        QVERIFY(bob != saved.end());
+        QCOMPARE(bob->name(), QString("Robert"));
+        QCOMPARE(bob->subscription().type(), Subscription::From);
+
+        auto carol = saved.find(Jid("carol@example.com"));
+        QVERIFY(carol != saved.end());
+        QCOMPARE(carol->name(), QString("Carol"));
+        QCOMPARE(carol->subscription().type(), Subscription::Both);
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(RosterSnapshotTest);
+#include "rostersnapshottest.moc"
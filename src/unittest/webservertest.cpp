@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2026  Psi Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "webserver.h"
+#include "filesharingproxy.h"
+#include "httputil.h"
+#include "qttestutil/qttestutil.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QtTest/QtTest>
+
+static const int RequestCount = 200;
+static const int SharedSize   = 64 * 1024 * 1024;
+
+class WebServerTest : public QObject {
+    Q_OBJECT
+
+private:
+    WebServer             *server = nullptr;
+    QNetworkAccessManager *nam    = nullptr;
+    int                    loads  = 0;
+    QByteArray             theme;
+    QTemporaryFile         sharedFile; // a cached shared file
+
+    QNetworkReply *get(const QString &path, const QByteArray &etag = QByteArray())
+    {
+        QUrl url = server->serverUrl();
+        url.setPath(path);
+        QNetworkRequest req(url);
+        if (!etag.isEmpty())
+            req.setRawHeader("If-None-Match", etag);
+        return nam->get(req);
+    }
+
+    // sends all the requests at once, like a chat view loading a theme, and waits for the replies
+    bool getMany(const QStringList &paths, QList<QNetworkReply *> &replies)
+    {
+        for (auto const &path : paths)
+            replies << get(path);
+        for (auto reply : std::as_const(replies)) {
+            if (!reply->isFinished() && !QSignalSpy(reply, &QNetworkReply::finished).wait(10000))
+                return false;
+        }
+        return true;
+    }
+
+    QNetworkReply *getOne(const QString &path, const QByteArray &etag = QByteArray())
+    {
+        QNetworkReply *reply = get(path, etag);
+        if (!reply->isFinished())
+            QSignalSpy(reply, &QNetworkReply::finished).wait(10000);
+        return reply;
+    }
+
+    QNetworkReply *getRange(const QByteArray &range)
+    {
+        QUrl url = server->serverUrl();
+        url.setPath("/file/shared");
+        QNetworkRequest req(url);
+        req.setRawHeader("Range", range);
+        QNetworkReply *reply = nam->get(req);
+        if (!reply->isFinished())
+            QSignalSpy(reply, &QNetworkReply::finished).wait(10000);
+        return reply;
+    }
+
+    static QByteArray sharedData(qint64 offset, qint64 size)
+    {
+        QByteArray data(int(size), Qt::Uninitialized);
+        for (int i = 0; i < size; i++)
+            data[i] = char((offset + i) % 251);
+        return data;
+    }
+
+    static int status(QNetworkReply *reply)
+    {
+        return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(sharedFile.open());
+        for (qint64 offset = 0; offset < SharedSize; offset += 1024 * 1024)
+            sharedFile.write(sharedData(offset, 1024 * 1024));
+        sharedFile.close();
+    }
+
+    void init()
+    {
+        theme = QByteArray("body { color: black; }\n").repeated(3000);
+        loads = 0;
+
+        server = new WebServer;
+        nam    = new QNetworkAccessManager;
+        server->routeResource("/psi/themes/", [this](const QString &path, WebServer::Resource &resource) {
+            if (!path.endsWith(".css"))
+                return false;
+            loads++;
+            resource.data        = theme;
+            resource.contentType = "text/css";
+            return true;
+        });
+        server->route("/file/", [this](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) {
+            FileSharingProxy::serveFile(sharedFile.fileName(), "application/octet-stream", req, res);
+            return true;
+        });
+    }
+
+    void cleanup()
+    {
+        delete nam;
+        delete server;
+    }
+
+    void benchmarkThemeLoad()
+    {
+        QStringList paths;
+        for (int i = 0; i < RequestCount; i++)
+            paths << QString("/psi/themes/chatview/adium/Default/style%1.css").arg(i % 10);
+
+        QBENCHMARK
+        {
+            QList<QNetworkReply *> replies;
+            QVERIFY(getMany(paths, replies));
+            for (auto reply : replies) {
+                QCOMPARE(status(reply), 200);
+                QCOMPARE(reply->readAll(), theme);
+                reply->deleteLater();
+            }
+        }
+
+        QCOMPARE(loads, 10); // each file is read once, then it's served from memory
+    }
+
+    void testUnchanged_NotModified()
+    {
+        QNetworkReply *reply = getOne("/psi/themes/a.css");
+        QCOMPARE(status(reply), 200);
+        QByteArray etag = reply->rawHeader("ETag");
+        QVERIFY(!etag.isEmpty());
+        delete reply;
+
+        reply = getOne("/psi/themes/a.css", etag);
+        QCOMPARE(status(reply), 304);
+        QCOMPARE(loads, 1);
+        delete reply;
+    }
+
+    void testInvalidate_ServesNewData()
+    {
+        QNetworkReply *reply = getOne("/psi/themes/a.css");
+        QByteArray     etag  = reply->rawHeader("ETag");
+        delete reply;
+
+        // the theme was edited, stale cache must not survive a reload
+        theme = "body { color: white; }\n";
+        server->invalidateResources("/psi/themes/");
+
+        reply = getOne("/psi/themes/a.css", etag);
+        QCOMPARE(status(reply), 200);
+        QCOMPARE(reply->readAll(), theme);
+        QVERIFY(reply->rawHeader("ETag") != etag);
+        QCOMPARE(loads, 2);
+        delete reply;
+    }
+
+    // sustained throughput of a cached shared file to a local client
+    void benchmarkServeFile()
+    {
+        QUrl url = server->serverUrl();
+        url.setPath("/file/shared");
+
+        QElapsedTimer timer;
+        qint64        received = 0;
+        timer.start();
+        QNetworkReply *reply = nam->get(QNetworkRequest(url));
+        connect(reply, &QNetworkReply::readyRead, this, [reply, &received]() { received += reply->readAll().size(); });
+        if (!reply->isFinished())
+            QVERIFY(QSignalSpy(reply, &QNetworkReply::finished).wait(60000));
+        received += reply->readAll().size();
+        qint64 msecs = qMax(qint64(1), timer.elapsed());
+
+        QCOMPARE(status(reply), 200);
+        QCOMPARE(received, qint64(SharedSize));
+        QTest::setBenchmarkResult(qreal(received) * 1000 / msecs, QTest::BytesPerSecond);
+        delete reply;
+    }
+
+    void testServeFile_Range()
+    {
+        QNetworkReply *reply = getRange("bytes=1000-1999");
+        QCOMPARE(status(reply), 206);
+        QCOMPARE(reply->rawHeader("Content-Range"), QByteArray("bytes 1000-1999/") + QByteArray::number(SharedSize));
+        QCOMPARE(reply->readAll(), sharedData(1000, 1000));
+        delete reply;
+    }
+
+    void testServeFile_MultiRange()
+    {
+        QNetworkReply *reply = getRange("bytes=0-9, 100-109");
+        QCOMPARE(status(reply), 206);
+        QVERIFY(reply->rawHeader("Content-Type").startsWith("multipart/byteranges; boundary="));
+        QByteArray body = reply->readAll();
+        QVERIFY(body.contains("Content-Range: bytes 0-9/" + QByteArray::number(SharedSize)));
+        QVERIFY(body.contains(sharedData(0, 10)));
+        QVERIFY(body.contains("Content-Range: bytes 100-109/" + QByteArray::number(SharedSize)));
+        QVERIFY(body.contains(sharedData(100, 10)));
+        delete reply;
+
+        // the only satisfiable range is sent as is
+        reply = getRange(QByteArray("bytes=10-19, ") + QByteArray::number(SharedSize) + "-");
+        QCOMPARE(status(reply), 206);
+        QCOMPARE(reply->readAll(), sharedData(10, 10));
+        delete reply;
+
+        reply = getRange(QByteArray("bytes=") + QByteArray::number(SharedSize) + "-, "
+                         + QByteArray::number(SharedSize + 10) + "-");
+        QCOMPARE(status(reply), 416);
+        delete reply;
+    }
+
+    void testParseMultiRangeHeader_data()
+    {
+        QTest::addColumn<QByteArray>("header");
+        QTest::addColumn<int>("result");
+        QTest::addColumn<QList<quint64>>("ranges"); // start, size pairs
+
+        QTest::newRow("single") << QByteArray("bytes=0-99") << int(Http::Parsed) << QList<quint64> { 0, 100 };
+        QTest::newRow("several") << QByteArray("bytes=0-9, 20-29,40-") << int(Http::Parsed)
+                                 << QList<quint64> { 0, 10, 20, 10, 40, 0 };
+        QTest::newRow("past the end skipped")
+            << QByteArray("bytes=0-9,2000-2009") << int(Http::Parsed) << QList<quint64> { 0, 10 };
+        QTest::newRow("all past the end") << QByteArray("bytes=1000-,2000-") << int(Http::OutOfRange)
+                                          << QList<quint64> {};
+        QTest::newRow("tail") << QByteArray("bytes=0-9,-100") << int(Http::NotImplementedTailLoad)
+                              << QList<quint64> {};
+        QTest::newRow("reversed") << QByteArray("bytes=0-9,30-20") << int(Http::Unparsed) << QList<quint64> {};
+        QTest::newRow("other unit") << QByteArray("items=0-9") << int(Http::NotImplementedRangeType)
+                                    << QList<quint64> {};
+    }
+
+    void testParseMultiRangeHeader()
+    {
+        QFETCH(QByteArray, header);
+        QFETCH(int, result);
+        QFETCH(QList<quint64>, ranges);
+
+        auto const [parseResult, parsed] = Http::parseMultiRangeHeader(header, quint64(1000));
+        QCOMPARE(int(parseResult), result);
+        QList<quint64> flat;
+        for (auto const &[start, size] : parsed)
+            flat << start << size;
+        QCOMPARE(flat, ranges);
+    }
+
+    void testUnknown_NotFound()
+    {
+        QNetworkReply *reply = getOne("/psi/themes/a.png");
+        QCOMPARE(status(reply), 404);
+        QCOMPARE(loads, 0);
+        delete reply;
+    }
+};
+
+QTTESTUTIL_REGISTER_TEST(WebServerTest);
+#include "webservertest.moc"
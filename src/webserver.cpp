@@ -1,22 +1,80 @@
 #include "webserver.h"
 
+#include <QCryptographicHash>
 #include <QFile>
 #include <QTcpServer>
+#include <QVarLengthArray>
+
+static const int ResourceCacheSize = 16 * 1024 * 1024; // bytes
+static const int MinCompressSize   = 1024;
+
+struct WebServer::CachedResource {
+    QByteArray data;
+    QByteArray deflated; // empty if not worth it
+    QByteArray contentType;
+    QByteArray contentEncoding;
+    QByteArray etag;
+};
+
+static bool isCompressible(const QByteArray &contentType)
+{
+    return contentType.startsWith("text/") || contentType.contains("javascript") || contentType.contains("json")
+        || contentType.contains("xml");
+}
+
+// checks if a comma separated header list has the token and it's not disabled with q=0
+static bool headerHasToken(const QByteArray &header, const QByteArray &token)
+{
+    for (auto const &item : header.split(',')) {
+        auto params = item.split(';');
+        if (params.value(0).trimmed() != token)
+            continue;
+        for (int i = 1; i < params.size(); i++) {
+            auto p = params[i].trimmed();
+            if (p.startsWith("q=") && p.mid(2).toDouble() == 0.0)
+                return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool etagMatches(const QByteArray &ifNoneMatch, const QByteArray &etag)
+{
+    for (auto const &item : ifNoneMatch.split(',')) {
+        auto tag = item.trimmed();
+        if (tag.startsWith("W/"))
+            tag = tag.mid(2); // If-None-Match uses weak comparison
+        if (tag == "*" || tag == etag)
+            return true;
+    }
+    return false;
+}
 
 WebServer::WebServer(QObject *parent) : qhttp::server::QHttpServer(parent)
 {
     using namespace qhttp::server;
+    resourceCache.setMaxCost(ResourceCacheSize);
     listen( // listening on 0.0.0.0:8080
         QHostAddress::LocalHost, 0, [this](QHttpRequest *req, QHttpResponse *res) {
             // very global stuff first
             QString path = req->url().path();
             // qDebug() << "LOADING: " << path << serverPort();
 
-            for (auto &h : pathHandlers) {
-                if (path.startsWith(h.first)) {
-                    if (h.second(req, res)) {
-                        return;
-                    }
+            // collect handlers along the path, the longest prefix is tried first
+            QVarLengthArray<const Handler *, 8> matched;
+            const RouteNode                    *node = &routes;
+            for (auto c : std::as_const(path)) {
+                auto it = node->children.find(c);
+                if (it == node->children.end())
+                    break;
+                node = it->second.get();
+                if (node->handler)
+                    matched.append(&node->handler);
+            }
+            for (int i = matched.size() - 1; i >= 0; i--) {
+                if ((*matched[i])(req, res)) {
+                    return;
                 }
             }
 
@@ -27,6 +85,8 @@ WebServer::WebServer(QObject *parent) : qhttp::server::QHttpServer(parent)
         });
 }
 
+WebServer::~WebServer() { }
+
 quint16 WebServer::serverPort() const { return tcpServer()->serverPort(); }
 
 QHostAddress WebServer::serverAddress() const { return tcpServer()->serverAddress(); }
@@ -42,13 +102,116 @@ QUrl WebServer::serverUrl()
 
 void WebServer::route(const char *path, const WebServer::Handler &handler)
 {
-    pathHandlers.append(QPair<QString, Handler>(QLatin1String(path), handler));
+    RouteNode *node = &routes;
+    for (auto c : QString(QLatin1String(path))) {
+        auto &child = node->children[c];
+        if (!child)
+            child = std::make_unique<RouteNode>();
+        node = child.get();
+    }
+    node->handler = handler;
+}
+
+/**
+ * Routes \a path to a handler of static data. The rendered data is kept in memory
+ * and served with a strong ETag, so unchanged resources are answered with 304 and
+ * text resources are sent compressed when the client accepts it.
+ * Call invalidateResources() when the data behind the path changes.
+ */
+void WebServer::routeResource(const char *path, const ResourceHandler &handler)
+{
+    route(path, [this, handler](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) {
+        return serveResource(handler, req, res);
+    });
 }
 
 void WebServer::unroute(const char *path)
 {
-    QString pstr = QLatin1String(path);
-    auto    it
-        = std::remove_if(pathHandlers.begin(), pathHandlers.end(), [pstr](const auto &v) { return v.first == pstr; });
-    pathHandlers.erase(it, pathHandlers.end());
+    RouteNode *node = &routes;
+    for (auto c : QString(QLatin1String(path))) {
+        auto it = node->children.find(c);
+        if (it == node->children.end())
+            return;
+        node = it->second.get();
+    }
+    node->handler = Handler();
+}
+
+void WebServer::invalidateResources(const QString &pathPrefix)
+{
+    if (pathPrefix.isEmpty()) {
+        resourceCache.clear();
+        return;
+    }
+    const auto keys = resourceCache.keys();
+    for (auto const &key : keys) {
+        if (key.startsWith(pathPrefix))
+            resourceCache.remove(key);
+    }
+}
+
+bool WebServer::serveResource(const ResourceHandler &handler, qhttp::server::QHttpRequest *req,
+                              qhttp::server::QHttpResponse *res)
+{
+    if (req->method() != qhttp::EHTTP_GET)
+        return false;
+
+    QString                         path   = req->url().path();
+    CachedResource                 *cached = resourceCache.object(path);
+    std::unique_ptr<CachedResource> uncached;
+    if (!cached) {
+        Resource resource;
+        if (!handler(path, resource))
+            return false;
+
+        auto fresh             = std::make_unique<CachedResource>();
+        fresh->data            = resource.data;
+        fresh->contentType     = resource.contentType;
+        fresh->contentEncoding = resource.contentEncoding;
+        fresh->etag = '"' + QCryptographicHash::hash(resource.data, QCryptographicHash::Sha1).toHex() + '"';
+        if (resource.contentEncoding.isEmpty() && resource.data.size() >= MinCompressSize
+            && isCompressible(resource.contentType)) {
+            auto deflated = qCompress(resource.data, 9).mid(4); // strip Qt's size prefix to get a zlib stream
+            if (deflated.size() < resource.data.size())
+                fresh->deflated = deflated;
+        }
+        int cost = int(fresh->data.size() + fresh->deflated.size());
+        if (cost <= resourceCache.maxCost()) {
+            cached = fresh.get();
+            resourceCache.insert(path, fresh.release(), cost);
+        } else { // too big to be cached
+            uncached = std::move(fresh);
+            cached   = uncached.get();
+        }
+    }
+
+    // qhttp::server keeps request headers lower-cased
+    auto const &headers = req->headers();
+    if (req->httpVersion() == QLatin1String("1.1") && !headers.keyHasValue("connection", "close")) {
+        res->addHeader("Connection", "keep-alive");
+    }
+    res->addHeader("ETag", cached->etag);
+    res->addHeader("Cache-Control", "no-cache"); // always revalidate, it's cheap
+    if (etagMatches(headers.value("if-none-match"), cached->etag)) {
+        res->setStatusCode(qhttp::ESTATUS_NOT_MODIFIED);
+        res->end();
+        return true;
+    }
+
+    if (!cached->contentType.isEmpty())
+        res->addHeader("Content-Type", cached->contentType);
+    const QByteArray *body = &cached->data;
+    if (!cached->deflated.isEmpty()) {
+        res->addHeader("Vary", "Accept-Encoding");
+        if (headerHasToken(headers.value("accept-encoding"), "deflate")) {
+            res->addHeader("Content-Encoding", "deflate");
+            body = &cached->deflated;
+        }
+    } else if (!cached->contentEncoding.isEmpty()) {
+        res->addHeader("Content-Encoding", cached->contentEncoding);
+    }
+    res->addHeader("Content-Length", QByteArray::number(body->size()));
+    res->setStatusCode(qhttp::ESTATUS_OK);
+    res->end(*body);
+    return true;
 }
@@ -5,28 +5,52 @@
 #include "qhttpserverrequest.hpp"
 #include "qhttpserverresponse.hpp"
 
+#include <QCache>
 #include <QObject>
 #include <functional>
+#include <map>
+#include <memory>
 
 class WebServer : public qhttp::server::QHttpServer {
     Q_OBJECT
 public:
     typedef std::function<bool(qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res)> Handler;
 
+    // static data rendered once and then served from memory
+    struct Resource {
+        QByteArray data;
+        QByteArray contentType;
+        QByteArray contentEncoding; // when data is already encoded, e.g. svgz
+    };
+    typedef std::function<bool(const QString &path, Resource &resource)> ResourceHandler;
+
     WebServer(QObject *parent = nullptr);
+    ~WebServer();
 
     quint16      serverPort() const;
     QHostAddress serverAddress() const;
     QUrl         serverUrl();
 
     void route(const char *path, const Handler &handler);
+    void routeResource(const char *path, const ResourceHandler &handler);
     void unroute(const char *path);
+    void invalidateResources(const QString &pathPrefix = QString());
 
     inline void setDefaultHandler(const Handler &h) { defaultHandler = h; }
 
 private:
-    QList<QPair<QString, Handler>> pathHandlers;
-    Handler                        defaultHandler;
+    struct RouteNode {
+        std::map<QChar, std::unique_ptr<RouteNode>> children;
+        Handler                                     handler;
+    };
+    struct CachedResource;
+
+    bool serveResource(const ResourceHandler &handler, qhttp::server::QHttpRequest *req,
+                       qhttp::server::QHttpResponse *res);
+
+    RouteNode                       routes;
+    Handler                         defaultHandler;
+    QCache<QString, CachedResource> resourceCache;
 };
 
 #endif // WEBSERVER_H
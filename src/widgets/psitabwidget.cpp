@@ -260,14 +260,15 @@ void PsiTabWidget::removePage(QWidget *widget)
 }
 
 /**
- * Set the text of the tab.
+ * Set the text of the tab. \a note is added to its tooltip.
  */
-void PsiTabWidget::setTabText(QWidget *widget, const QString &label)
+void PsiTabWidget::setTabText(QWidget *widget, const QString &label, const QString &note)
 {
     int index = widgets_.indexOf(widget);
     if (index != -1) {
-        auto shortLabel = label;
-        auto labelSize  = label.size();
+        QStringList toolTip;
+        auto        shortLabel = label;
+        auto        labelSize  = label.size();
         if (labelSize > 40) {
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
             shortLabel = label.left(37) + "...";
@@ -288,11 +289,15 @@ void PsiTabWidget::setTabText(QWidget *widget, const QString &label)
                         break;
                     }
                 }
-                tabBar_->setTabToolTip(index, sentences.join("\n"));
+                toolTip << sentences;
             } else {
-                tabBar_->setTabToolTip(index, label);
+                toolTip << label;
             }
         }
+        if (!note.isEmpty()) {
+            toolTip << note;
+        }
+        tabBar_->setTabToolTip(index, toolTip.join("\n"));
         tabBar_->setTabText(index, shortLabel);
     }
 }
@@ -58,7 +58,7 @@ public:
 
     void     removePage(QWidget *);
     QWidget *page(int index);
-    void     setTabText(QWidget *, const QString &);
+    void     setTabText(QWidget *, const QString &, const QString &note = QString());
     void     setTabIcon(QWidget *, const QIcon &);
     void     setTabPosition(QTabWidget::TabPosition pos);
     void     setCloseIcon(const QIcon &);
@@ -34,6 +34,7 @@
 #include <QScrollBar>
 #include <QTextEdit>
 #include <QTextFrame>
+#include <QTimer>
 #include <QVBoxLayout>
 
 //----------------------------------------------------------------------------
@@ -46,8 +47,6 @@ XmlConsole::XmlConsole(PsiAccount *_pa) : QWidget()
     pa = _pa;
     pa->dialogRegister(this);
     connect(pa, SIGNAL(updatedAccount()), SLOT(updateCaption()));
-    connect(pa->client(), SIGNAL(xmlIncoming(const QString &)), SLOT(client_xmlIncoming(const QString &)));
-    connect(pa->client(), SIGNAL(xmlOutgoing(const QString &)), SLOT(client_xmlOutgoing(const QString &)));
     connect(pa->psi(), SIGNAL(accountCountChanged()), this, SLOT(updateCaption()));
     updateCaption();
 
@@ -65,6 +64,14 @@ XmlConsole::XmlConsole(PsiAccount *_pa) : QWidget()
     connect(ui_.pb_input, SIGNAL(clicked()), SLOT(insertXml()));
     connect(ui_.pb_close, SIGNAL(clicked()), SLOT(close()));
     connect(ui_.pb_dumpRingbuf, SIGNAL(clicked()), SLOT(dumpRingbuf()));
+    // the client serializes stanzas only while someone listens, so listen only when enabled
+    connect(ui_.ck_enable, SIGNAL(toggled(bool)), SLOT(setTracing(bool)));
+    setTracing(ui_.ck_enable->isChecked());
+
+    auto csiTimer = new QTimer(this);
+    connect(csiTimer, &QTimer::timeout, this, &XmlConsole::updateClientState);
+    csiTimer->start(5000);
+    updateClientState();
 
     resize(560, 400);
 }
@@ -87,8 +94,28 @@ void XmlConsole::updateCaption()
         setWindowTitle(tr("XML Console"));
 }
 
+void XmlConsole::updateClientState()
+{
+    QString report = pa->clientStateReport();
+    ui_.lb_csi->setText(report);
+    ui_.lb_csi->setVisible(!report.isEmpty());
+}
+
 void XmlConsole::enable() { ui_.ck_enable->setChecked(true); }
 
+void XmlConsole::setTracing(bool on)
+{
+    if (on) {
+        connect(pa->client(), &XMPP::Client::xmlIncoming, this, &XmlConsole::client_xmlIncoming,
+                Qt::UniqueConnection);
+        connect(pa->client(), &XMPP::Client::xmlOutgoing, this, &XmlConsole::client_xmlOutgoing,
+                Qt::UniqueConnection);
+    } else {
+        disconnect(pa->client(), &XMPP::Client::xmlIncoming, this, &XmlConsole::client_xmlIncoming);
+        disconnect(pa->client(), &XMPP::Client::xmlOutgoing, this, &XmlConsole::client_xmlOutgoing);
+    }
+}
+
 bool XmlConsole::filtered(const QString &str) const
 {
     if (ui_.ck_enable->isChecked()) {
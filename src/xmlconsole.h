@@ -41,8 +41,10 @@ public:
 private slots:
     void clear();
     void updateCaption();
+    void updateClientState();
     void insertXml();
     void dumpRingbuf();
+    void setTracing(bool);
     void client_xmlIncoming(const QString &);
     void client_xmlOutgoing(const QString &);
     void xml_textReady(const QString &);
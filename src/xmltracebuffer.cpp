@@ -0,0 +1,263 @@
+/*
+ * xmltracebuffer.cpp - ring buffer of raw XMPP stream data
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "xmltracebuffer.h"
+
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include <cstring>
+
+static const int    ChunkSlots  = 4096;
+static const qint64 MergeWindow = 100; // msecs. adjacent reads closer than this share a chunk
+
+/**
+ * \class XmlTraceBuffer
+ * \brief Keeps the most recent stream data of an account for the XML console
+ *
+ * append() only copies raw bytes into preallocated storage and remembers the
+ * direction and a monotonic timestamp. Nothing is parsed or formatted until
+ * records() is called.
+ */
+
+XmlTraceBuffer::XmlTraceBuffer(int capacity) { reset(capacity); }
+
+/**
+ * Drops all data and reallocates the storage for \a capacity bytes.
+ */
+void XmlTraceBuffer::reset(int capacity)
+{
+    data_ = QByteArray(capacity, Qt::Uninitialized);
+    chunks_.fill(Chunk(), ChunkSlots);
+    written_    = 0;
+    chunkHead_  = 0;
+    chunkCount_ = 0;
+    clock_.start();
+    epoch_ = QDateTime::currentDateTime();
+}
+
+void XmlTraceBuffer::append(bool incoming, const QByteArray &data)
+{
+    if (data.isEmpty() || data_.isEmpty()) {
+        return;
+    }
+
+    const qint64 capacity = data_.size();
+    const char  *src      = data.constData();
+    qint64       size     = data.size();
+    if (size > capacity) { // only the tail fits
+        written_ += quint64(size - capacity);
+        src += size - capacity;
+        size = capacity;
+    }
+
+    qint64 pos   = qint64(written_ % quint64(capacity));
+    qint64 first = qMin(size, capacity - pos);
+    std::memcpy(data_.data() + pos, src, size_t(first));
+    if (first < size) {
+        std::memcpy(data_.data(), src + first, size_t(size - first));
+    }
+
+    qint64 now = clock_.elapsed();
+    if (chunkCount_) {
+        Chunk &last = chunks_[(chunkHead_ + chunkCount_ - 1) % ChunkSlots];
+        if (last.incoming == incoming && last.start + quint64(last.size) == written_
+            && now - last.msecs < MergeWindow) {
+            last.size += size;
+            written_ += quint64(size);
+            return;
+        }
+    }
+    if (chunkCount_ == ChunkSlots) {
+        chunkHead_ = (chunkHead_ + 1) % ChunkSlots;
+        chunkCount_--;
+    }
+    chunks_[(chunkHead_ + chunkCount_) % ChunkSlots] = Chunk { written_, size, now, incoming };
+    chunkCount_++;
+    written_ += quint64(size);
+}
+
+namespace {
+struct Element {
+    qint64  offset; // in text, somewhere in the start tag
+    QString xml;
+};
+}
+
+// Number of UTF-16 code units the UTF-8 \a data decodes to. Counts correctly even when
+// the data starts or ends in the middle of a character, so pieces can be counted separately.
+static qint64 utf16Length(const char *data, qint64 size)
+{
+    qint64 ret = 0;
+    for (qint64 i = 0; i < size; i++) {
+        uchar c = uchar(data[i]);
+        if ((c & 0xC0) != 0x80)
+            ret += c >= 0xF0 ? 2 : 1; // four-byte sequences become surrogate pairs
+    }
+    return ret;
+}
+
+// Splits stream text into top-level elements and indents them.
+// The stream header is never closed in a trace, so it's reported as a separate record.
+static QList<Element> prettyElements(const QString &text)
+{
+    QList<Element>   ret;
+    QXmlStreamReader reader;
+    reader.setNamespaceProcessing(false);
+    reader.addData(QStringLiteral("<trace>"));
+    reader.addData(text);
+    reader.addData(QStringLiteral("</trace>"));
+
+    QString          current;
+    QXmlStreamWriter writer(&current);
+    writer.setAutoFormatting(true);
+    writer.setAutoFormattingIndent(1);
+    const qint64 wrapSize = qint64(sizeof("<trace>") - 1);
+    bool         wrapped  = false;
+    int          depth    = 0; // inside the top-level element
+    qint64       consumed = 0; // input characters already reported
+    qint64       offset   = 0; // of the current top-level element
+
+    auto const flush = [&]() {
+        ret.append(Element { offset, current.trimmed() });
+        current.clear();
+        consumed = reader.characterOffset() - wrapSize;
+    };
+
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartElement:
+            if (!wrapped) {
+                wrapped = true;
+                break;
+            }
+            if (!depth) {
+                offset = qMax(consumed, reader.characterOffset() - wrapSize - 1);
+            }
+            if (!depth && reader.qualifiedName() == QLatin1String("stream:stream")) {
+                QString header = QLatin1Char('<') + reader.qualifiedName().toString();
+                for (auto const &attr : reader.attributes()) {
+                    header += QString(QLatin1String(" %1=\"%2\"")).arg(attr.qualifiedName(), attr.value());
+                }
+                current = header + QLatin1Char('>');
+                flush();
+                break;
+            }
+            writer.writeStartElement(reader.qualifiedName().toString());
+            for (auto const &attr : reader.attributes()) {
+                writer.writeAttribute(attr.qualifiedName().toString(), attr.value().toString());
+            }
+            depth++;
+            break;
+        case QXmlStreamReader::EndElement:
+            if (!depth) {
+                if (reader.qualifiedName() == QLatin1String("stream:stream")) {
+                    current = QStringLiteral("</stream:stream>");
+                    offset  = qMax(consumed, reader.characterOffset() - wrapSize - 1);
+                    flush();
+                }
+                break;
+            }
+            writer.writeEndElement();
+            if (--depth == 0) {
+                flush();
+            }
+            break;
+        case QXmlStreamReader::Characters:
+            if (depth && !reader.isWhitespace()) {
+                if (reader.isCDATA())
+                    writer.writeCDATA(reader.text().toString());
+                else
+                    writer.writeCharacters(reader.text().toString());
+            }
+            break;
+        case QXmlStreamReader::Comment:
+            if (depth)
+                writer.writeComment(reader.text().toString());
+            break;
+        default:
+            break;
+        }
+    }
+
+    // the stream end, a half of a stanza or something we don't understand. show it as is
+    QString rest = text.mid(int(qBound(qint64(0), consumed, qint64(text.size())))).trimmed();
+    if (!rest.isEmpty() && !(reader.error() == QXmlStreamReader::NoError && depth == 0)) {
+        ret.append(Element { consumed, rest });
+    }
+    return ret;
+}
+
+/**
+ * Returns the buffered data as one record per top-level element, oldest first.
+ * Adjacent data in the same direction is joined before parsing, so elements split
+ * across network reads are shown whole. Each element gets the time of the chunk
+ * its start tag came in.
+ */
+QList<XmlTraceBuffer::Record> XmlTraceBuffer::records() const
+{
+    QList<Record>   ret;
+    const qint64    capacity = data_.size();
+    const quint64   oldest   = written_ > quint64(capacity) ? written_ - quint64(capacity) : 0;
+    QByteArray      group;
+    bool            groupIncoming = false;
+    QVector<qint64> chunkEnds; // in UTF-16 units of the group text
+    QVector<qint64> chunkMsecs;
+
+    auto const flushGroup = [&]() {
+        if (group.isEmpty())
+            return;
+        int n = 0; // the chunk the element came in
+        for (auto const &element : prettyElements(QString::fromUtf8(group))) {
+            while (n < chunkEnds.size() - 1 && chunkEnds[n] <= element.offset)
+                n++;
+            ret.append(Record { groupIncoming, epoch_.addMSecs(chunkMsecs[n]), element.xml });
+        }
+        group.clear();
+        chunkEnds.clear();
+        chunkMsecs.clear();
+    };
+
+    for (int i = 0; i < chunkCount_; i++) {
+        auto const &chunk = chunks_[(chunkHead_ + i) % ChunkSlots];
+        quint64     end   = chunk.start + quint64(chunk.size);
+        if (end <= oldest)
+            continue; // overwritten
+        quint64 start = qMax(chunk.start, oldest);
+
+        if (!group.isEmpty() && chunk.incoming != groupIncoming) {
+            flushGroup();
+        }
+        if (group.isEmpty()) {
+            groupIncoming = chunk.incoming;
+        }
+        qint64 pos  = qint64(start % quint64(capacity));
+        qint64 size = qint64(end - start);
+        qint64 part = qMin(size, capacity - pos);
+        qint64 from = group.size();
+        group.append(data_.constData() + pos, int(part));
+        if (part < size) {
+            group.append(data_.constData(), int(size - part));
+        }
+        chunkEnds.append((chunkEnds.isEmpty() ? 0 : chunkEnds.last()) + utf16Length(group.constData() + from, size));
+        chunkMsecs.append(chunk.msecs);
+    }
+    flushGroup();
+    return ret;
+}
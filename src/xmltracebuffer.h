@@ -0,0 +1,60 @@
+/*
+ * xmltracebuffer.h - ring buffer of raw XMPP stream data
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef XMLTRACEBUFFER_H
+#define XMLTRACEBUFFER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVector>
+
+class XmlTraceBuffer {
+public:
+    struct Record {
+        bool      incoming;
+        QDateTime time;
+        QString   xml;
+    };
+
+    explicit XmlTraceBuffer(int capacity);
+
+    void          append(bool incoming, const QByteArray &data);
+    QList<Record> records() const;
+    void          reset(int capacity);
+
+private:
+    struct Chunk {
+        quint64 start; // absolute stream position
+        qint64  size;
+        qint64  msecs; // since epoch_
+        bool    incoming;
+    };
+
+    QByteArray     data_;
+    quint64        written_ = 0;
+    QVector<Chunk> chunks_;
+    int            chunkHead_  = 0;
+    int            chunkCount_ = 0;
+    QElapsedTimer  clock_;
+    QDateTime      epoch_;
+};
+
+#endif // XMLTRACEBUFFER_H